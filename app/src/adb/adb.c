@@ -6,6 +6,7 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "adb/adb_client.h"
 #include "adb/adb_device.h"
 #include "adb/adb_parser.h"
 #include "util/env.h"
@@ -28,8 +29,14 @@
 
 static char *adb_executable;
 
+// Send the requests directly to the adb server when possible, rather than
+// executing the adb executable for each command
+static bool adb_native;
+
 bool
 sc_adb_init(void) {
+    adb_native = sc_adb_client_init();
+
     adb_executable = sc_get_env("ADB");
     if (adb_executable) {
         LOGD("Using adb: %s", adb_executable);
@@ -231,6 +238,11 @@ sc_adb_execute(const char *const argv[], unsigned flags) {
 
 bool
 sc_adb_start_server(struct sc_intr *intr, unsigned flags) {
+    if (adb_native && sc_adb_client_ping(intr) == SC_ADB_CLIENT_OK) {
+        // Already started
+        return true;
+    }
+
     const char *const argv[] = SC_ADB_COMMAND("start-server");
 
     sc_pid pid = sc_adb_execute(argv, flags);
@@ -262,6 +274,15 @@ sc_adb_forward(struct sc_intr *intr, const char *serial, uint16_t local_port,
     }
 
     assert(serial);
+
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_forward(intr, serial, local, remote, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", local, remote);
 
@@ -278,6 +299,15 @@ sc_adb_forward_remove(struct sc_intr *intr, const char *serial,
     (void) r;
 
     assert(serial);
+
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_forward_remove(intr, serial, local, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", "--remove", local);
 
@@ -302,6 +332,15 @@ sc_adb_reverse(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_reverse(intr, serial, remote, local, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", remote, local);
 
@@ -321,6 +360,15 @@ sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_reverse_remove(intr, serial, remote, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", "--remove", remote);
 
@@ -332,6 +380,15 @@ bool
 sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
             const char *remote, unsigned flags) {
     assert(serial);
+
+    if (adb_native) {
+        enum sc_adb_client_result res =
+            sc_adb_client_push(intr, serial, local, remote, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            return res == SC_ADB_CLIENT_OK;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "push", local, remote);
 
@@ -340,6 +397,26 @@ sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
     return process_check_success_intr(intr, pid, "adb push", flags);
 }
 
+bool
+sc_adb_get_file_size(struct sc_intr *intr, const char *serial,
+                     const char *path, uint32_t *out_size) {
+    assert(serial);
+
+    if (!adb_native) {
+        return false;
+    }
+
+    uint32_t mode;
+    enum sc_adb_client_result res =
+        sc_adb_client_stat(intr, serial, path, &mode, out_size, SC_ADB_SILENT);
+    if (res != SC_ADB_CLIENT_OK) {
+        return false;
+    }
+
+    // S_IFREG
+    return (mode & 0170000) == 0100000;
+}
+
 bool
 sc_adb_install(struct sc_intr *intr, const char *serial, const char *local,
                unsigned flags) {
@@ -419,7 +496,7 @@ sc_adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags) {
     return process_check_success_intr(intr, pid, "adb disconnect", flags);
 }
 
-static bool
+bool
 sc_adb_list_devices(struct sc_intr *intr, unsigned flags,
                     struct sc_vec_adb_devices *out_vec) {
     const char *const argv[] = SC_ADB_COMMAND("devices", "-l");
@@ -431,6 +508,25 @@ sc_adb_list_devices(struct sc_intr *intr, unsigned flags,
         return false;
     }
 
+    if (adb_native) {
+        // The adb server does not send the header printed by "adb devices",
+        // which is expected by the parser
+#define HEADER "List of devices attached\n"
+#define HEADER_LEN (sizeof(HEADER) - 1)
+        memcpy(buf, HEADER, HEADER_LEN);
+        enum sc_adb_client_result res =
+            sc_adb_client_list_devices(intr, buf + HEADER_LEN,
+                                       BUFSIZE - HEADER_LEN, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            bool ok = res == SC_ADB_CLIENT_OK
+                   && sc_adb_parse_devices(buf, out_vec);
+            free(buf);
+            return ok;
+        }
+#undef HEADER
+#undef HEADER_LEN
+    }
+
     sc_pipe pout;
     sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
     if (pid == SC_PROCESS_NONE) {
@@ -668,6 +764,32 @@ char *
 sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
                unsigned flags) {
     assert(serial);
+
+    char buf[128];
+
+    if (adb_native) {
+        char command[128];
+        int r = snprintf(command, sizeof(command), "getprop %s", prop);
+        assert(r >= 0 && (size_t) r < sizeof(command));
+        (void) r;
+
+        size_t len;
+        enum sc_adb_client_result res =
+            sc_adb_client_shell(intr, serial, command, buf, sizeof(buf) - 1,
+                                &len, flags);
+        if (res != SC_ADB_CLIENT_UNSUPPORTED) {
+            if (res != SC_ADB_CLIENT_OK) {
+                return NULL;
+            }
+
+            buf[len] = '\0';
+            len = strcspn(buf, " \r\n");
+            buf[len] = '\0';
+
+            return strdup(buf);
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "shell", "getprop", prop);
 
@@ -678,7 +800,6 @@ sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
         return NULL;
     }
 
-    char buf[128];
     ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
     sc_pipe_close(pout);
 
@@ -702,28 +823,44 @@ sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
 char *
 sc_adb_get_device_ip(struct sc_intr *intr, const char *serial, unsigned flags) {
     assert(serial);
-    const char *const argv[] =
-        SC_ADB_COMMAND("-s", serial, "shell", "ip", "route");
-
-    sc_pipe pout;
-    sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
-    if (pid == SC_PROCESS_NONE) {
-        LOGD("Could not execute \"ip route\"");
-        return NULL;
-    }
 
     // "adb shell ip route" output should contain only a few lines
     char buf[1024];
-    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
-    sc_pipe_close(pout);
-
-    bool ok = process_check_success_intr(intr, pid, "ip route", flags);
-    if (!ok) {
-        return NULL;
+    ssize_t r;
+
+    enum sc_adb_client_result res = SC_ADB_CLIENT_UNSUPPORTED;
+    if (adb_native) {
+        size_t len;
+        res = sc_adb_client_shell(intr, serial, "ip route", buf,
+                                  sizeof(buf) - 1, &len, flags);
+        if (res == SC_ADB_CLIENT_ERROR) {
+            return NULL;
+        }
+        r = len;
     }
 
-    if (r == -1) {
-        return NULL;
+    if (res == SC_ADB_CLIENT_UNSUPPORTED) {
+        const char *const argv[] =
+            SC_ADB_COMMAND("-s", serial, "shell", "ip", "route");
+
+        sc_pipe pout;
+        sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
+        if (pid == SC_PROCESS_NONE) {
+            LOGD("Could not execute \"ip route\"");
+            return NULL;
+        }
+
+        r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
+        sc_pipe_close(pout);
+
+        bool ok = process_check_success_intr(intr, pid, "ip route", flags);
+        if (!ok) {
+            return NULL;
+        }
+
+        if (r == -1) {
+            return NULL;
+        }
     }
 
     assert((size_t) r < sizeof(buf));
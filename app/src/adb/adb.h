@@ -66,6 +66,16 @@ bool
 sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
             const char *remote, unsigned flags);
 
+/**
+ * Retrieve the size of a regular file on the device
+ *
+ * Return false if the file does not exist or if it could not be checked (the
+ * check requires to reach the adb server directly, it never executes adb).
+ */
+bool
+sc_adb_get_file_size(struct sc_intr *intr, const char *serial,
+                     const char *path, uint32_t *out_size);
+
 bool
 sc_adb_install(struct sc_intr *intr, const char *serial, const char *local,
                unsigned flags);
@@ -94,6 +104,13 @@ sc_adb_connect(struct sc_intr *intr, const char *ip_port, unsigned flags);
 bool
 sc_adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags);
 
+/**
+ * Execute `adb devices` and parse the result
+ */
+bool
+sc_adb_list_devices(struct sc_intr *intr, unsigned flags,
+                    struct sc_vec_adb_devices *out_vec);
+
 /**
  * Execute `adb devices` and parse the result to select a device
  *
@@ -0,0 +1,664 @@
+#include "adb_client.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb/adb.h"
+#include "util/binary.h"
+#include "util/env.h"
+#include "util/file.h"
+#include "util/log.h"
+#include "util/net_intr.h"
+#include "util/str.h"
+
+// Maximum length of a request (the adb server rejects longer requests)
+#define SC_ADB_CLIENT_MAX_REQUEST_LEN 1024
+
+// Maximum size of a DATA chunk in the sync protocol
+#define SC_ADB_SYNC_MAX_CHUNK (64 * 1024)
+
+// File mode for pushed files (S_IFREG | 0644)
+#define SC_ADB_SYNC_FILE_MODE 0100644
+#define SC_ADB_SYNC_MODE_TYPE_MASK 0170000
+#define SC_ADB_SYNC_MODE_DIR 0040000
+
+static uint16_t adb_server_port = SC_ADB_SERVER_DEFAULT_PORT;
+
+bool
+sc_adb_client_init(void) {
+    char *server_socket = sc_get_env("ADB_SERVER_SOCKET");
+    if (server_socket) {
+        // The adb server is not necessarily local, let adb handle it
+        LOGD("ADB_SERVER_SOCKET is set, the adb server will not be "
+             "contacted directly");
+        free(server_socket);
+        return false;
+    }
+
+    adb_server_port = SC_ADB_SERVER_DEFAULT_PORT;
+
+    char *port = sc_get_env("ANDROID_ADB_SERVER_PORT");
+    if (port) {
+        long value;
+        bool ok = sc_str_parse_integer(port, &value);
+        free(port);
+        if (!ok || value <= 0 || value > 0xFFFF) {
+            LOGW("Invalid ANDROID_ADB_SERVER_PORT, the adb server will not be "
+                 "contacted directly");
+            return false;
+        }
+        adb_server_port = value;
+    }
+
+    return true;
+}
+
+// The interruptor is optional in adb functions
+static ssize_t
+sc_adb_client_recv_all(struct sc_intr *intr, sc_socket socket, void *buf,
+                       size_t len) {
+    return intr ? net_recv_all_intr(intr, socket, buf, len)
+                : net_recv_all(socket, buf, len);
+}
+
+static ssize_t
+sc_adb_client_recv(struct sc_intr *intr, sc_socket socket, void *buf,
+                   size_t len) {
+    return intr ? net_recv_intr(intr, socket, buf, len)
+                : net_recv(socket, buf, len);
+}
+
+static bool
+sc_adb_client_send_all(struct sc_intr *intr, sc_socket socket,
+                       const void *buf, size_t len) {
+    ssize_t w = intr ? net_send_all_intr(intr, socket, buf, len)
+                     : net_send_all(socket, buf, len);
+    return w == (ssize_t) len;
+}
+
+static enum sc_adb_client_result
+sc_adb_client_io_error(struct sc_intr *intr) {
+    // If interrupted, do not fall back to the adb executable
+    if (intr && sc_intr_is_interrupted(intr)) {
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    LOGD("adb server: unexpected end of stream");
+    return SC_ADB_CLIENT_UNSUPPORTED;
+}
+
+static sc_socket
+sc_adb_client_connect(struct sc_intr *intr) {
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return SC_SOCKET_NONE;
+    }
+
+    bool ok = intr ? net_connect_intr(intr, socket, IPV4_LOCALHOST,
+                                      adb_server_port)
+                   : net_connect(socket, IPV4_LOCALHOST, adb_server_port);
+    if (!ok) {
+        net_close(socket);
+        return SC_SOCKET_NONE;
+    }
+
+    return socket;
+}
+
+// Read a length-prefixed string ("%04x" followed by the content)
+//
+// The result is truncated to fit in buf (including the terminating NUL).
+static enum sc_adb_client_result
+sc_adb_client_read_string(struct sc_intr *intr, sc_socket socket, char *buf,
+                          size_t len, size_t *out_len) {
+    assert(len);
+
+    char hex[5];
+    ssize_t r = sc_adb_client_recv_all(intr, socket, hex, 4);
+    if (r != 4) {
+        return sc_adb_client_io_error(intr);
+    }
+    hex[4] = '\0';
+
+    char *endptr;
+    unsigned long size = strtoul(hex, &endptr, 16);
+    if (*endptr != '\0') {
+        LOGD("adb server: invalid length \"%s\"", hex);
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    size_t to_keep = MIN(size, len - 1);
+    r = sc_adb_client_recv_all(intr, socket, buf, to_keep);
+    if (r != (ssize_t) to_keep) {
+        return sc_adb_client_io_error(intr);
+    }
+    buf[to_keep] = '\0';
+
+    // Discard the remaining content, if any
+    size_t remaining = size - to_keep;
+    while (remaining) {
+        char discard[256];
+        size_t n = MIN(remaining, sizeof(discard));
+        r = sc_adb_client_recv_all(intr, socket, discard, n);
+        if (r != (ssize_t) n) {
+            return sc_adb_client_io_error(intr);
+        }
+        remaining -= n;
+    }
+
+    if (out_len) {
+        *out_len = to_keep;
+    }
+
+    return SC_ADB_CLIENT_OK;
+}
+
+static void
+sc_adb_client_report_failure(const char *service, const char *msg,
+                             unsigned flags) {
+    if (!(flags & SC_ADB_NO_STDERR)) {
+        // Same output as the adb executable
+        fprintf(stderr, "adb: error: %s\n", msg);
+    }
+    if (!(flags & SC_ADB_NO_LOGERR)) {
+        LOGE("adb server request \"%s\" failed", service);
+    }
+}
+
+// Read a status ("OKAY" or "FAIL" followed by a length-prefixed message)
+static enum sc_adb_client_result
+sc_adb_client_read_status(struct sc_intr *intr, sc_socket socket,
+                          const char *service, unsigned flags) {
+    char status[4];
+    ssize_t r = sc_adb_client_recv_all(intr, socket, status, 4);
+    if (r != 4) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    if (!memcmp(status, "OKAY", 4)) {
+        return SC_ADB_CLIENT_OK;
+    }
+
+    if (memcmp(status, "FAIL", 4)) {
+        LOGD("adb server: unexpected status \"%.4s\"", status);
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    char msg[256];
+    enum sc_adb_client_result res =
+        sc_adb_client_read_string(intr, socket, msg, sizeof(msg), NULL);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    sc_adb_client_report_failure(service, msg, flags);
+    return SC_ADB_CLIENT_ERROR;
+}
+
+// Send a request and read its status
+static enum sc_adb_client_result
+sc_adb_client_request(struct sc_intr *intr, sc_socket socket,
+                      const char *service, unsigned flags) {
+    size_t len = strlen(service);
+    if (len > SC_ADB_CLIENT_MAX_REQUEST_LEN) {
+        LOGD("adb server: request too long");
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    char buf[4 + SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(buf, sizeof(buf), "%04x%s", (unsigned) len, service);
+    assert(r >= 0 && (size_t) r == 4 + len);
+    (void) r;
+
+    if (!sc_adb_client_send_all(intr, socket, buf, 4 + len)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    return sc_adb_client_read_status(intr, socket, service, flags);
+}
+
+// Connect to the adb server, and switch the connection to the device
+// transport, so that the next request is sent to the device
+static enum sc_adb_client_result
+sc_adb_client_open_transport(struct sc_intr *intr, const char *serial,
+                             unsigned flags, sc_socket *out_socket) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "host:transport:%s", serial);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    sc_socket socket = sc_adb_client_connect(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    enum sc_adb_client_result res =
+        sc_adb_client_request(intr, socket, service, flags);
+    if (res != SC_ADB_CLIENT_OK) {
+        net_close(socket);
+        return res;
+    }
+
+    *out_socket = socket;
+    return SC_ADB_CLIENT_OK;
+}
+
+// Execute a request expecting a second status once the command is executed
+// (the first status only indicates that the request has been accepted)
+static enum sc_adb_client_result
+sc_adb_client_command(struct sc_intr *intr, const char *serial,
+                      bool on_device, const char *service, unsigned flags) {
+    sc_socket socket;
+    enum sc_adb_client_result res;
+    if (on_device) {
+        res = sc_adb_client_open_transport(intr, serial, flags, &socket);
+        if (res != SC_ADB_CLIENT_OK) {
+            return res;
+        }
+    } else {
+        socket = sc_adb_client_connect(intr);
+        if (socket == SC_SOCKET_NONE) {
+            return SC_ADB_CLIENT_UNSUPPORTED;
+        }
+    }
+
+    res = sc_adb_client_request(intr, socket, service, flags);
+    if (res == SC_ADB_CLIENT_OK) {
+        res = sc_adb_client_read_status(intr, socket, service, flags);
+    }
+
+    net_close(socket);
+    return res;
+}
+
+enum sc_adb_client_result
+sc_adb_client_ping(struct sc_intr *intr) {
+    sc_socket socket = sc_adb_client_connect(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    enum sc_adb_client_result res =
+        sc_adb_client_request(intr, socket, "host:version", SC_ADB_SILENT);
+    if (res == SC_ADB_CLIENT_OK) {
+        char version[16];
+        res = sc_adb_client_read_string(intr, socket, version,
+                                        sizeof(version), NULL);
+        if (res == SC_ADB_CLIENT_OK) {
+            LOGD("adb server version: %s", version);
+        }
+    }
+
+    net_close(socket);
+    return res;
+}
+
+enum sc_adb_client_result
+sc_adb_client_list_devices(struct sc_intr *intr, char *buf, size_t len,
+                           unsigned flags) {
+    sc_socket socket = sc_adb_client_connect(intr);
+    if (socket == SC_SOCKET_NONE) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    const char *service = "host:devices-l";
+    enum sc_adb_client_result res =
+        sc_adb_client_request(intr, socket, service, flags);
+    if (res == SC_ADB_CLIENT_OK) {
+        size_t r;
+        res = sc_adb_client_read_string(intr, socket, buf, len, &r);
+        if (res == SC_ADB_CLIENT_OK && r == len - 1) {
+            LOGD("adb server: device list truncated");
+            res = SC_ADB_CLIENT_UNSUPPORTED;
+        }
+    }
+
+    net_close(socket);
+    return res;
+}
+
+enum sc_adb_client_result
+sc_adb_client_forward(struct sc_intr *intr, const char *serial,
+                      const char *local, const char *remote, unsigned flags) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "host-serial:%s:forward:%s;%s",
+                     serial, local, remote);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    return sc_adb_client_command(intr, serial, false, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_forward_remove(struct sc_intr *intr, const char *serial,
+                             const char *local, unsigned flags) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "host-serial:%s:killforward:%s",
+                     serial, local);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    return sc_adb_client_command(intr, serial, false, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_reverse(struct sc_intr *intr, const char *serial,
+                      const char *remote, const char *local, unsigned flags) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "reverse:forward:%s;%s",
+                     remote, local);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    return sc_adb_client_command(intr, serial, true, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_reverse_remove(struct sc_intr *intr, const char *serial,
+                             const char *remote, unsigned flags) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "reverse:killforward:%s",
+                     remote);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    return sc_adb_client_command(intr, serial, true, service, flags);
+}
+
+enum sc_adb_client_result
+sc_adb_client_shell(struct sc_intr *intr, const char *serial,
+                    const char *command, char *buf, size_t len,
+                    size_t *out_len, unsigned flags) {
+    char service[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(service, sizeof(service), "shell:%s", command);
+    if (r < 0 || (size_t) r >= sizeof(service)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        sc_adb_client_open_transport(intr, serial, flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    res = sc_adb_client_request(intr, socket, service, flags);
+    if (res != SC_ADB_CLIENT_OK) {
+        net_close(socket);
+        return res;
+    }
+
+    // The raw output is streamed until the command terminates
+    size_t total = 0;
+    for (;;) {
+        char discard[256];
+        bool full = total == len;
+        char *ptr = full ? discard : buf + total;
+        size_t n = full ? sizeof(discard) : len - total;
+        ssize_t rr = sc_adb_client_recv(intr, socket, ptr, n);
+        if (rr <= 0) {
+            if (intr && sc_intr_is_interrupted(intr)) {
+                net_close(socket);
+                return SC_ADB_CLIENT_ERROR;
+            }
+            break;
+        }
+        if (!full) {
+            total += rr;
+        }
+    }
+
+    net_close(socket);
+
+    *out_len = total;
+    return SC_ADB_CLIENT_OK;
+}
+
+static bool
+sc_adb_sync_send_header(struct sc_intr *intr, sc_socket socket,
+                        const char *id, uint32_t value) {
+    uint8_t header[8];
+    memcpy(header, id, 4);
+    sc_write32le(&header[4], value);
+    return sc_adb_client_send_all(intr, socket, header, sizeof(header));
+}
+
+// Read a sync response header (4-byte id and 32-bit little-endian value)
+static enum sc_adb_client_result
+sc_adb_sync_read_header(struct sc_intr *intr, sc_socket socket, char *id,
+                        uint32_t *value) {
+    uint8_t header[8];
+    ssize_t r = sc_adb_client_recv_all(intr, socket, header, sizeof(header));
+    if (r != sizeof(header)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    memcpy(id, header, 4);
+    *value = sc_read32le(&header[4]);
+    return SC_ADB_CLIENT_OK;
+}
+
+// Retrieve the mode (0 if it does not exist) and the size of the remote path
+static enum sc_adb_client_result
+sc_adb_sync_stat(struct sc_intr *intr, sc_socket socket, const char *path,
+                 uint32_t *out_mode, uint32_t *out_size) {
+    size_t len = strlen(path);
+    if (!sc_adb_sync_send_header(intr, socket, "STAT", len)
+            || !sc_adb_client_send_all(intr, socket, path, len)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    // "STAT" followed by mode, size and mtime
+    uint8_t reply[16];
+    ssize_t r = sc_adb_client_recv_all(intr, socket, reply, sizeof(reply));
+    if (r != sizeof(reply)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    if (memcmp(reply, "STAT", 4)) {
+        LOGD("adb server: unexpected sync response \"%.4s\"", reply);
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    *out_mode = sc_read32le(&reply[4]);
+    *out_size = sc_read32le(&reply[8]);
+    return SC_ADB_CLIENT_OK;
+}
+
+// Return the full remote path of the pushed file (to be freed by the caller)
+static char *
+sc_adb_sync_target_path(const char *local, const char *remote,
+                        bool remote_is_dir) {
+    size_t remote_len = strlen(remote);
+    bool trailing_slash = remote_len && remote[remote_len - 1] == '/';
+    if (!remote_is_dir && !trailing_slash) {
+        return strdup(remote);
+    }
+
+    const char *basename = strrchr(local, SC_PATH_SEPARATOR);
+#ifdef _WIN32
+    // Both separators are accepted on Windows
+    const char *slash = strrchr(local, '/');
+    if (slash > basename) {
+        basename = slash;
+    }
+#endif
+    basename = basename ? basename + 1 : local;
+
+    size_t len = remote_len + 1 + strlen(basename) + 1;
+    char *path = malloc(len);
+    if (!path) {
+        return NULL;
+    }
+
+    const char *sep = trailing_slash ? "" : "/";
+    int r = snprintf(path, len, "%s%s%s", remote, sep, basename);
+    assert(r >= 0 && (size_t) r < len);
+    (void) r;
+
+    return path;
+}
+
+static enum sc_adb_client_result
+sc_adb_sync_send_file(struct sc_intr *intr, sc_socket socket, FILE *file,
+                      const char *target, unsigned flags) {
+    char spec[SC_ADB_CLIENT_MAX_REQUEST_LEN + 1];
+    int r = snprintf(spec, sizeof(spec), "%s,%" PRIu32, target,
+                     (uint32_t) SC_ADB_SYNC_FILE_MODE);
+    if (r < 0 || (size_t) r >= sizeof(spec)) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    if (!sc_adb_sync_send_header(intr, socket, "SEND", r)
+            || !sc_adb_client_send_all(intr, socket, spec, r)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    uint8_t *chunk = malloc(8 + SC_ADB_SYNC_MAX_CHUNK);
+    if (!chunk) {
+        LOG_OOM();
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    for (;;) {
+        size_t n = fread(&chunk[8], 1, SC_ADB_SYNC_MAX_CHUNK, file);
+        if (!n) {
+            break;
+        }
+
+        // Send the header and the data in a single call
+        memcpy(chunk, "DATA", 4);
+        sc_write32le(&chunk[4], n);
+        if (!sc_adb_client_send_all(intr, socket, chunk, 8 + n)) {
+            free(chunk);
+            return sc_adb_client_io_error(intr);
+        }
+    }
+
+    bool read_error = ferror(file);
+    free(chunk);
+
+    if (read_error) {
+        LOGE("Could not read local file");
+        return SC_ADB_CLIENT_ERROR;
+    }
+
+    uint32_t mtime = time(NULL);
+    if (!sc_adb_sync_send_header(intr, socket, "DONE", mtime)) {
+        return sc_adb_client_io_error(intr);
+    }
+
+    char id[4];
+    uint32_t value;
+    enum sc_adb_client_result res =
+        sc_adb_sync_read_header(intr, socket, id, &value);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    if (!memcmp(id, "OKAY", 4)) {
+        return SC_ADB_CLIENT_OK;
+    }
+
+    if (memcmp(id, "FAIL", 4) || value > 1024) {
+        LOGD("adb server: unexpected sync response \"%.4s\"", id);
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    char msg[1024 + 1];
+    ssize_t rr = sc_adb_client_recv_all(intr, socket, msg, value);
+    if (rr != (ssize_t) value) {
+        return sc_adb_client_io_error(intr);
+    }
+    msg[value] = '\0';
+
+    sc_adb_client_report_failure("sync:", msg, flags);
+    return SC_ADB_CLIENT_ERROR;
+}
+
+enum sc_adb_client_result
+sc_adb_client_push(struct sc_intr *intr, const char *serial, const char *local,
+                   const char *remote, unsigned flags) {
+    if (!sc_file_is_regular(local)) {
+        // Let adb handle directories and errors
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    FILE *file = sc_file_open_read(local);
+    if (!file) {
+        return SC_ADB_CLIENT_UNSUPPORTED;
+    }
+
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        sc_adb_client_open_transport(intr, serial, flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        fclose(file);
+        return res;
+    }
+
+    res = sc_adb_client_request(intr, socket, "sync:", flags);
+    if (res != SC_ADB_CLIENT_OK) {
+        goto end;
+    }
+
+    uint32_t mode;
+    uint32_t size;
+    res = sc_adb_sync_stat(intr, socket, remote, &mode, &size);
+    if (res != SC_ADB_CLIENT_OK) {
+        goto end;
+    }
+
+    bool remote_is_dir =
+        (mode & SC_ADB_SYNC_MODE_TYPE_MASK) == SC_ADB_SYNC_MODE_DIR;
+    char *target = sc_adb_sync_target_path(local, remote, remote_is_dir);
+    if (!target) {
+        LOG_OOM();
+        res = SC_ADB_CLIENT_ERROR;
+        goto end;
+    }
+
+    res = sc_adb_sync_send_file(intr, socket, file, target, flags);
+    free(target);
+
+    if (res == SC_ADB_CLIENT_OK) {
+        // Best effort, the file has been pushed anyway
+        sc_adb_sync_send_header(intr, socket, "QUIT", 0);
+    }
+
+end:
+    net_close(socket);
+    fclose(file);
+    return res;
+}
+
+enum sc_adb_client_result
+sc_adb_client_stat(struct sc_intr *intr, const char *serial, const char *path,
+                   uint32_t *out_mode, uint32_t *out_size, unsigned flags) {
+    sc_socket socket;
+    enum sc_adb_client_result res =
+        sc_adb_client_open_transport(intr, serial, flags, &socket);
+    if (res != SC_ADB_CLIENT_OK) {
+        return res;
+    }
+
+    res = sc_adb_client_request(intr, socket, "sync:", flags);
+    if (res == SC_ADB_CLIENT_OK) {
+        res = sc_adb_sync_stat(intr, socket, path, out_mode, out_size);
+        if (res == SC_ADB_CLIENT_OK) {
+            sc_adb_sync_send_header(intr, socket, "QUIT", 0);
+        }
+    }
+
+    net_close(socket);
+    return res;
+}
@@ -0,0 +1,117 @@
+#ifndef SC_ADB_CLIENT_H
+#define SC_ADB_CLIENT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "util/intr.h"
+
+// Client for the protocol spoken by the adb executable to the adb server
+// (on localhost:5037), to avoid executing a new adb process for each command.
+//
+// Refs:
+//  - <https://android.googlesource.com/platform/packages/modules/adb/+/refs/heads/main/docs/dev/services.md>
+//  - <https://android.googlesource.com/platform/packages/modules/adb/+/refs/heads/main/docs/dev/sync.md>
+
+#define SC_ADB_SERVER_DEFAULT_PORT 5037
+
+enum sc_adb_client_result {
+    SC_ADB_CLIENT_OK,
+    // The request failed (the adb server replied with an error, or the call
+    // was interrupted)
+    SC_ADB_CLIENT_ERROR,
+    // The request could not be handled by the client (the adb server is not
+    // reachable, or it does not behave as expected): the caller should
+    // execute the adb command instead
+    SC_ADB_CLIENT_UNSUPPORTED,
+};
+
+/**
+ * Initialize the client from the environment
+ *
+ * Return false if the adb server may not be reached directly (for example if
+ * ADB_SERVER_SOCKET is set).
+ */
+bool
+sc_adb_client_init(void);
+
+/**
+ * Request "host:version", to check that the adb server is running
+ */
+enum sc_adb_client_result
+sc_adb_client_ping(struct sc_intr *intr);
+
+/**
+ * Request "host:devices-l"
+ *
+ * On success, the result (in the same format as the output of
+ * `adb devices -l`, without header) is written to buf as a NUL-terminated
+ * string.
+ */
+enum sc_adb_client_result
+sc_adb_client_list_devices(struct sc_intr *intr, char *buf, size_t len,
+                           unsigned flags);
+
+/**
+ * Request "host-serial:<serial>:forward:<local>;<remote>"
+ */
+enum sc_adb_client_result
+sc_adb_client_forward(struct sc_intr *intr, const char *serial,
+                      const char *local, const char *remote, unsigned flags);
+
+/**
+ * Request "host-serial:<serial>:killforward:<local>"
+ */
+enum sc_adb_client_result
+sc_adb_client_forward_remove(struct sc_intr *intr, const char *serial,
+                             const char *local, unsigned flags);
+
+/**
+ * Request "reverse:forward:<remote>;<local>" on the device transport
+ */
+enum sc_adb_client_result
+sc_adb_client_reverse(struct sc_intr *intr, const char *serial,
+                      const char *remote, const char *local, unsigned flags);
+
+/**
+ * Request "reverse:killforward:<remote>" on the device transport
+ */
+enum sc_adb_client_result
+sc_adb_client_reverse_remove(struct sc_intr *intr, const char *serial,
+                             const char *remote, unsigned flags);
+
+/**
+ * Push a local file to the device using the "sync:" service
+ *
+ * The remote path must be the full path of the target file (not a directory).
+ */
+enum sc_adb_client_result
+sc_adb_client_push(struct sc_intr *intr, const char *serial, const char *local,
+                   const char *remote, unsigned flags);
+
+/**
+ * Retrieve the mode and the size of a file on the device using the "sync:"
+ * service
+ *
+ * If the file does not exist, the mode is 0.
+ */
+enum sc_adb_client_result
+sc_adb_client_stat(struct sc_intr *intr, const char *serial, const char *path,
+                   uint32_t *out_mode, uint32_t *out_size, unsigned flags);
+
+/**
+ * Execute a shell command on the device using the "shell:" service
+ *
+ * At most len bytes of its output are written to buf, and their number is
+ * written to out_len. The output beyond len bytes is discarded.
+ */
+enum sc_adb_client_result
+sc_adb_client_shell(struct sc_intr *intr, const char *serial,
+                    const char *command, char *buf, size_t len,
+                    size_t *out_len, unsigned flags);
+
+#endif
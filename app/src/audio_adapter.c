@@ -0,0 +1,49 @@
+#include "audio_adapter.h"
+
+void
+sc_audio_adapter_init(struct sc_audio_adapter *adapter, uint32_t sample_rate,
+                      uint32_t target) {
+    adapter->min_target = SC_AUDIO_ADAPTER_MIN_TARGET_MS * sample_rate / 1000;
+    adapter->max_target = SC_AUDIO_ADAPTER_MAX_TARGET_MS * sample_rate / 1000;
+    adapter->target = CLAMP(target, adapter->min_target, adapter->max_target);
+    adapter->min_buffering = UINT32_MAX;
+    adapter->stable_periods = 0;
+}
+
+void
+sc_audio_adapter_observe(struct sc_audio_adapter *adapter, uint32_t buffering) {
+    adapter->min_buffering = MIN(adapter->min_buffering, buffering);
+}
+
+void
+sc_audio_adapter_reset(struct sc_audio_adapter *adapter) {
+    adapter->min_buffering = UINT32_MAX;
+    adapter->stable_periods = 0;
+}
+
+uint32_t
+sc_audio_adapter_update(struct sc_audio_adapter *adapter, uint32_t underflow) {
+    uint32_t target = adapter->target;
+    uint32_t new_target = target;
+
+    if (underflow) {
+        // Raise immediately, by at least the missing samples (within 10%-50%
+        // of the current target)
+        new_target += CLAMP(underflow, target / 10, target / 2);
+        sc_audio_adapter_reset(adapter);
+    } else if (++adapter->stable_periods >= SC_AUDIO_ADAPTER_STABLE_PERIODS) {
+        // The buffering level went down to min_buffering at worst, so the
+        // jitter absorbed by the buffer did not exceed (target - min).
+        // Keep a 50% margin, and lower by at most 10% at a time.
+        uint32_t jitter = target - MIN(target, adapter->min_buffering);
+        uint32_t wanted = jitter + jitter / 2;
+        if (wanted < target) {
+            new_target = MAX(wanted, target - target / 10);
+        }
+        sc_audio_adapter_reset(adapter);
+    }
+
+    adapter->target = CLAMP(new_target, adapter->min_target,
+                            adapter->max_target);
+    return adapter->target;
+}
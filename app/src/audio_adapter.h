@@ -0,0 +1,66 @@
+#ifndef SC_AUDIO_ADAPTER_H
+#define SC_AUDIO_ADAPTER_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+/**
+ * Adaptive target buffering of the audio regulator (--audio-buffer=auto).
+ *
+ * The target is raised as soon as underflow occurs, and lowered progressively
+ * when the buffering level has stayed far enough above zero for several
+ * periods (i.e. when the jitter is lower than what the target allows to
+ * absorb). It always remains within [min_target, max_target].
+ *
+ * All the values are in samples.
+ */
+
+// Bounds of the adaptive target buffering
+#define SC_AUDIO_ADAPTER_MIN_TARGET_MS 10
+#define SC_AUDIO_ADAPTER_MAX_TARGET_MS 500
+// Number of consecutive periods without underflow before the target may be
+// lowered
+#define SC_AUDIO_ADAPTER_STABLE_PERIODS 10
+
+struct sc_audio_adapter {
+    uint32_t target;
+    uint32_t min_target;
+    uint32_t max_target;
+    // Lowest buffering level observed since the last adjustment
+    uint32_t min_buffering;
+    // Number of consecutive periods without underflow
+    unsigned stable_periods;
+};
+
+/**
+ * Initialize the adapter (the initial target is clamped to the bounds)
+ */
+void
+sc_audio_adapter_init(struct sc_audio_adapter *adapter, uint32_t sample_rate,
+                      uint32_t target);
+
+/**
+ * Report the current buffering level
+ */
+void
+sc_audio_adapter_observe(struct sc_audio_adapter *adapter, uint32_t buffering);
+
+/**
+ * Forget the buffering levels observed so far (typically on discontinuity)
+ */
+void
+sc_audio_adapter_reset(struct sc_audio_adapter *adapter);
+
+/**
+ * Adjust the target according to the underflow (number of silence samples
+ * inserted) during the last period
+ *
+ * This must be called once per period (1 second).
+ *
+ * Return the new target.
+ */
+uint32_t
+sc_audio_adapter_update(struct sc_audio_adapter *adapter, uint32_t underflow);
+
+#endif
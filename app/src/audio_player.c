@@ -1,5 +1,7 @@
 #include "audio_player.h"
 
+#include <inttypes.h>
+
 #include "util/log.h"
 #include "util/memory.h"
 #include "SDL3/SDL_hints.h"
@@ -73,7 +75,8 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
 
     size_t sample_size = nb_channels * out_bytes_per_sample;
     bool ok = sc_audio_regulator_init(&ap->audioreg, sample_size, ctx,
-                                      target_buffering_samples);
+                                      target_buffering_samples,
+                                      ap->adaptive_buffering);
     if (!ok) {
         return false;
     }
@@ -144,6 +147,16 @@ sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
     // ap->device is owned by ap->stream
     SDL_DestroyAudioStream(ap->stream);
 
+    struct sc_audio_regulator_stats stats;
+    sc_audio_regulator_get_stats(&ap->audioreg, &stats);
+    uint32_t sample_rate = ap->audioreg.sample_rate;
+    LOGD("Audio: %" PRIu64 " underflow samples, %" PRIu64 " dropped samples",
+         stats.underflow, stats.dropped);
+    if (ap->adaptive_buffering) {
+        LOGI("Audio buffer auto-adjusted to %" PRIu32 " ms",
+             stats.target_buffering * 1000 / sample_rate);
+    }
+
     sc_audio_regulator_destroy(&ap->audioreg);
 
     free(ap->aout_buffer);
@@ -151,8 +164,9 @@ sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick output_buffer_duration) {
+                     bool adaptive_buffering, sc_tick output_buffer_duration) {
     ap->target_buffering_delay = target_buffering;
+    ap->adaptive_buffering = adaptive_buffering;
     ap->output_buffer_duration = output_buffer_duration;
 
     static const struct sc_frame_sink_ops ops = {
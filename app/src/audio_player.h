@@ -19,6 +19,9 @@ struct sc_audio_player {
     // value should be higher.
     sc_tick target_buffering_delay;
 
+    // Adjust the target buffering automatically
+    bool adaptive_buffering;
+
     // SDL audio output buffer size
     sc_tick output_buffer_duration;
 
@@ -32,6 +35,6 @@ struct sc_audio_player {
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick audio_output_buffer);
+                     bool adaptive_buffering, sc_tick audio_output_buffer);
 
 #endif
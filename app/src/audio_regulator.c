@@ -7,6 +7,8 @@
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
 
+#include "metrics.h"
+#include "util/audioconv.h"
 #include "util/log.h"
 
 //#define SC_AUDIO_REGULATOR_DEBUG // uncomment to debug
@@ -54,6 +56,18 @@
  * Therefore, the regulator doesn't drop any sample on underflow. The
  * compensation mechanism will absorb the delay introduced by the inserted
  * silence.
+ *
+ * With --audio-buffer=auto, the target buffering is itself adjusted (within
+ * bounds, see audio_adapter.h) every time the compensation is updated: it is
+ * raised as soon as underflow occurs, and lowered progressively when the
+ * buffering level has stayed far enough above zero for several seconds (i.e.
+ * when the jitter is lower than what the target buffering allows to absorb).
+ *
+ * As long as compensation is disabled (so that libswresample does not hold any
+ * delayed samples), the conversion to the output format is performed directly
+ * by dedicated kernels for the common input formats. When compensation ends,
+ * the delayed samples are flushed and libswresample is reinitialized, so that
+ * the direct conversion is used again.
  */
 
 #define TO_BYTES(SAMPLES) sc_audiobuf_to_bytes(&ar->buf, (SAMPLES))
@@ -66,11 +80,13 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
     LOGD("[Audio] Audio regulator pulls %" PRIu32 " samples", out_samples);
 #endif
 
-    // A lock is necessary in the rare case where the producer needs to drop
-    // samples already pushed (when the buffer is full)
-    sc_mutex_lock(&ar->mutex);
+    // This is called from the audio callback: it must never block. The
+    // producer may drop samples concurrently (when the buffer is full), this
+    // is handled by the audio buffer without locking.
 
-    bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
+    // Acquire/release on played: target_buffering may be modified by the
+    // receiver thread once playback has started
+    bool played = atomic_load_explicit(&ar->played, memory_order_acquire);
     if (!played) {
         uint32_t buffered_samples = sc_audiobuf_can_read(&ar->buf);
         // Wait until the buffer is filled up to at least target_buffering
@@ -84,15 +100,12 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // whole buffer with silence (len is small compared to the
             // arbitrary margin value).
             memset(out, 0, out_samples * ar->sample_size);
-            sc_mutex_unlock(&ar->mutex);
             return;
         }
     }
 
     uint32_t read = sc_audiobuf_read(&ar->buf, out, out_samples);
 
-    sc_mutex_unlock(&ar->mutex);
-
     if (read < out_samples) {
         uint32_t silence = out_samples - read;
         // Insert silence. In theory, the inserted silent samples replace the
@@ -112,10 +125,33 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
             // Inserting additional samples immediately increases buffering
             atomic_fetch_add_explicit(&ar->underflow, silence,
                                       memory_order_relaxed);
+            sc_metrics_add(SC_METRIC_AUDIO_UNDERFLOW_SAMPLES, silence);
         }
     }
 
-    atomic_store_explicit(&ar->played, true, memory_order_relaxed);
+    atomic_store_explicit(&ar->played, true, memory_order_release);
+}
+
+static void
+sc_audio_regulator_set_target_buffering(struct sc_audio_regulator *ar,
+                                        uint32_t target_buffering) {
+    ar->target_buffering = target_buffering;
+    atomic_store_explicit(&ar->stats.target_buffering, target_buffering,
+                          memory_order_relaxed);
+    sc_metrics_set(SC_METRIC_AUDIO_TARGET_BUFFERING, target_buffering);
+}
+
+// Adjust the target buffering according to the underflow since the last call
+// (called once per second)
+static void
+sc_audio_regulator_adapt(struct sc_audio_regulator *ar, uint32_t underflow) {
+    uint32_t target = ar->target_buffering;
+    uint32_t new_target = sc_audio_adapter_update(&ar->adapter, underflow);
+    if (new_target != target) {
+        LOGD("[Audio] Target buffering adjusted: %" PRIu32 " -> %" PRIu32
+             " samples", target, new_target);
+        sc_audio_regulator_set_target_buffering(ar, new_target);
+    }
 }
 
 static uint8_t *
@@ -137,6 +173,73 @@ sc_audio_regulator_get_swr_buf(struct sc_audio_regulator *ar,
     return ar->swr_buf;
 }
 
+// Convert the frame to SC_AV_SAMPLE_FMT without libswresample, if the input
+// format is supported
+static bool
+sc_audio_regulator_convert(struct sc_audio_regulator *ar, const AVFrame *frame,
+                           uint8_t *out) {
+    static_assert(SC_AV_SAMPLE_FMT == AV_SAMPLE_FMT_FLT, "Unexpected format");
+    unsigned channels = ar->sample_size / sizeof(float);
+
+    switch (frame->format) {
+        case AV_SAMPLE_FMT_S16:
+            sc_audioconv_s16_to_f32((float *) out,
+                                    (const int16_t *) frame->data[0],
+                                    frame->nb_samples * channels);
+            return true;
+        case AV_SAMPLE_FMT_FLT:
+            memcpy(out, frame->data[0], TO_BYTES(frame->nb_samples));
+            return true;
+        case AV_SAMPLE_FMT_FLTP:
+            sc_audioconv_interleave_f32((float *) out,
+                                        (const float *const *)
+                                            frame->extended_data,
+                                        channels, frame->nb_samples);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Once compensation has been enabled, libswresample keeps its resampler (and
+// the samples delayed by its filter) even when compensation is disabled, so
+// the direct conversion could never be used again. Flush the delayed samples
+// to the audio buffer, then reinitialize the context without resampling.
+static bool
+sc_audio_regulator_reset_swr(struct sc_audio_regulator *ar) {
+    SwrContext *swr_ctx = ar->swr_ctx;
+
+    int64_t swr_delay = swr_get_delay(swr_ctx, ar->sample_rate);
+    if (swr_delay > 0) {
+        int dst_nb_samples = swr_delay + 256;
+        uint8_t *swr_buf = sc_audio_regulator_get_swr_buf(ar, dst_nb_samples);
+        if (!swr_buf) {
+            return false;
+        }
+
+        int ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples, NULL, 0);
+        if (ret < 0) {
+            LOGE("Resampling flush failed: %d", ret);
+            return false;
+        }
+
+        // The delay is a few samples only, if the buffer is full (very
+        // unlikely), just drop them
+        uint32_t samples = MIN(ret, dst_nb_samples);
+        sc_audiobuf_write(&ar->buf, swr_buf, samples);
+    }
+
+    // swr_set_compensation() forced the resampling
+    av_opt_set_int(swr_ctx, "flags", 0, 0);
+    int ret = swr_init(swr_ctx);
+    if (ret) {
+        LOGE("Failed to reinitialize the resampling context");
+        return false;
+    }
+
+    return true;
+}
+
 bool
 sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     SwrContext *swr_ctx = ar->swr_ctx;
@@ -150,6 +253,18 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
              pts - ar->next_expected_pts);
         // More than 100ms: consider it as a discontinuity
         // (typically because silence packets were not captured)
+        // Disable compensation first, so that the samples delayed by the
+        // resampler are written before the silence
+        if (ar->compensation_active) {
+            int ret = swr_set_compensation(swr_ctx, 0, 0);
+            (void) ret;
+            assert(!ret); // disabling compensation should never fail
+            if (!sc_audio_regulator_reset_swr(ar)) {
+                return false;
+            }
+            ar->compensation_active = false;
+        }
+
         uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
         if (input_samples + can_read < ar->target_buffering) {
             // Adjust buffering to the target value directly
@@ -159,11 +274,11 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
         // Reset state
         ar->avg_buffering.avg = ar->target_buffering;
-        int ret = swr_set_compensation(swr_ctx, 0, 0);
-        (void) ret;
-        assert(!ret); // disabling compensation should never fail
-        ar->compensation_active = false;
+        sc_metrics_set(SC_METRIC_AUDIO_COMPENSATION, 0);
         ar->samples_since_resync = 0;
+        if (ar->adaptive) {
+            sc_audio_adapter_reset(&ar->adapter);
+        }
         atomic_store_explicit(&ar->underflow, 0, memory_order_relaxed);
     }
 
@@ -181,11 +296,18 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         return false;
     }
 
-    int ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples,
+    int ret;
+    if (!ar->compensation_active && !swr_delay
+            && sc_audio_regulator_convert(ar, frame, swr_buf)) {
+        // No resampling needed, the samples have been converted directly
+        ret = frame->nb_samples;
+    } else {
+        ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples,
                           (const uint8_t **) frame->data, frame->nb_samples);
-    if (ret < 0) {
-        LOGE("Resampling failed: %d", ret);
-        return false;
+        if (ret < 0) {
+            LOGE("Resampling failed: %d", ret);
+            return false;
+        }
     }
 
     // swr_convert() returns the number of samples which would have been
@@ -210,24 +332,18 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     if (written < samples) {
         uint32_t remaining = samples - written;
 
-        // All samples that could be written without locking have been written,
-        // now we need to lock to drop/consume old samples
-        sc_mutex_lock(&ar->mutex);
-
-        // Retry with the lock
+        // The player may have consumed samples in the meantime
         written += sc_audiobuf_write(&ar->buf,
                                      swr_buf + TO_BYTES(written),
                                      remaining);
         if (written < samples) {
             remaining = samples - written;
-            // Still insufficient, drop old samples to make space
-            skipped_samples = sc_audiobuf_read(&ar->buf, NULL, remaining);
-            assert(skipped_samples == remaining);
-        }
-
-        sc_mutex_unlock(&ar->mutex);
+            // Still insufficient, drop old samples to make space, without
+            // locking (the player never blocks). If the player consumes
+            // samples concurrently, fewer samples are dropped (there is
+            // enough space anyway).
+            skipped_samples = sc_audiobuf_drop(&ar->buf, remaining);
 
-        if (written < samples) {
             // Now there is enough space
             uint32_t w = sc_audiobuf_write(&ar->buf,
                                            swr_buf + TO_BYTES(written),
@@ -239,11 +355,13 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     uint32_t underflow = 0;
     uint32_t max_buffered_samples;
-    bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
+    bool played = atomic_load_explicit(&ar->played, memory_order_acquire);
     if (played) {
         underflow = atomic_exchange_explicit(&ar->underflow, 0,
                                              memory_order_relaxed);
         ar->underflow_report += underflow;
+        atomic_fetch_add_explicit(&ar->stats.underflow, underflow,
+                                  memory_order_relaxed);
 
         max_buffered_samples = ar->target_buffering * 11 / 10
                              + 60 * ar->sample_rate / 1000 /* 60 ms */;
@@ -257,18 +375,9 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
     if (can_read > max_buffered_samples) {
-        uint32_t skip_samples = 0;
-
-        sc_mutex_lock(&ar->mutex);
-        can_read = sc_audiobuf_can_read(&ar->buf);
-        if (can_read > max_buffered_samples) {
-            skip_samples = can_read - max_buffered_samples;
-            uint32_t r = sc_audiobuf_read(&ar->buf, NULL, skip_samples);
-            assert(r == skip_samples);
-            (void) r;
-            skipped_samples += skip_samples;
-        }
-        sc_mutex_unlock(&ar->mutex);
+        uint32_t skip_samples =
+            sc_audiobuf_drop(&ar->buf, can_read - max_buffered_samples);
+        skipped_samples += skip_samples;
 
         if (skip_samples) {
             if (played) {
@@ -283,6 +392,12 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         }
     }
 
+    if (skipped_samples) {
+        atomic_fetch_add_explicit(&ar->stats.dropped, skipped_samples,
+                                  memory_order_relaxed);
+        sc_metrics_add(SC_METRIC_AUDIO_DROPPED_SAMPLES, skipped_samples);
+    }
+
     atomic_store_explicit(&ar->received, true, memory_order_relaxed);
     if (!played) {
         // Nothing more to do
@@ -311,6 +426,13 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
     // However, the buffering level must be smoothed
     sc_average_push(&ar->avg_buffering, can_read);
+    sc_metrics_set(SC_METRIC_AUDIO_BUFFERING, can_read);
+
+    // The buffering level is the lowest just before the samples are written
+    if (ar->adaptive) {
+        uint32_t low_buffering = can_read > written ? can_read - written : 0;
+        sc_audio_adapter_observe(&ar->adapter, low_buffering);
+    }
 
 #ifdef SC_AUDIO_REGULATOR_DEBUG
     LOGD("[Audio] can_read=%" PRIu32 " avg_buffering=%f",
@@ -348,15 +470,30 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         LOGV("[Audio] Buffering: target=%" PRIu32 " avg=%f cur=%" PRIu32
              " compensation=%d (underflow=%" PRIu32 ")",
              ar->target_buffering, avg, can_read, diff, ar->underflow_report);
-        ar->underflow_report = 0;
 
         int ret = swr_set_compensation(swr_ctx, diff, distance);
         if (ret < 0) {
             LOGW("Resampling compensation failed: %d", ret);
             // not fatal
         } else {
+            if (ar->compensation_active && !diff) {
+                if (!sc_audio_regulator_reset_swr(ar)) {
+                    return false;
+                }
+            }
             ar->compensation_active = diff != 0;
+            atomic_store_explicit(&ar->stats.compensation, diff,
+                                  memory_order_relaxed);
+            sc_metrics_set(SC_METRIC_AUDIO_COMPENSATION, diff);
         }
+
+        atomic_store_explicit(&ar->stats.avg_buffering, (uint32_t) avg,
+                              memory_order_relaxed);
+
+        if (ar->adaptive) {
+            sc_audio_regulator_adapt(ar, ar->underflow_report);
+        }
+        ar->underflow_report = 0;
     }
 
     return true;
@@ -364,7 +501,8 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
 
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering) {
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        bool adaptive) {
     SwrContext *swr_ctx = swr_alloc();
     if (!swr_ctx) {
         LOG_OOM();
@@ -394,24 +532,26 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
         goto error_free_swr_ctx;
     }
 
-    bool ok = sc_mutex_init(&ar->mutex);
-    if (!ok) {
-        goto error_free_swr_ctx;
-    }
-
-    ar->target_buffering = target_buffering;
     ar->sample_size = sample_size;
     ar->sample_rate = ctx->sample_rate;
 
-    // Use a ring-buffer of the target buffering size plus 1 second between the
-    // producer and the consumer. It's too big on purpose, to guarantee that
-    // the producer and the consumer will be able to access it in parallel
-    // without locking.
-    uint32_t audiobuf_samples = target_buffering + ar->sample_rate;
+    ar->adaptive = adaptive;
+    if (adaptive) {
+        sc_audio_adapter_init(&ar->adapter, ar->sample_rate, target_buffering);
+        target_buffering = ar->adapter.target;
+    }
+
+    // Use a ring-buffer of the (maximum) target buffering size plus 1 second
+    // between the producer and the consumer. It's too big on purpose, to
+    // guarantee that the producer and the consumer will be able to access it
+    // in parallel without locking.
+    uint32_t max_target = adaptive ? ar->adapter.max_target
+                                   : target_buffering;
+    uint32_t audiobuf_samples = max_target + ar->sample_rate;
 
-    ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
+    bool ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
     if (!ok) {
-        goto error_destroy_mutex;
+        goto error_free_swr_ctx;
     }
 
     size_t initial_swr_buf_size = TO_BYTES(4096);
@@ -435,22 +575,41 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
     ar->compensation_active = false;
     ar->next_expected_pts = 0;
 
+    atomic_init(&ar->stats.avg_buffering, 0);
+    atomic_init(&ar->stats.compensation, 0);
+    atomic_init(&ar->stats.underflow, 0);
+    atomic_init(&ar->stats.dropped, 0);
+    atomic_init(&ar->stats.target_buffering, 0);
+    sc_audio_regulator_set_target_buffering(ar, target_buffering);
+
     return true;
 
 error_destroy_audiobuf:
     sc_audiobuf_destroy(&ar->buf);
-error_destroy_mutex:
-    sc_mutex_destroy(&ar->mutex);
 error_free_swr_ctx:
     swr_free(&ar->swr_ctx);
 
     return false;
 }
 
+void
+sc_audio_regulator_get_stats(struct sc_audio_regulator *ar,
+                             struct sc_audio_regulator_stats *stats) {
+    stats->target_buffering =
+        atomic_load_explicit(&ar->stats.target_buffering, memory_order_relaxed);
+    stats->avg_buffering =
+        atomic_load_explicit(&ar->stats.avg_buffering, memory_order_relaxed);
+    stats->compensation =
+        atomic_load_explicit(&ar->stats.compensation, memory_order_relaxed);
+    stats->underflow =
+        atomic_load_explicit(&ar->stats.underflow, memory_order_relaxed);
+    stats->dropped =
+        atomic_load_explicit(&ar->stats.dropped, memory_order_relaxed);
+}
+
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar) {
     free(ar->swr_buf);
     sc_audiobuf_destroy(&ar->buf);
-    sc_mutex_destroy(&ar->mutex);
     swr_free(&ar->swr_ctx);
 }
@@ -9,18 +9,36 @@
 #include <stdint.h>
 #include <libavcodec/avcodec.h>
 #include <libswresample/swresample.h>
+#include "audio_adapter.h"
 #include "util/audiobuf.h"
 #include "util/average.h"
-#include "util/thread.h"
 
 #define SC_AV_SAMPLE_FMT AV_SAMPLE_FMT_FLT
 
-struct sc_audio_regulator {
-    sc_mutex mutex;
+struct sc_audio_regulator_stats {
+    // Target buffering (in samples)
+    uint32_t target_buffering;
+    // Smoothed buffering level (in samples)
+    uint32_t avg_buffering;
+    // Current compensation (samples added, or removed if negative, over 4s)
+    int32_t compensation;
+    // Total number of silence samples inserted on buffer underflow
+    uint64_t underflow;
+    // Total number of samples dropped on buffer overflow
+    uint64_t dropped;
+};
 
+struct sc_audio_regulator {
     // Target buffering between the producer and the consumer (in samples)
+    // (only written by the receiver thread, and only read by the player
+    // thread before playback starts)
     uint32_t target_buffering;
 
+    // If set, target_buffering is adjusted automatically by the adapter
+    // (only used by the receiver thread)
+    bool adaptive;
+    struct sc_audio_adapter adapter;
+
     // Audio buffer to communicate between the receiver and the player
     struct sc_audiobuf buf;
 
@@ -60,11 +78,21 @@ struct sc_audio_regulator {
 
     // PTS of the next expected packet (useful to detect discontinuities)
     int64_t next_expected_pts;
+
+    // Statistics, written by the receiver thread, readable from any thread
+    struct {
+        atomic_uint_least32_t target_buffering;
+        atomic_uint_least32_t avg_buffering;
+        atomic_int_least32_t compensation;
+        atomic_uint_least64_t underflow;
+        atomic_uint_least64_t dropped;
+    } stats;
 };
 
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering);
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        bool adaptive);
 
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
@@ -76,4 +104,11 @@ void
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t samples);
 
+/**
+ * Read the current statistics (may be called from any thread)
+ */
+void
+sc_audio_regulator_get_stats(struct sc_audio_regulator *ar,
+                             struct sc_audio_regulator_stats *stats);
+
 #endif
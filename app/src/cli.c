@@ -1,6 +1,7 @@
 #include "cli.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <getopt.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -111,6 +112,26 @@ enum {
     OPT_RENDER_FIT,
     OPT_IGNORE_VIDEO_ENCODER_CONSTRAINTS,
     OPT_NO_TERMINAL_TITLE,
+    OPT_STREAM_DUMP,
+    OPT_STREAM_REPLAY,
+    OPT_STREAM_REPLAY_SPEED,
+    OPT_METRICS_PORT,
+    OPT_STARTUP_PROFILE,
+    OPT_MULTI_DEVICE,
+    OPT_MULTI_DEVICE_JOBS,
+    OPT_SERVER_IDLE_TIMEOUT,
+    OPT_RESUME_TIMEOUT,
+    OPT_MULTIPLEX,
+    OPT_DIRECT_TCP,
+    OPT_SOCKET_BUFFERS,
+    OPT_LOW_LATENCY_SOCKETS,
+    OPT_VIDEO_LOW_LATENCY,
+    OPT_SKIP_UNCHANGED_FRAMES,
+    OPT_VIDEO_DIRTY_RECTS,
+    OPT_VIDEO_SCALE_FILTER,
+    OPT_VIDEO_SHARPEN,
+    OPT_VIDEO_SIMULCAST,
+    OPT_VIDEO_DROP_FRAMES,
 };
 
 struct sc_option {
@@ -174,6 +195,9 @@ static const struct sc_option options[] = {
         .text = "Configure the audio buffering delay (in milliseconds).\n"
                 "Lower values decrease the latency, but increase the "
                 "likelihood of buffer underrun (causing audio glitches).\n"
+                "If set to 'auto', the buffering delay is adjusted "
+                "continuously (between 10 and 500 ms) to the lowest value "
+                "that does not cause buffer underrun.\n"
                 "Default is 50.",
     },
     {
@@ -353,6 +377,22 @@ static const struct sc_option options[] = {
         .text = "Use USB device (if there is exactly one, like adb -d).\n"
                 "Also see -e (--select-tcpip).",
     },
+    {
+        .longopt_id = OPT_DIRECT_TCP,
+        .longopt = "direct-tcp",
+        .argdesc = "port",
+        .optional_arg = true,
+        .text = "Connect to the device over TCP directly, without the adb "
+                "tunnel (the device must be reachable from the computer, "
+                "typically on the same local network).\n"
+                "The server listens on the given port on the device (default "
+                "is 27183). adb is still used to start the server, and to "
+                "transmit a secret token which authenticates the "
+                "connection.\n"
+                "The streams are not encrypted: the screen content, the audio "
+                "and the input events are transmitted in clear over the "
+                "network. Only use this option on a trusted network.",
+    },
     {
         .longopt_id = OPT_DISABLE_SCREENSAVER,
         .longopt = "disable-screensaver",
@@ -508,6 +548,15 @@ static const struct sc_option options[] = {
         .longopt = "list-encoders",
         .text = "List video and audio encoders available on the device.",
     },
+    {
+        .longopt_id = OPT_LOW_LATENCY_SOCKETS,
+        .longopt = "low-latency-sockets",
+        .text = "Configure the sockets to reduce the latency at the expense of "
+                "CPU usage: acknowledge the received data immediately and "
+                "busy-poll on reads on the computer (on Linux), and limit the "
+                "amount of unsent data queued in the kernel on the device "
+                "(with --direct-tcp).",
+    },
     {
         .shortopt = 'm',
         .longopt = "max-size",
@@ -531,6 +580,14 @@ static const struct sc_option options[] = {
         .text = "Limit the frame rate of screen capture (officially supported "
                 "since Android 10, but may work on earlier versions).",
     },
+    {
+        .longopt_id = OPT_METRICS_PORT,
+        .longopt = "metrics-port",
+        .argdesc = "port",
+        .text = "Expose pipeline metrics over HTTP on 127.0.0.1:port, in "
+                "Prometheus text format on /metrics and in JSON on "
+                "/metrics.json.",
+    },
     {
         .longopt_id = OPT_MIN_SIZE_ALIGNMENT,
         .longopt = "min-size-alignment",
@@ -586,6 +643,30 @@ static const struct sc_option options[] = {
                 "Default is 'bhsn:++++' for SDK mouse, and '++++:bhsn' for AOA "
                 "and UHID.",
     },
+    {
+        .longopt_id = OPT_MULTI_DEVICE,
+        .longopt = "multi-device",
+        .argdesc = "serial1,serial2,...",
+        .optional_arg = true,
+        .text = "Mirror several devices in parallel (all the connected "
+                "devices if no serial is provided).\n"
+                "The server is pushed to the devices concurrently (see "
+                "--multi-device-jobs), then a separate scrcpy session is "
+                "started for each device, with the other arguments, its own "
+                "serial and its own part of the port range (see --port).\n"
+                "If --metrics-port is set, each session exposes its metrics "
+                "on its own port, starting from the given port.\n"
+                "If --startup-profile=<prefix> is set, the startup profile of "
+                "each session is written to <prefix>-<serial>.json.",
+    },
+    {
+        .longopt_id = OPT_MULTI_DEVICE_JOBS,
+        .longopt = "multi-device-jobs",
+        .argdesc = "value",
+        .text = "Set the maximum number of devices prepared concurrently by "
+                "--multi-device.\n"
+                "Default is 4.",
+    },
     {
         .shortopt = 'n',
         .longopt = "no-control",
@@ -597,6 +678,16 @@ static const struct sc_option options[] = {
         .text = "Disable video and audio playback on the computer (equivalent "
                 "to --no-video-playback --no-audio-playback).",
     },
+    {
+        .longopt_id = OPT_MULTIPLEX,
+        .longopt = "multiplex",
+        .text = "Transmit the video, audio and control streams over a single "
+                "connection (instead of one connection per stream).\n"
+                "It reduces the connection time, and the device sends the "
+                "control messages and the audio packets before the pending "
+                "video data, so that a large video frame does not delay "
+                "them.",
+    },
     {
         .longopt_id = OPT_NEW_DISPLAY,
         .longopt = "new-display",
@@ -842,6 +933,17 @@ static const struct sc_option options[] = {
                 "fails on the device. This option makes scrcpy fail if audio "
                 "is enabled but does not work."
     },
+    {
+        .longopt_id = OPT_RESUME_TIMEOUT,
+        .longopt = "resume-timeout",
+        .argdesc = "seconds",
+        .text = "When the connection to the device is lost, keep the window "
+                "open and try to resume the session (restart the server and "
+                "reconnect) for up to the given delay. The recording "
+                "continues in the same file (it is not split into segments, "
+                "and the interruption is not marked).\n"
+                "Default is 0 (disabled: scrcpy exits on disconnection).",
+    },
     {
         .shortopt = 's',
         .longopt = "serial",
@@ -861,6 +963,18 @@ static const struct sc_option options[] = {
         .text = "Set the screen off timeout while scrcpy is running (restore "
                 "the initial value on exit).",
     },
+    {
+        .longopt_id = OPT_SERVER_IDLE_TIMEOUT,
+        .longopt = "server-idle-timeout",
+        .argdesc = "seconds",
+        .text = "Keep the server running on the device after scrcpy exits, so "
+                "that the next scrcpy with the same options attaches to it "
+                "instantly (without starting a new server). The server exits "
+                "if no client connects within the given delay.\n"
+                "This forces the adb tunnel in forward mode (see "
+                "--force-adb-forward).\n"
+                "Default is 0 (the server exits with scrcpy).",
+    },
     {
         .longopt_id = OPT_SHORTCUT_MOD,
         .longopt = "shortcut-mod",
@@ -874,6 +988,30 @@ static const struct sc_option options[] = {
                 "shortcuts, pass \"lctrl,lsuper\".\n"
                 "Default is \"lalt,lsuper\" (left-Alt or left-Super).",
     },
+    {
+        .longopt_id = OPT_SKIP_UNCHANGED_FRAMES,
+        .longopt = "skip-unchanged-frames",
+        .text = "Do not encode the frames identical to the previous one (the "
+                "last frame remains displayed).\n"
+                "This saves device power, bandwidth and decoding for mostly "
+                "idle screens. The unchanged frames are detected on a "
+                "downsampled signature, so a very small change (a few "
+                "pixels) may be delayed until the next detected change.\n"
+                "This is only available with --video-source=display.",
+    },
+    {
+        .longopt_id = OPT_SOCKET_BUFFERS,
+        .longopt = "socket-buffers",
+        .argdesc = "type=size[,...]",
+        .text = "Set the socket buffer sizes (in bytes, with an optional K or "
+                "M suffix) per stream type (video, audio or control), on the "
+                "computer and on the device.\n"
+                "For example, to increase the buffers for a high bit rate "
+                "video stream: \"video=8M\".\n"
+                "The effective values, and the connection statistics on exit, "
+                "are logged in debug mode (-Vdebug).\n"
+                "By default, the system defaults are used.",
+    },
     {
         .longopt_id = OPT_START_APP,
         .longopt = "start-app",
@@ -888,6 +1026,42 @@ static const struct sc_option options[] = {
                 "Both prefixes can be used, in that order:\n"
                 "    scrcpy --start-app=+?firefox",
     },
+    {
+        .longopt_id = OPT_STARTUP_PROFILE,
+        .longopt = "startup-profile",
+        .argdesc = "file",
+        .text = "Measure the duration of each startup phase (until the "
+                "first frame is rendered), and write the results to <file> as "
+                "JSON.\n"
+                "The summary is also logged (without this option, it is only "
+                "logged at the debug level, see -V).",
+    },
+    {
+        .longopt_id = OPT_STREAM_DUMP,
+        .longopt = "stream-dump",
+        .argdesc = "prefix",
+        .text = "Dump the raw video and audio streams, exactly as received "
+                "from the device, to <prefix>-video.scdump and "
+                "<prefix>-audio.scdump.\n"
+                "The dumps can be replayed later by --stream-replay.",
+    },
+    {
+        .longopt_id = OPT_STREAM_REPLAY,
+        .longopt = "stream-replay",
+        .argdesc = "prefix",
+        .text = "Replay the streams dumped by --stream-dump instead of "
+                "connecting to a device (no device is necessary).\n"
+                "Control is disabled in this mode.",
+    },
+    {
+        .longopt_id = OPT_STREAM_REPLAY_SPEED,
+        .longopt = "stream-replay-speed",
+        .argdesc = "factor",
+        .text = "Set the speed factor of --stream-replay (2 replays twice as "
+                "fast as the original timing).\n"
+                "The special value 0 replays as fast as possible.\n"
+                "Default is 1.",
+    },
     {
         .shortopt = 't',
         .longopt = "show-touches",
@@ -997,6 +1171,25 @@ static const struct sc_option options[] = {
                 "Android documentation: "
                 "<https://d.android.com/reference/android/media/MediaFormat>",
     },
+    {
+        .longopt_id = OPT_VIDEO_DIRTY_RECTS,
+        .longopt = "video-dirty-rects",
+        .text = "Send, along with each video frame, the regions which changed "
+                "since the previous frame, so that only these regions are "
+                "uploaded to the texture on the computer.\n"
+                "This reduces the client CPU and GPU usage when only a small "
+                "part of the screen changes.\n"
+                "This only applies to display mirroring (not to camera).",
+    },
+    {
+        .longopt_id = OPT_VIDEO_DROP_FRAMES,
+        .longopt = "video-drop-frames",
+        .text = "If the connection can not keep up with the video encoder, "
+                "drop the video packets until the next key frame (and request "
+                "a key frame) instead of waiting.\n"
+                "This reduces the latency on a congested connection, at the "
+                "cost of a frozen video until the next key frame.",
+    },
     {
         .longopt_id = OPT_VIDEO_ENCODER,
         .longopt = "video-encoder",
@@ -1005,6 +1198,51 @@ static const struct sc_option options[] = {
                 "codec provided by --video-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_VIDEO_LOW_LATENCY,
+        .longopt = "video-low-latency",
+        .text = "Configure the video encoder to avoid the latency spikes "
+                "caused by periodic key frames.\n"
+                "If the encoder supports it, the picture is refreshed "
+                "progressively (intra refresh) instead of by full key frames. "
+                "Otherwise, the key frame interval is reduced and a constant "
+                "bit rate is requested, to limit the size of the key frames.",
+    },
+    {
+        .longopt_id = OPT_VIDEO_SCALE_FILTER,
+        .longopt = "video-scale-filter",
+        .argdesc = "filter",
+        .text = "Select the filter used on the device to downscale the video "
+                "(bilinear or lanczos).\n"
+                "The lanczos filter gives a sharper picture (which also "
+                "compresses better at a given bit rate) when the video is "
+                "much smaller than the display, at the cost of more GPU "
+                "work on the device.\n"
+                "This only applies to display mirroring (not to camera).\n"
+                "Default is bilinear.",
+    },
+    {
+        .longopt_id = OPT_VIDEO_SHARPEN,
+        .longopt = "video-sharpen",
+        .argdesc = "amount",
+        .text = "Sharpen the video on the device before encoding (typically "
+                "between 0.1 and 0.5), to compensate for the blur caused by "
+                "downscaling.\n"
+                "This only applies to display mirroring (not to camera).\n"
+                "Default is 0 (disabled).",
+    },
+    {
+        .longopt_id = OPT_VIDEO_SIMULCAST,
+        .longopt = "video-simulcast",
+        .argdesc = "max_size",
+        .text = "Also encode the video at a lower definition (limited to "
+                "<max_size>) on the device, and stream it instead of the main "
+                "video while the window is not focused.\n"
+                "Since both encoders keep running, switching between them "
+                "only waits for the next key frame of the selected stream "
+                "(the window is not resized).\n"
+                "This only applies to display mirroring (not to camera).",
+    },
     {
         .longopt_id = OPT_VIDEO_SOURCE,
         .longopt = "video-source",
@@ -2005,6 +2243,77 @@ parse_port(const char *optarg, uint16_t *port) {
     return true;
 }
 
+static bool
+parse_socket_buffers(const char *s, struct sc_socket_buffers *buffers) {
+    // A list of buffer sizes per stream type, for example "video=8M,audio=1M"
+
+    for (;;) {
+        char *comma = strchr(s, ',');
+        size_t limit = comma ? (size_t) (comma - s) : strlen(s);
+
+        const char *eq = memchr(s, '=', limit);
+        if (!eq) {
+            LOGE("Invalid socket buffer size (expected type=size): %.*s",
+                 (int) limit, s);
+            return false;
+        }
+
+        size_t key_len = eq - s;
+        uint32_t *target;
+        if (key_len == 5 && !strncmp(s, "video", 5)) {
+            target = &buffers->video;
+        } else if (key_len == 5 && !strncmp(s, "audio", 5)) {
+            target = &buffers->audio;
+        } else if (key_len == 7 && !strncmp(s, "control", 7)) {
+            target = &buffers->control;
+        } else {
+            LOGE("Unknown socket type (expected video, audio or control): "
+                 "%.*s", (int) key_len, s);
+            return false;
+        }
+
+        // Copy the size to parse it as a NUL-terminated string
+        char value[16];
+        size_t value_len = limit - key_len - 1;
+        if (value_len >= sizeof(value)) {
+            LOGE("Invalid socket buffer size: %.*s", (int) limit, s);
+            return false;
+        }
+        memcpy(value, eq + 1, value_len);
+        value[value_len] = '\0';
+
+        long size;
+        if (!parse_integer_arg(value, &size, true, 1, 0x4000000,
+                               "socket buffer size")) {
+            return false;
+        }
+        *target = (uint32_t) size;
+
+        if (!comma) {
+            break;
+        }
+
+        s = comma + 1;
+    }
+
+    return true;
+}
+
+static bool
+parse_direct_tcp_port(const char *optarg, uint16_t *port) {
+    if (!optarg) {
+        *port = SC_DIRECT_TCP_DEFAULT_PORT;
+        return true;
+    }
+
+    long value;
+    if (!parse_integer_arg(optarg, &value, false, 1, 0xFFFF, "port")) {
+        return false;
+    }
+    *port = (uint16_t) value;
+    return true;
+}
+
 static enum sc_record_format
 guess_record_format(const char *filename) {
     const char *dot = strrchr(filename, '.');
@@ -2081,6 +2390,24 @@ parse_video_source(const char *optarg, enum sc_video_source *source) {
     return false;
 }
 
+static bool
+parse_video_scale_filter(const char *optarg,
+                         enum sc_video_scale_filter *filter) {
+    if (!strcmp(optarg, "bilinear")) {
+        *filter = SC_VIDEO_SCALE_FILTER_BILINEAR;
+        return true;
+    }
+
+    if (!strcmp(optarg, "lanczos")) {
+        *filter = SC_VIDEO_SCALE_FILTER_LANCZOS;
+        return true;
+    }
+
+    LOGE("Unsupported video scale filter: %s (expected bilinear or lanczos)",
+         optarg);
+    return false;
+}
+
 static bool
 parse_audio_source(const char *optarg, enum sc_audio_source *source) {
     if (!strcmp(optarg, "mic")) {
@@ -2300,6 +2627,33 @@ parse_screen_off_timeout(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_server_idle_timeout(const char *s, sc_tick *tick) {
+    long value;
+    // value in seconds, but must fit in 31 bits in milliseconds
+    bool ok = parse_integer_arg(s, &value, false, 0, 0x7FFFFFFF / 1000,
+                                "server idle timeout");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
+static bool
+parse_resume_timeout(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 0x7FFFFFFF,
+                                "resume timeout");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
 static bool
 parse_pause_on_exit(const char *s, enum sc_pause_on_exit *pause_on_exit) {
     if (!s || !strcmp(s, "true")) {
@@ -2487,6 +2841,32 @@ parse_render_fit(const char *optarg, enum sc_render_fit *mode) {
     return false;
 }
 
+static bool
+parse_stream_replay_speed(const char *s, float *speed) {
+    char *endptr;
+    errno = 0;
+    float value = strtof(s, &endptr);
+    if (errno || *s == '\0' || *endptr != '\0' || !(value >= 0)) {
+        LOGE("Invalid stream replay speed: %s", s);
+        return false;
+    }
+
+    *speed = value;
+    return true;
+}
+
+static bool
+parse_multi_device_jobs(const char *s, unsigned *jobs) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 64, "multi-device jobs");
+    if (!ok) {
+        return false;
+    }
+
+    *jobs = (unsigned) value;
+    return true;
+}
+
 static bool
 parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                        const char *optstring, const struct option *longopts) {
@@ -2812,9 +3192,16 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 opts->require_audio = true;
                 break;
             case OPT_AUDIO_BUFFER:
+                if (!strcmp(optarg, "auto")) {
+                    opts->audio_buffer_auto = true;
+                    // The initial value depends on the audio format
+                    opts->audio_buffer = -1;
+                    break;
+                }
                 if (!parse_buffering_time(optarg, &opts->audio_buffer)) {
                     return false;
                 }
+                opts->audio_buffer_auto = false;
                 break;
             case OPT_AUDIO_OUTPUT_BUFFER:
                 if (!parse_audio_output_buffer(optarg,
@@ -2945,6 +3332,88 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             case OPT_NO_TERMINAL_TITLE:
                 opts->update_terminal_title = false;
                 break;
+            case OPT_STREAM_DUMP:
+                opts->stream_dump = optarg;
+                break;
+            case OPT_STREAM_REPLAY:
+                opts->stream_replay = optarg;
+                break;
+            case OPT_STREAM_REPLAY_SPEED:
+                if (!parse_stream_replay_speed(optarg,
+                                               &opts->stream_replay_speed)) {
+                    return false;
+                }
+                break;
+            case OPT_METRICS_PORT:
+                if (!parse_port(optarg, &opts->metrics_port)) {
+                    return false;
+                }
+                break;
+            case OPT_STARTUP_PROFILE:
+                opts->startup_profile = optarg;
+                break;
+            case OPT_MULTI_DEVICE:
+                opts->multi_device = optarg ? optarg : "";
+                break;
+            case OPT_MULTI_DEVICE_JOBS:
+                if (!parse_multi_device_jobs(optarg,
+                                             &opts->multi_device_jobs)) {
+                    return false;
+                }
+                break;
+            case OPT_SERVER_IDLE_TIMEOUT:
+                if (!parse_server_idle_timeout(optarg,
+                                               &opts->server_idle_timeout)) {
+                    return false;
+                }
+                break;
+            case OPT_RESUME_TIMEOUT:
+                if (!parse_resume_timeout(optarg, &opts->resume_timeout)) {
+                    return false;
+                }
+                break;
+            case OPT_MULTIPLEX:
+                opts->multiplex = true;
+                break;
+            case OPT_DIRECT_TCP:
+                if (!parse_direct_tcp_port(optarg, &opts->direct_tcp_port)) {
+                    return false;
+                }
+                break;
+            case OPT_SOCKET_BUFFERS:
+                if (!parse_socket_buffers(optarg, &opts->socket_buffers)) {
+                    return false;
+                }
+                break;
+            case OPT_LOW_LATENCY_SOCKETS:
+                opts->low_latency_sockets = true;
+                break;
+            case OPT_VIDEO_LOW_LATENCY:
+                opts->video_low_latency = true;
+                break;
+            case OPT_SKIP_UNCHANGED_FRAMES:
+                opts->skip_unchanged_frames = true;
+                break;
+            case OPT_VIDEO_DIRTY_RECTS:
+                opts->video_dirty_rects = true;
+                break;
+            case OPT_VIDEO_SCALE_FILTER:
+                if (!parse_video_scale_filter(optarg,
+                                              &opts->video_scale_filter)) {
+                    return false;
+                }
+                break;
+            case OPT_VIDEO_SHARPEN:
+                opts->video_sharpen = optarg;
+                break;
+            case OPT_VIDEO_SIMULCAST:
+                if (!parse_max_size(optarg, &opts->video_simulcast)) {
+                    return false;
+                }
+                break;
+            case OPT_VIDEO_DROP_FRAMES:
+                opts->video_drop_frames = true;
+                break;
             default:
                 // getopt prints the error message on stderr
                 return false;
@@ -2982,6 +3451,98 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     v4l2 = !!opts->v4l2_device;
 #endif
 
+    if (opts->stream_replay) {
+        if (opts->stream_dump) {
+            LOGE("Cannot dump a replayed stream");
+            return false;
+        }
+
+        if (otg) {
+            LOGE("OTG mode: could not replay a stream");
+            return false;
+        }
+
+        if (selectors || opts->tcpip || opts->list) {
+            LOGE("No device is used when replaying a stream");
+            return false;
+        }
+
+        if (opts->control) {
+            LOGI("Replaying a stream: control disabled");
+            opts->control = false;
+        }
+    } else if (opts->stream_replay_speed != 1) {
+        LOGE("--stream-replay-speed requires --stream-replay");
+        return false;
+    }
+
+    if (opts->multi_device) {
+        if (selectors || opts->tcpip || otg || opts->stream_replay
+                || opts->list) {
+            LOGE("--multi-device selects the devices itself, it is not "
+                 "compatible with device selection options, --tcpip, --otg, "
+                 "--stream-replay or --list");
+            return false;
+        }
+
+        if (opts->record_filename || opts->stream_dump || v4l2) {
+            // All the sessions would write to the same file or device
+            LOGE("--multi-device is not compatible with --record, "
+                 "--stream-dump or --v4l2-sink");
+            return false;
+        }
+    } else if (opts->multi_device_jobs != 4) {
+        LOGE("--multi-device-jobs requires --multi-device");
+        return false;
+    }
+
+    if (opts->resume_timeout) {
+        if (otg || opts->stream_replay || opts->list) {
+            LOGE("--resume-timeout requires a connection to the server");
+            return false;
+        }
+
+        if (opts->stream_dump) {
+            // The dump would contain several streams
+            LOGE("--resume-timeout is not compatible with --stream-dump");
+            return false;
+        }
+
+        if (opts->kill_adb_on_close) {
+            // The adb server is needed to reconnect
+            LOGE("--resume-timeout is not compatible with --kill-adb-on-close");
+            return false;
+        }
+
+        if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AOA
+                || opts->mouse_input_mode == SC_MOUSE_INPUT_MODE_AOA
+                || opts->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_AOA) {
+            LOGE("--resume-timeout is not compatible with AOA input modes");
+            return false;
+        }
+    }
+
+    if (opts->direct_tcp_port) {
+        if (otg || opts->stream_replay || opts->list) {
+            LOGE("--direct-tcp requires a connection to the server");
+            return false;
+        }
+
+        if (opts->tunnel_host || opts->tunnel_port
+                || opts->force_adb_forward) {
+            LOGE("--direct-tcp does not use the adb tunnel, it is not "
+                 "compatible with --tunnel-host, --tunnel-port or "
+                 "--force-adb-forward");
+            return false;
+        }
+
+        if (opts->server_idle_timeout) {
+            // A running server may only be reached through a forward tunnel
+            LOGE("--direct-tcp is not compatible with --server-idle-timeout");
+            return false;
+        }
+    }
+
     if (!opts->window) {
         // Without window, there cannot be any video playback
         opts->video_playback = false;
@@ -3218,6 +3779,36 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             return false;
         }
 
+        if (opts->skip_unchanged_frames) {
+            LOGE("--skip-unchanged-frames is only available with "
+                 "--video-source=display");
+            return false;
+        }
+
+        if (opts->video_dirty_rects) {
+            LOGE("--video-dirty-rects is only available with "
+                 "--video-source=display");
+            return false;
+        }
+
+        if (opts->video_scale_filter != SC_VIDEO_SCALE_FILTER_DEFAULT) {
+            LOGE("--video-scale-filter is only available with "
+                 "--video-source=display");
+            return false;
+        }
+
+        if (opts->video_sharpen) {
+            LOGE("--video-sharpen is only available with "
+                 "--video-source=display");
+            return false;
+        }
+
+        if (opts->video_simulcast) {
+            LOGE("--video-simulcast is only available with "
+                 "--video-source=display");
+            return false;
+        }
+
         if (opts->camera_id && opts->camera_facing != SC_CAMERA_FACING_ANY) {
             LOGE("Cannot specify both --camera-id and --camera-facing");
             return false;
@@ -3442,6 +4033,22 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("Cannot keep device active if control is disabled");
             return false;
         }
+        if (opts->video_simulcast) {
+            LOGE("Cannot switch the simulcast stream if control is disabled");
+            return false;
+        }
+    }
+
+    if (opts->video_simulcast) {
+        if (!opts->video_playback) {
+            LOGE("--video-simulcast requires video playback");
+            return false;
+        }
+        if (opts->video_dirty_rects) {
+            LOGE("Cannot specify both --video-simulcast and "
+                 "--video-dirty-rects");
+            return false;
+        }
     }
 
 # ifdef _WIN32
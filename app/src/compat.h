@@ -61,6 +61,13 @@
 # define SCRCPY_LAVC_HAS_CODECPAR_CODEC_SIDEDATA
 #endif
 
+// AVPacket.opaque_ref (along with AVPacket.opaque and AVPacket.time_base) has
+// been added during the lavc 59 development cycle; check against the first
+// release providing it (FFmpeg 5.0, lavc 59.18.100).
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(59, 18, 100)
+# define SCRCPY_LAVC_HAS_PACKET_OPAQUE_REF
+#endif
+
 #ifndef HAVE_STRDUP
 char *strdup(const char *s);
 #endif
@@ -194,6 +194,9 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
                                       SC_CONTROL_MSG_SCAN_FILE_PATH_MAX_LENGTH);
             return 1 + len;
         };
+        case SC_CONTROL_MSG_TYPE_SELECT_VIDEO_STREAM:
+            buf[1] = msg->select_video_stream.stream;
+            return 2;
         case SC_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case SC_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case SC_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
@@ -349,6 +352,12 @@ sc_control_msg_log(const struct sc_control_msg *msg) {
         case SC_CONTROL_MSG_TYPE_SCAN_FILE:
             LOG_CMSG("scan file \"%s\"", msg->scan_file.path);
             break;
+        case SC_CONTROL_MSG_TYPE_SELECT_VIDEO_STREAM: {
+            bool is_main =
+                msg->select_video_stream.stream == SC_VIDEO_STREAM_MAIN;
+            LOG_CMSG("select video stream %s", is_main ? "main" : "simulcast");
+            break;
+        }
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
@@ -50,6 +50,12 @@ enum sc_control_msg_type {
     SC_CONTROL_MSG_TYPE_CAMERA_ZOOM_OUT,
     SC_CONTROL_MSG_TYPE_RESIZE_DISPLAY,
     SC_CONTROL_MSG_TYPE_SCAN_FILE,
+    SC_CONTROL_MSG_TYPE_SELECT_VIDEO_STREAM,
+};
+
+enum sc_video_stream {
+    SC_VIDEO_STREAM_MAIN,
+    SC_VIDEO_STREAM_SIMULCAST, // the lower resolution stream
 };
 
 enum sc_copy_key {
@@ -128,6 +134,9 @@ struct sc_control_msg {
         struct {
             char *path; // owned, to be freed by free()
         } scan_file;
+        struct {
+            enum sc_video_stream stream;
+        } select_video_stream;
     };
 };
 
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 
+#include "metrics.h"
 #include "util/log.h"
 
 // Drop droppable events above this limit
@@ -120,8 +121,17 @@ sc_controller_push_msg(struct sc_controller *controller,
     }
     // Otherwise, the msg is discarded
 
+    if (pushed) {
+        sc_metrics_set(SC_METRIC_CONTROLLER_QUEUE_SIZE,
+                       sc_vecdeque_size(&controller->queue));
+    }
+
     sc_mutex_unlock(&controller->mutex);
 
+    if (!pushed) {
+        sc_metrics_add(SC_METRIC_CONTROLLER_DROPPED, 1);
+    }
+
     return pushed;
 }
 
@@ -192,6 +202,8 @@ run_controller(void *data) {
             controller->resize_display.height = 0;
         } else {
             msg = sc_vecdeque_pop(&controller->queue);
+            sc_metrics_set(SC_METRIC_CONTROLLER_QUEUE_SIZE,
+                           sc_vecdeque_size(&controller->queue));
         }
         sc_mutex_unlock(&controller->mutex);
 
@@ -249,3 +261,18 @@ sc_controller_join(struct sc_controller *controller) {
     sc_thread_join(&controller->thread, NULL);
     sc_receiver_join(&controller->receiver);
 }
+
+bool
+sc_controller_resume(struct sc_controller *controller,
+                     sc_socket control_socket) {
+    assert(control_socket != SC_SOCKET_NONE);
+
+    sc_mutex_lock(&controller->mutex);
+    controller->control_socket = control_socket;
+    controller->stopped = false;
+    sc_mutex_unlock(&controller->mutex);
+
+    controller->receiver.control_socket = control_socket;
+
+    return sc_controller_start(controller);
+}
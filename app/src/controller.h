@@ -64,6 +64,15 @@ sc_controller_stop(struct sc_controller *controller);
 void
 sc_controller_join(struct sc_controller *controller);
 
+/**
+ * Restart a stopped (and joined) controller on a new socket
+ *
+ * The pending messages are kept.
+ */
+bool
+sc_controller_resume(struct sc_controller *controller,
+                     sc_socket control_socket);
+
 bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg);
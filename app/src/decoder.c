@@ -4,7 +4,10 @@
 #include <libavcodec/packet.h>
 #include <libavutil/avutil.h>
 
+#include "metrics.h"
+#include "startup.h"
 #include "util/log.h"
+#include "util/tick.h"
 
 /** Downcast packet_sink to decoder */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_decoder, packet_sink)
@@ -51,8 +54,11 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         return true;
     }
 
+    sc_tick submitted = sc_tick_now();
+
     int ret = avcodec_send_packet(decoder->ctx, packet);
     if (ret < 0 && ret != AVERROR(EAGAIN)) {
+        sc_metrics_add(SC_METRIC_DECODER_ERRORS, 1);
         LOGE("Decoder '%s': could not send video packet: %d",
              decoder->name, ret);
         return false;
@@ -65,6 +71,7 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
         }
 
         if (ret) {
+            sc_metrics_add(SC_METRIC_DECODER_ERRORS, 1);
             LOGE("Decoder '%s', could not receive video frame: %d",
                  decoder->name, ret);
             return false;
@@ -95,6 +102,15 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
             }
 
             decoder->frame_size = frame_size;
+
+#ifdef SCRCPY_LAVC_HAS_PACKET_OPAQUE_REF
+            if (packet->opaque_ref && decoder->frame->pts == packet->pts) {
+                // Forward the dirty rects of the packet to its frame (on
+                // allocation failure, the frame is just fully uploaded)
+                av_buffer_unref(&decoder->frame->opaque_ref);
+                decoder->frame->opaque_ref = av_buffer_ref(packet->opaque_ref);
+            }
+#endif
         }
 
         bool ok = sc_frame_source_sinks_push(&decoder->frame_source,
@@ -104,6 +120,11 @@ sc_decoder_push(struct sc_decoder *decoder, const AVPacket *packet) {
             // Error already logged
             return false;
         }
+
+        if (decoder->ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+            sc_metrics_record_decode_latency(sc_tick_now() - submitted);
+            sc_startup_mark(SC_STARTUP_PHASE_FIRST_FRAME_DECODED);
+        }
     }
 
     return true;
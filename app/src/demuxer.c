@@ -2,20 +2,18 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <string.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/channel_layout.h>
 
+#include "dirty_rects.h"
+#include "metrics.h"
+#include "packet_header.h"
 #include "packet_merger.h"
+#include "startup.h"
 #include "util/binary.h"
 #include "util/log.h"
 
-#define SC_PACKET_HEADER_SIZE 12
-
-#define SC_PACKET_FLAG_CONFIG    (UINT64_C(1) << 62)
-#define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 61)
-
-#define SC_PACKET_PTS_MASK (SC_PACKET_FLAG_KEY_FRAME - 1)
-
 static enum AVCodecID
 sc_demuxer_to_avcodec_id(uint32_t codec_id) {
 #define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264" in ASCII
@@ -57,10 +55,26 @@ sc_demuxer_to_avcodec_id(uint32_t codec_id) {
     }
 }
 
+static ssize_t
+sc_demuxer_recv_all(struct sc_demuxer *demuxer, void *buf, size_t len) {
+    ssize_t r;
+    if (demuxer->replay) {
+        r = sc_stream_replay_recv_all(demuxer->replay, buf, len);
+    } else {
+        r = net_recv_all(demuxer->socket, buf, len);
+    }
+
+    if (demuxer->dump && r > 0) {
+        sc_stream_dump_write(demuxer->dump, buf, r);
+    }
+
+    return r;
+}
+
 static bool
 sc_demuxer_recv_codec_id(struct sc_demuxer *demuxer, uint32_t *codec_id) {
     uint8_t data[4];
-    ssize_t r = net_recv_all(demuxer->socket, data, 4);
+    ssize_t r = sc_demuxer_recv_all(demuxer, data, 4);
     if (r < 4) {
         return false;
     }
@@ -106,19 +120,32 @@ sc_demuxer_recv_header(struct sc_demuxer *demuxer,
     // The most significant bits of the PTS are used for packet flags:
     //
     //  byte 0   byte 1   byte 2   byte 3   byte 4   byte 5   byte 6   byte 7
-    // 0CK..... ........ ........ ........ ........ ........ ........ ........
-    // ^^^<------------------------------------------------------------------>
-    // |||                                PTS
-    // || `- key frame
-    // | `-- config packet
-    //  `--- media packet flag
+    // 0CKD.... ........ ........ ........ ........ ........ ........ ........
+    // ^^^^<----------------------------------------------------------------->
+    // ||||                               PTS
+    // ||| `- dirty rects
+    // || `-- key frame
+    // | `--- config packet
+    //  `---- media packet flag
     //
     //  byte 8   byte 9   byte 10  byte 11
     // ........ ........ ........ ........ ........ ........ . . .
     // <---------------------------------> <---------------- . . .
     //            packet size                       raw packet
     //
-    ssize_t r = net_recv_all(demuxer->socket, buf, SC_PACKET_HEADER_SIZE);
+    // If the dirty rects flag is set (only for video frames, if
+    // --video-dirty-rects is enabled), the frame header is followed by the
+    // regions which changed since the previous frame (before the raw packet,
+    // not included in the packet size):
+    //
+    // [. .|. . . . . . . .|. . . . . . . .|...]
+    //  <-> <-------------> <------------->
+    //  count     rect 0          rect 1
+    //
+    // The count is a 16-bit value (at most 16), each rect is 4 16-bit values:
+    // x, y, width and height (in pixels).
+    //
+    ssize_t r = sc_demuxer_recv_all(demuxer, buf, SC_PACKET_HEADER_SIZE);
     assert(r <= SC_PACKET_HEADER_SIZE);
     return r == SC_PACKET_HEADER_SIZE;
 }
@@ -137,42 +164,152 @@ sc_demuxer_parse_session(const uint8_t *header,
     session->video.client_resized = header[3] & 1;
 }
 
+static ssize_t
+sc_demuxer_recv_all_cb(void *userdata, void *buf, size_t len) {
+    struct sc_demuxer *demuxer = userdata;
+    return sc_demuxer_recv_all(demuxer, buf, len);
+}
+
+// On error, eos is set if the error is caused by the end of the stream
 static bool
 sc_demuxer_recv_packet(struct sc_demuxer *demuxer, const uint8_t *header,
-                       AVPacket *packet) {
+                       AVPacket *packet, bool *eos) {
     assert(!sc_demuxer_is_session(header));
-    uint64_t pts_flags = sc_read64be(header);
-    uint32_t len = sc_read32be(&header[8]);
+    *eos = false;
+    struct sc_packet_header ph;
+    sc_packet_header_parse(header, &ph);
+    uint32_t len = ph.len;
     if (!len) {
         LOGE("Invalid packet length: 0");
         return false;
     }
 
+    struct sc_dirty_rects drs;
+    if (ph.dirty_rects) {
+        bool ok = sc_packet_header_recv_dirty_rects(sc_demuxer_recv_all_cb,
+                                                    demuxer, &drs, eos);
+        if (!ok) {
+            return false;
+        }
+    }
+
     if (av_new_packet(packet, len)) {
         LOG_OOM();
         return false;
     }
 
-    ssize_t r = net_recv_all(demuxer->socket, packet->data, len);
+    ssize_t r = sc_demuxer_recv_all(demuxer, packet->data, len);
     if (r < 0 || ((uint32_t) r) < len) {
         av_packet_unref(packet);
+        *eos = true;
         return false;
     }
 
-    if (pts_flags & SC_PACKET_FLAG_CONFIG) {
+    if (ph.config) {
         packet->pts = AV_NOPTS_VALUE;
     } else {
-        packet->pts = pts_flags & SC_PACKET_PTS_MASK;
+        packet->pts = ph.pts;
     }
 
-    if (pts_flags & SC_PACKET_FLAG_KEY_FRAME) {
+    if (ph.key_frame) {
         packet->flags |= AV_PKT_FLAG_KEY;
     }
 
+#ifdef SCRCPY_LAVC_HAS_PACKET_OPAQUE_REF
+    if (ph.dirty_rects) {
+        // Forwarded to the decoded frame by the decoder
+        assert(!packet->opaque_ref);
+        packet->opaque_ref = av_buffer_alloc(sizeof(drs));
+        if (!packet->opaque_ref) {
+            LOG_OOM();
+            av_packet_unref(packet);
+            return false;
+        }
+        memcpy(packet->opaque_ref->data, &drs, sizeof(drs));
+    }
+#endif
+
     packet->dts = packet->pts;
     return true;
 }
 
+static bool
+sc_demuxer_is_stopped(struct sc_demuxer *demuxer) {
+    sc_mutex_lock(&demuxer->resume.mutex);
+    bool stopped = demuxer->resume.stopped;
+    sc_mutex_unlock(&demuxer->resume.mutex);
+    return stopped;
+}
+
+// Wait for the stream to be resumed on a new socket, and receive its header
+//
+// Return false if the demuxer is stopped or if the new stream is incompatible.
+static bool
+sc_demuxer_await_resume(struct sc_demuxer *demuxer, uint32_t raw_codec_id,
+                        struct sc_stream_session *session) {
+    assert(demuxer->resume.enabled);
+
+    for (;;) {
+        sc_mutex_lock(&demuxer->resume.mutex);
+        demuxer->resume.interrupted = true;
+        sc_cond_broadcast(&demuxer->resume.cond);
+        sc_mutex_unlock(&demuxer->resume.mutex);
+
+        LOGD("Demuxer '%s': stream interrupted", demuxer->name);
+        demuxer->resume.cbs->on_interrupted(demuxer,
+                                            demuxer->resume.cbs_userdata);
+
+        sc_mutex_lock(&demuxer->resume.mutex);
+        while (!demuxer->resume.stopped && demuxer->resume.interrupted) {
+            sc_cond_wait(&demuxer->resume.cond, &demuxer->resume.mutex);
+        }
+        bool stopped = demuxer->resume.stopped;
+        sc_mutex_unlock(&demuxer->resume.mutex);
+
+        if (stopped) {
+            return false;
+        }
+
+        // demuxer->socket has been replaced by sc_demuxer_resume()
+        uint32_t codec_id;
+        bool ok = sc_demuxer_recv_codec_id(demuxer, &codec_id);
+        if (!ok) {
+            // Interrupted again
+            continue;
+        }
+
+        if (codec_id != raw_codec_id) {
+            LOGE("Demuxer '%s': the resumed stream has a different codec "
+                 "(0x%08" PRIx32 " instead of 0x%08" PRIx32 ")", demuxer->name,
+                 codec_id, raw_codec_id);
+            return false;
+        }
+
+        if (session) {
+            uint8_t header[SC_PACKET_HEADER_SIZE];
+            ok = sc_demuxer_recv_header(demuxer, header);
+            if (!ok) {
+                continue;
+            }
+
+            if (!sc_demuxer_is_session(header)) {
+                LOGE("Unexpected packet (not a session header)");
+                return false;
+            }
+
+            sc_demuxer_parse_session(header, session);
+            ok = sc_packet_source_sinks_push_session(&demuxer->packet_source,
+                                                     session);
+            if (!ok) {
+                return false;
+            }
+        }
+
+        LOGD("Demuxer '%s': stream resumed", demuxer->name);
+        return true;
+    }
+}
+
 static int
 run_demuxer(void *data) {
     struct sc_demuxer *demuxer = data;
@@ -297,9 +434,44 @@ run_demuxer(void *data) {
         goto finally_close_sinks;
     }
 
+    bool video = codec->type == AVMEDIA_TYPE_VIDEO;
+    if (video) {
+        sc_startup_mark(SC_STARTUP_PHASE_VIDEO_CODEC_RECEIVED);
+    }
+
+    enum sc_metric metric_packets = video ? SC_METRIC_VIDEO_PACKETS
+                                          : SC_METRIC_AUDIO_PACKETS;
+    enum sc_metric metric_bytes = video ? SC_METRIC_VIDEO_BYTES
+                                        : SC_METRIC_AUDIO_BYTES;
+
+    // Only used by resumable demuxers
+    bool splicing = false; // drop the video packets until the next key frame
+    bool rebase_pts = false; // compute pts_offset on the next media packet
+    int64_t pts_offset = 0;
+    int64_t last_pts = AV_NOPTS_VALUE;
+    sc_tick last_packet_time = 0;
+
+    struct sc_packet_size_stats packet_size_stats;
+    sc_packet_size_stats_init(&packet_size_stats);
+
     for (;;) {
         bool ok = sc_demuxer_recv_header(demuxer, header);
         if (!ok) {
+            if (demuxer->resume.enabled) {
+                ok = sc_demuxer_await_resume(demuxer, raw_codec_id,
+                                             video ? &session_data : NULL);
+                if (ok) {
+                    splicing = video;
+                    rebase_pts = true;
+                    continue;
+                }
+
+                if (!sc_demuxer_is_stopped(demuxer)) {
+                    // Incompatible resumed stream
+                    break;
+                }
+            }
+
             // end of stream
             status = SC_DEMUXER_STATUS_EOS;
             break;
@@ -314,11 +486,57 @@ run_demuxer(void *data) {
                 break;
             }
         } else {
-            bool ok = sc_demuxer_recv_packet(demuxer, header, packet);
+            bool eos;
+            bool ok = sc_demuxer_recv_packet(demuxer, header, packet, &eos);
             if (!ok) {
+                if (eos && demuxer->resume.enabled) {
+                    // The connection is lost, the next header read will fail
+                    // and wait for the resumption
+                    continue;
+                }
                 break;
             }
 
+            sc_metrics_add(metric_packets, 1);
+            sc_metrics_add(metric_bytes, packet->size);
+            if (video) {
+                sc_metrics_record_video_packet_size(&packet_size_stats,
+                                                    packet->size,
+                                                    sc_tick_now());
+            }
+
+            if (video) {
+                sc_startup_mark(SC_STARTUP_PHASE_FIRST_VIDEO_PACKET);
+            }
+
+            bool is_config = packet->pts == AV_NOPTS_VALUE;
+            if (splicing && !is_config) {
+                if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                    // Only splice the resumed stream at a key frame (keep any
+                    // pending config packet in the merger)
+                    av_packet_unref(packet);
+                    continue;
+                }
+                splicing = false;
+            }
+
+            if (demuxer->resume.enabled && !is_config) {
+                sc_tick now = sc_tick_now();
+                if (rebase_pts) {
+                    if (last_pts != AV_NOPTS_VALUE) {
+                        // Keep the timestamps continuous (and increasing) over
+                        // the interruption
+                        sc_tick gap = MAX(now - last_packet_time, 1);
+                        pts_offset = last_pts + gap - packet->pts;
+                    }
+                    rebase_pts = false;
+                }
+                packet->pts += pts_offset;
+                packet->dts = packet->pts;
+                last_pts = packet->pts;
+                last_packet_time = now;
+            }
+
             if (must_merge_config_packet) {
                 // Prepend any config packet to the next media packet
                 ok = sc_packet_merger_merge(&merger, packet);
@@ -349,6 +567,13 @@ finally_close_sinks:
 finally_free_context:
     avcodec_free_context(&codec_ctx);
 end:
+    if (demuxer->resume.enabled) {
+        sc_mutex_lock(&demuxer->resume.mutex);
+        demuxer->resume.ended = true;
+        sc_cond_broadcast(&demuxer->resume.cond);
+        sc_mutex_unlock(&demuxer->resume.mutex);
+    }
+
     demuxer->cbs->on_ended(demuxer, status, demuxer->cbs_userdata);
 
     return 0;
@@ -361,12 +586,118 @@ sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
 
     demuxer->name = name; // statically allocated
     demuxer->socket = socket;
+    demuxer->replay = NULL;
+    demuxer->dump = NULL;
+    sc_packet_source_init(&demuxer->packet_source);
+
+    assert(cbs && cbs->on_ended);
+
+    demuxer->cbs = cbs;
+    demuxer->cbs_userdata = cbs_userdata;
+
+    demuxer->resume.enabled = false;
+}
+
+void
+sc_demuxer_init_replay(struct sc_demuxer *demuxer, const char *name,
+                       struct sc_stream_replay *replay,
+                       const struct sc_demuxer_callbacks *cbs,
+                       void *cbs_userdata) {
+    assert(replay);
+
+    demuxer->name = name; // statically allocated
+    demuxer->socket = SC_SOCKET_NONE;
+    demuxer->replay = replay;
+    demuxer->dump = NULL;
     sc_packet_source_init(&demuxer->packet_source);
 
     assert(cbs && cbs->on_ended);
 
     demuxer->cbs = cbs;
     demuxer->cbs_userdata = cbs_userdata;
+
+    demuxer->resume.enabled = false;
+}
+
+void
+sc_demuxer_set_dump(struct sc_demuxer *demuxer, struct sc_stream_dump *dump) {
+    demuxer->dump = dump;
+}
+
+bool
+sc_demuxer_init_resume(struct sc_demuxer *demuxer,
+                       const struct sc_demuxer_resume_callbacks *cbs,
+                       void *cbs_userdata) {
+    assert(!demuxer->replay);
+    assert(cbs && cbs->on_interrupted);
+
+    bool ok = sc_mutex_init(&demuxer->resume.mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&demuxer->resume.cond);
+    if (!ok) {
+        sc_mutex_destroy(&demuxer->resume.mutex);
+        return false;
+    }
+
+    demuxer->resume.stopped = false;
+    demuxer->resume.interrupted = false;
+    demuxer->resume.ended = false;
+    demuxer->resume.cbs = cbs;
+    demuxer->resume.cbs_userdata = cbs_userdata;
+    demuxer->resume.enabled = true;
+
+    return true;
+}
+
+void
+sc_demuxer_destroy_resume(struct sc_demuxer *demuxer) {
+    assert(demuxer->resume.enabled);
+    sc_cond_destroy(&demuxer->resume.cond);
+    sc_mutex_destroy(&demuxer->resume.mutex);
+    demuxer->resume.enabled = false;
+}
+
+bool
+sc_demuxer_await_interrupted(struct sc_demuxer *demuxer) {
+    assert(demuxer->resume.enabled);
+
+    sc_mutex_lock(&demuxer->resume.mutex);
+    while (!demuxer->resume.stopped && !demuxer->resume.ended
+            && !demuxer->resume.interrupted) {
+        sc_cond_wait(&demuxer->resume.cond, &demuxer->resume.mutex);
+    }
+    bool interrupted = demuxer->resume.interrupted
+                    && !demuxer->resume.stopped;
+    sc_mutex_unlock(&demuxer->resume.mutex);
+
+    return interrupted;
+}
+
+void
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket) {
+    assert(demuxer->resume.enabled);
+    assert(socket != SC_SOCKET_NONE);
+
+    sc_mutex_lock(&demuxer->resume.mutex);
+    if (demuxer->resume.interrupted) {
+        demuxer->socket = socket;
+        demuxer->resume.interrupted = false;
+        sc_cond_broadcast(&demuxer->resume.cond);
+    }
+    sc_mutex_unlock(&demuxer->resume.mutex);
+}
+
+void
+sc_demuxer_stop(struct sc_demuxer *demuxer) {
+    assert(demuxer->resume.enabled);
+
+    sc_mutex_lock(&demuxer->resume.mutex);
+    demuxer->resume.stopped = true;
+    sc_cond_broadcast(&demuxer->resume.cond);
+    sc_mutex_unlock(&demuxer->resume.mutex);
 }
 
 bool
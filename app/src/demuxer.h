@@ -5,9 +5,12 @@
 
 #include <stdbool.h>
 
+#include "stream_dump.h"
+#include "stream_replay.h"
 #include "trait/packet_source.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 struct sc_demuxer {
     struct sc_packet_source packet_source; // packet source trait
@@ -15,10 +18,27 @@ struct sc_demuxer {
     const char *name; // must be statically allocated (e.g. a string literal)
 
     sc_socket socket;
+    // If set, the stream is read from a dump instead of the socket
+    struct sc_stream_replay *replay;
+    // If set, all the bytes received are also written to this dump
+    struct sc_stream_dump *dump;
     sc_thread thread;
 
     const struct sc_demuxer_callbacks *cbs;
     void *cbs_userdata;
+
+    // Only initialized if the demuxer is resumable
+    struct {
+        bool enabled;
+        sc_mutex mutex;
+        sc_cond cond;
+        bool stopped;
+        bool interrupted; // waiting for sc_demuxer_resume()
+        bool ended;
+
+        const struct sc_demuxer_resume_callbacks *cbs;
+        void *cbs_userdata;
+    } resume;
 };
 
 enum sc_demuxer_status {
@@ -32,11 +52,70 @@ struct sc_demuxer_callbacks {
                      void *userdata);
 };
 
+struct sc_demuxer_resume_callbacks {
+    /**
+     * Called from the demuxer thread when the stream is interrupted (the
+     * socket is closed)
+     *
+     * The demuxer then waits for sc_demuxer_resume() or sc_demuxer_stop().
+     */
+    void (*on_interrupted)(struct sc_demuxer *demuxer, void *userdata);
+};
+
 // The name must be statically allocated (e.g. a string literal)
 void
 sc_demuxer_init(struct sc_demuxer *demuxer, const char *name, sc_socket socket,
                 const struct sc_demuxer_callbacks *cbs, void *cbs_userdata);
 
+// Read the stream from a dump file instead of a socket
+// The name must be statically allocated (e.g. a string literal)
+void
+sc_demuxer_init_replay(struct sc_demuxer *demuxer, const char *name,
+                       struct sc_stream_replay *replay,
+                       const struct sc_demuxer_callbacks *cbs,
+                       void *cbs_userdata);
+
+// Tee all the bytes received to a dump (must be called before start)
+void
+sc_demuxer_set_dump(struct sc_demuxer *demuxer, struct sc_stream_dump *dump);
+
+/**
+ * Make the demuxer resumable (must be called before start)
+ *
+ * On end-of-stream, the sinks are not closed: the demuxer waits for the stream
+ * to be resumed on a new socket (with the same codec), and splices the new
+ * stream at its first key frame (the timestamps are shifted to be continuous).
+ */
+bool
+sc_demuxer_init_resume(struct sc_demuxer *demuxer,
+                       const struct sc_demuxer_resume_callbacks *cbs,
+                       void *cbs_userdata);
+
+void
+sc_demuxer_destroy_resume(struct sc_demuxer *demuxer);
+
+/**
+ * Wait until the demuxer is interrupted (resumable demuxers only)
+ *
+ * Return false if the demuxer is terminated or stopped.
+ */
+bool
+sc_demuxer_await_interrupted(struct sc_demuxer *demuxer);
+
+/**
+ * Resume an interrupted demuxer on a new socket
+ */
+void
+sc_demuxer_resume(struct sc_demuxer *demuxer, sc_socket socket);
+
+/**
+ * Stop waiting for a resumption (resumable demuxers only)
+ *
+ * The demuxer will terminate at the end of the current stream.
+ */
+void
+sc_demuxer_stop(struct sc_demuxer *demuxer);
+
 bool
 sc_demuxer_start(struct sc_demuxer *demuxer);
 
@@ -0,0 +1,62 @@
+#include "dirty_rects.h"
+
+#include "util/binary.h"
+
+bool
+sc_dirty_rects_parse(struct sc_dirty_rects *drs, const uint8_t *data,
+                     unsigned count) {
+    if (count > SC_DIRTY_RECTS_MAX) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        const uint8_t *buf = &data[i * SC_DIRTY_RECT_SERIALIZED_SIZE];
+        struct sc_dirty_rect *rect = &drs->rects[i];
+        rect->x = sc_read16be(buf);
+        rect->y = sc_read16be(&buf[2]);
+        rect->width = sc_read16be(&buf[4]);
+        rect->height = sc_read16be(&buf[6]);
+    }
+
+    drs->count = count;
+    return true;
+}
+
+bool
+sc_dirty_rect_align(const struct sc_dirty_rect *rect, struct sc_size frame_size,
+                    struct sc_dirty_rect *out) {
+    uint32_t x0 = rect->x;
+    uint32_t y0 = rect->y;
+    uint32_t x1 = x0 + rect->width;
+    uint32_t y1 = y0 + rect->height;
+
+    if (x1 > frame_size.width) {
+        x1 = frame_size.width;
+    }
+    if (y1 > frame_size.height) {
+        y1 = frame_size.height;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    // Round down the start and round up the end to even values, without
+    // exceeding the frame (if its size is odd, the last chroma sample covers
+    // a single column or row)
+    x0 &= ~UINT32_C(1);
+    y0 &= ~UINT32_C(1);
+    x1 = (x1 + 1) & ~UINT32_C(1);
+    y1 = (y1 + 1) & ~UINT32_C(1);
+    if (x1 > frame_size.width) {
+        x1 = frame_size.width;
+    }
+    if (y1 > frame_size.height) {
+        y1 = frame_size.height;
+    }
+
+    out->x = x0;
+    out->y = y0;
+    out->width = x1 - x0;
+    out->height = y1 - y0;
+    return true;
+}
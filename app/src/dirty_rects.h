@@ -0,0 +1,56 @@
+#ifndef SC_DIRTY_RECTS_H
+#define SC_DIRTY_RECTS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "coords.h"
+
+/**
+ * The server may send, along with a video packet, the regions of the frame
+ * which changed since the previous frame (see --video-dirty-rects).
+ *
+ * Outside these regions, the decoded frame is (almost) identical to the
+ * previous one, so only these regions need to be uploaded to the texture.
+ */
+
+#define SC_DIRTY_RECTS_MAX 16
+
+// The serialized size of one rectangle: x, y, width and height (u16 each)
+#define SC_DIRTY_RECT_SERIALIZED_SIZE 8
+
+struct sc_dirty_rect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct sc_dirty_rects {
+    unsigned count;
+    struct sc_dirty_rect rects[SC_DIRTY_RECTS_MAX];
+};
+
+/**
+ * Parse count rectangles (count * SC_DIRTY_RECT_SERIALIZED_SIZE bytes, in
+ * big-endian)
+ *
+ * Return false if count exceeds SC_DIRTY_RECTS_MAX.
+ */
+bool
+sc_dirty_rects_parse(struct sc_dirty_rects *drs, const uint8_t *data,
+                     unsigned count);
+
+/**
+ * Clip the rectangle to the frame, and expand it to even coordinates (the
+ * chroma planes are subsampled by 2 in both dimensions)
+ *
+ * Return false if the resulting rectangle is empty.
+ */
+bool
+sc_dirty_rect_align(const struct sc_dirty_rect *rect, struct sc_size frame_size,
+                    struct sc_dirty_rect *out);
+
+#endif
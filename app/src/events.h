@@ -21,6 +21,8 @@ enum {
     SC_EVENT_AOA_OPEN_ERROR,
     SC_EVENT_DISCONNECTED_ICON_LOADED,
     SC_EVENT_DISCONNECTED_TIMEOUT,
+    SC_EVENT_SESSION_INTERRUPTED,
+    SC_EVENT_SESSION_RESUMED,
 };
 
 bool
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include "metrics.h"
 #include "util/log.h"
 
 #define SC_FPS_COUNTER_INTERVAL SC_TICK_FROM_SEC(1)
@@ -161,6 +162,8 @@ sc_fps_counter_join(struct sc_fps_counter *counter) {
 
 void
 sc_fps_counter_add_rendered_frame(struct sc_fps_counter *counter) {
+    sc_metrics_add(SC_METRIC_FRAMES_RENDERED, 1);
+
     if (!is_started(counter)) {
         return;
     }
@@ -174,6 +177,8 @@ sc_fps_counter_add_rendered_frame(struct sc_fps_counter *counter) {
 
 void
 sc_fps_counter_add_skipped_frame(struct sc_fps_counter *counter) {
+    sc_metrics_add(SC_METRIC_FRAMES_SKIPPED, 1);
+
     if (!is_started(counter)) {
         return;
     }
@@ -256,6 +256,24 @@ sc_hid_gamepad_generate_open(struct sc_hid_gamepad *hid,
     return true;
 }
 
+bool
+sc_hid_gamepad_generate_reopen(struct sc_hid_gamepad *hid,
+                               struct sc_hid_open *hid_open, size_t slot_idx) {
+    assert(slot_idx < SC_MAX_GAMEPADS);
+    struct sc_hid_gamepad_slot *slot = &hid->slots[slot_idx];
+    if (slot->gamepad_id == SC_GAMEPAD_ID_INVALID) {
+        return false;
+    }
+
+    sc_hid_gamepad_slot_init(slot, slot->gamepad_id);
+
+    hid_open->hid_id = sc_hid_gamepad_slot_get_id(slot_idx);
+    hid_open->report_desc = SC_HID_GAMEPAD_REPORT_DESC;
+    hid_open->report_desc_size = sizeof(SC_HID_GAMEPAD_REPORT_DESC);
+
+    return true;
+}
+
 bool
 sc_hid_gamepad_generate_close(struct sc_hid_gamepad *hid,
                               struct sc_hid_close *hid_close,
@@ -4,6 +4,7 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "hid/hid_event.h"
@@ -41,6 +42,16 @@ sc_hid_gamepad_generate_close(struct sc_hid_gamepad *hid,
                               struct sc_hid_close *hid_close,
                               uint32_t gamepad_id);
 
+/**
+ * Generate the open of the gamepad in slot `slot_idx` again, with its state
+ * reset (to re-create the device on a new server)
+ *
+ * Return false if the slot is empty.
+ */
+bool
+sc_hid_gamepad_generate_reopen(struct sc_hid_gamepad *hid,
+                               struct sc_hid_open *hid_open, size_t slot_idx);
+
 bool
 sc_hid_gamepad_generate_input_from_button(struct sc_hid_gamepad *hid,
                                           struct sc_hid_input *hid_input,
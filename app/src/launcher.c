@@ -0,0 +1,492 @@
+#include "launcher.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adb/adb.h"
+#include "server.h"
+#include "util/intr.h"
+#include "util/log.h"
+#include "util/process.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+#define SC_LAUNCHER_MAX_JOBS 64
+
+struct sc_launcher_device {
+    char *serial;
+    struct sc_port_range port_range;
+    uint16_t metrics_port; // 0 if the metrics endpoint is disabled
+
+    // Written by a worker thread, read after the workers are joined
+    bool started;
+    sc_pid pid;
+    sc_tick push_duration;
+    sc_tick start_time; // relative to the launcher start
+};
+
+struct sc_launcher {
+    const struct scrcpy_options *options;
+    int argc;
+    char **argv;
+
+    struct sc_launcher_device *devices;
+    size_t count;
+
+    // Index of the next device to process by a worker
+    atomic_size_t next;
+
+    sc_tick start;
+};
+
+static bool
+sc_launcher_add_device(struct sc_launcher *launcher, const char *serial,
+                       size_t len) {
+    struct sc_launcher_device *device = &launcher->devices[launcher->count];
+    device->serial = malloc(len + 1);
+    if (!device->serial) {
+        LOG_OOM();
+        return false;
+    }
+
+    memcpy(device->serial, serial, len);
+    device->serial[len] = '\0';
+    device->started = false;
+    device->metrics_port = 0;
+    device->pid = SC_PROCESS_NONE;
+    device->push_duration = -1;
+    device->start_time = -1;
+    ++launcher->count;
+    return true;
+}
+
+static bool
+sc_launcher_parse_serials(struct sc_launcher *launcher, const char *list) {
+    size_t max = 1;
+    for (const char *c = list; *c; ++c) {
+        if (*c == ',') {
+            ++max;
+        }
+    }
+
+    launcher->devices = malloc(max * sizeof(*launcher->devices));
+    if (!launcher->devices) {
+        LOG_OOM();
+        return false;
+    }
+
+    const char *s = list;
+    for (;;) {
+        size_t len = strcspn(s, ",");
+        if (len) {
+            if (!sc_launcher_add_device(launcher, s, len)) {
+                return false;
+            }
+        }
+        if (!s[len]) {
+            break;
+        }
+        s += len + 1;
+    }
+
+    return true;
+}
+
+static bool
+sc_launcher_list_serials(struct sc_launcher *launcher, struct sc_intr *intr) {
+    struct sc_vec_adb_devices vec = SC_VECTOR_INITIALIZER;
+    bool ok = sc_adb_list_devices(intr, 0, &vec);
+    if (!ok) {
+        LOGE("Could not list ADB devices");
+        return false;
+    }
+
+    if (vec.size) {
+        launcher->devices = malloc(vec.size * sizeof(*launcher->devices));
+        if (!launcher->devices) {
+            LOG_OOM();
+            sc_adb_devices_destroy(&vec);
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < vec.size; ++i) {
+        struct sc_adb_device *d = &vec.data[i];
+        if (strcmp(d->state, "device")) {
+            LOGW("Ignoring device %s (%s)", d->serial, d->state);
+            continue;
+        }
+
+        if (!sc_launcher_add_device(launcher, d->serial, strlen(d->serial))) {
+            sc_adb_devices_destroy(&vec);
+            return false;
+        }
+    }
+
+    sc_adb_devices_destroy(&vec);
+    return true;
+}
+
+static bool
+sc_launcher_allocate_ports(struct sc_launcher *launcher) {
+    // Assign a distinct part of the port range to each device, so that the
+    // sessions started in parallel do not compete for the same ports
+    const struct sc_port_range *range = &launcher->options->port_range;
+    uint32_t size = range->last - range->first + 1;
+    uint32_t per_device = MAX(size / launcher->count, 1);
+
+    for (size_t i = 0; i < launcher->count; ++i) {
+        uint32_t first = range->first + i * per_device;
+        uint32_t last = first + per_device - 1;
+        if (last > 0xFFFF) {
+            LOGE("Not enough ports for %" PRIu64 " devices",
+                 (uint64_t) launcher->count);
+            return false;
+        }
+
+        launcher->devices[i].port_range.first = first;
+        launcher->devices[i].port_range.last = last;
+    }
+
+    // Each session binds its own metrics endpoint, on consecutive ports
+    uint16_t metrics_port = launcher->options->metrics_port;
+    if (metrics_port) {
+        if (metrics_port + launcher->count - 1 > 0xFFFF) {
+            LOGE("Not enough metrics ports for %" PRIu64 " devices",
+                 (uint64_t) launcher->count);
+            return false;
+        }
+
+        for (size_t i = 0; i < launcher->count; ++i) {
+            launcher->devices[i].metrics_port = metrics_port + i;
+        }
+    }
+
+    if (size < launcher->count) {
+        LOGW("Port range too small for %" PRIu64 " devices, extended to "
+             "%" PRIu16 ":%" PRIu16, (uint64_t) launcher->count, range->first,
+             launcher->devices[launcher->count - 1].port_range.last);
+    }
+
+    return true;
+}
+
+static bool
+sc_launcher_is_own_arg(const char *arg) {
+    return !strncmp(arg, "--multi-device", sizeof("--multi-device") - 1);
+}
+
+static char *
+sc_launcher_format_arg(const char *fmt, const char *value) {
+    size_t len = strlen(fmt) + strlen(value) + 1;
+    char *arg = malloc(len);
+    if (!arg) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    int r = snprintf(arg, len, fmt, value);
+    assert(r >= 0 && (size_t) r < len);
+    (void) r;
+    return arg;
+}
+
+static char *
+sc_launcher_format_profile_arg(const char *prefix, const char *serial) {
+#define OPTION "--startup-profile="
+    size_t prefix_len = sizeof(OPTION) - 1 + strlen(prefix) + 1;
+    size_t serial_len = strlen(serial);
+    size_t len = prefix_len + serial_len + sizeof(".json");
+    char *arg = malloc(len);
+    if (!arg) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    int r = snprintf(arg, len, OPTION "%s-%s.json", prefix, serial);
+    assert(r >= 0 && (size_t) r < len);
+    (void) r;
+#undef OPTION
+
+    // The serial may contain characters not allowed in a filename (for
+    // example ':' for TCP/IP devices)
+    for (size_t i = prefix_len; i < prefix_len + serial_len; ++i) {
+        if (arg[i] == ':' || arg[i] == '/' || arg[i] == '\\') {
+            arg[i] = '_';
+        }
+    }
+
+    return arg;
+}
+
+static bool
+sc_launcher_execute(struct sc_launcher *launcher,
+                    struct sc_launcher_device *device) {
+    // argv[0], the forwarded arguments, --serial, --port, --metrics-port,
+    // --startup-profile and the NULL terminator
+    const char **argv = malloc((launcher->argc + 5) * sizeof(*argv));
+    if (!argv) {
+        LOG_OOM();
+        return false;
+    }
+
+    char port_range[sizeof("65535:65535")];
+    int r = snprintf(port_range, sizeof(port_range), "%" PRIu16 ":%" PRIu16,
+                     device->port_range.first, device->port_range.last);
+    assert(r >= 0 && (size_t) r < sizeof(port_range));
+    (void) r;
+
+    char *serial_arg = sc_launcher_format_arg("--serial=%s", device->serial);
+    char *port_arg = sc_launcher_format_arg("--port=%s", port_range);
+    char *metrics_port_arg = NULL;
+    if (device->metrics_port) {
+        char metrics_port[sizeof("65535")];
+        r = snprintf(metrics_port, sizeof(metrics_port), "%" PRIu16,
+                     device->metrics_port);
+        assert(r >= 0 && (size_t) r < sizeof(metrics_port));
+        metrics_port_arg =
+            sc_launcher_format_arg("--metrics-port=%s", metrics_port);
+    }
+    char *profile_arg = NULL;
+    const char *profile_prefix = launcher->options->startup_profile;
+    if (profile_prefix) {
+        profile_arg =
+            sc_launcher_format_profile_arg(profile_prefix, device->serial);
+    }
+
+    bool ok = false;
+    if (!serial_arg || !port_arg || (device->metrics_port && !metrics_port_arg)
+            || (profile_prefix && !profile_arg)) {
+        goto end;
+    }
+
+    int argc = 0;
+    argv[argc++] = launcher->argv[0];
+    for (int i = 1; i < launcher->argc; ++i) {
+        const char *arg = launcher->argv[i];
+        if (sc_launcher_is_own_arg(arg)) {
+            if (!strcmp(arg, "--multi-device-jobs")) {
+                // Also skip its argument
+                ++i;
+            }
+            continue;
+        }
+        argv[argc++] = arg;
+    }
+    // The last occurrence of an option overrides the previous ones
+    argv[argc++] = serial_arg;
+    argv[argc++] = port_arg;
+    if (metrics_port_arg) {
+        argv[argc++] = metrics_port_arg;
+    }
+    if (profile_arg) {
+        argv[argc++] = profile_arg;
+    }
+    argv[argc] = NULL;
+
+    enum sc_process_result pr = sc_process_execute(argv, &device->pid, 0);
+    if (pr != SC_PROCESS_SUCCESS) {
+        LOGE("Could not start scrcpy for device %s", device->serial);
+        goto end;
+    }
+
+    ok = true;
+
+end:
+    free(profile_arg);
+    free(metrics_port_arg);
+    free(port_arg);
+    free(serial_arg);
+    free(argv);
+    return ok;
+}
+
+static void
+sc_launcher_process_device(struct sc_launcher *launcher,
+                           struct sc_launcher_device *device,
+                           struct sc_intr *intr) {
+    LOGD("Preparing device %s", device->serial);
+
+    sc_tick start = sc_tick_now();
+    char device_path[SC_DEVICE_SERVER_PATH_LENGTH];
+    bool ok = sc_server_push(intr, device->serial, device_path,
+                             sizeof(device_path));
+    if (!ok) {
+        LOGE("Could not push the server to device %s", device->serial);
+        return;
+    }
+
+    sc_tick now = sc_tick_now();
+    device->push_duration = now - start;
+
+    ok = sc_launcher_execute(launcher, device);
+    if (!ok) {
+        return;
+    }
+
+    device->start_time = now - launcher->start;
+    device->started = true;
+}
+
+static int
+run_launcher_worker(void *data) {
+    struct sc_launcher *launcher = data;
+
+    struct sc_intr intr;
+    if (!sc_intr_init(&intr)) {
+        return -1;
+    }
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&launcher->next, 1);
+        if (index >= launcher->count) {
+            break;
+        }
+
+        sc_launcher_process_device(launcher, &launcher->devices[index], &intr);
+    }
+
+    sc_intr_destroy(&intr);
+    return 0;
+}
+
+static void
+sc_launcher_log_summary(struct sc_launcher *launcher) {
+    LOGI("Devices:");
+    for (size_t i = 0; i < launcher->count; ++i) {
+        struct sc_launcher_device *device = &launcher->devices[i];
+        if (device->started) {
+            LOGI("    %-24s ports %" PRIu16 ":%" PRIu16 ", pushed in %"
+                 PRItick " ms, started at %" PRItick " ms", device->serial,
+                 device->port_range.first, device->port_range.last,
+                 SC_TICK_TO_MS(device->push_duration),
+                 SC_TICK_TO_MS(device->start_time));
+            if (device->metrics_port) {
+                LOGI("    %-24s metrics port %" PRIu16, "",
+                     device->metrics_port);
+            }
+        } else {
+            LOGI("    %-24s failed", device->serial);
+        }
+    }
+}
+
+static bool
+sc_launcher_wait(struct sc_launcher *launcher) {
+    bool success = true;
+    for (size_t i = 0; i < launcher->count; ++i) {
+        struct sc_launcher_device *device = &launcher->devices[i];
+        if (!device->started) {
+            success = false;
+            continue;
+        }
+
+        sc_exit_code code = sc_process_wait(device->pid, true);
+        if (code) {
+            LOGW("scrcpy for device %s terminated with exit code %"
+                 SC_PRIexitcode, device->serial, code);
+            success = false;
+        } else {
+            LOGD("scrcpy for device %s terminated", device->serial);
+        }
+    }
+
+    return success;
+}
+
+enum scrcpy_exit_code
+sc_launcher(const struct scrcpy_options *options, int argc, char *argv[]) {
+    struct sc_launcher launcher = {
+        .options = options,
+        .argc = argc,
+        .argv = argv,
+        .devices = NULL,
+        .count = 0,
+        .start = sc_tick_now(),
+    };
+    atomic_init(&launcher.next, 0);
+
+    enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
+
+    if (!sc_adb_init()) {
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    struct sc_intr intr;
+    if (!sc_intr_init(&intr)) {
+        sc_adb_destroy();
+        return SCRCPY_EXIT_FAILURE;
+    }
+
+    // Start the adb server once, instead of letting each session race to
+    // start it
+    bool ok = sc_adb_start_server(&intr, 0);
+    if (!ok) {
+        LOGE("Could not start adb server");
+        goto end;
+    }
+
+    const char *serials = options->multi_device;
+    assert(serials);
+    ok = *serials ? sc_launcher_parse_serials(&launcher, serials)
+                  : sc_launcher_list_serials(&launcher, &intr);
+    if (!ok) {
+        goto end;
+    }
+
+    if (!launcher.count) {
+        LOGE("Could not find any ADB device");
+        goto end;
+    }
+
+    ok = sc_launcher_allocate_ports(&launcher);
+    if (!ok) {
+        goto end;
+    }
+
+    unsigned jobs = MIN(options->multi_device_jobs, launcher.count);
+    jobs = MIN(jobs, SC_LAUNCHER_MAX_JOBS);
+    LOGI("Starting %" PRIu64 " sessions (%u in parallel)",
+         (uint64_t) launcher.count, jobs);
+
+    sc_thread threads[SC_LAUNCHER_MAX_JOBS];
+    unsigned started_threads = 0;
+    for (unsigned i = 0; i < jobs; ++i) {
+        ok = sc_thread_create(&threads[i], run_launcher_worker, "scrcpy-launch",
+                              &launcher);
+        if (!ok) {
+            LOGE("Could not start launcher thread");
+            break;
+        }
+        ++started_threads;
+    }
+
+    if (!started_threads) {
+        goto end;
+    }
+
+    // If some threads could not be started, the others process all the
+    // devices anyway
+    for (unsigned i = 0; i < started_threads; ++i) {
+        sc_thread_join(&threads[i], NULL);
+    }
+
+    sc_launcher_log_summary(&launcher);
+
+    ok = sc_launcher_wait(&launcher);
+    ret = ok ? SCRCPY_EXIT_SUCCESS : SCRCPY_EXIT_FAILURE;
+
+end:
+    for (size_t i = 0; i < launcher.count; ++i) {
+        free(launcher.devices[i].serial);
+    }
+    free(launcher.devices);
+    sc_intr_destroy(&intr);
+    sc_adb_destroy();
+
+    return ret;
+}
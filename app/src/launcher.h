@@ -0,0 +1,23 @@
+#ifndef SC_LAUNCHER_H
+#define SC_LAUNCHER_H
+
+#include "common.h"
+
+#include "options.h"
+#include "scrcpy.h"
+
+/**
+ * Start one scrcpy session per device (--multi-device)
+ *
+ * The adb server is started and the devices are listed only once. The server
+ * is pushed to the devices concurrently (by at most options->multi_device_jobs
+ * threads), and each device is mirrored by a separate scrcpy process (executed
+ * with the same arguments, a specific serial and a specific port range) as soon
+ * as the server has been pushed to it.
+ *
+ * Block until all the sessions are terminated.
+ */
+enum scrcpy_exit_code
+sc_launcher(const struct scrcpy_options *options, int argc, char *argv[]);
+
+#endif
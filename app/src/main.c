@@ -9,6 +9,7 @@
 
 #include "cli.h"
 #include "events.h"
+#include "launcher.h"
 #include "options.h"
 #include "scrcpy.h"
 #ifdef HAVE_USB
@@ -93,6 +94,12 @@ main_scrcpy(int argc, char *argv[]) {
 
     sc_log_configure();
 
+    if (args.opts.multi_device) {
+        // The sessions are run by separate scrcpy processes
+        ret = sc_launcher(&args.opts, argc, argv);
+        goto net_cleanup;
+    }
+
     if (!sc_main_thread_init()) {
         ret = SCRCPY_EXIT_FAILURE;
         goto net_cleanup;
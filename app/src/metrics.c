@@ -0,0 +1,441 @@
+#include "metrics.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+struct sc_metric_def {
+    // Prometheus metric family name
+    const char *name;
+    // Prometheus labels (may be NULL)
+    const char *labels;
+    bool gauge;
+    const char *help;
+    // Key in the JSON object
+    const char *key;
+};
+
+// Metrics of the same family must be consecutive
+static const struct sc_metric_def sc_metric_defs[SC_METRIC_COUNT] = {
+    [SC_METRIC_FRAMES_RENDERED] = {
+        .name = "scrcpy_frames_rendered_total",
+        .help = "Number of video frames rendered",
+        .key = "frames_rendered",
+    },
+    [SC_METRIC_FRAMES_SKIPPED] = {
+        .name = "scrcpy_frames_skipped_total",
+        .help = "Number of video frames skipped before being rendered",
+        .key = "frames_skipped",
+    },
+    [SC_METRIC_VIDEO_PACKETS] = {
+        .name = "scrcpy_demuxer_packets_total",
+        .labels = "stream=\"video\"",
+        .help = "Number of packets received by the demuxer",
+        .key = "video_packets",
+    },
+    [SC_METRIC_AUDIO_PACKETS] = {
+        .name = "scrcpy_demuxer_packets_total",
+        .labels = "stream=\"audio\"",
+        .key = "audio_packets",
+    },
+    [SC_METRIC_VIDEO_BYTES] = {
+        .name = "scrcpy_demuxer_bytes_total",
+        .labels = "stream=\"video\"",
+        .help = "Number of packet payload bytes received by the demuxer",
+        .key = "video_bytes",
+    },
+    [SC_METRIC_AUDIO_BYTES] = {
+        .name = "scrcpy_demuxer_bytes_total",
+        .labels = "stream=\"audio\"",
+        .key = "audio_bytes",
+    },
+    [SC_METRIC_DECODER_ERRORS] = {
+        .name = "scrcpy_decoder_errors_total",
+        .help = "Number of decoding errors",
+        .key = "decoder_errors",
+    },
+    [SC_METRIC_AUDIO_UNDERFLOW_SAMPLES] = {
+        .name = "scrcpy_audio_underflow_samples_total",
+        .help = "Number of silence samples inserted on audio buffer underflow",
+        .key = "audio_underflow_samples",
+    },
+    [SC_METRIC_AUDIO_DROPPED_SAMPLES] = {
+        .name = "scrcpy_audio_dropped_samples_total",
+        .help = "Number of audio samples dropped on audio buffer overflow",
+        .key = "audio_dropped_samples",
+    },
+    [SC_METRIC_AUDIO_BUFFERING] = {
+        .name = "scrcpy_audio_buffering_samples",
+        .gauge = true,
+        .help = "Number of audio samples currently buffered",
+        .key = "audio_buffering",
+    },
+    [SC_METRIC_AUDIO_TARGET_BUFFERING] = {
+        .name = "scrcpy_audio_target_buffering_samples",
+        .gauge = true,
+        .help = "Target number of buffered audio samples",
+        .key = "audio_target_buffering",
+    },
+    [SC_METRIC_AUDIO_COMPENSATION] = {
+        .name = "scrcpy_audio_compensation_samples",
+        .gauge = true,
+        .help = "Current audio clock compensation (samples per 4 seconds)",
+        .key = "audio_compensation",
+    },
+    [SC_METRIC_CONTROLLER_QUEUE_SIZE] = {
+        .name = "scrcpy_controller_queue_size",
+        .gauge = true,
+        .help = "Number of control messages waiting to be sent",
+        .key = "controller_queue_size",
+    },
+    [SC_METRIC_CONTROLLER_DROPPED] = {
+        .name = "scrcpy_controller_dropped_total",
+        .help = "Number of control messages dropped because the queue is full",
+        .key = "controller_dropped",
+    },
+    [SC_METRIC_RECORDER_VIDEO_QUEUE_SIZE] = {
+        .name = "scrcpy_recorder_queue_size",
+        .labels = "stream=\"video\"",
+        .gauge = true,
+        .help = "Number of packets waiting to be written by the recorder",
+        .key = "recorder_video_queue_size",
+    },
+    [SC_METRIC_RECORDER_AUDIO_QUEUE_SIZE] = {
+        .name = "scrcpy_recorder_queue_size",
+        .labels = "stream=\"audio\"",
+        .gauge = true,
+        .key = "recorder_audio_queue_size",
+    },
+    [SC_METRIC_SESSION_RESUMES] = {
+        .name = "scrcpy_session_resumes_total",
+        .help = "Number of sessions resumed after a disconnection",
+        .key = "session_resumes",
+    },
+    [SC_METRIC_SESSION_RESUME_TIME] = {
+        .name = "scrcpy_session_resume_time_ms",
+        .gauge = true,
+        .help = "Time to recover from the last disconnection (in milliseconds)",
+        .key = "session_resume_time_ms",
+    },
+    [SC_METRIC_VIDEO_PACKET_SIZE_MEAN] = {
+        .name = "scrcpy_video_packet_size_mean_bytes",
+        .gauge = true,
+        .help = "Mean size of the video packets over the last window",
+        .key = "video_packet_size_mean",
+    },
+    [SC_METRIC_VIDEO_PACKET_SIZE_STDDEV] = {
+        .name = "scrcpy_video_packet_size_stddev_bytes",
+        .gauge = true,
+        .help = "Standard deviation of the video packet sizes over the last "
+                "window",
+        .key = "video_packet_size_stddev",
+    },
+    [SC_METRIC_VIDEO_PACKET_SIZE_MAX] = {
+        .name = "scrcpy_video_packet_size_max_bytes",
+        .gauge = true,
+        .help = "Size of the largest video packet over the last window",
+        .key = "video_packet_size_max",
+    },
+};
+
+// Upper bounds of the latency histogram buckets (the last one is +Inf)
+static const sc_tick
+sc_metrics_latency_bounds[SC_METRICS_LATENCY_BUCKETS - 1] = {
+    SC_TICK_FROM_US(500),
+    SC_TICK_FROM_MS(1), SC_TICK_FROM_MS(2), SC_TICK_FROM_MS(3),
+    SC_TICK_FROM_MS(4), SC_TICK_FROM_MS(5), SC_TICK_FROM_MS(6),
+    SC_TICK_FROM_MS(8), SC_TICK_FROM_MS(10), SC_TICK_FROM_MS(12),
+    SC_TICK_FROM_MS(15), SC_TICK_FROM_MS(20), SC_TICK_FROM_MS(25),
+    SC_TICK_FROM_MS(30), SC_TICK_FROM_MS(40), SC_TICK_FROM_MS(50),
+    SC_TICK_FROM_MS(75), SC_TICK_FROM_MS(100), SC_TICK_FROM_MS(150),
+    SC_TICK_FROM_MS(200), SC_TICK_FROM_MS(300), SC_TICK_FROM_MS(500),
+    SC_TICK_FROM_SEC(1),
+};
+
+// Static storage, implicitly zero-initialized
+static atomic_int_least64_t sc_metrics_values[SC_METRIC_COUNT];
+static atomic_uint_least64_t sc_metrics_latency[SC_METRICS_LATENCY_BUCKETS];
+static atomic_int_least64_t sc_metrics_latency_sum;
+
+void
+sc_metrics_add(enum sc_metric metric, int64_t delta) {
+    assert(metric < SC_METRIC_COUNT);
+    atomic_fetch_add_explicit(&sc_metrics_values[metric], delta,
+                              memory_order_relaxed);
+}
+
+void
+sc_metrics_set(enum sc_metric metric, int64_t value) {
+    assert(metric < SC_METRIC_COUNT);
+    assert(sc_metric_defs[metric].gauge);
+    atomic_store_explicit(&sc_metrics_values[metric], value,
+                          memory_order_relaxed);
+}
+
+void
+sc_metrics_record_decode_latency(sc_tick latency) {
+    unsigned i = 0;
+    while (i < SC_METRICS_LATENCY_BUCKETS - 1
+            && latency > sc_metrics_latency_bounds[i]) {
+        ++i;
+    }
+
+    atomic_fetch_add_explicit(&sc_metrics_latency[i], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sc_metrics_latency_sum, latency,
+                              memory_order_relaxed);
+}
+
+void
+sc_packet_size_stats_init(struct sc_packet_size_stats *stats) {
+    stats->window_start = 0;
+    stats->count = 0;
+    stats->mean = 0;
+    stats->m2 = 0;
+    stats->max = 0;
+}
+
+// Integer square root (floor), to avoid depending on libm
+static uint64_t
+sc_isqrt(uint64_t value) {
+    uint64_t res = 0;
+    uint64_t bit = UINT64_C(1) << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= res + bit) {
+            value -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+void
+sc_metrics_record_video_packet_size(struct sc_packet_size_stats *stats,
+                                    int64_t size, sc_tick now) {
+    if (!stats->count) {
+        stats->window_start = now;
+    }
+
+    ++stats->count;
+    double delta = size - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (size - stats->mean);
+    if (size > stats->max) {
+        stats->max = size;
+    }
+
+    if (now - stats->window_start >= SC_METRICS_PACKET_SIZE_WINDOW) {
+        // Population variance over the window
+        uint64_t variance = (uint64_t) (stats->m2 / stats->count);
+        sc_metrics_set(SC_METRIC_VIDEO_PACKET_SIZE_MEAN, (int64_t) stats->mean);
+        sc_metrics_set(SC_METRIC_VIDEO_PACKET_SIZE_STDDEV, sc_isqrt(variance));
+        sc_metrics_set(SC_METRIC_VIDEO_PACKET_SIZE_MAX, stats->max);
+        sc_packet_size_stats_init(stats);
+    }
+}
+
+void
+sc_metrics_snapshot(struct sc_metrics_snapshot *snapshot) {
+    for (unsigned i = 0; i < SC_METRIC_COUNT; ++i) {
+        snapshot->values[i] =
+            atomic_load_explicit(&sc_metrics_values[i], memory_order_relaxed);
+    }
+
+    uint64_t count = 0;
+    for (unsigned i = 0; i < SC_METRICS_LATENCY_BUCKETS; ++i) {
+        count += atomic_load_explicit(&sc_metrics_latency[i],
+                                      memory_order_relaxed);
+        snapshot->latency_buckets[i] = count;
+    }
+    snapshot->latency_count = count;
+    snapshot->latency_sum =
+        atomic_load_explicit(&sc_metrics_latency_sum, memory_order_relaxed);
+}
+
+sc_tick
+sc_metrics_snapshot_latency_percentile(const struct sc_metrics_snapshot *s,
+                                       unsigned percent) {
+    assert(percent > 0 && percent < 100);
+
+    if (!s->latency_count) {
+        return -1;
+    }
+
+    // Rank of the requested sample (rounded up)
+    uint64_t rank = (s->latency_count * percent + 99) / 100;
+
+    unsigned i = 0;
+    while (s->latency_buckets[i] < rank) {
+        ++i;
+        assert(i < SC_METRICS_LATENCY_BUCKETS);
+    }
+
+    sc_tick lower = i ? sc_metrics_latency_bounds[i - 1] : 0;
+    if (i == SC_METRICS_LATENCY_BUCKETS - 1) {
+        // +Inf bucket, the best estimation is its lower bound
+        return lower;
+    }
+
+    // Linear interpolation within the bucket
+    sc_tick upper = sc_metrics_latency_bounds[i];
+    uint64_t prev = i ? s->latency_buckets[i - 1] : 0;
+    uint64_t in_bucket = s->latency_buckets[i] - prev;
+    return lower + (upper - lower) * (sc_tick) (rank - prev)
+                                   / (sc_tick) in_bucket;
+}
+
+static bool
+sc_metrics_append(struct sc_strbuf *buf, const char *fmt, ...) {
+    char tmp[256];
+
+    va_list va;
+    va_start(va, fmt);
+    int len = vsnprintf(tmp, sizeof(tmp), fmt, va);
+    va_end(va);
+
+    // All formatted lines are short
+    assert(len >= 0 && (size_t) len < sizeof(tmp));
+    return sc_strbuf_append(buf, tmp, len);
+}
+
+#define SC_METRICS_SEC(TICK) ((double) (TICK) / SC_TICK_FREQ)
+
+static const unsigned sc_metrics_percentiles[] = {50, 90, 99};
+
+bool
+sc_metrics_format_prometheus(const struct sc_metrics_snapshot *snapshot,
+                             struct sc_strbuf *buf) {
+    bool ok;
+
+    for (unsigned i = 0; i < SC_METRIC_COUNT; ++i) {
+        const struct sc_metric_def *def = &sc_metric_defs[i];
+        bool new_family = !i || strcmp(def->name, sc_metric_defs[i - 1].name);
+        if (new_family) {
+            assert(def->help);
+            ok = sc_metrics_append(buf, "# HELP %s %s\n# TYPE %s %s\n",
+                                   def->name, def->help, def->name,
+                                   def->gauge ? "gauge" : "counter");
+            if (!ok) {
+                return false;
+            }
+        }
+
+        if (def->labels) {
+            ok = sc_metrics_append(buf, "%s{%s} %" PRIi64 "\n", def->name,
+                                   def->labels, snapshot->values[i]);
+        } else {
+            ok = sc_metrics_append(buf, "%s %" PRIi64 "\n", def->name,
+                                   snapshot->values[i]);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+#define LATENCY "scrcpy_video_decode_latency_seconds"
+    ok = sc_strbuf_append_staticstr(buf,
+        "# HELP " LATENCY " Delay between the submission of a video packet "
+            "to the decoder and the delivery of the decoded frame\n"
+        "# TYPE " LATENCY " histogram\n");
+    if (!ok) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < SC_METRICS_LATENCY_BUCKETS - 1; ++i) {
+        ok = sc_metrics_append(buf, LATENCY "_bucket{le=\"%g\"} %" PRIu64 "\n",
+                               SC_METRICS_SEC(sc_metrics_latency_bounds[i]),
+                               snapshot->latency_buckets[i]);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    ok = sc_metrics_append(buf,
+                           LATENCY "_bucket{le=\"+Inf\"} %" PRIu64 "\n"
+                           LATENCY "_sum %f\n"
+                           LATENCY "_count %" PRIu64 "\n",
+                           snapshot->latency_count,
+                           SC_METRICS_SEC(snapshot->latency_sum),
+                           snapshot->latency_count);
+    if (!ok) {
+        return false;
+    }
+
+#define ESTIMATE "scrcpy_video_decode_latency_estimate_seconds"
+    ok = sc_strbuf_append_staticstr(buf,
+        "# HELP " ESTIMATE " Video decoding latency percentiles estimated "
+            "from the histogram\n"
+        "# TYPE " ESTIMATE " gauge\n");
+    if (!ok) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < ARRAY_LEN(sc_metrics_percentiles); ++i) {
+        unsigned percent = sc_metrics_percentiles[i];
+        sc_tick value =
+            sc_metrics_snapshot_latency_percentile(snapshot, percent);
+        if (value < 0) {
+            ok = sc_metrics_append(buf, ESTIMATE "{percentile=\"%u\"} NaN\n",
+                                   percent);
+        } else {
+            ok = sc_metrics_append(buf, ESTIMATE "{percentile=\"%u\"} %f\n",
+                                   percent, SC_METRICS_SEC(value));
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+#undef ESTIMATE
+#undef LATENCY
+
+    return true;
+}
+
+bool
+sc_metrics_format_json(const struct sc_metrics_snapshot *snapshot,
+                       struct sc_strbuf *buf) {
+    bool ok = sc_strbuf_append_char(buf, '{');
+    if (!ok) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < SC_METRIC_COUNT; ++i) {
+        ok = sc_metrics_append(buf, "\"%s\":%" PRIi64 ",",
+                               sc_metric_defs[i].key, snapshot->values[i]);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    ok = sc_metrics_append(buf,
+                           "\"video_decode_latency_us\":{\"count\":%" PRIu64
+                           ",\"sum\":%" PRIi64,
+                           snapshot->latency_count, snapshot->latency_sum);
+    if (!ok) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < ARRAY_LEN(sc_metrics_percentiles); ++i) {
+        unsigned percent = sc_metrics_percentiles[i];
+        sc_tick value =
+            sc_metrics_snapshot_latency_percentile(snapshot, percent);
+        if (value < 0) {
+            ok = sc_metrics_append(buf, ",\"p%u\":null", percent);
+        } else {
+            ok = sc_metrics_append(buf, ",\"p%u\":%" PRIi64, percent, value);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return sc_strbuf_append_staticstr(buf, "}}\n");
+}
@@ -0,0 +1,131 @@
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/strbuf.h"
+#include "util/tick.h"
+
+// Process-wide pipeline metrics.
+//
+// Updating a metric is a single relaxed atomic operation, so it can be called
+// from any thread on the hot paths, whether the metrics endpoint is enabled or
+// not.
+
+enum sc_metric {
+    SC_METRIC_FRAMES_RENDERED,
+    SC_METRIC_FRAMES_SKIPPED,
+    SC_METRIC_VIDEO_PACKETS,
+    SC_METRIC_AUDIO_PACKETS,
+    SC_METRIC_VIDEO_BYTES,
+    SC_METRIC_AUDIO_BYTES,
+    SC_METRIC_DECODER_ERRORS,
+    SC_METRIC_AUDIO_UNDERFLOW_SAMPLES,
+    SC_METRIC_AUDIO_DROPPED_SAMPLES,
+    SC_METRIC_AUDIO_BUFFERING,
+    SC_METRIC_AUDIO_TARGET_BUFFERING,
+    SC_METRIC_AUDIO_COMPENSATION,
+    SC_METRIC_CONTROLLER_QUEUE_SIZE,
+    SC_METRIC_CONTROLLER_DROPPED,
+    SC_METRIC_RECORDER_VIDEO_QUEUE_SIZE,
+    SC_METRIC_RECORDER_AUDIO_QUEUE_SIZE,
+    SC_METRIC_SESSION_RESUMES,
+    SC_METRIC_SESSION_RESUME_TIME,
+    SC_METRIC_VIDEO_PACKET_SIZE_MEAN,
+    SC_METRIC_VIDEO_PACKET_SIZE_STDDEV,
+    SC_METRIC_VIDEO_PACKET_SIZE_MAX,
+    SC_METRIC_COUNT,
+};
+
+// Number of buckets of the video decoding latency histogram (including +Inf)
+#define SC_METRICS_LATENCY_BUCKETS 24
+
+// Duration of the windows over which the video packet size statistics are
+// computed
+#define SC_METRICS_PACKET_SIZE_WINDOW SC_TICK_FROM_SEC(10)
+
+// Video packet size statistics over the current window (owned by the caller,
+// typically the video demuxer thread)
+struct sc_packet_size_stats {
+    sc_tick window_start;
+    uint64_t count;
+    // Running mean and sum of squared deviations (Welford's algorithm)
+    double mean;
+    double m2;
+    int64_t max;
+};
+
+struct sc_metrics_snapshot {
+    int64_t values[SC_METRIC_COUNT];
+    // Cumulative counts (as in a Prometheus histogram)
+    uint64_t latency_buckets[SC_METRICS_LATENCY_BUCKETS];
+    uint64_t latency_count;
+    sc_tick latency_sum;
+};
+
+/**
+ * Increment a counter (or a gauge)
+ */
+void
+sc_metrics_add(enum sc_metric metric, int64_t delta);
+
+/**
+ * Set the value of a gauge
+ */
+void
+sc_metrics_set(enum sc_metric metric, int64_t value);
+
+/**
+ * Record the latency between the submission of a video packet to the decoder
+ * and the delivery of the decoded frame (the network and the buffering before
+ * the decoder are not included)
+ */
+void
+sc_metrics_record_decode_latency(sc_tick latency);
+
+void
+sc_packet_size_stats_init(struct sc_packet_size_stats *stats);
+
+/**
+ * Record the size of a video packet
+ *
+ * At the end of each window, the mean, standard deviation and maximum of the
+ * packet sizes are published as gauges, and the statistics are reset.
+ *
+ * The variance of the packet sizes reveals the latency spikes caused by large
+ * key frames (see --video-low-latency).
+ */
+void
+sc_metrics_record_video_packet_size(struct sc_packet_size_stats *stats,
+                                    int64_t size, sc_tick now);
+
+void
+sc_metrics_snapshot(struct sc_metrics_snapshot *snapshot);
+
+/**
+ * Estimate a latency percentile (0 < percent < 100) from the histogram
+ *
+ * Return -1 if no latency has been recorded.
+ */
+sc_tick
+sc_metrics_snapshot_latency_percentile(const struct sc_metrics_snapshot *s,
+                                       unsigned percent);
+
+/**
+ * Append the snapshot in Prometheus text exposition format
+ */
+bool
+sc_metrics_format_prometheus(const struct sc_metrics_snapshot *snapshot,
+                             struct sc_strbuf *buf);
+
+/**
+ * Append the snapshot as a JSON object
+ */
+bool
+sc_metrics_format_json(const struct sc_metrics_snapshot *snapshot,
+                       struct sc_strbuf *buf);
+
+#endif
@@ -0,0 +1,197 @@
+#include "metrics_server.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "util/log.h"
+#include "util/net_intr.h"
+#include "util/strbuf.h"
+
+#define SC_METRICS_SERVER_REQUEST_MAX 1024
+// The requests are served one at a time, so a client which does not send its
+// request must not block the others
+#define SC_METRICS_SERVER_RECV_TIMEOUT_MS 2000
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *ms, uint16_t port) {
+    bool ok = sc_intr_init(&ms->intr);
+    if (!ok) {
+        return false;
+    }
+
+    ms->server_socket = net_socket();
+    if (ms->server_socket == SC_SOCKET_NONE) {
+        LOGE("Could not create metrics server socket");
+        goto error_destroy_intr;
+    }
+
+    ok = net_listen(ms->server_socket, IPV4_LOCALHOST, port, 1);
+    if (!ok) {
+        LOGE("Could not listen on metrics port %" PRIu16, port);
+        goto error_close_socket;
+    }
+
+    LOGI("Metrics available on http://127.0.0.1:%" PRIu16 "/metrics", port);
+
+    return true;
+
+error_close_socket:
+    net_close(ms->server_socket);
+error_destroy_intr:
+    sc_intr_destroy(&ms->intr);
+
+    return false;
+}
+
+// Read the request line ("GET /path HTTP/1.x"), and return the path
+static const char *
+sc_metrics_server_read_path(struct sc_metrics_server *ms, sc_socket socket,
+                            char *buf, size_t len) {
+    assert(len);
+
+    size_t size = 0;
+    char *eol = NULL;
+    while (!eol) {
+        if (size == len - 1) {
+            // Request line too long
+            return NULL;
+        }
+
+        ssize_t r = net_recv_intr(&ms->intr, socket, buf + size,
+                                  len - 1 - size);
+        if (r <= 0) {
+            return NULL;
+        }
+
+        size_t prev_size = size;
+        size += r;
+        buf[size] = '\0';
+        eol = strchr(buf + prev_size, '\n');
+    }
+    *eol = '\0';
+
+    if (strncmp(buf, "GET ", 4)) {
+        return NULL;
+    }
+
+    char *path = buf + 4;
+    path[strcspn(path, " \r")] = '\0';
+    return path;
+}
+
+static bool
+sc_metrics_server_respond(struct sc_metrics_server *ms, sc_socket socket,
+                          const char *path) {
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_snapshot(&snapshot);
+
+    struct sc_strbuf body;
+    bool ok = sc_strbuf_init(&body, 4096);
+    if (!ok) {
+        LOG_OOM();
+        return false;
+    }
+
+    const char *status;
+    const char *content_type;
+    if (!strcmp(path, "/metrics")) {
+        status = "200 OK";
+        content_type = "text/plain; version=0.0.4";
+        ok = sc_metrics_format_prometheus(&snapshot, &body);
+    } else if (!strcmp(path, "/metrics.json")) {
+        status = "200 OK";
+        content_type = "application/json";
+        ok = sc_metrics_format_json(&snapshot, &body);
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain";
+        ok = sc_strbuf_append_staticstr(&body, "Not found\n");
+    }
+
+    if (!ok) {
+        LOG_OOM();
+        free(body.s);
+        return false;
+    }
+
+    char header[128];
+    int len = snprintf(header, sizeof(header),
+                       "HTTP/1.0 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: close\r\n"
+                       "\r\n", status, content_type, body.len);
+    assert(len > 0 && (size_t) len < sizeof(header));
+
+    ssize_t w = net_send_all_intr(&ms->intr, socket, header, len);
+    if (w == len) {
+        w = net_send_all_intr(&ms->intr, socket, body.s, body.len);
+    }
+
+    free(body.s);
+
+    return w >= 0;
+}
+
+static int
+run_metrics_server(void *data) {
+    struct sc_metrics_server *ms = data;
+
+    char request[SC_METRICS_SERVER_REQUEST_MAX];
+
+    for (;;) {
+        sc_socket socket = net_accept_intr(&ms->intr, ms->server_socket);
+        if (socket == SC_SOCKET_NONE) {
+            // Interrupted (or fatal error)
+            break;
+        }
+
+        net_set_recv_timeout(socket, SC_METRICS_SERVER_RECV_TIMEOUT_MS);
+
+        const char *path = sc_metrics_server_read_path(ms, socket, request,
+                                                       sizeof(request));
+        if (path) {
+            sc_metrics_server_respond(ms, socket, path);
+        } else {
+            LOGD("Invalid metrics request");
+        }
+
+        net_close(socket);
+    }
+
+    LOGD("Metrics server stopped");
+
+    return 0;
+}
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *ms) {
+    bool ok = sc_thread_create(&ms->thread, run_metrics_server,
+                               "scrcpy-metrics", ms);
+    if (!ok) {
+        LOGE("Could not start metrics server thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_metrics_server_interrupt(struct sc_metrics_server *ms) {
+    sc_intr_interrupt(&ms->intr);
+}
+
+void
+sc_metrics_server_join(struct sc_metrics_server *ms) {
+    sc_thread_join(&ms->thread, NULL);
+}
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *ms) {
+    net_close(ms->server_socket);
+    sc_intr_destroy(&ms->intr);
+}
@@ -0,0 +1,42 @@
+#ifndef SC_METRICS_SERVER_H
+#define SC_METRICS_SERVER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/intr.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+/**
+ * Minimal HTTP endpoint on localhost exposing the pipeline metrics
+ *
+ *  - GET /metrics: Prometheus text exposition format
+ *  - GET /metrics.json: JSON
+ *
+ * Clients are served sequentially by a single thread.
+ */
+struct sc_metrics_server {
+    sc_socket server_socket;
+    sc_thread thread;
+    struct sc_intr intr;
+};
+
+bool
+sc_metrics_server_init(struct sc_metrics_server *ms, uint16_t port);
+
+bool
+sc_metrics_server_start(struct sc_metrics_server *ms);
+
+void
+sc_metrics_server_interrupt(struct sc_metrics_server *ms);
+
+void
+sc_metrics_server_join(struct sc_metrics_server *ms);
+
+void
+sc_metrics_server_destroy(struct sc_metrics_server *ms);
+
+#endif
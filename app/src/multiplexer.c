@@ -0,0 +1,379 @@
+#include "multiplexer.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+#define SC_MULTIPLEXER_HEADER_LENGTH 5
+// The device sends chunks of at most 16 KiB (Multiplexer.MAX_CHUNK_LENGTH),
+// larger payloads are accepted to leave some margin
+#define SC_MULTIPLEXER_MAX_PAYLOAD_LENGTH (1 << 16)
+// Control messages are small, there is no need to send large chunks
+#define SC_MULTIPLEXER_CONTROL_CHUNK_LENGTH 4096
+// The demultiplexer only blocks if a component is this far behind
+#define SC_MULTIPLEXER_CHANNEL_MAX_QUEUED (8 << 20) // 8 MiB
+
+static int
+run_channel(void *data) {
+    struct sc_multiplexer_channel *channel = data;
+
+    for (;;) {
+        sc_mutex_lock(&channel->mutex);
+        while (!channel->stopped && !channel->eos
+                && sc_vecdeque_is_empty(&channel->queue)) {
+            sc_cond_wait(&channel->cond, &channel->mutex);
+        }
+
+        if (channel->stopped || sc_vecdeque_is_empty(&channel->queue)) {
+            // Stopped, or end of stream and all the chunks are written
+            sc_mutex_unlock(&channel->mutex);
+            break;
+        }
+
+        struct sc_multiplexer_chunk chunk = sc_vecdeque_pop(&channel->queue);
+        sc_mutex_unlock(&channel->mutex);
+
+        // May block if the component does not consume its stream fast enough
+        ssize_t w = net_send_all(channel->socket, chunk.data, chunk.len);
+        free(chunk.data);
+
+        sc_mutex_lock(&channel->mutex);
+        channel->queued_bytes -= chunk.len;
+        bool failed = w < (ssize_t) chunk.len;
+        if (failed) {
+            channel->failed = true;
+        }
+        // Wake up the demultiplexer if it waits for space
+        sc_cond_signal(&channel->cond);
+        sc_mutex_unlock(&channel->mutex);
+
+        if (failed) {
+            break;
+        }
+    }
+
+    // Propagate the end of stream to the component
+    net_interrupt(channel->socket);
+
+    return 0;
+}
+
+// On success, the channel takes ownership of the data
+static bool
+sc_multiplexer_channel_push(struct sc_multiplexer_channel *channel,
+                            uint8_t *data, uint32_t len) {
+    sc_mutex_lock(&channel->mutex);
+    // A single chunk is always accepted, whatever its size
+    while (!channel->stopped && !channel->failed && channel->queued_bytes
+            && channel->queued_bytes + len
+                    > SC_MULTIPLEXER_CHANNEL_MAX_QUEUED) {
+        sc_cond_wait(&channel->cond, &channel->mutex);
+    }
+
+    if (channel->stopped || channel->failed) {
+        sc_mutex_unlock(&channel->mutex);
+        return false;
+    }
+
+    struct sc_multiplexer_chunk chunk = {
+        .data = data,
+        .len = len,
+    };
+    bool ok = sc_vecdeque_push(&channel->queue, chunk);
+    if (!ok) {
+        sc_mutex_unlock(&channel->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    channel->queued_bytes += len;
+    sc_cond_signal(&channel->cond);
+    sc_mutex_unlock(&channel->mutex);
+
+    return true;
+}
+
+static void
+sc_multiplexer_end_channels(struct sc_multiplexer *mux) {
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        if (channel->socket != SC_SOCKET_NONE) {
+            sc_mutex_lock(&channel->mutex);
+            channel->eos = true;
+            sc_cond_signal(&channel->cond);
+            sc_mutex_unlock(&channel->mutex);
+        }
+    }
+}
+
+static void
+sc_multiplexer_stop_channels(struct sc_multiplexer *mux) {
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        if (channel->socket != SC_SOCKET_NONE) {
+            sc_mutex_lock(&channel->mutex);
+            channel->stopped = true;
+            sc_cond_signal(&channel->cond);
+            sc_mutex_unlock(&channel->mutex);
+
+            // Unblock the writes to the component and the control reads
+            net_interrupt(channel->socket);
+        }
+    }
+}
+
+static int
+run_demux(void *data) {
+    struct sc_multiplexer *mux = data;
+
+    for (;;) {
+        uint8_t header[SC_MULTIPLEXER_HEADER_LENGTH];
+        ssize_t r = net_recv_all(mux->socket, header, sizeof(header));
+        if (r < (ssize_t) sizeof(header)) {
+            // End of stream, or interrupted
+            break;
+        }
+
+        uint8_t channel = header[0];
+        uint32_t len = sc_read32be(&header[1]);
+        if (channel >= SC_MULTIPLEXER_CHANNEL_COUNT
+                || mux->channels[channel].socket == SC_SOCKET_NONE
+                || len > SC_MULTIPLEXER_MAX_PAYLOAD_LENGTH) {
+            LOGE("Invalid multiplexed frame (channel %" PRIu8 ", length %"
+                 PRIu32 ")", channel, len);
+            break;
+        }
+
+        if (!len) {
+            continue;
+        }
+
+        uint8_t *payload = malloc(len);
+        if (!payload) {
+            LOG_OOM();
+            break;
+        }
+
+        r = net_recv_all(mux->socket, payload, len);
+        if (r < (ssize_t) len) {
+            free(payload);
+            break;
+        }
+
+        bool ok = sc_multiplexer_channel_push(&mux->channels[channel],
+                                              payload, len);
+        if (!ok) {
+            free(payload);
+            break;
+        }
+    }
+
+    // Propagate the end of stream to all the components (the data already
+    // received is still delivered)
+    sc_multiplexer_end_channels(mux);
+    net_interrupt(mux->socket);
+
+    LOGD("Demultiplexer stopped");
+    return 0;
+}
+
+static int
+run_mux(void *data) {
+    struct sc_multiplexer *mux = data;
+
+    sc_socket control_socket =
+        mux->channels[SC_MULTIPLEXER_CHANNEL_CONTROL].socket;
+    assert(control_socket != SC_SOCKET_NONE);
+
+    uint8_t buf[SC_MULTIPLEXER_HEADER_LENGTH
+              + SC_MULTIPLEXER_CONTROL_CHUNK_LENGTH];
+    for (;;) {
+        ssize_t r = net_recv(control_socket, buf + SC_MULTIPLEXER_HEADER_LENGTH,
+                             SC_MULTIPLEXER_CONTROL_CHUNK_LENGTH);
+        if (r <= 0) {
+            // The controller closed its end, or interrupted
+            break;
+        }
+
+        buf[0] = SC_MULTIPLEXER_CHANNEL_CONTROL;
+        sc_write32be(&buf[1], r);
+
+        // Send the header and the payload at once
+        size_t len = SC_MULTIPLEXER_HEADER_LENGTH + r;
+        ssize_t w = net_send_all(mux->socket, buf, len);
+        if (w < (ssize_t) len) {
+            // The connection is broken, stop everything
+            sc_multiplexer_interrupt(mux);
+            break;
+        }
+    }
+
+    LOGD("Multiplexer stopped");
+    return 0;
+}
+
+static bool
+sc_multiplexer_channel_init(struct sc_multiplexer_channel *channel) {
+    bool ok = sc_mutex_init(&channel->mutex);
+    if (!ok) {
+        return false;
+    }
+
+    ok = sc_cond_init(&channel->cond);
+    if (!ok) {
+        sc_mutex_destroy(&channel->mutex);
+        return false;
+    }
+
+    sc_vecdeque_init(&channel->queue);
+    channel->queued_bytes = 0;
+    channel->eos = false;
+    channel->stopped = false;
+    channel->failed = false;
+
+    return true;
+}
+
+static void
+sc_multiplexer_channel_destroy(struct sc_multiplexer_channel *channel) {
+    while (!sc_vecdeque_is_empty(&channel->queue)) {
+        struct sc_multiplexer_chunk chunk = sc_vecdeque_pop(&channel->queue);
+        free(chunk.data);
+    }
+    sc_vecdeque_destroy(&channel->queue);
+    sc_cond_destroy(&channel->cond);
+    sc_mutex_destroy(&channel->mutex);
+}
+
+bool
+sc_multiplexer_start(struct sc_multiplexer *mux, sc_socket socket, bool video,
+                     bool audio, bool control,
+                     sc_socket sockets[SC_MULTIPLEXER_CHANNEL_COUNT]) {
+    assert(socket != SC_SOCKET_NONE);
+    assert(video || audio || control);
+
+    mux->socket = socket;
+
+    const bool enabled[SC_MULTIPLEXER_CHANNEL_COUNT] = {
+        [SC_MULTIPLEXER_CHANNEL_VIDEO] = video,
+        [SC_MULTIPLEXER_CHANNEL_AUDIO] = audio,
+        [SC_MULTIPLEXER_CHANNEL_CONTROL] = control,
+    };
+
+    static const char *const thread_names[SC_MULTIPLEXER_CHANNEL_COUNT] = {
+        [SC_MULTIPLEXER_CHANNEL_VIDEO] = "scrcpy-demux-v",
+        [SC_MULTIPLEXER_CHANNEL_AUDIO] = "scrcpy-demux-a",
+        [SC_MULTIPLEXER_CHANNEL_CONTROL] = "scrcpy-demux-c",
+    };
+
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        sockets[i] = SC_SOCKET_NONE;
+        mux->channels[i].socket = SC_SOCKET_NONE;
+    }
+
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        if (!enabled[i]) {
+            continue;
+        }
+
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        bool ok = sc_multiplexer_channel_init(channel);
+        if (!ok) {
+            goto error_stop_channels;
+        }
+
+        sc_socket pair[2];
+        ok = net_socketpair(pair);
+        if (!ok) {
+            LOGE("Could not create multiplexer channel");
+            sc_multiplexer_channel_destroy(channel);
+            goto error_stop_channels;
+        }
+
+        channel->socket = pair[1];
+        ok = sc_thread_create(&channel->thread, run_channel, thread_names[i],
+                              channel);
+        if (!ok) {
+            LOGE("Could not start multiplexer channel thread");
+            net_close(pair[0]);
+            net_close(pair[1]);
+            channel->socket = SC_SOCKET_NONE;
+            sc_multiplexer_channel_destroy(channel);
+            goto error_stop_channels;
+        }
+
+        sockets[i] = pair[0];
+    }
+
+    bool ok = sc_thread_create(&mux->demux_thread, run_demux, "scrcpy-demux",
+                               mux);
+    if (!ok) {
+        LOGE("Could not start demultiplexer thread");
+        goto error_stop_channels;
+    }
+
+    if (control) {
+        ok = sc_thread_create(&mux->mux_thread, run_mux, "scrcpy-mux", mux);
+        if (!ok) {
+            LOGE("Could not start multiplexer thread");
+            net_interrupt(socket);
+            sc_thread_join(&mux->demux_thread, NULL);
+            goto error_stop_channels;
+        }
+    }
+
+    return true;
+
+error_stop_channels:
+    sc_multiplexer_stop_channels(mux);
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        if (channel->socket != SC_SOCKET_NONE) {
+            sc_thread_join(&channel->thread, NULL);
+            sc_multiplexer_channel_destroy(channel);
+            net_close(channel->socket);
+            channel->socket = SC_SOCKET_NONE;
+        }
+        if (sockets[i] != SC_SOCKET_NONE) {
+            net_close(sockets[i]);
+            sockets[i] = SC_SOCKET_NONE;
+        }
+    }
+    return false;
+}
+
+void
+sc_multiplexer_interrupt(struct sc_multiplexer *mux) {
+    net_interrupt(mux->socket);
+    sc_multiplexer_stop_channels(mux);
+}
+
+void
+sc_multiplexer_join(struct sc_multiplexer *mux) {
+    sc_thread_join(&mux->demux_thread, NULL);
+    if (mux->channels[SC_MULTIPLEXER_CHANNEL_CONTROL].socket
+            != SC_SOCKET_NONE) {
+        sc_thread_join(&mux->mux_thread, NULL);
+    }
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        if (channel->socket != SC_SOCKET_NONE) {
+            sc_thread_join(&channel->thread, NULL);
+        }
+    }
+}
+
+void
+sc_multiplexer_destroy(struct sc_multiplexer *mux) {
+    for (unsigned i = 0; i < SC_MULTIPLEXER_CHANNEL_COUNT; ++i) {
+        struct sc_multiplexer_channel *channel = &mux->channels[i];
+        if (channel->socket != SC_SOCKET_NONE) {
+            sc_multiplexer_channel_destroy(channel);
+            net_close(channel->socket);
+        }
+    }
+    net_close(mux->socket);
+}
@@ -0,0 +1,96 @@
+#ifndef SC_MULTIPLEXER_H
+#define SC_MULTIPLEXER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/net.h"
+#include "util/thread.h"
+#include "util/vecdeque.h"
+
+// The channel ids are part of the protocol
+enum sc_multiplexer_channel_id {
+    SC_MULTIPLEXER_CHANNEL_VIDEO = 0,
+    SC_MULTIPLEXER_CHANNEL_AUDIO = 1,
+    SC_MULTIPLEXER_CHANNEL_CONTROL = 2,
+};
+
+#define SC_MULTIPLEXER_CHANNEL_COUNT 3
+
+struct sc_multiplexer_chunk {
+    uint8_t *data;
+    uint32_t len;
+};
+
+struct sc_multiplexer_chunk_queue SC_VECDEQUE(struct sc_multiplexer_chunk);
+
+/**
+ * The data received for one component, written to its socket pair by a
+ * dedicated thread
+ *
+ * A component which does not consume its stream fast enough does not block
+ * the other channels, until its queue is full.
+ */
+struct sc_multiplexer_channel {
+    // The end read and written by the multiplexer threads (SC_SOCKET_NONE if
+    // the channel is disabled)
+    sc_socket socket;
+    sc_thread thread;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    struct sc_multiplexer_chunk_queue queue;
+    size_t queued_bytes;
+    bool eos; // no more chunks will be queued
+    bool stopped; // stop without writing the queued chunks
+    bool failed; // the component closed its end
+};
+
+/**
+ * Carry the video, audio and control streams over a single socket
+ * (--multiplex)
+ *
+ * Each stream is exposed to its component (the demuxers and the controller)
+ * as one end of a local socket pair, so the components are not aware of the
+ * multiplexing. The data is transmitted in frames:
+ *
+ *     [channel (1 byte)] [payload length (4 bytes)] [payload]
+ *
+ * The device prioritizes control and audio over video when it sends the
+ * frames.
+ */
+struct sc_multiplexer {
+    sc_socket socket;
+    struct sc_multiplexer_channel channels[SC_MULTIPLEXER_CHANNEL_COUNT];
+
+    sc_thread demux_thread;
+    sc_thread mux_thread; // only if control is enabled
+};
+
+/**
+ * Start (de)multiplexing the enabled channels over the socket
+ *
+ * On success, the multiplexer owns the socket, and sockets[] contains the
+ * sockets to be used by the components, owned by the caller (SC_SOCKET_NONE
+ * for the disabled channels).
+ *
+ * On error, the socket is not closed.
+ */
+bool
+sc_multiplexer_start(struct sc_multiplexer *mux, sc_socket socket, bool video,
+                     bool audio, bool control,
+                     sc_socket sockets[SC_MULTIPLEXER_CHANNEL_COUNT]);
+
+// Interrupt the multiplexer, so that the components reach end-of-stream
+void
+sc_multiplexer_interrupt(struct sc_multiplexer *mux);
+
+void
+sc_multiplexer_join(struct sc_multiplexer *mux);
+
+void
+sc_multiplexer_destroy(struct sc_multiplexer *mux);
+
+#endif
@@ -91,6 +91,18 @@ const struct scrcpy_options scrcpy_options_default = {
     .mipmaps = true,
     .stay_awake = false,
     .force_adb_forward = false,
+    .multiplex = false,
+    .direct_tcp_port = 0,
+    .socket_buffers = {
+        .video = 0,
+        .audio = 0,
+        .control = 0,
+    },
+    .low_latency_sockets = false,
+    .video_low_latency = false,
+    .skip_unchanged_frames = false,
+    .video_dirty_rects = false,
+    .video_drop_frames = false,
     .disable_screensaver = false,
     .forward_key_repeat = true,
     .legacy_paste = false,
@@ -116,6 +128,9 @@ const struct scrcpy_options scrcpy_options_default = {
     .new_display = NULL,
     .start_app = NULL,
     .angle = NULL,
+    .video_scale_filter = SC_VIDEO_SCALE_FILTER_DEFAULT,
+    .video_sharpen = NULL,
+    .video_simulcast = 0,
     .vd_destroy_content = true,
     .vd_system_decorations = true,
     .camera_torch = false,
@@ -123,6 +138,16 @@ const struct scrcpy_options scrcpy_options_default = {
     .flex_display = false,
     .ignore_video_encoder_constraints = false,
     .update_terminal_title = true,
+    .stream_dump = NULL,
+    .stream_replay = NULL,
+    .stream_replay_speed = 1,
+    .metrics_port = 0,
+    .audio_buffer_auto = false,
+    .startup_profile = NULL,
+    .multi_device = NULL,
+    .multi_device_jobs = 4,
+    .server_idle_timeout = 0,
+    .resume_timeout = 0,
 };
 
 enum sc_orientation
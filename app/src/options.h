@@ -71,6 +71,12 @@ enum sc_audio_source {
     SC_AUDIO_SOURCE_VOICE_PERFORMANCE,
 };
 
+enum sc_video_scale_filter {
+    SC_VIDEO_SCALE_FILTER_DEFAULT, // let the server use its default
+    SC_VIDEO_SCALE_FILTER_BILINEAR,
+    SC_VIDEO_SCALE_FILTER_LANCZOS,
+};
+
 enum sc_camera_facing {
     SC_CAMERA_FACING_ANY,
     SC_CAMERA_FACING_FRONT,
@@ -236,6 +242,15 @@ struct sc_port_range {
 
 #define SC_WINDOW_POSITION_UNDEFINED (-0x8000)
 
+#define SC_DIRECT_TCP_DEFAULT_PORT 27183
+
+// Socket buffer sizes, in bytes (0 for the system default)
+struct sc_socket_buffers {
+    uint32_t video;
+    uint32_t audio;
+    uint32_t control;
+};
+
 struct scrcpy_options {
     const char *serial;
     const char *crop;
@@ -273,6 +288,9 @@ struct scrcpy_options {
     uint32_t audio_bit_rate;
     const char *max_fps; // float to be parsed by the server
     const char *angle; // float to be parsed by the server
+    enum sc_video_scale_filter video_scale_filter;
+    const char *video_sharpen; // float to be parsed by the server
+    uint16_t video_simulcast; // max size of the simulcast stream, 0 to disable
     enum sc_orientation capture_orientation;
     enum sc_orientation_lock capture_orientation_lock;
     enum sc_orientation display_orientation;
@@ -310,6 +328,14 @@ struct scrcpy_options {
     bool mipmaps;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
+    uint16_t direct_tcp_port; // 0 to connect through the adb tunnel
+    struct sc_socket_buffers socket_buffers;
+    bool low_latency_sockets;
+    bool video_low_latency;
+    bool skip_unchanged_frames;
+    bool video_dirty_rects;
+    bool video_drop_frames;
     bool disable_screensaver;
     bool forward_key_repeat;
     bool legacy_paste;
@@ -346,6 +372,16 @@ struct scrcpy_options {
     bool flex_display;
     bool ignore_video_encoder_constraints;
     bool update_terminal_title;
+    const char *stream_dump; // prefix of the stream dump files
+    const char *stream_replay; // prefix of the stream dump files to replay
+    float stream_replay_speed;
+    uint16_t metrics_port; // 0 to disable the metrics endpoint
+    bool audio_buffer_auto; // adjust audio_buffer automatically
+    const char *startup_profile;
+    const char *multi_device; // NULL if disabled, "" for all devices
+    unsigned multi_device_jobs;
+    sc_tick server_idle_timeout; // 0 to stop the server with scrcpy
+    sc_tick resume_timeout; // 0 to exit on disconnection
 };
 
 extern const struct scrcpy_options scrcpy_options_default;
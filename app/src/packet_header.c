@@ -0,0 +1,52 @@
+#include "packet_header.h"
+
+#include <assert.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+void
+sc_packet_header_parse(const uint8_t *data, struct sc_packet_header *header) {
+    uint64_t pts_flags = sc_read64be(data);
+    assert(!(pts_flags & (UINT64_C(1) << 63))); // not a session packet
+
+    header->pts = pts_flags & SC_PACKET_PTS_MASK;
+    header->len = sc_read32be(&data[8]);
+    header->config = pts_flags & SC_PACKET_FLAG_CONFIG;
+    header->key_frame = pts_flags & SC_PACKET_FLAG_KEY_FRAME;
+    header->dirty_rects = pts_flags & SC_PACKET_FLAG_DIRTY_RECTS;
+}
+
+bool
+sc_packet_header_recv_dirty_rects(sc_packet_header_recv_fn recv_all,
+                                  void *userdata, struct sc_dirty_rects *drs,
+                                  bool *eos) {
+    uint8_t buf[SC_DIRTY_RECTS_MAX * SC_DIRTY_RECT_SERIALIZED_SIZE];
+    *eos = false;
+
+    ssize_t r = recv_all(userdata, buf, 2);
+    if (r < 2) {
+        *eos = true;
+        return false;
+    }
+
+    unsigned count = sc_read16be(buf);
+    if (count > SC_DIRTY_RECTS_MAX) {
+        LOGE("Invalid dirty rects count: %u", count);
+        return false;
+    }
+
+    size_t len = count * SC_DIRTY_RECT_SERIALIZED_SIZE;
+    if (len) {
+        r = recv_all(userdata, buf, len);
+        if (r < 0 || (size_t) r < len) {
+            *eos = true;
+            return false;
+        }
+    }
+
+    bool ok = sc_dirty_rects_parse(drs, buf, count);
+    assert(ok);
+    (void) ok;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SC_PACKET_HEADER_H
+#define SC_PACKET_HEADER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "dirty_rects.h"
+
+/**
+ * Parsing of the media packet headers of the video and audio streams (see the
+ * protocol description in demuxer.c)
+ */
+
+#define SC_PACKET_HEADER_SIZE 12
+
+#define SC_PACKET_FLAG_CONFIG    (UINT64_C(1) << 62)
+#define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 61)
+#define SC_PACKET_FLAG_DIRTY_RECTS (UINT64_C(1) << 60)
+
+#define SC_PACKET_PTS_MASK (SC_PACKET_FLAG_DIRTY_RECTS - 1)
+
+struct sc_packet_header {
+    uint64_t pts; // meaningless for a config packet
+    uint32_t len;
+    bool config;
+    bool key_frame;
+    bool dirty_rects; // the header is followed by the dirty rects extension
+};
+
+/**
+ * Function receiving exactly len bytes
+ *
+ * Return the number of bytes received (less than len on end of stream), or -1
+ * on error.
+ */
+typedef ssize_t (*sc_packet_header_recv_fn)(void *userdata, void *buf,
+                                            size_t len);
+
+/**
+ * Parse a media packet header (the session packet flag must not be set)
+ */
+void
+sc_packet_header_parse(const uint8_t *data, struct sc_packet_header *header);
+
+/**
+ * Receive and parse the dirty rects extension
+ *
+ * On error, eos is set if the error is caused by the end of the stream.
+ */
+bool
+sc_packet_header_recv_dirty_rects(sc_packet_header_recv_fn recv_all,
+                                  void *userdata, struct sc_dirty_rects *drs,
+                                  bool *eos);
+
+#endif
@@ -9,6 +9,7 @@
 #include <libavutil/time.h>
 #include <libavutil/display.h>
 
+#include "metrics.h"
 #include "util/log.h"
 #include "util/str.h"
 
@@ -197,6 +198,15 @@ sc_recorder_must_wait_for_config_packets(struct sc_recorder *recorder) {
     return false;
 }
 
+// must be called with mutex locked
+static void
+sc_recorder_update_queue_metrics(struct sc_recorder *recorder) {
+    sc_metrics_set(SC_METRIC_RECORDER_VIDEO_QUEUE_SIZE,
+                   sc_vecdeque_size(&recorder->video_queue));
+    sc_metrics_set(SC_METRIC_RECORDER_AUDIO_QUEUE_SIZE,
+                   sc_vecdeque_size(&recorder->audio_queue));
+}
+
 static bool
 sc_recorder_process_header(struct sc_recorder *recorder) {
     sc_mutex_lock(&recorder->mutex);
@@ -340,6 +350,8 @@ sc_recorder_process_packets(struct sc_recorder *recorder) {
             audio_pkt = sc_vecdeque_pop(&recorder->audio_queue);
         }
 
+        sc_recorder_update_queue_metrics(recorder);
+
         if (recorder->stopped && !video_pkt && !audio_pkt) {
             assert(sc_vecdeque_is_empty(&recorder->video_queue));
             assert(sc_vecdeque_is_empty(&recorder->audio_queue));
@@ -636,6 +648,7 @@ sc_recorder_video_packet_sink_push(struct sc_packet_sink *sink,
         return false;
     }
 
+    sc_recorder_update_queue_metrics(recorder);
     sc_cond_signal(&recorder->cond);
 
     sc_mutex_unlock(&recorder->mutex);
@@ -726,6 +739,7 @@ sc_recorder_audio_packet_sink_push(struct sc_packet_sink *sink,
         return false;
     }
 
+    sc_recorder_update_queue_metrics(recorder);
     sc_cond_signal(&recorder->cond);
 
     sc_mutex_unlock(&recorder->mutex);
@@ -0,0 +1,450 @@
+#include "resumer.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adb/adb.h"
+#include "adb/adb_device.h"
+#include "metrics.h"
+#include "util/log.h"
+
+#define SC_RESUMER_RETRY_DELAY SC_TICK_FROM_MS(500)
+
+static void
+sc_resumer_demuxer_on_interrupted(struct sc_demuxer *demuxer, void *userdata) {
+    (void) demuxer;
+
+    struct sc_resumer *resumer = userdata;
+    sc_resumer_interrupt_session(resumer);
+}
+
+static void
+sc_resumer_on_server_result(struct sc_resumer *resumer, bool success) {
+    sc_mutex_lock(&resumer->mutex);
+    resumer->connection = success ? SC_RESUMER_CONNECTION_SUCCESS
+                                  : SC_RESUMER_CONNECTION_FAILURE;
+    sc_cond_signal(&resumer->cond);
+    sc_mutex_unlock(&resumer->mutex);
+}
+
+static void
+sc_resumer_server_on_connection_failed(struct sc_server *server,
+                                       void *userdata) {
+    (void) server;
+
+    struct sc_resumer *resumer = userdata;
+    sc_resumer_on_server_result(resumer, false);
+}
+
+static void
+sc_resumer_server_on_connected(struct sc_server *server, void *userdata) {
+    (void) server;
+
+    struct sc_resumer *resumer = userdata;
+    sc_resumer_on_server_result(resumer, true);
+}
+
+static void
+sc_resumer_server_on_disconnected(struct sc_server *server, void *userdata) {
+    (void) server;
+    (void) userdata;
+
+    // Do nothing, the disconnection is detected by the demuxers and the
+    // controller
+}
+
+bool
+sc_resumer_init(struct sc_resumer *resumer, struct sc_server *server,
+                const struct sc_server_params *params,
+                struct sc_demuxer *video_demuxer,
+                struct sc_demuxer *audio_demuxer,
+                struct sc_controller *controller, sc_tick timeout,
+                const struct sc_resumer_callbacks *cbs, void *cbs_userdata) {
+    assert(server->serial);
+    assert(timeout > 0);
+
+    resumer->serial = strdup(server->serial);
+    if (!resumer->serial) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&resumer->mutex);
+    if (!ok) {
+        goto error_free_serial;
+    }
+
+    ok = sc_cond_init(&resumer->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ok = sc_intr_init(&resumer->intr);
+    if (!ok) {
+        goto error_destroy_cond;
+    }
+
+    static const struct sc_demuxer_resume_callbacks demuxer_cbs = {
+        .on_interrupted = sc_resumer_demuxer_on_interrupted,
+    };
+
+    if (video_demuxer) {
+        ok = sc_demuxer_init_resume(video_demuxer, &demuxer_cbs, resumer);
+        if (!ok) {
+            goto error_destroy_intr;
+        }
+    }
+
+    if (audio_demuxer) {
+        ok = sc_demuxer_init_resume(audio_demuxer, &demuxer_cbs, resumer);
+        if (!ok) {
+            if (video_demuxer) {
+                sc_demuxer_destroy_resume(video_demuxer);
+            }
+            goto error_destroy_intr;
+        }
+    }
+
+    // Reconnect to the very same device
+    resumer->params = *params;
+    if (params->tcpip_dst) {
+        // Execute "adb connect" again on each attempt
+    } else if (params->tcpip) {
+        // The device has been switched to TCP/IP by the first connection, its
+        // serial is now its address
+        resumer->params.tcpip_dst = resumer->serial;
+    } else {
+        resumer->params.req_serial = resumer->serial;
+        resumer->params.select_usb = false;
+        resumer->params.select_tcpip = false;
+    }
+    // Do not turn the device screen on again
+    resumer->params.power_on = false;
+
+    resumer->server = server;
+    resumer->video_demuxer = video_demuxer;
+    resumer->audio_demuxer = audio_demuxer;
+    resumer->controller = controller;
+    resumer->timeout = timeout;
+
+    resumer->stopped = false;
+    resumer->interrupted = false;
+    resumer->connection = SC_RESUMER_CONNECTION_PENDING;
+    resumer->server_started = true;
+    resumer->controller_started = false;
+
+    sc_rand_init(&resumer->rand);
+
+    assert(cbs && cbs->on_interrupted && cbs->on_resumed && cbs->on_failed);
+    resumer->cbs = cbs;
+    resumer->cbs_userdata = cbs_userdata;
+
+    return true;
+
+error_destroy_intr:
+    sc_intr_destroy(&resumer->intr);
+error_destroy_cond:
+    sc_cond_destroy(&resumer->cond);
+error_destroy_mutex:
+    sc_mutex_destroy(&resumer->mutex);
+error_free_serial:
+    free(resumer->serial);
+
+    return false;
+}
+
+void
+sc_resumer_destroy(struct sc_resumer *resumer) {
+    if (resumer->audio_demuxer) {
+        sc_demuxer_destroy_resume(resumer->audio_demuxer);
+    }
+    if (resumer->video_demuxer) {
+        sc_demuxer_destroy_resume(resumer->video_demuxer);
+    }
+    sc_intr_destroy(&resumer->intr);
+    sc_cond_destroy(&resumer->cond);
+    sc_mutex_destroy(&resumer->mutex);
+    free(resumer->serial);
+}
+
+static bool
+sc_resumer_is_stopped(struct sc_resumer *resumer) {
+    sc_mutex_lock(&resumer->mutex);
+    bool stopped = resumer->stopped;
+    sc_mutex_unlock(&resumer->mutex);
+    return stopped;
+}
+
+// Release the lost connection
+static void
+sc_resumer_release(struct sc_resumer *resumer) {
+    sc_mutex_lock(&resumer->mutex);
+    bool server_started = resumer->server_started;
+    resumer->server_started = false;
+    sc_mutex_unlock(&resumer->mutex);
+
+    if (server_started) {
+        // Shutdown the sockets and terminate the server
+        sc_server_stop(resumer->server);
+        sc_server_join(resumer->server);
+    }
+
+    if (resumer->controller_started) {
+        sc_controller_stop(resumer->controller);
+        sc_controller_join(resumer->controller);
+        resumer->controller_started = false;
+    }
+
+    // The sockets must not be closed while the demuxers still read them
+    if (resumer->video_demuxer) {
+        sc_demuxer_await_interrupted(resumer->video_demuxer);
+    }
+    if (resumer->audio_demuxer) {
+        sc_demuxer_await_interrupted(resumer->audio_demuxer);
+    }
+
+    if (server_started) {
+        sc_server_destroy(resumer->server);
+    }
+}
+
+static bool
+sc_resumer_is_device_available(struct sc_resumer *resumer) {
+    if (resumer->params.tcpip_dst) {
+        // The server will execute "adb connect"
+        return true;
+    }
+
+    const char *serial = resumer->params.req_serial;
+    assert(serial);
+
+    struct sc_vec_adb_devices vec = SC_VECTOR_INITIALIZER;
+    bool ok = sc_adb_list_devices(&resumer->intr, SC_ADB_SILENT, &vec);
+    if (!ok) {
+        return false;
+    }
+
+    bool available = false;
+    for (size_t i = 0; i < vec.size; ++i) {
+        struct sc_adb_device *device = &vec.data[i];
+        if (!strcmp(device->serial, serial)
+                && !strcmp(device->state, "device")) {
+            available = true;
+            break;
+        }
+    }
+
+    sc_adb_devices_destroy(&vec);
+    return available;
+}
+
+// Start a new server and wait for its connection
+static bool
+sc_resumer_connect(struct sc_resumer *resumer) {
+    if (!sc_resumer_is_device_available(resumer)) {
+        return false;
+    }
+
+    static const struct sc_server_callbacks cbs = {
+        .on_connection_failed = sc_resumer_server_on_connection_failed,
+        .on_connected = sc_resumer_server_on_connected,
+        .on_disconnected = sc_resumer_server_on_disconnected,
+    };
+
+    // Only use 31 bits to avoid issues with signed values on the Java-side
+    resumer->params.scid = sc_rand_u32(&resumer->rand) & 0x7FFFFFFF;
+
+    struct sc_server *server = resumer->server;
+    if (!sc_server_init(server, &resumer->params, &cbs, resumer)) {
+        return false;
+    }
+
+    resumer->connection = SC_RESUMER_CONNECTION_PENDING;
+
+    if (!sc_server_start(server)) {
+        sc_server_destroy(server);
+        return false;
+    }
+
+    sc_mutex_lock(&resumer->mutex);
+    resumer->server_started = true;
+    if (resumer->stopped) {
+        // sc_resumer_stop() has been called before the server was started
+        sc_server_stop(server);
+    }
+    while (resumer->connection == SC_RESUMER_CONNECTION_PENDING) {
+        // If the resumer is stopped, the server is interrupted, so the
+        // callback will be called anyway
+        sc_cond_wait(&resumer->cond, &resumer->mutex);
+    }
+    bool connected = resumer->connection == SC_RESUMER_CONNECTION_SUCCESS;
+    if (!connected) {
+        resumer->server_started = false;
+    }
+    sc_mutex_unlock(&resumer->mutex);
+
+    if (!connected) {
+        sc_server_join(server);
+        sc_server_destroy(server);
+    }
+
+    return connected;
+}
+
+static bool
+sc_resumer_resume_components(struct sc_resumer *resumer) {
+    struct sc_server *server = resumer->server;
+
+    sc_mutex_lock(&resumer->mutex);
+    // From now on, a disconnection interrupts the new session
+    resumer->interrupted = false;
+    sc_mutex_unlock(&resumer->mutex);
+
+    if (resumer->video_demuxer) {
+        sc_demuxer_resume(resumer->video_demuxer, server->video_socket);
+    }
+    if (resumer->audio_demuxer) {
+        sc_demuxer_resume(resumer->audio_demuxer, server->audio_socket);
+    }
+
+    if (resumer->controller) {
+        bool ok = sc_controller_resume(resumer->controller,
+                                       server->control_socket);
+        if (!ok) {
+            return false;
+        }
+        resumer->controller_started = true;
+    }
+
+    return true;
+}
+
+// Return false if the resumer is stopped or if the session could not be resumed
+// before the timeout
+static bool
+sc_resumer_resume(struct sc_resumer *resumer) {
+    sc_resumer_release(resumer);
+
+    sc_tick deadline = sc_tick_now() + resumer->timeout;
+    unsigned attempts = 0;
+
+    for (;;) {
+        ++attempts;
+        LOGD("Resumer: connection attempt %u", attempts);
+
+        if (sc_resumer_connect(resumer)) {
+            LOGD("Resumer: connected after %u attempt(s)", attempts);
+            return sc_resumer_resume_components(resumer);
+        }
+
+        sc_tick next = sc_tick_now() + SC_RESUMER_RETRY_DELAY;
+        if (next >= deadline) {
+            return false;
+        }
+
+        sc_mutex_lock(&resumer->mutex);
+        bool timed_out = false;
+        while (!resumer->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&resumer->cond, &resumer->mutex,
+                                           next);
+        }
+        bool stopped = resumer->stopped;
+        sc_mutex_unlock(&resumer->mutex);
+
+        if (stopped) {
+            return false;
+        }
+    }
+}
+
+static int
+run_resumer(void *data) {
+    struct sc_resumer *resumer = data;
+
+    for (;;) {
+        sc_mutex_lock(&resumer->mutex);
+        while (!resumer->stopped && !resumer->interrupted) {
+            sc_cond_wait(&resumer->cond, &resumer->mutex);
+        }
+        bool stopped = resumer->stopped;
+        sc_mutex_unlock(&resumer->mutex);
+
+        if (stopped) {
+            break;
+        }
+
+        sc_tick start = sc_tick_now();
+        resumer->cbs->on_interrupted(resumer, resumer->cbs_userdata);
+
+        bool ok = sc_resumer_resume(resumer);
+        if (!ok) {
+            if (!sc_resumer_is_stopped(resumer)) {
+                LOGE("Could not resume the session");
+                resumer->cbs->on_failed(resumer, resumer->cbs_userdata);
+            }
+            break;
+        }
+
+        sc_tick duration = sc_tick_now() - start;
+        sc_metrics_add(SC_METRIC_SESSION_RESUMES, 1);
+        resumer->cbs->on_resumed(resumer, duration, resumer->cbs_userdata);
+    }
+
+    LOGD("Resumer stopped");
+
+    return 0;
+}
+
+bool
+sc_resumer_start(struct sc_resumer *resumer) {
+    LOGD("Starting resumer thread");
+
+    resumer->controller_started = !!resumer->controller;
+
+    bool ok = sc_thread_create(&resumer->thread, run_resumer, "scrcpy-resume",
+                               resumer);
+    if (!ok) {
+        LOGE("Could not start resumer thread");
+        return false;
+    }
+
+    return true;
+}
+
+void
+sc_resumer_interrupt_session(struct sc_resumer *resumer) {
+    sc_mutex_lock(&resumer->mutex);
+    if (!resumer->stopped && !resumer->interrupted) {
+        resumer->interrupted = true;
+        sc_cond_signal(&resumer->cond);
+    }
+    sc_mutex_unlock(&resumer->mutex);
+}
+
+void
+sc_resumer_stop(struct sc_resumer *resumer) {
+    sc_mutex_lock(&resumer->mutex);
+    resumer->stopped = true;
+    sc_cond_signal(&resumer->cond);
+    sc_intr_interrupt(&resumer->intr);
+    if (resumer->server_started) {
+        // Interrupt any pending connection
+        sc_server_stop(resumer->server);
+    }
+    sc_mutex_unlock(&resumer->mutex);
+
+    // Do not wait for a resumption anymore
+    if (resumer->video_demuxer) {
+        sc_demuxer_stop(resumer->video_demuxer);
+    }
+    if (resumer->audio_demuxer) {
+        sc_demuxer_stop(resumer->audio_demuxer);
+    }
+}
+
+void
+sc_resumer_join(struct sc_resumer *resumer) {
+    sc_thread_join(&resumer->thread, NULL);
+}
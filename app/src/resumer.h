@@ -0,0 +1,127 @@
+#ifndef SC_RESUMER_H
+#define SC_RESUMER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "controller.h"
+#include "demuxer.h"
+#include "server.h"
+#include "util/intr.h"
+#include "util/rand.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Resume the session after a transient disconnection (--resume-timeout)
+ *
+ * When the connection is lost, the server is restarted and the demuxers and
+ * the controller are resumed on the new sockets, so that all the other
+ * components (the window, the decoders, the recorder, the input processors…)
+ * are kept alive.
+ */
+struct sc_resumer {
+    struct sc_server *server;
+    struct sc_server_params params;
+    char *serial;
+
+    struct sc_demuxer *video_demuxer; // may be NULL
+    struct sc_demuxer *audio_demuxer; // may be NULL
+    struct sc_controller *controller; // may be NULL
+
+    sc_tick timeout;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+    bool interrupted; // the session is interrupted (a resumption is pending)
+    struct sc_intr intr;
+    struct sc_rand rand;
+
+    enum {
+        SC_RESUMER_CONNECTION_PENDING,
+        SC_RESUMER_CONNECTION_SUCCESS,
+        SC_RESUMER_CONNECTION_FAILURE,
+    } connection;
+
+    bool server_started; // protected by the mutex
+    bool controller_started;
+
+    const struct sc_resumer_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+struct sc_resumer_callbacks {
+    /**
+     * Called when the session is interrupted, before trying to reconnect
+     */
+    void (*on_interrupted)(struct sc_resumer *resumer, void *userdata);
+
+    /**
+     * Called once the demuxers and the controller are resumed
+     *
+     * The duration is the time spent to reconnect.
+     */
+    void (*on_resumed)(struct sc_resumer *resumer, sc_tick duration,
+                       void *userdata);
+
+    /**
+     * Called if the session could not be resumed before the timeout
+     *
+     * The resumer is terminated.
+     */
+    void (*on_failed)(struct sc_resumer *resumer, void *userdata);
+};
+
+/**
+ * Initialize the resumer for a server already started and connected
+ *
+ * The server must be connected to the device (its serial is known), and the
+ * demuxers and the controller (if any) must not be started yet.
+ *
+ * Once initialized, sc_resumer_stop() must be called before joining the
+ * demuxers, even if the resumer is not started.
+ */
+bool
+sc_resumer_init(struct sc_resumer *resumer, struct sc_server *server,
+                const struct sc_server_params *params,
+                struct sc_demuxer *video_demuxer,
+                struct sc_demuxer *audio_demuxer,
+                struct sc_controller *controller, sc_tick timeout,
+                const struct sc_resumer_callbacks *cbs, void *cbs_userdata);
+
+void
+sc_resumer_destroy(struct sc_resumer *resumer);
+
+/**
+ * Start the resumer thread
+ *
+ * The demuxers and the controller (if any) must be started.
+ */
+bool
+sc_resumer_start(struct sc_resumer *resumer);
+
+/**
+ * Notify that the connection is lost (may be called from any thread)
+ *
+ * It has no effect if the session is already being resumed.
+ */
+void
+sc_resumer_interrupt_session(struct sc_resumer *resumer);
+
+/**
+ * Stop the resumer (and the current server, if any)
+ *
+ * Once the resumer is joined, the server must be stopped, joined and destroyed
+ * only if resumer->server_started, and the controller must be stopped and
+ * joined only if resumer->controller_started.
+ */
+void
+sc_resumer_stop(struct sc_resumer *resumer);
+
+void
+sc_resumer_join(struct sc_resumer *resumer);
+
+#endif
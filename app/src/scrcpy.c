@@ -21,11 +21,17 @@
 #include "events.h"
 #include "file_pusher.h"
 #include "keyboard_sdk.h"
+#include "metrics.h"
+#include "metrics_server.h"
 #include "mouse_sdk.h"
 #include "recorder.h"
+#include "resumer.h"
 #include "screen.h"
 #include "sdl_hints.h"
 #include "server.h"
+#include "startup.h"
+#include "stream_dump.h"
+#include "stream_replay.h"
 #include "uhid/gamepad_uhid.h"
 #include "uhid/keyboard_uhid.h"
 #include "uhid/mouse_uhid.h"
@@ -54,6 +60,10 @@ struct scrcpy {
     struct sc_audio_player audio_player;
     struct sc_demuxer video_demuxer;
     struct sc_demuxer audio_demuxer;
+    struct sc_stream_dump video_dump;
+    struct sc_stream_dump audio_dump;
+    struct sc_stream_replay video_replay;
+    struct sc_stream_replay audio_replay;
     struct sc_decoder video_decoder;
     struct sc_decoder audio_decoder;
     struct sc_recorder recorder;
@@ -64,6 +74,7 @@ struct scrcpy {
 #endif
     struct sc_controller controller;
     struct sc_file_pusher file_pusher;
+    struct sc_metrics_server metrics_server;
 #ifdef HAVE_USB
     struct sc_usb usb;
     struct sc_aoa aoa;
@@ -92,6 +103,7 @@ struct scrcpy {
 #endif
     };
     struct sc_timeout timeout;
+    struct sc_resumer resumer;
 };
 
 #ifdef _WIN32
@@ -113,8 +125,45 @@ sdl_configure_ctrl_c_windows(void) {
 }
 #endif // _WIN32
 
+static void
+sc_set_display_power_off(struct sc_controller *controller) {
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
+    msg.set_display_power.on = false;
+
+    if (!sc_controller_push_msg(controller, &msg)) {
+        LOGW("Could not request 'set display power'");
+    }
+}
+
+// Restore the device state which did not survive the previous server
+static void
+restore_session(struct scrcpy *s, const struct scrcpy_options *options) {
+    if (!options->control) {
+        return;
+    }
+
+    // The UHID devices are owned by the server process
+    if (options->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_UHID) {
+        sc_keyboard_uhid_resume(&s->keyboard_uhid);
+    }
+    if (options->mouse_input_mode == SC_MOUSE_INPUT_MODE_UHID) {
+        sc_mouse_uhid_resume(&s->mouse_uhid);
+    }
+    if (options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
+        sc_gamepad_uhid_resume(&s->gamepad_uhid);
+    }
+
+    // The cleanup process of the previous server turned the device screen
+    // back on when it died
+    if (options->turn_screen_off) {
+        sc_set_display_power_off(&s->controller);
+    }
+}
+
 static enum scrcpy_exit_code
-event_loop(struct scrcpy *s, bool has_screen) {
+event_loop(struct scrcpy *s, const struct scrcpy_options *options) {
+    bool has_screen = options->window;
     SDL_Event event;
     while (SDL_WaitEvent(&event)) {
         switch (event.type) {
@@ -142,6 +191,12 @@ event_loop(struct scrcpy *s, bool has_screen) {
             case SDL_EVENT_QUIT:
                 LOGD("User requested to quit");
                 return SCRCPY_EXIT_SUCCESS;
+            case SC_EVENT_SESSION_RESUMED:
+                restore_session(s, options);
+                if (has_screen) {
+                    sc_screen_handle_event(&s->screen, &event);
+                }
+                break;
             default:
                 if (has_screen) {
                     sc_screen_handle_event(&s->screen, &event);
@@ -230,15 +285,48 @@ sc_controller_on_ended(struct sc_controller *controller, bool error,
     // Note: this function may be called twice, once from the controller thread
     // and once from the receiver thread
     (void) controller;
-    (void) userdata;
+
+    // Only set if the session may be resumed
+    struct sc_resumer *resumer = userdata;
 
     if (error) {
         sc_push_event(SC_EVENT_CONTROLLER_ERROR);
+    } else if (resumer) {
+        sc_resumer_interrupt_session(resumer);
     } else {
         sc_push_event(SC_EVENT_DEVICE_DISCONNECTED);
     }
 }
 
+static void
+sc_resumer_on_interrupted(struct sc_resumer *resumer, void *userdata) {
+    (void) resumer;
+    (void) userdata;
+
+    LOGW("Device disconnected, trying to resume the session...");
+    sc_push_event(SC_EVENT_SESSION_INTERRUPTED);
+}
+
+static void
+sc_resumer_on_resumed(struct sc_resumer *resumer, sc_tick duration,
+                      void *userdata) {
+    (void) resumer;
+    (void) userdata;
+
+    LOGI("Reconnected in %" PRItick " ms", SC_TICK_TO_MS(duration));
+    // Overwritten on the first rendered frame, if any
+    sc_metrics_set(SC_METRIC_SESSION_RESUME_TIME, SC_TICK_TO_MS(duration));
+    sc_push_event(SC_EVENT_SESSION_RESUMED);
+}
+
+static void
+sc_resumer_on_failed(struct sc_resumer *resumer, void *userdata) {
+    (void) resumer;
+    (void) userdata;
+
+    sc_push_event(SC_EVENT_DEVICE_DISCONNECTED);
+}
+
 static void
 sc_server_on_connection_failed(struct sc_server *server, void *userdata) {
     (void) server;
@@ -282,6 +370,44 @@ scrcpy_generate_scid(void) {
     return sc_rand_u32(&rand) & 0x7FFFFFFF;
 }
 
+static char *
+scrcpy_get_stream_dump_filename(const char *prefix, const char *name) {
+    char *filename;
+    int r = asprintf(&filename, "%s-%s.scdump", prefix, name);
+    if (r == -1) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    return filename;
+}
+
+static bool
+scrcpy_open_stream_dump(struct sc_stream_dump *dump, const char *prefix,
+                        const char *name) {
+    char *filename = scrcpy_get_stream_dump_filename(prefix, name);
+    if (!filename) {
+        return false;
+    }
+
+    bool ok = sc_stream_dump_open(dump, filename);
+    free(filename);
+    return ok;
+}
+
+static bool
+scrcpy_init_stream_replay(struct sc_stream_replay *replay, const char *prefix,
+                          const char *name, float speed) {
+    char *filename = scrcpy_get_stream_dump_filename(prefix, name);
+    if (!filename) {
+        return false;
+    }
+
+    bool ok = sc_stream_replay_init(replay, filename, speed);
+    free(filename);
+    return ok;
+}
+
 static void
 init_sdl_gamepads(void) {
     // Trigger a SDL_EVENT_GAMEPAD_ADDED event for all gamepads already
@@ -334,8 +460,11 @@ scrcpy(struct scrcpy_options *options) {
 
     atexit(SDL_Quit);
 
+    sc_startup_init(options->startup_profile);
+
     enum scrcpy_exit_code ret = SCRCPY_EXIT_FAILURE;
 
+    bool server_initialized = false;
     bool server_started = false;
     bool file_pusher_initialized = false;
     bool recorder_initialized = false;
@@ -343,6 +472,10 @@ scrcpy(struct scrcpy_options *options) {
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
 #endif
+    bool video_replay_initialized = false;
+    bool audio_replay_initialized = false;
+    bool video_dump_opened = false;
+    bool audio_dump_opened = false;
     bool video_demuxer_started = false;
     bool audio_demuxer_started = false;
 #ifdef HAVE_USB
@@ -356,6 +489,10 @@ scrcpy(struct scrcpy_options *options) {
     bool screen_initialized = false;
     bool timeout_initialized = false;
     bool timeout_started = false;
+    bool metrics_server_initialized = false;
+    bool metrics_server_started = false;
+    bool resumer_initialized = false;
+    bool resumer_started = false;
     bool disconnected = false;
 
     struct sc_acksync *acksync = NULL;
@@ -383,6 +520,9 @@ scrcpy(struct scrcpy_options *options) {
         .audio_bit_rate = options->audio_bit_rate,
         .max_fps = options->max_fps,
         .angle = options->angle,
+        .video_scale_filter = options->video_scale_filter,
+        .video_sharpen = options->video_sharpen,
+        .video_simulcast = options->video_simulcast,
         .screen_off_timeout = options->screen_off_timeout,
         .capture_orientation = options->capture_orientation,
         .capture_orientation_lock = options->capture_orientation_lock,
@@ -404,6 +544,14 @@ scrcpy(struct scrcpy_options *options) {
         .camera_ar = options->camera_ar,
         .camera_fps = options->camera_fps,
         .force_adb_forward = options->force_adb_forward,
+        .multiplex = options->multiplex,
+        .direct_tcp_port = options->direct_tcp_port,
+        .socket_buffers = options->socket_buffers,
+        .low_latency_sockets = options->low_latency_sockets,
+        .video_low_latency = options->video_low_latency,
+        .skip_unchanged_frames = options->skip_unchanged_frames,
+        .video_dirty_rects = options->video_dirty_rects,
+        .video_drop_frames = options->video_drop_frames,
         .power_off_on_close = options->power_off_on_close,
         .clipboard_autosync = options->clipboard_autosync,
         .downsize_on_error = options->downsize_on_error,
@@ -422,15 +570,22 @@ scrcpy(struct scrcpy_options *options) {
         .ignore_video_encoder_constraints =
             options->ignore_video_encoder_constraints,
         .list = options->list,
+        .idle_timeout = options->server_idle_timeout,
     };
 
-    static const struct sc_server_callbacks cbs = {
-        .on_connection_failed = sc_server_on_connection_failed,
-        .on_connected = sc_server_on_connected,
-        .on_disconnected = sc_server_on_disconnected,
-    };
-    if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
-        return SCRCPY_EXIT_FAILURE;
+    // When replaying a stream dump, there is no device (and no server)
+    bool replay = !!options->stream_replay;
+
+    if (!replay) {
+        static const struct sc_server_callbacks cbs = {
+            .on_connection_failed = sc_server_on_connection_failed,
+            .on_connected = sc_server_on_connected,
+            .on_disconnected = sc_server_on_disconnected,
+        };
+        if (!sc_server_init(&s->server, &params, &cbs, NULL)) {
+            return SCRCPY_EXIT_FAILURE;
+        }
+        server_initialized = true;
     }
 
 #ifdef _WIN32
@@ -441,11 +596,13 @@ scrcpy(struct scrcpy_options *options) {
     // SDL
     sc_sdl_set_hints(options->render_driver, options->disable_screensaver);
 
-    if (!sc_server_start(&s->server)) {
-        goto end;
-    }
+    if (!replay) {
+        if (!sc_server_start(&s->server)) {
+            goto end;
+        }
 
-    server_started = true;
+        server_started = true;
+    }
 
     if (options->list) {
         bool ok = await_for_server(NULL);
@@ -453,6 +610,19 @@ scrcpy(struct scrcpy_options *options) {
         goto end;
     }
 
+    if (options->metrics_port) {
+        if (!sc_metrics_server_init(&s->metrics_server,
+                                    options->metrics_port)) {
+            goto end;
+        }
+        metrics_server_initialized = true;
+
+        if (!sc_metrics_server_start(&s->metrics_server)) {
+            goto end;
+        }
+        metrics_server_started = true;
+    }
+
     // playback implies capture
     assert(!options->video_playback || options->video);
     assert(!options->audio_playback || options->audio);
@@ -488,36 +658,45 @@ scrcpy(struct scrcpy_options *options) {
         }
     }
 
-    // Await for server without blocking Ctrl+C handling
-    bool connected;
-    if (!await_for_server(&connected)) {
-        LOGE("Server connection failed");
-        goto end;
-    }
+    const char *window_title = options->window_title;
+    const char *serial = NULL;
 
-    if (!connected) {
-        // This is not an error, user requested to quit
-        LOGD("User requested to quit");
-        ret = SCRCPY_EXIT_SUCCESS;
-        goto end;
-    }
+    if (!replay) {
+        // Await for server without blocking Ctrl+C handling
+        bool connected;
+        if (!await_for_server(&connected)) {
+            LOGE("Server connection failed");
+            goto end;
+        }
 
-    LOGD("Server connected");
+        if (!connected) {
+            // This is not an error, user requested to quit
+            LOGD("User requested to quit");
+            ret = SCRCPY_EXIT_SUCCESS;
+            goto end;
+        }
+
+        LOGD("Server connected");
+
+        // It is necessarily initialized here, since the device is connected
+        struct sc_server_info *info = &s->server.info;
 
-    // It is necessarily initialized here, since the device is connected
-    struct sc_server_info *info = &s->server.info;
+        if (!window_title) {
+            window_title = info->device_name;
+        }
+
+        serial = s->server.serial;
+        assert(serial);
+    } else if (!window_title) {
+        window_title = options->stream_replay;
+    }
 
-    const char *window_title =
-        options->window_title ? options->window_title : info->device_name;
     assert(window_title);
 
     if (options->update_terminal_title) {
         set_terminal_title_with_prefix(window_title);
     }
 
-    const char *serial = s->server.serial;
-    assert(serial);
-
     struct sc_file_pusher *fp = NULL;
 
     if (options->window && options->control) {
@@ -533,16 +712,63 @@ scrcpy(struct scrcpy_options *options) {
         static const struct sc_demuxer_callbacks video_demuxer_cbs = {
             .on_ended = sc_video_demuxer_on_ended,
         };
-        sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
-                        &video_demuxer_cbs, NULL);
+        if (replay) {
+            if (!scrcpy_init_stream_replay(&s->video_replay,
+                                           options->stream_replay, "video",
+                                           options->stream_replay_speed)) {
+                goto end;
+            }
+            video_replay_initialized = true;
+
+            sc_demuxer_init_replay(&s->video_demuxer, "video",
+                                   &s->video_replay, &video_demuxer_cbs, NULL);
+        } else {
+            sc_demuxer_init(&s->video_demuxer, "video", s->server.video_socket,
+                            &video_demuxer_cbs, NULL);
+        }
+
+        if (options->stream_dump) {
+            if (!scrcpy_open_stream_dump(&s->video_dump, options->stream_dump,
+                                         "video")) {
+                goto end;
+            }
+            video_dump_opened = true;
+
+            sc_demuxer_set_dump(&s->video_demuxer, &s->video_dump);
+        }
     }
 
     if (options->audio) {
         static const struct sc_demuxer_callbacks audio_demuxer_cbs = {
             .on_ended = sc_audio_demuxer_on_ended,
         };
-        sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
-                        &audio_demuxer_cbs, options);
+        if (replay) {
+            if (!scrcpy_init_stream_replay(&s->audio_replay,
+                                           options->stream_replay, "audio",
+                                           options->stream_replay_speed)) {
+                LOGE("No audio stream dump (use --no-audio to replay the video "
+                     "only)");
+                goto end;
+            }
+            audio_replay_initialized = true;
+
+            sc_demuxer_init_replay(&s->audio_demuxer, "audio",
+                                   &s->audio_replay, &audio_demuxer_cbs,
+                                   options);
+        } else {
+            sc_demuxer_init(&s->audio_demuxer, "audio", s->server.audio_socket,
+                            &audio_demuxer_cbs, options);
+        }
+
+        if (options->stream_dump) {
+            if (!scrcpy_open_stream_dump(&s->audio_dump, options->stream_dump,
+                                         "audio")) {
+                goto end;
+            }
+            audio_dump_opened = true;
+
+            sc_demuxer_set_dump(&s->audio_demuxer, &s->audio_dump);
+        }
     }
 
     bool needs_video_decoder = options->video_playback;
@@ -588,6 +814,28 @@ scrcpy(struct scrcpy_options *options) {
         }
     }
 
+    if (options->resume_timeout) {
+        static const struct sc_resumer_callbacks resumer_cbs = {
+            .on_interrupted = sc_resumer_on_interrupted,
+            .on_resumed = sc_resumer_on_resumed,
+            .on_failed = sc_resumer_on_failed,
+        };
+
+        assert(!replay);
+        struct sc_demuxer *video_demuxer =
+            options->video ? &s->video_demuxer : NULL;
+        struct sc_demuxer *audio_demuxer =
+            options->audio ? &s->audio_demuxer : NULL;
+        struct sc_controller *resumed_controller =
+            options->control ? &s->controller : NULL;
+        if (!sc_resumer_init(&s->resumer, &s->server, &params, video_demuxer,
+                             audio_demuxer, resumed_controller,
+                             options->resume_timeout, &resumer_cbs, NULL)) {
+            goto end;
+        }
+        resumer_initialized = true;
+    }
+
     struct sc_controller *controller = NULL;
     struct sc_key_processor *kp = NULL;
     struct sc_mouse_processor *mp = NULL;
@@ -598,8 +846,10 @@ scrcpy(struct scrcpy_options *options) {
             .on_ended = sc_controller_on_ended,
         };
 
+        struct sc_resumer *resumer =
+            resumer_initialized ? &s->resumer : NULL;
         if (!sc_controller_init(&s->controller, s->server.control_socket,
-            &controller_cbs, NULL)) {
+            &controller_cbs, resumer)) {
             goto end;
         }
         controller_initialized = true;
@@ -759,6 +1009,7 @@ aoa_complete:
             .video = options->video_playback,
             .camera = options->video_source == SC_VIDEO_SOURCE_CAMERA,
             .flex_display = options->flex_display,
+            .video_simulcast = options->video_simulcast != 0,
             .controller = controller,
             .fp = fp,
             .kp = kp,
@@ -804,6 +1055,7 @@ aoa_complete:
 
     if (options->audio_playback) {
         sc_audio_player_init(&s->audio_player, options->audio_buffer,
+                             options->audio_buffer_auto,
                              options->audio_output_buffer);
         sc_frame_source_add_sink(&s->audio_decoder.frame_source,
                                  &s->audio_player.frame_sink);
@@ -846,16 +1098,17 @@ aoa_complete:
         audio_demuxer_started = true;
     }
 
+    if (resumer_initialized) {
+        if (!sc_resumer_start(&s->resumer)) {
+            goto end;
+        }
+        resumer_started = true;
+    }
+
     // If the device screen is to be turned off, send the control message after
     // everything is set up
     if (options->control && options->turn_screen_off) {
-        struct sc_control_msg msg;
-        msg.type = SC_CONTROL_MSG_TYPE_SET_DISPLAY_POWER;
-        msg.set_display_power.on = false;
-
-        if (!sc_controller_push_msg(&s->controller, &msg)) {
-            LOGW("Could not request 'set display power'");
-        }
+        sc_set_display_power_off(&s->controller);
     }
 
     if (options->time_limit) {
@@ -903,7 +1156,10 @@ aoa_complete:
         }
     }
 
-    ret = event_loop(s, options->window);
+    ret = event_loop(s, options);
+
+    // Report the phases reached, even if the first frame was never rendered
+    sc_startup_complete();
 
     // Reject all new runnables, and execute the pending ones now
     // (they could access memory that will be cleaned up below)
@@ -912,6 +1168,18 @@ aoa_complete:
     disconnected = ret == SCRCPY_EXIT_DISCONNECTED;
 
 end:
+    if (resumer_initialized) {
+        // Also stop the demuxers waiting for a resumption
+        sc_resumer_stop(&s->resumer);
+    }
+    if (resumer_started) {
+        sc_resumer_join(&s->resumer);
+        // The server and the controller may have been released or restarted
+        server_started = s->resumer.server_started;
+        server_initialized = server_started;
+        controller_started = s->resumer.controller_started;
+    }
+
     if (timeout_started) {
         sc_timeout_stop(&s->timeout);
     }
@@ -941,6 +1209,15 @@ end:
         // shutdown the sockets and kill the server
         sc_server_stop(&s->server);
     }
+    if (video_replay_initialized) {
+        sc_stream_replay_interrupt(&s->video_replay);
+    }
+    if (audio_replay_initialized) {
+        sc_stream_replay_interrupt(&s->audio_replay);
+    }
+    if (metrics_server_started) {
+        sc_metrics_server_interrupt(&s->metrics_server);
+    }
 
     if (screen_initialized) {
         if (disconnected) {
@@ -970,6 +1247,19 @@ end:
         sc_demuxer_join(&s->audio_demuxer);
     }
 
+    if (video_replay_initialized) {
+        sc_stream_replay_destroy(&s->video_replay);
+    }
+    if (audio_replay_initialized) {
+        sc_stream_replay_destroy(&s->audio_replay);
+    }
+    if (video_dump_opened) {
+        sc_stream_dump_close(&s->video_dump);
+    }
+    if (audio_dump_opened) {
+        sc_stream_dump_close(&s->audio_dump);
+    }
+
 #ifdef HAVE_V4L2
     if (v4l2_sink_initialized) {
         sc_v4l2_sink_destroy(&s->v4l2_sink);
@@ -1030,7 +1320,21 @@ end:
         sc_server_join(&s->server);
     }
 
-    sc_server_destroy(&s->server);
+    if (server_initialized) {
+        sc_server_destroy(&s->server);
+    }
+
+    if (resumer_initialized) {
+        // The server params reference the serial owned by the resumer
+        sc_resumer_destroy(&s->resumer);
+    }
+
+    if (metrics_server_started) {
+        sc_metrics_server_join(&s->metrics_server);
+    }
+    if (metrics_server_initialized) {
+        sc_metrics_server_destroy(&s->metrics_server);
+    }
 
     return ret;
 }
@@ -1,12 +1,15 @@
 #include "screen.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <string.h>
 #include <SDL3/SDL.h>
 
 #include "events.h"
 #include "icon.h"
+#include "metrics.h"
 #include "options.h"
+#include "startup.h"
 #include "util/log.h"
 #include "util/sdl.h"
 
@@ -231,6 +234,37 @@ sc_screen_update_content_rect(struct sc_screen *screen) {
                          screen->render_fit, &screen->rect);
 }
 
+// Dim the content and draw a "Reconnecting..." message over it
+static void
+sc_screen_render_reconnecting(struct sc_screen *screen) {
+    SDL_Renderer *renderer = screen->renderer;
+
+    int w;
+    int h;
+    if (!SDL_GetCurrentRenderOutputSize(renderer, &w, &h)) {
+        LOGE("Could not get render output size: %s", SDL_GetError());
+        return;
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, NULL);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    static const char text[] = "Reconnecting...";
+    // The debug font is tiny, upscale it
+    float text_scale = h >= 480 ? 3 : 2;
+    float text_w = (sizeof(text) - 1) * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE
+                 * text_scale;
+    float text_h = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE * text_scale;
+
+    SDL_SetRenderScale(renderer, text_scale, text_scale);
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderDebugText(renderer, (w - text_w) / 2 / text_scale,
+                        (h - text_h) / 2 / text_scale, text);
+    SDL_SetRenderScale(renderer, 1, 1);
+}
+
 // render the texture to the renderer
 //
 // Set the update_content_rect flag if the window or content size may have
@@ -306,9 +340,30 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
     }
 
 end:
+    if (screen->reconnecting) {
+        sc_screen_render_reconnecting(screen);
+    }
+
     sc_sdl_render_present(renderer);
 }
 
+static void
+sc_screen_select_video_stream(struct sc_screen *screen, bool focused) {
+    assert(screen->video_simulcast);
+    assert(screen->controller);
+
+    // While the window is not focused, the lower definition stream is
+    // sufficient (the server switches on the next key frame)
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_SELECT_VIDEO_STREAM;
+    msg.select_video_stream.stream = focused ? SC_VIDEO_STREAM_MAIN
+                                             : SC_VIDEO_STREAM_SIMULCAST;
+
+    if (!sc_controller_push_msg(screen->controller, &msg)) {
+        LOGW("Could not request video stream selection");
+    }
+}
+
 static void
 sc_screen_request_resize_display(struct sc_screen *screen, uint16_t width,
                                  uint16_t height) {
@@ -452,6 +507,9 @@ sc_screen_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
     bool previous_skipped = sc_frame_buffer_has_frame(&screen->fb);
     bool ok = sc_frame_buffer_push(&screen->fb, frame);
     screen->prevent_auto_resize = screen->current_session.video.client_resized;
+    if (previous_skipped) {
+        screen->frame_skipped = true;
+    }
     sc_mutex_unlock(&screen->mutex);
     if (!ok) {
         return false;
@@ -492,12 +550,14 @@ sc_screen_init(struct sc_screen *screen,
     screen->orientation = SC_ORIENTATION_0;
     screen->disconnected = false;
     screen->disconnect_started = false;
+    screen->reconnecting = false;
 
     screen->video = params->video;
     screen->camera = params->camera;
     screen->window_aspect_ratio_lock = params->window_aspect_ratio_lock;
     screen->render_fit = params->render_fit;
     screen->flex_display = params->flex_display;
+    screen->video_simulcast = params->video_simulcast;
 
     screen->bg.r = (params->background_color >> 16) & 0xFF;
     screen->bg.g = (params->background_color >> 8) & 0xFF;
@@ -511,6 +571,7 @@ sc_screen_init(struct sc_screen *screen,
     screen->req.start_fps_counter = params->start_fps_counter;
 
     screen->prevent_auto_resize = false;
+    screen->frame_skipped = false;
 
     screen->resize_tracker.time = 0;
     screen->resize_tracker.size.width = 0;
@@ -771,6 +832,8 @@ sc_screen_show_initial_window(struct sc_screen *screen) {
     screen->window_shown = true;
     sc_sdl_show_window(screen->window);
     sc_screen_update_content_rect(screen);
+
+    sc_startup_mark(SC_STARTUP_PHASE_WINDOW_SHOWN);
 }
 
 void
@@ -912,8 +975,11 @@ sc_screen_set_orientation(struct sc_screen *screen,
     sc_screen_render(screen, true);
 }
 
+// If full_update is false, only the dirty rects of the frame (if any) are
+// uploaded to the texture
 static bool
-sc_screen_apply_frame(struct sc_screen *screen, bool can_resize) {
+sc_screen_apply_frame(struct sc_screen *screen, bool can_resize,
+                      bool full_update) {
     assert(screen->video);
     assert(screen->window_shown);
 
@@ -945,19 +1011,54 @@ sc_screen_apply_frame(struct sc_screen *screen, bool can_resize) {
         sc_screen_update_content_rect(screen);
     }
 
-    bool ok = sc_texture_set_from_frame(&screen->tex, frame);
+    const struct sc_dirty_rects *drs = NULL;
+#ifdef SCRCPY_LAVC_HAS_PACKET_OPAQUE_REF
+    if (!full_update && frame->opaque_ref) {
+        // Attached by the demuxer (forwarded by the decoder)
+        assert(frame->opaque_ref->size == sizeof(*drs));
+        drs = (const struct sc_dirty_rects *) frame->opaque_ref->data;
+    }
+#else
+    (void) full_update;
+#endif
+
+    bool ok = sc_texture_set_from_frame(&screen->tex, frame, drs);
     if (!ok) {
         return false;
     }
 
     sc_screen_render(screen, false);
+
+    sc_startup_mark(SC_STARTUP_PHASE_FIRST_FRAME_RENDERED);
+    // The startup ends on the first rendered frame
+    sc_startup_complete();
     return true;
 }
 
+// Called on the first frame of a resumed session
+static void
+sc_screen_finish_reconnecting(struct sc_screen *screen) {
+    assert(screen->reconnecting);
+    screen->reconnecting = false;
+
+    sc_tick ttr = sc_tick_now() - screen->reconnecting_since;
+    sc_metrics_set(SC_METRIC_SESSION_RESUME_TIME, SC_TICK_TO_MS(ttr));
+    LOGI("Session resumed, first frame %" PRItick " ms after the "
+         "disconnection", SC_TICK_TO_MS(ttr));
+}
+
 static bool
 sc_screen_update_frame(struct sc_screen *screen) {
     assert(screen->video);
 
+    if (screen->reconnecting) {
+        sc_screen_finish_reconnecting(screen);
+        if (screen->paused && screen->window_shown) {
+            // Remove the overlay (the frame will be applied on unpause)
+            sc_screen_render(screen, false);
+        }
+    }
+
     if (screen->paused) {
         if (!screen->resume_frame) {
             screen->resume_frame = av_frame_alloc();
@@ -979,8 +1080,10 @@ sc_screen_update_frame(struct sc_screen *screen) {
     sc_frame_buffer_consume(&screen->fb, screen->frame);
     // read with lock held
     bool can_resize = !screen->prevent_auto_resize;
+    bool full_update = screen->frame_skipped;
+    screen->frame_skipped = false;
     sc_mutex_unlock(&screen->mutex);
-    return sc_screen_apply_frame(screen, can_resize);
+    return sc_screen_apply_frame(screen, can_resize, full_update);
 }
 
 void
@@ -998,7 +1101,8 @@ sc_screen_set_paused(struct sc_screen *screen, bool paused) {
         av_frame_free(&screen->frame);
         screen->frame = screen->resume_frame;
         screen->resume_frame = NULL;
-        bool ok = sc_screen_apply_frame(screen, true);
+        // The frames received while paused have not been applied
+        bool ok = sc_screen_apply_frame(screen, true, true);
         if (!ok) {
             LOGE("Resume frame update failed");
         }
@@ -1169,6 +1273,14 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
             sc_screen_on_resize(screen, &event->window);
             return;
 #endif
+        case SDL_EVENT_WINDOW_FOCUS_GAINED:
+        case SDL_EVENT_WINDOW_FOCUS_LOST:
+            if (screen->video_simulcast) {
+                bool focused = event->type == SDL_EVENT_WINDOW_FOCUS_GAINED;
+                sc_screen_select_video_stream(screen, focused);
+            }
+            // The mouse capture must also handle the focus changes
+            break;
         case SDL_EVENT_WINDOW_RESTORED:
             if (screen->video && is_windowed(screen)) {
                 apply_pending_resize(screen);
@@ -1187,9 +1299,26 @@ sc_screen_handle_event(struct sc_screen *screen, const SDL_Event *event) {
                 sc_screen_render(screen, true);
             }
             return;
+        case SC_EVENT_SESSION_INTERRUPTED:
+            screen->reconnecting = true;
+            screen->reconnecting_since = sc_tick_now();
+            if (screen->window_shown) {
+                sc_screen_render(screen, false);
+            }
+            return;
+        case SC_EVENT_SESSION_RESUMED:
+            if (!screen->video && screen->reconnecting) {
+                // No frame will tell that the session is resumed
+                screen->reconnecting = false;
+                if (screen->window_shown) {
+                    sc_screen_render(screen, false);
+                }
+            }
+            return;
         case SC_EVENT_DEVICE_DISCONNECTED:
             assert(!screen->disconnected);
             screen->disconnected = true;
+            screen->reconnecting = false;
             if (!screen->window_shown) {
                 // No window open
                 return;
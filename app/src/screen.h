@@ -23,6 +23,7 @@
 #include "trait/frame_sink.h"
 #include "trait/mouse_processor.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 #ifdef __APPLE__
 # define SC_DISPLAY_FORCE_OPENGL_CORE_PROFILE
@@ -39,6 +40,7 @@ struct sc_screen {
     bool camera;
     bool window_aspect_ratio_lock;
     bool flex_display;
+    bool video_simulcast; // select the stream on window focus changes
 
     struct sc_controller *controller;
 
@@ -57,6 +59,9 @@ struct sc_screen {
     struct sc_frame_buffer fb; // protected by mutex
     // When true, a frame size change must not cause the window to be resized
     bool prevent_auto_resize; // protected by mutex
+    // When true, a frame has been replaced before being rendered, so the dirty
+    // rects of the next frame are not sufficient to update the texture
+    bool frame_skipped; // protected by mutex
 
     // The initial requested window properties
     struct {
@@ -102,6 +107,10 @@ struct sc_screen {
     bool disconnect_started;
     struct sc_disconnect disconnect;
 
+    // The session is interrupted, and is being resumed (--resume-timeout)
+    bool reconnecting;
+    sc_tick reconnecting_since;
+
     // Track resize requests caused by frame-size changes
     struct sc_resize_tracker {
         sc_tick time; // 0 means none
@@ -113,6 +122,7 @@ struct sc_screen_params {
     bool video;
     bool camera;
     bool flex_display;
+    bool video_simulcast;
 
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
@@ -8,21 +8,36 @@
 #include <sys/types.h>
 
 #include "adb/adb.h"
+#include "startup.h"
 #include "util/env.h"
 #include "util/file.h"
 #include "util/log.h"
 #include "util/net_intr.h"
 #include "util/process.h"
+#include "util/rand.h"
 #include "util/str.h"
 
 #define SC_SERVER_FILENAME "scrcpy-server"
 
 #define SC_SERVER_PATH_DEFAULT PREFIX "/share/scrcpy/" SC_SERVER_FILENAME
-#define SC_DEVICE_SERVER_PATH "/data/local/tmp/scrcpy-server.jar"
+// The server is pushed to a path depending on its content, so that it is not
+// pushed again if it is already present on the device (the server keeps such
+// a file on clean up)
+#define SC_DEVICE_SERVER_PATH_FORMAT \
+    "/data/local/tmp/scrcpy-server-%016" PRIx64 ".jar"
 
 #define SC_ADB_PORT_DEFAULT 5555
 #define SC_SOCKET_NAME_PREFIX "scrcpy_"
 
+// In forward tunnel mode, the delays between connection attempts grow
+// exponentially from the initial delay up to the max delay
+#define SC_SERVER_CONNECT_INITIAL_DELAY SC_TICK_FROM_MS(5)
+#define SC_SERVER_CONNECT_MAX_DELAY SC_TICK_FROM_MS(100)
+#define SC_SERVER_CONNECT_TIMEOUT SC_TICK_FROM_SEC(10)
+// A running server may accept the connection without ever responding (for
+// example if it is stuck in a previous session)
+#define SC_SERVER_ATTACH_TIMEOUT SC_TICK_FROM_SEC(2)
+
 static char *
 get_server_path(void) {
     char *server_path = sc_get_env("SCRCPY_SERVER_PATH");
@@ -53,8 +68,9 @@ get_server_path(void) {
     return server_path;
 }
 
-static bool
-push_server(struct sc_intr *intr, const char *serial) {
+bool
+sc_server_push(struct sc_intr *intr, const char *serial, char *device_path,
+               size_t device_path_len) {
     char *server_path = get_server_path();
     if (!server_path) {
         return false;
@@ -64,7 +80,30 @@ push_server(struct sc_intr *intr, const char *serial) {
         free(server_path);
         return false;
     }
-    bool ok = sc_adb_push(intr, serial, server_path, SC_DEVICE_SERVER_PATH, 0);
+
+    uint64_t hash;
+    uint64_t size;
+    bool ok = sc_file_hash(server_path, &hash, &size);
+    if (!ok) {
+        free(server_path);
+        return false;
+    }
+
+    int r = snprintf(device_path, device_path_len,
+                     SC_DEVICE_SERVER_PATH_FORMAT, hash);
+    assert(r >= 0 && (size_t) r < device_path_len);
+    (void) r;
+
+    uint32_t device_size;
+    if (sc_adb_get_file_size(intr, serial, device_path, &device_size)
+            && device_size == size) {
+        // A previous push may have been interrupted, so the size is checked
+        LOGD("Server already present on the device: %s", device_path);
+        free(server_path);
+        return true;
+    }
+
+    ok = sc_adb_push(intr, serial, server_path, device_path, 0);
     free(server_path);
     return ok;
 }
@@ -129,6 +168,19 @@ sc_server_get_codec_name(enum sc_codec codec) {
     }
 }
 
+static const char *
+sc_server_get_video_scale_filter_name(enum sc_video_scale_filter filter) {
+    switch (filter) {
+        case SC_VIDEO_SCALE_FILTER_BILINEAR:
+            return "bilinear";
+        case SC_VIDEO_SCALE_FILTER_LANCZOS:
+            return "lanczos";
+        default:
+            assert(!"unexpected video scale filter");
+            return NULL;
+    }
+}
+
 static const char *
 sc_server_get_camera_facing_name(enum sc_camera_facing camera_facing) {
     switch (camera_facing) {
@@ -205,60 +257,23 @@ validate_string(const char *s) {
     return true;
 }
 
-static sc_pid
-execute_server(struct sc_server *server,
-               const struct sc_server_params *params) {
-    sc_pid pid = SC_PROCESS_NONE;
-
-    const char *serial = server->serial;
-    assert(serial);
-
-    const char *cmd[128];
-    unsigned count = 0;
-    cmd[count++] = sc_adb_get_executable();
-    cmd[count++] = "-s";
-    cmd[count++] = serial;
-    cmd[count++] = "shell";
-    cmd[count++] = "CLASSPATH=" SC_DEVICE_SERVER_PATH;
-    cmd[count++] = "app_process";
-
-#ifdef SERVER_DEBUGGER
-    uint16_t sdk_version = sc_adb_get_device_sdk_version(&server->intr, serial);
-    if (!sdk_version) {
-        LOGE("Could not determine SDK version");
-        return 0;
-    }
-
-# define SERVER_DEBUGGER_PORT "5005"
-    const char *dbg;
-    if (sdk_version < 28) {
-        // Android < 9
-        dbg = "-agentlib:jdwp=transport=dt_socket,suspend=y,server=y,address="
-              SERVER_DEBUGGER_PORT;
-    } else if (sdk_version < 30) {
-        // Android >= 9 && Android < 11
-        dbg = "-XjdwpProvider:internal -XjdwpOptions:transport=dt_socket,"
-              "suspend=y,server=y,address=" SERVER_DEBUGGER_PORT;
-    } else {
-        // Android >= 11
-        // Contrary to the other methods, this does not suspend on start.
-        // <https://github.com/Genymobile/scrcpy/pull/5466>
-        dbg = "-XjdwpProvider:adbconnection";
-    }
-    cmd[count++] = dbg;
-#endif
-
-    cmd[count++] = "/"; // unused
-    cmd[count++] = "com.genymobile.scrcpy.Server";
-    cmd[count++] = SCRCPY_VERSION;
+// Append the server parameters to cmd
+//
+// The appended strings are allocated, they must be freed by the caller (even on
+// error).
+static bool
+sc_server_append_params(struct sc_server *server,
+                        const struct sc_server_params *params, uint32_t scid,
+                        const char **cmd, unsigned *count) {
+    unsigned n = *count;
+    bool ok = false;
 
-    unsigned dyn_idx = count; // from there, the strings are allocated
 #define ADD_PARAM(fmt, ...) do { \
         char *p; \
         if (asprintf(&p, fmt, ## __VA_ARGS__) == -1) { \
             goto end; \
         } \
-        cmd[count++] = p; \
+        cmd[n++] = p; \
     } while(0)
 #define VALIDATE_STRING(s) do { \
         if (!validate_string(s)) { \
@@ -266,7 +281,7 @@ execute_server(struct sc_server *server,
         } \
     } while(0)
 
-    ADD_PARAM("scid=%08x", params->scid);
+    ADD_PARAM("scid=%08x", scid);
     ADD_PARAM("log_level=%s", log_level_to_server_string(params->log_level));
 
     if (!params->video) {
@@ -316,6 +331,17 @@ execute_server(struct sc_server *server,
         VALIDATE_STRING(params->angle);
         ADD_PARAM("angle=%s", params->angle);
     }
+    if (params->video_scale_filter != SC_VIDEO_SCALE_FILTER_DEFAULT) {
+        ADD_PARAM("video_scale_filter=%s",
+            sc_server_get_video_scale_filter_name(params->video_scale_filter));
+    }
+    if (params->video_sharpen) {
+        VALIDATE_STRING(params->video_sharpen);
+        ADD_PARAM("video_sharpen=%s", params->video_sharpen);
+    }
+    if (params->video_simulcast) {
+        ADD_PARAM("video_simulcast=%" PRIu16, params->video_simulcast);
+    }
     if (params->capture_orientation_lock != SC_ORIENTATION_UNLOCKED
             || params->capture_orientation != SC_ORIENTATION_0) {
         if (params->capture_orientation_lock == SC_ORIENTATION_LOCKED_INITIAL) {
@@ -331,6 +357,42 @@ execute_server(struct sc_server *server,
     if (server->tunnel.forward) {
         ADD_PARAM("tunnel_forward=true");
     }
+    if (params->multiplex) {
+        ADD_PARAM("multiplex=true");
+    }
+    if (params->direct_tcp_port) {
+        ADD_PARAM("direct_tcp_port=%" PRIu16, params->direct_tcp_port);
+        char token[SC_DIRECT_TCP_TOKEN_LENGTH * 2 + 1];
+        for (unsigned i = 0; i < SC_DIRECT_TCP_TOKEN_LENGTH; ++i) {
+            sprintf(&token[i * 2], "%02x", server->direct_tcp_token[i]);
+        }
+        ADD_PARAM("direct_tcp_token=%s", token);
+    }
+    if (params->socket_buffers.video) {
+        ADD_PARAM("video_socket_buffer=%" PRIu32, params->socket_buffers.video);
+    }
+    if (params->socket_buffers.audio) {
+        ADD_PARAM("audio_socket_buffer=%" PRIu32, params->socket_buffers.audio);
+    }
+    if (params->socket_buffers.control) {
+        ADD_PARAM("control_socket_buffer=%" PRIu32,
+                  params->socket_buffers.control);
+    }
+    if (params->low_latency_sockets) {
+        ADD_PARAM("low_latency_sockets=true");
+    }
+    if (params->video_low_latency) {
+        ADD_PARAM("video_low_latency=true");
+    }
+    if (params->skip_unchanged_frames) {
+        ADD_PARAM("skip_unchanged_frames=true");
+    }
+    if (params->video_dirty_rects) {
+        ADD_PARAM("video_dirty_rects=true");
+    }
+    if (params->video_drop_frames) {
+        ADD_PARAM("video_drop_frames=true");
+    }
     if (params->crop) {
         VALIDATE_STRING(params->crop);
         ADD_PARAM("crop=%s", params->crop);
@@ -455,8 +517,117 @@ execute_server(struct sc_server *server,
     if (params->list & SC_OPTION_LIST_APPS) {
         ADD_PARAM("list_apps=true");
     }
+    if (params->idle_timeout) {
+        assert(params->idle_timeout > 0);
+        uint64_t ms = SC_TICK_TO_MS(params->idle_timeout);
+        ADD_PARAM("idle_timeout=%" PRIu64, ms);
+    }
 
 #undef ADD_PARAM
+#undef VALIDATE_STRING
+
+    ok = true;
+
+end:
+    *count = n;
+    return ok;
+}
+
+static uint64_t
+sc_server_hash_str(uint64_t hash, const char *s) {
+    // FNV-1a, including the terminating NUL as a separator
+    do {
+        hash ^= (uint8_t) *s;
+        hash *= 0x100000001b3; // FNV prime
+    } while (*s++);
+    return hash;
+}
+
+static bool
+sc_server_compute_keepalive_scid(struct sc_server *server, uint32_t *scid) {
+    const char *cmd[128];
+    unsigned count = 0;
+    bool ok = sc_server_append_params(server, &server->params, 0, cmd, &count);
+    if (ok) {
+        uint64_t hash = 0xcbf29ce484222325; // FNV offset basis
+        // The server path depends on the server content
+        hash = sc_server_hash_str(hash, server->device_server_path);
+        hash = sc_server_hash_str(hash, SCRCPY_VERSION);
+        // Skip the "scid=" parameter
+        for (unsigned i = 1; i < count; ++i) {
+            hash = sc_server_hash_str(hash, cmd[i]);
+        }
+
+        // Only use 31 bits to avoid issues with signed values on the Java-side
+        *scid = (hash ^ (hash >> 32)) & 0x7FFFFFFF;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        free((char *) cmd[i]);
+    }
+
+    return ok;
+}
+
+static sc_pid
+execute_server(struct sc_server *server,
+               const struct sc_server_params *params) {
+    sc_pid pid = SC_PROCESS_NONE;
+
+    const char *serial = server->serial;
+    assert(serial);
+
+    char classpath[sizeof("CLASSPATH=") + SC_DEVICE_SERVER_PATH_LENGTH];
+    int r = snprintf(classpath, sizeof(classpath), "CLASSPATH=%s",
+                     server->device_server_path);
+    assert(r >= 0 && (size_t) r < sizeof(classpath));
+    (void) r;
+
+    const char *cmd[128];
+    unsigned count = 0;
+    cmd[count++] = sc_adb_get_executable();
+    cmd[count++] = "-s";
+    cmd[count++] = serial;
+    cmd[count++] = "shell";
+    cmd[count++] = classpath;
+    cmd[count++] = "app_process";
+
+#ifdef SERVER_DEBUGGER
+    uint16_t sdk_version = sc_adb_get_device_sdk_version(&server->intr, serial);
+    if (!sdk_version) {
+        LOGE("Could not determine SDK version");
+        return 0;
+    }
+
+# define SERVER_DEBUGGER_PORT "5005"
+    const char *dbg;
+    if (sdk_version < 28) {
+        // Android < 9
+        dbg = "-agentlib:jdwp=transport=dt_socket,suspend=y,server=y,address="
+              SERVER_DEBUGGER_PORT;
+    } else if (sdk_version < 30) {
+        // Android >= 9 && Android < 11
+        dbg = "-XjdwpProvider:internal -XjdwpOptions:transport=dt_socket,"
+              "suspend=y,server=y,address=" SERVER_DEBUGGER_PORT;
+    } else {
+        // Android >= 11
+        // Contrary to the other methods, this does not suspend on start.
+        // <https://github.com/Genymobile/scrcpy/pull/5466>
+        dbg = "-XjdwpProvider:adbconnection";
+    }
+    cmd[count++] = dbg;
+#endif
+
+    cmd[count++] = "/"; // unused
+    cmd[count++] = "com.genymobile.scrcpy.Server";
+    cmd[count++] = SCRCPY_VERSION;
+
+    unsigned dyn_idx = count; // from there, the strings are allocated
+    bool ok = sc_server_append_params(server, params, server->scid, cmd,
+                                      &count);
+    if (!ok) {
+        goto end;
+    }
 
     cmd[count++] = NULL;
 
@@ -487,34 +658,87 @@ end:
 }
 
 static bool
-connect_and_read_byte(struct sc_intr *intr, sc_socket socket,
-                      uint32_t tunnel_host, uint16_t tunnel_port) {
-    bool ok = net_connect_intr(intr, socket, tunnel_host, tunnel_port);
+sc_server_connect_socket(struct sc_server *server, sc_socket socket,
+                         uint32_t host, uint16_t port) {
+    bool ok = net_connect_intr(&server->intr, socket, host, port);
+    if (!ok) {
+        return false;
+    }
+
+    if (server->params.direct_tcp_port) {
+        // The port is reachable from the network, so the server only accepts
+        // the connections starting with the token it received via adb
+        ssize_t w = net_send_all_intr(&server->intr, socket,
+                                      server->direct_tcp_token,
+                                      SC_DIRECT_TCP_TOKEN_LENGTH);
+        if (w != SC_DIRECT_TCP_TOKEN_LENGTH) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// If read_timeout is not 0, fail if the server does not respond in time
+static bool
+connect_and_read_byte(struct sc_server *server, sc_socket socket,
+                      uint32_t tunnel_host, uint16_t tunnel_port,
+                      sc_tick read_timeout) {
+    bool ok = sc_server_connect_socket(server, socket, tunnel_host,
+                                       tunnel_port);
     if (!ok) {
         return false;
     }
 
+    if (read_timeout) {
+        net_set_recv_timeout(socket, SC_TICK_TO_MS(read_timeout));
+    }
+
+    sc_tick start = sc_tick_now();
     char byte;
     // the connection may succeed even if the server behind the "adb tunnel"
     // is not listening, so read one byte to detect a working connection
-    if (net_recv_intr(intr, socket, &byte, 1) != 1) {
+    if (net_recv_intr(&server->intr, socket, &byte, 1) != 1) {
+        if (read_timeout && sc_tick_now() - start >= read_timeout) {
+            LOGW("The server did not respond within %" PRItick " ms",
+                 SC_TICK_TO_MS(read_timeout));
+            server->attach_timed_out = true;
+        }
         // the server is not listening yet behind the adb tunnel
         return false;
     }
 
+    if (read_timeout) {
+        net_set_recv_timeout(socket, 0);
+    }
+
     return true;
 }
 
 static sc_socket
-connect_to_server(struct sc_server *server, unsigned attempts, sc_tick delay,
-                  uint32_t host, uint16_t port) {
-    do {
-        LOGD("Remaining connection attempts: %u", attempts);
+connect_to_server(struct sc_server *server, sc_tick timeout, uint32_t host,
+                  uint16_t port) {
+    // The server is usually ready a few tens of milliseconds after it is
+    // executed: retry quickly first, then back off exponentially, so that the
+    // connection is established as soon as possible without busy-looping when
+    // the device is slow to start the server.
+    sc_tick delay = SC_SERVER_CONNECT_INITIAL_DELAY;
+    sc_tick start = sc_tick_now();
+    sc_tick timeout_deadline = start + timeout;
+    unsigned attempts = 0;
+
+    for (;;) {
+        ++attempts;
         sc_socket socket = net_socket();
         if (socket != SC_SOCKET_NONE) {
-            bool ok = connect_and_read_byte(&server->intr, socket, host, port);
+            // A single attempt is made to attach to a running server
+            sc_tick read_timeout = timeout ? 0 : SC_SERVER_ATTACH_TIMEOUT;
+            bool ok = connect_and_read_byte(server, socket, host, port,
+                                            read_timeout);
             if (ok) {
                 // it worked!
+                LOGD("Connected to server in %" PRItick " ms (%u attempts)",
+                     SC_TICK_TO_MS(sc_tick_now() - start), attempts);
                 return socket;
             }
 
@@ -526,15 +750,25 @@ connect_to_server(struct sc_server *server, unsigned attempts, sc_tick delay,
             break;
         }
 
-        if (attempts) {
-            sc_tick deadline = sc_tick_now() + delay;
-            bool ok = sc_server_sleep(server, deadline);
-            if (!ok) {
-                LOGI("Connection attempt stopped");
-                break;
+        sc_tick now = sc_tick_now();
+        if (now >= timeout_deadline) {
+            if (timeout) {
+                LOGE("Could not connect to server (timeout after %u "
+                     "attempts)", attempts);
             }
+            break;
         }
-    } while (--attempts);
+
+        sc_tick deadline = MIN(now + delay, timeout_deadline);
+        bool ok = sc_server_sleep(server, deadline);
+        if (!ok) {
+            LOGI("Connection attempt stopped");
+            break;
+        }
+
+        delay = MIN(delay * 2, SC_SERVER_CONNECT_MAX_DELAY);
+    }
+
     return SC_SOCKET_NONE;
 }
 
@@ -573,11 +807,15 @@ sc_server_init(struct sc_server *server, const struct sc_server_params *params,
 
     server->serial = NULL;
     server->device_socket_name = NULL;
+    server->device_server_path[0] = '\0';
+    server->scid = params->scid;
+    server->attach_timed_out = false;
     server->stopped = false;
 
     server->video_socket = SC_SOCKET_NONE;
     server->audio_socket = SC_SOCKET_NONE;
     server->control_socket = SC_SOCKET_NONE;
+    server->multiplexed = false;
 
     sc_adb_tunnel_init(&server->tunnel);
 
@@ -609,11 +847,47 @@ device_read_info(struct sc_intr *intr, sc_socket device_socket,
     return true;
 }
 
+static void
+sc_server_tune_socket(struct sc_server *server, sc_socket socket,
+                      const char *name, uint32_t buffer_size) {
+    if (buffer_size) {
+        // The client mainly receives (the control socket is bidirectional)
+        net_set_recv_buffer_size(socket, buffer_size);
+        net_set_send_buffer_size(socket, buffer_size);
+    }
+
+    if (server->params.low_latency_sockets) {
+        net_set_low_latency(socket);
+    }
+
+    int recv_size;
+    int send_size;
+    if (net_get_buffer_sizes(socket, &recv_size, &send_size)) {
+        LOGD("%s socket buffers: receive %d bytes, send %d bytes", name,
+             recv_size, send_size);
+    }
+}
+
+static void
+sc_server_log_socket_stats(sc_socket socket, const char *name) {
+    struct net_tcp_stats stats;
+    if (net_get_tcp_stats(socket, &stats)) {
+        LOGD("%s socket: rtt=%" PRIu32 "us (var %" PRIu32 "us), unacked=%"
+             PRIu32 ", retransmits=%" PRIu32 ", receive queue=%" PRIu32
+             " bytes", name, stats.rtt_us, stats.rtt_var_us, stats.unacked,
+             stats.retransmits, stats.recv_queue);
+    }
+}
+
+// If timeout is 0, only one connection attempt is made (in forward tunnel mode)
 static bool
-sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
+sc_server_connect_to(struct sc_server *server, struct sc_server_info *info,
+                     sc_tick timeout) {
     struct sc_adb_tunnel *tunnel = &server->tunnel;
 
-    assert(tunnel->enabled);
+    const struct sc_server_params *params = &server->params;
+    bool direct_tcp = params->direct_tcp_port;
+    assert(tunnel->enabled != direct_tcp);
 
     const char *serial = server->serial;
     assert(serial);
@@ -622,10 +896,60 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     bool audio = server->params.audio;
     bool control = server->params.control;
 
+    uint32_t tunnel_host;
+    uint16_t tunnel_port;
+    if (direct_tcp) {
+        // The client connects to the device directly, as in forward mode
+        tunnel_host = server->direct_tcp_host;
+        tunnel_port = server->params.direct_tcp_port;
+    } else {
+        tunnel_host = server->params.tunnel_host;
+        if (!tunnel_host) {
+            tunnel_host = IPV4_LOCALHOST;
+        }
+
+        tunnel_port = server->params.tunnel_port;
+        if (!tunnel_port) {
+            tunnel_port = tunnel->local_port;
+        }
+    }
+    bool reverse = !direct_tcp && !tunnel->forward;
+
     sc_socket video_socket = SC_SOCKET_NONE;
     sc_socket audio_socket = SC_SOCKET_NONE;
     sc_socket control_socket = SC_SOCKET_NONE;
-    if (!tunnel->forward) {
+    if (server->params.multiplex) {
+        // A single socket for all the streams
+        sc_socket socket;
+        if (reverse) {
+            socket = net_accept_intr(&server->intr, tunnel->server_socket);
+        } else {
+            socket = connect_to_server(server, timeout, tunnel_host,
+                                       tunnel_port);
+        }
+        if (socket == SC_SOCKET_NONE) {
+            goto fail;
+        }
+
+        if (control) {
+            // Disable Nagle's algorithm for the control messages
+            bool ok = net_set_tcp_nodelay(socket, true);
+            (void) ok; // error already logged
+        }
+
+        sc_socket sockets[SC_MULTIPLEXER_CHANNEL_COUNT];
+        bool ok = sc_multiplexer_start(&server->multiplexer, socket, video,
+                                       audio, control, sockets);
+        if (!ok) {
+            net_close(socket);
+            goto fail;
+        }
+
+        server->multiplexed = true;
+        video_socket = sockets[SC_MULTIPLEXER_CHANNEL_VIDEO];
+        audio_socket = sockets[SC_MULTIPLEXER_CHANNEL_AUDIO];
+        control_socket = sockets[SC_MULTIPLEXER_CHANNEL_CONTROL];
+    } else if (reverse) {
         if (video) {
             video_socket =
                 net_accept_intr(&server->intr, tunnel->server_socket);
@@ -650,20 +974,8 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
             }
         }
     } else {
-        uint32_t tunnel_host = server->params.tunnel_host;
-        if (!tunnel_host) {
-            tunnel_host = IPV4_LOCALHOST;
-        }
-
-        uint16_t tunnel_port = server->params.tunnel_port;
-        if (!tunnel_port) {
-            tunnel_port = tunnel->local_port;
-        }
-
-        unsigned attempts = 100;
-        sc_tick delay = SC_TICK_FROM_MS(100);
-        sc_socket first_socket = connect_to_server(server, attempts, delay,
-                                                   tunnel_host, tunnel_port);
+        sc_socket first_socket =
+            connect_to_server(server, timeout, tunnel_host, tunnel_port);
         if (first_socket == SC_SOCKET_NONE) {
             goto fail;
         }
@@ -680,8 +992,8 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
                 if (audio_socket == SC_SOCKET_NONE) {
                     goto fail;
                 }
-                bool ok = net_connect_intr(&server->intr, audio_socket,
-                                           tunnel_host, tunnel_port);
+                bool ok = sc_server_connect_socket(server, audio_socket,
+                                                   tunnel_host, tunnel_port);
                 if (!ok) {
                     goto fail;
                 }
@@ -696,8 +1008,8 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
                 if (control_socket == SC_SOCKET_NONE) {
                     goto fail;
                 }
-                bool ok = net_connect_intr(&server->intr, control_socket,
-                                           tunnel_host, tunnel_port);
+                bool ok = sc_server_connect_socket(server, control_socket,
+                                                   tunnel_host, tunnel_port);
                 if (!ok) {
                     goto fail;
                 }
@@ -705,7 +1017,7 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         }
     }
 
-    if (control_socket != SC_SOCKET_NONE) {
+    if (!server->multiplexed && control_socket != SC_SOCKET_NONE) {
         // Disable Nagle's algorithm for the control socket
         // (it only impacts the sending side, so it is useless to set it
         // for the other sockets)
@@ -713,9 +1025,32 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         (void) ok; // error already logged
     }
 
-    // we don't need the adb tunnel anymore
-    sc_adb_tunnel_close(tunnel, &server->intr, serial,
-                        server->device_socket_name);
+    if (server->multiplexed) {
+        // Only the multiplexed socket is a TCP socket
+        sc_server_tune_socket(server, server->multiplexer.socket,
+                              "Multiplexed", params->socket_buffers.video);
+    } else {
+        if (video_socket != SC_SOCKET_NONE) {
+            sc_server_tune_socket(server, video_socket, "Video",
+                                  params->socket_buffers.video);
+        }
+        if (audio_socket != SC_SOCKET_NONE) {
+            sc_server_tune_socket(server, audio_socket, "Audio",
+                                  params->socket_buffers.audio);
+        }
+        if (control_socket != SC_SOCKET_NONE) {
+            sc_server_tune_socket(server, control_socket, "Control",
+                                  params->socket_buffers.control);
+        }
+    }
+
+    if (tunnel->enabled) {
+        // we don't need the adb tunnel anymore
+        sc_adb_tunnel_close(tunnel, &server->intr, serial,
+                            server->device_socket_name);
+    }
+
+    sc_startup_mark(SC_STARTUP_PHASE_SERVER_CONNECTED);
 
     sc_socket first_socket = video ? video_socket
                            : audio ? audio_socket
@@ -727,6 +1062,8 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
         goto fail;
     }
 
+    sc_startup_mark(SC_STARTUP_PHASE_DEVICE_INFO_RECEIVED);
+
     assert(!video || video_socket != SC_SOCKET_NONE);
     assert(!audio || audio_socket != SC_SOCKET_NONE);
     assert(!control || control_socket != SC_SOCKET_NONE);
@@ -738,6 +1075,13 @@ sc_server_connect_to(struct sc_server *server, struct sc_server_info *info) {
     return true;
 
 fail:
+    if (server->multiplexed) {
+        sc_multiplexer_interrupt(&server->multiplexer);
+        sc_multiplexer_join(&server->multiplexer);
+        sc_multiplexer_destroy(&server->multiplexer);
+        server->multiplexed = false;
+    }
+
     if (video_socket != SC_SOCKET_NONE) {
         if (!net_close(video_socket)) {
             LOGW("Could not close video socket");
@@ -952,6 +1296,30 @@ sc_server_configure_tcpip_unknown_address(struct sc_server *server,
     return sc_server_connect_to_tcpip(server, ip_port, false);
 }
 
+static bool
+sc_server_prepare_direct_tcp(struct sc_server *server, const char *serial) {
+    char *ip = sc_adb_get_device_ip(&server->intr, serial, 0);
+    if (!ip) {
+        LOGE("Could not find the device IP address (required by "
+             "--direct-tcp)");
+        return false;
+    }
+
+    bool ok = net_parse_ipv4(ip, &server->direct_tcp_host);
+    if (ok) {
+        LOGI("Direct TCP connection to %s:%" PRIu16, ip,
+             server->params.direct_tcp_port);
+    }
+    free(ip);
+    if (!ok) {
+        return false;
+    }
+
+    // A new token for each server instance
+    return sc_rand_secure(server->direct_tcp_token,
+                          SC_DIRECT_TCP_TOKEN_LENGTH);
+}
+
 static void
 sc_server_kill_adb_if_requested(struct sc_server *server) {
     if (server->params.kill_adb_on_close) {
@@ -961,6 +1329,60 @@ sc_server_kill_adb_if_requested(struct sc_server *server) {
     }
 }
 
+static void
+sc_server_wait_stopped(struct sc_server *server) {
+    // Wait for server_stop()
+    sc_mutex_lock(&server->mutex);
+    while (!server->stopped) {
+        sc_cond_wait(&server->cond_stopped, &server->mutex);
+    }
+    sc_mutex_unlock(&server->mutex);
+}
+
+static void
+sc_server_log_tcp_stats(struct sc_server *server) {
+    if (server->multiplexed) {
+        sc_server_log_socket_stats(server->multiplexer.socket, "Multiplexed");
+        return;
+    }
+
+    if (server->video_socket != SC_SOCKET_NONE) {
+        sc_server_log_socket_stats(server->video_socket, "Video");
+    }
+    if (server->audio_socket != SC_SOCKET_NONE) {
+        sc_server_log_socket_stats(server->audio_socket, "Audio");
+    }
+    if (server->control_socket != SC_SOCKET_NONE) {
+        sc_server_log_socket_stats(server->control_socket, "Control");
+    }
+}
+
+static void
+sc_server_interrupt_sockets(struct sc_server *server) {
+    // Log the kernel statistics of the connection before closing it (useful
+    // to tune the socket options)
+    sc_server_log_tcp_stats(server);
+
+    if (server->video_socket != SC_SOCKET_NONE) {
+        // There is no video_socket if --no-video is set
+        net_interrupt(server->video_socket);
+    }
+
+    if (server->audio_socket != SC_SOCKET_NONE) {
+        // There is no audio_socket if --no-audio is set
+        net_interrupt(server->audio_socket);
+    }
+
+    if (server->control_socket != SC_SOCKET_NONE) {
+        // There is no control_socket if --no-control is set
+        net_interrupt(server->control_socket);
+    }
+
+    if (server->multiplexed) {
+        sc_multiplexer_interrupt(&server->multiplexer);
+    }
+}
+
 static int
 run_server(void *data) {
     struct sc_server *server = data;
@@ -976,6 +1398,8 @@ run_server(void *data) {
         goto error_connection_failed;
     }
 
+    sc_startup_mark(SC_STARTUP_PHASE_ADB_SERVER_STARTED);
+
     // params->tcpip_dst implies params->tcpip
     assert(!params->tcpip_dst || params->tcpip);
 
@@ -1052,11 +1476,16 @@ run_server(void *data) {
     assert(serial);
     LOGD("Device serial: %s", serial);
 
-    ok = push_server(&server->intr, serial);
+    sc_startup_mark(SC_STARTUP_PHASE_DEVICE_SELECTED);
+
+    ok = sc_server_push(&server->intr, serial, server->device_server_path,
+                        sizeof(server->device_server_path));
     if (!ok) {
         goto error_connection_failed;
     }
 
+    sc_startup_mark(SC_STARTUP_PHASE_SERVER_PUSHED);
+
     // If --list-* is passed, then the server just prints the requested data
     // then exits.
     if (params->list) {
@@ -1071,8 +1500,19 @@ run_server(void *data) {
         return 0;
     }
 
+    bool keepalive = params->idle_timeout;
+    if (keepalive) {
+        // The server keeps running after the client disconnects, so its
+        // socket name must be the same for all the clients requesting the same
+        // server parameters
+        ok = sc_server_compute_keepalive_scid(server, &server->scid);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+    }
+
     int r = asprintf(&server->device_socket_name, SC_SOCKET_NAME_PREFIX "%08x",
-                     params->scid);
+                     server->scid);
     if (r == -1) {
         LOG_OOM();
         goto error_connection_failed;
@@ -1080,21 +1520,81 @@ run_server(void *data) {
     assert(r == sizeof(SC_SOCKET_NAME_PREFIX) - 1 + 8);
     assert(server->device_socket_name);
 
-    ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
-                            server->device_socket_name, params->port_range,
-                            params->force_adb_forward);
+    if (params->direct_tcp_port) {
+        // No adb tunnel, the client connects to the device over TCP
+        assert(!keepalive);
+        ok = sc_server_prepare_direct_tcp(server, serial);
+    } else {
+        // A running server may only be reached through a forward tunnel
+        bool force_adb_forward = params->force_adb_forward || keepalive;
+        ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
+                                server->device_socket_name, params->port_range,
+                                force_adb_forward);
+    }
     if (!ok) {
         goto error_connection_failed;
     }
 
+    sc_startup_mark(SC_STARTUP_PHASE_TUNNEL_OPENED);
+
+    if (keepalive) {
+        // Attach to the server kept running by a previous client, if any
+        ok = sc_server_connect_to(server, &server->info, 0);
+        if (ok) {
+            LOGI("Attached to the running server");
+            server->cbs->on_connected(server, server->cbs_userdata);
+
+            sc_server_wait_stopped(server);
+            // Only disconnect, the server keeps running for the next clients
+            sc_server_interrupt_sockets(server);
+
+            sc_server_kill_adb_if_requested(server);
+            return 0;
+        }
+
+        if (sc_intr_is_interrupted(&server->intr)) {
+            goto error_connection_failed;
+        }
+
+        if (server->attach_timed_out) {
+            // The stuck server still listens on the socket name, so the new
+            // server must use its own (it will not be reused by the next
+            // clients)
+            LOGW("Running server not responding, starting a new one");
+            free(server->device_socket_name);
+            server->scid = params->scid;
+            r = asprintf(&server->device_socket_name,
+                         SC_SOCKET_NAME_PREFIX "%08x", server->scid);
+            if (r == -1) {
+                LOG_OOM();
+                server->device_socket_name = NULL;
+                goto error_connection_failed;
+            }
+        } else {
+            LOGD("No running server, starting a new one");
+        }
+
+        // The tunnel is always closed by sc_server_connect_to()
+        ok = sc_adb_tunnel_open(&server->tunnel, &server->intr, serial,
+                                server->device_socket_name, params->port_range,
+                                true);
+        if (!ok) {
+            goto error_connection_failed;
+        }
+    }
+
     // server will connect to our server socket
     sc_pid pid = execute_server(server, params);
     if (pid == SC_PROCESS_NONE) {
-        sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
-                            server->device_socket_name);
+        if (server->tunnel.enabled) {
+            sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
+                                server->device_socket_name);
+        }
         goto error_connection_failed;
     }
 
+    sc_startup_mark(SC_STARTUP_PHASE_SERVER_EXECUTED);
+
     static const struct sc_process_listener listener = {
         .on_terminated = sc_server_on_terminated,
     };
@@ -1103,12 +1603,15 @@ run_server(void *data) {
     if (!ok) {
         sc_process_terminate(pid);
         sc_process_wait(pid, true); // ignore exit code
-        sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
-                            server->device_socket_name);
+        if (server->tunnel.enabled) {
+            sc_adb_tunnel_close(&server->tunnel, &server->intr, serial,
+                                server->device_socket_name);
+        }
         goto error_connection_failed;
     }
 
-    ok = sc_server_connect_to(server, &server->info);
+    ok = sc_server_connect_to(server, &server->info,
+                              SC_SERVER_CONNECT_TIMEOUT);
     // The tunnel is always closed by server_connect_to()
     if (!ok) {
         sc_process_terminate(pid);
@@ -1121,44 +1624,32 @@ run_server(void *data) {
     // Now connected
     server->cbs->on_connected(server, server->cbs_userdata);
 
-    // Wait for server_stop()
-    sc_mutex_lock(&server->mutex);
-    while (!server->stopped) {
-        sc_cond_wait(&server->cond_stopped, &server->mutex);
-    }
-    sc_mutex_unlock(&server->mutex);
+    sc_server_wait_stopped(server);
 
     // Interrupt sockets to wake up socket blocking calls on the server
+    sc_server_interrupt_sockets(server);
 
-    if (server->video_socket != SC_SOCKET_NONE) {
-        // There is no video_socket if --no-video is set
-        net_interrupt(server->video_socket);
-    }
-
-    if (server->audio_socket != SC_SOCKET_NONE) {
-        // There is no audio_socket if --no-audio is set
-        net_interrupt(server->audio_socket);
-    }
-
-    if (server->control_socket != SC_SOCKET_NONE) {
-        // There is no control_socket if --no-control is set
-        net_interrupt(server->control_socket);
-    }
-
-    // Give some delay for the server to terminate properly
-#define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
-    sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
-    bool terminated = sc_process_observer_timedwait(&observer, deadline);
-
-    // After this delay, kill the server if it's not dead already.
-    // On some devices, closing the sockets is not sufficient to wake up the
-    // blocking calls while the device is asleep.
-    if (!terminated) {
-        // The process may have terminated since the check, but it is not
-        // reaped (closed) yet, so its PID is still valid, and it is ok to call
-        // sc_process_terminate() even in that case.
-        LOGW("Killing the server...");
+    if (keepalive) {
+        // The server keeps running on the device for the next clients (it
+        // runs in its own session, so it is not killed along with the adb
+        // shell): only terminate the local adb process
         sc_process_terminate(pid);
+    } else {
+        // Give some delay for the server to terminate properly
+#define WATCHDOG_DELAY SC_TICK_FROM_SEC(1)
+        sc_tick deadline = sc_tick_now() + WATCHDOG_DELAY;
+        bool terminated = sc_process_observer_timedwait(&observer, deadline);
+
+        // After this delay, kill the server if it's not dead already.
+        // On some devices, closing the sockets is not sufficient to wake up
+        // the blocking calls while the device is asleep.
+        if (!terminated) {
+            // The process may have terminated since the check, but it is not
+            // reaped (closed) yet, so its PID is still valid, and it is ok to
+            // call sc_process_terminate() even in that case.
+            LOGW("Killing the server...");
+            sc_process_terminate(pid);
+        }
     }
 
     sc_process_observer_join(&observer);
@@ -1204,6 +1695,12 @@ sc_server_join(struct sc_server *server) {
 
 void
 sc_server_destroy(struct sc_server *server) {
+    if (server->multiplexed) {
+        // Interrupted by sc_server_interrupt_sockets()
+        sc_multiplexer_join(&server->multiplexer);
+        sc_multiplexer_destroy(&server->multiplexer);
+    }
+
     if (server->video_socket != SC_SOCKET_NONE) {
         net_close(server->video_socket);
     }
@@ -4,9 +4,11 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "adb/adb_tunnel.h"
+#include "multiplexer.h"
 #include "options.h"
 #include "util/intr.h"
 #include "util/net.h"
@@ -14,6 +16,8 @@
 #include "util/tick.h"
 
 #define SC_DEVICE_NAME_FIELD_LENGTH 64
+#define SC_DEVICE_SERVER_PATH_LENGTH 64
+#define SC_DIRECT_TCP_TOKEN_LENGTH 16
 struct sc_server_info {
     char device_name[SC_DEVICE_NAME_FIELD_LENGTH];
 };
@@ -40,12 +44,22 @@ struct sc_server_params {
     struct sc_port_range port_range;
     uint32_t tunnel_host;
     uint16_t tunnel_port;
+    uint16_t direct_tcp_port; // 0 to connect through the adb tunnel
+    struct sc_socket_buffers socket_buffers;
+    bool low_latency_sockets;
+    bool video_low_latency;
+    bool skip_unchanged_frames;
+    bool video_dirty_rects;
+    bool video_drop_frames;
     uint16_t max_size;
     uint8_t min_size_alignment;
     uint32_t video_bit_rate;
     uint32_t audio_bit_rate;
     const char *max_fps; // float to be parsed by the server
     const char *angle; // float to be parsed by the server
+    enum sc_video_scale_filter video_scale_filter;
+    const char *video_sharpen; // float to be parsed by the server
+    uint16_t video_simulcast;
     sc_tick screen_off_timeout;
     enum sc_orientation capture_orientation;
     enum sc_orientation_lock capture_orientation_lock;
@@ -59,6 +73,7 @@ struct sc_server_params {
     bool show_touches;
     bool stay_awake;
     bool force_adb_forward;
+    bool multiplex;
     bool power_off_on_close;
     bool clipboard_autosync;
     bool downsize_on_error;
@@ -77,6 +92,7 @@ struct sc_server_params {
     bool flex_display;
     bool ignore_video_encoder_constraints;
     uint8_t list;
+    sc_tick idle_timeout; // keep the server alive if not 0
 };
 
 struct sc_server {
@@ -84,6 +100,8 @@ struct sc_server {
     struct sc_server_params params;
     char *serial;
     char *device_socket_name;
+    uint32_t scid; // may differ from params.scid if the server is kept alive
+    char device_server_path[SC_DEVICE_SERVER_PATH_LENGTH];
 
     sc_thread thread;
     struct sc_server_info info; // initialized once connected
@@ -95,10 +113,21 @@ struct sc_server {
     struct sc_intr intr;
     struct sc_adb_tunnel tunnel;
 
+    // Only initialized if params.direct_tcp_port is set
+    uint32_t direct_tcp_host;
+    uint8_t direct_tcp_token[SC_DIRECT_TCP_TOKEN_LENGTH];
+
     sc_socket video_socket;
     sc_socket audio_socket;
     sc_socket control_socket;
 
+    // Only initialized if params.multiplex (set once the socket is connected)
+    struct sc_multiplexer multiplexer;
+    bool multiplexed;
+
+    // Set if a running server accepted the connection but did not respond
+    bool attach_timed_out;
+
     const struct sc_server_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -144,4 +173,13 @@ sc_server_join(struct sc_server *server);
 void
 sc_server_destroy(struct sc_server *server);
 
+/**
+ * Push the server to the device (unless it is already present)
+ *
+ * The path of the server on the device is written to device_path.
+ */
+bool
+sc_server_push(struct sc_intr *intr, const char *serial, char *device_path,
+               size_t device_path_len);
+
 #endif
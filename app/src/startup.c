@@ -0,0 +1,182 @@
+#include "startup.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/log.h"
+
+static const char *const sc_startup_phase_names[SC_STARTUP_PHASE_COUNT] = {
+    [SC_STARTUP_PHASE_ADB_SERVER_STARTED] = "adb_server_started",
+    [SC_STARTUP_PHASE_DEVICE_SELECTED] = "device_selected",
+    [SC_STARTUP_PHASE_SERVER_PUSHED] = "server_pushed",
+    [SC_STARTUP_PHASE_TUNNEL_OPENED] = "tunnel_opened",
+    [SC_STARTUP_PHASE_SERVER_EXECUTED] = "server_executed",
+    [SC_STARTUP_PHASE_SERVER_CONNECTED] = "server_connected",
+    [SC_STARTUP_PHASE_DEVICE_INFO_RECEIVED] = "device_info_received",
+    [SC_STARTUP_PHASE_VIDEO_CODEC_RECEIVED] = "video_codec_received",
+    [SC_STARTUP_PHASE_FIRST_VIDEO_PACKET] = "first_video_packet",
+    [SC_STARTUP_PHASE_FIRST_FRAME_DECODED] = "first_frame_decoded",
+    [SC_STARTUP_PHASE_WINDOW_SHOWN] = "window_shown",
+    [SC_STARTUP_PHASE_FIRST_FRAME_RENDERED] = "first_frame_rendered",
+};
+
+static sc_tick sc_startup_origin;
+static const char *sc_startup_profile_filename;
+// Relative time of each phase, or 0 if not reached yet
+static atomic_int_least64_t sc_startup_phases[SC_STARTUP_PHASE_COUNT];
+static atomic_bool sc_startup_completed;
+
+void
+sc_startup_init(const char *profile_filename) {
+    sc_startup_origin = sc_tick_now();
+    sc_startup_profile_filename = profile_filename;
+    for (unsigned i = 0; i < SC_STARTUP_PHASE_COUNT; ++i) {
+        atomic_init(&sc_startup_phases[i], 0);
+    }
+    atomic_init(&sc_startup_completed, false);
+}
+
+void
+sc_startup_mark(enum sc_startup_phase phase) {
+    assert(phase < SC_STARTUP_PHASE_COUNT);
+
+    // Never store 0, which means "not reached"
+    int_least64_t value = MAX(sc_tick_now() - sc_startup_origin, 1);
+    int_least64_t expected = 0;
+    // Only keep the first mark
+    atomic_compare_exchange_strong_explicit(&sc_startup_phases[phase],
+                                            &expected, value,
+                                            memory_order_relaxed,
+                                            memory_order_relaxed);
+}
+
+sc_tick
+sc_startup_get(enum sc_startup_phase phase) {
+    assert(phase < SC_STARTUP_PHASE_COUNT);
+    int_least64_t value = atomic_load_explicit(&sc_startup_phases[phase],
+                                               memory_order_relaxed);
+    return value ? value : -1;
+}
+
+const char *
+sc_startup_phase_name(enum sc_startup_phase phase) {
+    assert(phase < SC_STARTUP_PHASE_COUNT);
+    return sc_startup_phase_names[phase];
+}
+
+static void
+sc_startup_log_summary(enum sc_log_level level) {
+    LOG(level, "Startup profile:");
+    sc_tick previous = 0;
+    for (unsigned i = 0; i < SC_STARTUP_PHASE_COUNT; ++i) {
+        sc_tick t = sc_startup_get(i);
+        if (t < 0) {
+            continue;
+        }
+
+        LOG(level, "    %-22s %6" PRIi64 " ms  (+%" PRIi64 " ms)",
+            sc_startup_phase_names[i], SC_TICK_TO_MS(t),
+            SC_TICK_TO_MS(t - previous));
+        previous = t;
+    }
+}
+
+static bool
+sc_startup_append(struct sc_strbuf *buf, const char *fmt, ...) {
+    char tmp[128];
+
+    va_list va;
+    va_start(va, fmt);
+    int len = vsnprintf(tmp, sizeof(tmp), fmt, va);
+    va_end(va);
+
+    assert(len >= 0 && (size_t) len < sizeof(tmp));
+    return sc_strbuf_append(buf, tmp, len);
+}
+
+bool
+sc_startup_format_json(struct sc_strbuf *buf) {
+    bool ok = sc_strbuf_append_staticstr(buf, "{\"phases\":[");
+    if (!ok) {
+        return false;
+    }
+
+    bool first = true;
+    sc_tick previous = 0;
+    for (unsigned i = 0; i < SC_STARTUP_PHASE_COUNT; ++i) {
+        sc_tick t = sc_startup_get(i);
+        if (t < 0) {
+            continue;
+        }
+
+        ok = sc_startup_append(buf, "%s{\"name\":\"%s\",\"time_us\":%" PRIi64
+                                    ",\"delta_us\":%" PRIi64 "}",
+                               first ? "" : ",", sc_startup_phase_names[i],
+                               t, t - previous);
+        if (!ok) {
+            return false;
+        }
+
+        first = false;
+        previous = t;
+    }
+
+    return sc_strbuf_append_staticstr(buf, "]}\n");
+}
+
+static bool
+sc_startup_write_json(const char *filename) {
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 1024)) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_startup_format_json(&buf);
+    if (!ok) {
+        LOG_OOM();
+        free(buf.s);
+        return false;
+    }
+
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        LOGE("Could not open startup profile file: %s", filename);
+        free(buf.s);
+        return false;
+    }
+
+    size_t w = fwrite(buf.s, 1, buf.len, file);
+    ok = w == buf.len;
+    if (fclose(file)) {
+        ok = false;
+    }
+    free(buf.s);
+
+    if (!ok) {
+        LOGE("Could not write startup profile file: %s", filename);
+        return false;
+    }
+
+    LOGI("Startup profile written to %s", filename);
+    return true;
+}
+
+void
+sc_startup_complete(void) {
+    if (atomic_exchange(&sc_startup_completed, true)) {
+        // Already reported
+        return;
+    }
+
+    const char *filename = sc_startup_profile_filename;
+    sc_startup_log_summary(filename ? SC_LOG_LEVEL_INFO : SC_LOG_LEVEL_DEBUG);
+
+    if (filename) {
+        sc_startup_write_json(filename);
+    }
+}
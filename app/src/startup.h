@@ -0,0 +1,75 @@
+#ifndef SC_STARTUP_H
+#define SC_STARTUP_H
+
+#include "common.h"
+
+#include <stdbool.h>
+
+#include "util/strbuf.h"
+#include "util/tick.h"
+
+// Startup profiler, to measure where the time to the first frame is spent.
+//
+// Each phase is marked once (only the first call is taken into account), from
+// any thread.
+
+enum sc_startup_phase {
+    SC_STARTUP_PHASE_ADB_SERVER_STARTED,
+    SC_STARTUP_PHASE_DEVICE_SELECTED,
+    SC_STARTUP_PHASE_SERVER_PUSHED,
+    SC_STARTUP_PHASE_TUNNEL_OPENED,
+    SC_STARTUP_PHASE_SERVER_EXECUTED,
+    SC_STARTUP_PHASE_SERVER_CONNECTED,
+    SC_STARTUP_PHASE_DEVICE_INFO_RECEIVED,
+    SC_STARTUP_PHASE_VIDEO_CODEC_RECEIVED,
+    SC_STARTUP_PHASE_FIRST_VIDEO_PACKET,
+    SC_STARTUP_PHASE_FIRST_FRAME_DECODED,
+    SC_STARTUP_PHASE_WINDOW_SHOWN,
+    SC_STARTUP_PHASE_FIRST_FRAME_RENDERED,
+    SC_STARTUP_PHASE_COUNT,
+};
+
+/**
+ * Start measuring (all the phases are relative to this instant)
+ *
+ * If profile_filename is not NULL, the phases will be written to this file
+ * (as JSON) on completion.
+ */
+void
+sc_startup_init(const char *profile_filename);
+
+/**
+ * Mark the end of a phase
+ */
+void
+sc_startup_mark(enum sc_startup_phase phase);
+
+/**
+ * Return the time of a phase relative to the start, or -1 if it has not been
+ * reached
+ */
+sc_tick
+sc_startup_get(enum sc_startup_phase phase);
+
+/**
+ * Return the name of the phase
+ */
+const char *
+sc_startup_phase_name(enum sc_startup_phase phase);
+
+/**
+ * Report the phases reached so far (only the first call has an effect)
+ *
+ * Log a summary (at debug level, unless a profile file is requested), and
+ * write the profile file if requested.
+ */
+void
+sc_startup_complete(void);
+
+/**
+ * Append the phases as a JSON object
+ */
+bool
+sc_startup_format_json(struct sc_strbuf *buf);
+
+#endif
@@ -0,0 +1,57 @@
+#include "stream_dump.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+bool
+sc_stream_dump_open(struct sc_stream_dump *dump, const char *filename) {
+    dump->file = fopen(filename, "wb");
+    if (!dump->file) {
+        LOGE("Could not open stream dump file: %s", filename);
+        return false;
+    }
+
+    size_t w = fwrite(SC_STREAM_DUMP_MAGIC, 1, SC_STREAM_DUMP_MAGIC_SIZE,
+                      dump->file);
+    if (w != SC_STREAM_DUMP_MAGIC_SIZE) {
+        LOGE("Could not write stream dump file: %s", filename);
+        fclose(dump->file);
+        return false;
+    }
+
+    dump->start = sc_tick_now();
+    dump->failed = false;
+
+    LOGI("Dumping stream to %s", filename);
+    return true;
+}
+
+void
+sc_stream_dump_close(struct sc_stream_dump *dump) {
+    if (fclose(dump->file)) {
+        LOGW("Could not close stream dump file");
+    }
+}
+
+void
+sc_stream_dump_write(struct sc_stream_dump *dump, const void *data,
+                     size_t len) {
+    assert(len <= UINT32_MAX);
+
+    if (dump->failed) {
+        return;
+    }
+
+    uint8_t header[SC_STREAM_DUMP_RECORD_HEADER_SIZE];
+    sc_write64be(header, sc_tick_now() - dump->start);
+    sc_write32be(&header[8], len);
+
+    if (fwrite(header, 1, sizeof(header), dump->file) != sizeof(header)
+            || fwrite(data, 1, len, dump->file) != len) {
+        LOGE("Could not write stream dump, dump disabled");
+        dump->failed = true;
+    }
+}
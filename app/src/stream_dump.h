@@ -0,0 +1,48 @@
+#ifndef SC_STREAM_DUMP_H
+#define SC_STREAM_DUMP_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "util/tick.h"
+
+// A stream dump file contains the exact bytes received on a stream socket
+// (codec id, session headers, frame headers and payloads), so that they can
+// be replayed later (see stream_replay.h).
+//
+// The file starts with an 8-byte magic, followed by a sequence of records:
+//
+//  <----- 8 bytes -----> <- 4 bytes -> <------- length bytes -------...
+//     reception time        length               raw data
+//
+// The reception time is expressed in microseconds relative to the creation of
+// the dump, both fields are big-endian.
+#define SC_STREAM_DUMP_MAGIC "scrcpyD1"
+#define SC_STREAM_DUMP_MAGIC_SIZE 8
+#define SC_STREAM_DUMP_RECORD_HEADER_SIZE 12
+
+struct sc_stream_dump {
+    FILE *file;
+    sc_tick start;
+    bool failed;
+};
+
+bool
+sc_stream_dump_open(struct sc_stream_dump *dump, const char *filename);
+
+void
+sc_stream_dump_close(struct sc_stream_dump *dump);
+
+/**
+ * Append the given bytes, received at the current time, to the dump
+ *
+ * On error, the dump is disabled (an error is logged only once).
+ */
+void
+sc_stream_dump_write(struct sc_stream_dump *dump, const void *data,
+                     size_t len);
+
+#endif
@@ -0,0 +1,162 @@
+#include "stream_replay.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stream_dump.h"
+#include "util/binary.h"
+#include "util/log.h"
+
+bool
+sc_stream_replay_init(struct sc_stream_replay *replay, const char *filename,
+                      float speed) {
+    assert(speed >= 0);
+
+    replay->file = fopen(filename, "rb");
+    if (!replay->file) {
+        LOGE("Could not open stream dump file: %s", filename);
+        return false;
+    }
+
+    char magic[SC_STREAM_DUMP_MAGIC_SIZE];
+    size_t r = fread(magic, 1, sizeof(magic), replay->file);
+    if (r != sizeof(magic)
+            || memcmp(magic, SC_STREAM_DUMP_MAGIC, sizeof(magic))) {
+        LOGE("Not a stream dump file: %s", filename);
+        goto error_close_file;
+    }
+
+    bool ok = sc_mutex_init(&replay->mutex);
+    if (!ok) {
+        goto error_close_file;
+    }
+
+    ok = sc_cond_init(&replay->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    replay->speed = speed;
+    replay->started = false;
+    replay->data = NULL;
+    replay->cap = 0;
+    replay->len = 0;
+    replay->pos = 0;
+    replay->interrupted = false;
+
+    return true;
+
+error_mutex_destroy:
+    sc_mutex_destroy(&replay->mutex);
+error_close_file:
+    fclose(replay->file);
+
+    return false;
+}
+
+void
+sc_stream_replay_destroy(struct sc_stream_replay *replay) {
+    free(replay->data);
+    sc_cond_destroy(&replay->cond);
+    sc_mutex_destroy(&replay->mutex);
+    fclose(replay->file);
+}
+
+// Return false if interrupted
+static bool
+sc_stream_replay_wait(struct sc_stream_replay *replay, sc_tick deadline) {
+    sc_mutex_lock(&replay->mutex);
+    bool timed_out = false;
+    while (!replay->interrupted && !timed_out) {
+        timed_out = !sc_cond_timedwait(&replay->cond, &replay->mutex,
+                                       deadline);
+    }
+    bool interrupted = replay->interrupted;
+    sc_mutex_unlock(&replay->mutex);
+
+    return !interrupted;
+}
+
+// Return 1 on success, 0 on end-of-stream, -1 on error
+static int
+sc_stream_replay_next_record(struct sc_stream_replay *replay) {
+    uint8_t header[SC_STREAM_DUMP_RECORD_HEADER_SIZE];
+    size_t r = fread(header, 1, sizeof(header), replay->file);
+    if (r != sizeof(header)) {
+        if (r) {
+            LOGW("Stream dump: truncated record header");
+        }
+        return 0;
+    }
+
+    sc_tick pts = sc_read64be(header);
+    uint32_t len = sc_read32be(&header[8]);
+
+    if (len > replay->cap) {
+        uint8_t *data = realloc(replay->data, len);
+        if (!data) {
+            LOG_OOM();
+            return -1;
+        }
+        replay->data = data;
+        replay->cap = len;
+    }
+
+    r = fread(replay->data, 1, len, replay->file);
+    if (r != len) {
+        LOGW("Stream dump: truncated record");
+    }
+
+    replay->len = r;
+    replay->pos = 0;
+
+    if (replay->speed) {
+        if (!replay->started) {
+            replay->origin = sc_tick_now() - pts / replay->speed;
+            replay->started = true;
+        }
+
+        sc_tick deadline = replay->origin + pts / replay->speed;
+        if (!sc_stream_replay_wait(replay, deadline)) {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+ssize_t
+sc_stream_replay_recv_all(struct sc_stream_replay *replay, void *buf,
+                          size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        if (replay->pos == replay->len) {
+            int r = sc_stream_replay_next_record(replay);
+            if (r <= 0) {
+                return r < 0 ? -1 : (ssize_t) copied;
+            }
+            continue;
+        }
+
+        size_t available = replay->len - replay->pos;
+        size_t n = len - copied < available ? len - copied : available;
+        memcpy((uint8_t *) buf + copied, &replay->data[replay->pos], n);
+        replay->pos += n;
+        copied += n;
+    }
+
+    sc_mutex_lock(&replay->mutex);
+    bool interrupted = replay->interrupted;
+    sc_mutex_unlock(&replay->mutex);
+
+    return interrupted ? -1 : (ssize_t) copied;
+}
+
+void
+sc_stream_replay_interrupt(struct sc_stream_replay *replay) {
+    sc_mutex_lock(&replay->mutex);
+    replay->interrupted = true;
+    sc_cond_signal(&replay->cond);
+    sc_mutex_unlock(&replay->mutex);
+}
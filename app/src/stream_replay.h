@@ -0,0 +1,59 @@
+#ifndef SC_STREAM_REPLAY_H
+#define SC_STREAM_REPLAY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "util/thread.h"
+#include "util/tick.h"
+
+// Read a stream dump (see stream_dump.h), to stand in for a stream socket
+struct sc_stream_replay {
+    FILE *file;
+
+    // Replay speed factor (1 for the original timing, 0 for no throttling)
+    float speed;
+
+    // Local time at which the first record has been delivered
+    sc_tick origin;
+    bool started;
+
+    // Current record data
+    uint8_t *data;
+    size_t cap;
+    size_t len;
+    size_t pos;
+
+    sc_mutex mutex;
+    sc_cond cond;
+    bool interrupted;
+};
+
+bool
+sc_stream_replay_init(struct sc_stream_replay *replay, const char *filename,
+                      float speed);
+
+void
+sc_stream_replay_destroy(struct sc_stream_replay *replay);
+
+/**
+ * Read exactly len bytes, waiting for the recorded reception time if necessary
+ *
+ * Same semantics as net_recv_all(): return the number of bytes read (less
+ * than len only on end-of-stream), or -1 on error or interruption.
+ */
+ssize_t
+sc_stream_replay_recv_all(struct sc_stream_replay *replay, void *buf,
+                          size_t len);
+
+/**
+ * Wake up any blocking call, and make all further reads fail
+ */
+void
+sc_stream_replay_interrupt(struct sc_stream_replay *replay);
+
+#endif
@@ -7,6 +7,11 @@
 
 #include "util/log.h"
 
+// Upload the whole frame at least once every N frames, even if the dirty rects
+// are known: the regions outside the dirty rects are only "almost" identical
+// (the encoder may refine them over several frames)
+#define SC_TEXTURE_MAX_PARTIAL_UPLOADS 60
+
 bool
 sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps) {
     const char *renderer_name = SDL_GetRendererName(renderer);
@@ -42,6 +47,7 @@ sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps) {
 
     tex->renderer = renderer;
     tex->texture = NULL;
+    tex->partial_uploads = 0;
     return true;
 }
 
@@ -158,8 +164,37 @@ sc_texture_create_frame_texture(struct sc_texture *tex,
     return texture;
 }
 
+static bool
+sc_texture_update_rect(struct sc_texture *tex, const AVFrame *frame,
+                       const struct sc_dirty_rect *rect) {
+    // The coordinates are even (the chroma planes are subsampled by 2)
+    assert(!(rect->x & 1));
+    assert(!(rect->y & 1));
+
+    SDL_Rect sdl_rect = {
+        .x = rect->x,
+        .y = rect->y,
+        .w = rect->width,
+        .h = rect->height,
+    };
+
+    int x = rect->x;
+    int y = rect->y;
+    const uint8_t *y_plane = frame->data[0] + y * frame->linesize[0] + x;
+    const uint8_t *u_plane =
+        frame->data[1] + (y / 2) * frame->linesize[1] + x / 2;
+    const uint8_t *v_plane =
+        frame->data[2] + (y / 2) * frame->linesize[2] + x / 2;
+
+    return SDL_UpdateYUVTexture(tex->texture, &sdl_rect,
+                                y_plane, frame->linesize[0],
+                                u_plane, frame->linesize[1],
+                                v_plane, frame->linesize[2]);
+}
+
 bool
-sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame) {
+sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame,
+                          const struct sc_dirty_rects *drs) {
 
     struct sc_size size = {frame->width, frame->height};
     assert(size.width && size.height);
@@ -186,18 +221,43 @@ sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame) {
         tex->texture_type = SC_TEXTURE_TYPE_FRAME;
 
         LOGI("Texture: %" PRIu16 "x%" PRIu16, size.width, size.height);
+
+        // The new texture content is undefined
+        drs = NULL;
     }
 
     assert(tex->texture);
     assert(tex->texture_type == SC_TEXTURE_TYPE_FRAME);
 
-    bool ok = SDL_UpdateYUVTexture(tex->texture, NULL,
-                                   frame->data[0], frame->linesize[0],
-                                   frame->data[1], frame->linesize[1],
-                                   frame->data[2], frame->linesize[2]);
-    if (!ok) {
-        LOGD("Could not update texture: %s", SDL_GetError());
-        return false;
+    if (drs && tex->partial_uploads >= SC_TEXTURE_MAX_PARTIAL_UPLOADS) {
+        drs = NULL;
+    }
+
+    if (drs) {
+        ++tex->partial_uploads;
+
+        for (unsigned i = 0; i < drs->count; ++i) {
+            struct sc_dirty_rect rect;
+            if (!sc_dirty_rect_align(&drs->rects[i], size, &rect)) {
+                continue;
+            }
+
+            bool ok = sc_texture_update_rect(tex, frame, &rect);
+            if (!ok) {
+                LOGD("Could not update texture: %s", SDL_GetError());
+                return false;
+            }
+        }
+    } else {
+        tex->partial_uploads = 0;
+        bool ok = SDL_UpdateYUVTexture(tex->texture, NULL,
+                                       frame->data[0], frame->linesize[0],
+                                       frame->data[1], frame->linesize[1],
+                                       frame->data[2], frame->linesize[2]);
+        if (!ok) {
+            LOGD("Could not update texture: %s", SDL_GetError());
+            return false;
+        }
     }
 
     if (tex->mipmaps) {
@@ -9,6 +9,7 @@
 #include <SDL3/SDL.h>
 
 #include "coords.h"
+#include "dirty_rects.h"
 #include "opengl.h"
 
 enum sc_texture_type {
@@ -22,6 +23,9 @@ struct sc_texture {
     // Only valid if texture != NULL
     struct sc_size texture_size;
     enum sc_texture_type texture_type;
+    // Number of frames uploaded from their dirty rects only since the last
+    // full upload
+    unsigned partial_uploads;
 
     struct sc_opengl gl;
 
@@ -35,8 +39,17 @@ sc_texture_init(struct sc_texture *tex, SDL_Renderer *renderer, bool mipmaps);
 void
 sc_texture_destroy(struct sc_texture *tex);
 
+/**
+ * Upload the frame to the texture
+ *
+ * If drs is not NULL and the texture is reused, only the dirty rects are
+ * uploaded (the rest of the texture must already contain the previous frame).
+ * The whole frame is still uploaded periodically, so that any difference
+ * outside the dirty rects does not persist.
+ */
 bool
-sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame);
+sc_texture_set_from_frame(struct sc_texture *tex, const AVFrame *frame,
+                          const struct sc_dirty_rects *drs);
 
 bool
 sc_texture_set_from_surface(struct sc_texture *tex, SDL_Surface *surface);
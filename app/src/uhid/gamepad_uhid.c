@@ -143,3 +143,14 @@ sc_gamepad_uhid_init(struct sc_gamepad_uhid *gamepad,
 
     gamepad->gamepad_processor.ops = &ops;
 }
+
+void
+sc_gamepad_uhid_resume(struct sc_gamepad_uhid *gamepad) {
+    // Re-create the devices of the gamepads still plugged in
+    for (size_t i = 0; i < SC_MAX_GAMEPADS; ++i) {
+        struct sc_hid_open hid_open;
+        if (sc_hid_gamepad_generate_reopen(&gamepad->hid, &hid_open, i)) {
+            sc_gamepad_uhid_send_open(gamepad, &hid_open);
+        }
+    }
+}
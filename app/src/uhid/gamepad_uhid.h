@@ -18,4 +18,11 @@ void
 sc_gamepad_uhid_init(struct sc_gamepad_uhid *mouse,
                      struct sc_controller *controller);
 
+/**
+ * Re-create the devices of the open gamepads after the server has been
+ * restarted
+ */
+void
+sc_gamepad_uhid_resume(struct sc_gamepad_uhid *gamepad);
+
 #endif
@@ -119,6 +119,28 @@ sc_keyboard_uhid_process_hid_output(struct sc_keyboard_uhid *kb,
     kb->device_mod = device_mod;
 }
 
+static bool
+sc_keyboard_uhid_send_create(struct sc_keyboard_uhid *kb) {
+    struct sc_hid_open hid_open;
+    sc_hid_keyboard_generate_open(&hid_open);
+    assert(hid_open.hid_id == SC_HID_ID_KEYBOARD);
+
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_UHID_CREATE;
+    msg.uhid_create.id = SC_HID_ID_KEYBOARD;
+    msg.uhid_create.vendor_id = 0;
+    msg.uhid_create.product_id = 0;
+    msg.uhid_create.name = NULL;
+    msg.uhid_create.report_desc = hid_open.report_desc;
+    msg.uhid_create.report_desc_size = hid_open.report_desc_size;
+    if (!sc_controller_push_msg(kb->controller, &msg)) {
+        LOGE("Could not send UHID_CREATE message (keyboard)");
+        return false;
+    }
+
+    return true;
+}
+
 bool
 sc_keyboard_uhid_init(struct sc_keyboard_uhid *kb,
                       struct sc_controller *controller) {
@@ -140,22 +162,15 @@ sc_keyboard_uhid_init(struct sc_keyboard_uhid *kb,
     kb->key_processor.hid = true;
     kb->key_processor.ops = &ops;
 
-    struct sc_hid_open hid_open;
-    sc_hid_keyboard_generate_open(&hid_open);
-    assert(hid_open.hid_id == SC_HID_ID_KEYBOARD);
+    return sc_keyboard_uhid_send_create(kb);
+}
 
-    struct sc_control_msg msg;
-    msg.type = SC_CONTROL_MSG_TYPE_UHID_CREATE;
-    msg.uhid_create.id = SC_HID_ID_KEYBOARD;
-    msg.uhid_create.vendor_id = 0;
-    msg.uhid_create.product_id = 0;
-    msg.uhid_create.name = NULL;
-    msg.uhid_create.report_desc = hid_open.report_desc;
-    msg.uhid_create.report_desc_size = hid_open.report_desc_size;
-    if (!sc_controller_push_msg(controller, &msg)) {
-        LOGE("Could not send UHID_CREATE message (keyboard)");
-        return false;
-    }
+bool
+sc_keyboard_uhid_resume(struct sc_keyboard_uhid *kb) {
+    // The UHID devices of the previous server have been destroyed along with
+    // it: no key is pressed on the new device
+    sc_hid_keyboard_init(&kb->hid);
+    kb->device_mod = 0;
 
-    return true;
+    return sc_keyboard_uhid_send_create(kb);
 }
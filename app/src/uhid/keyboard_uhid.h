@@ -25,4 +25,10 @@ void
 sc_keyboard_uhid_process_hid_output(struct sc_keyboard_uhid *kb,
                                     const uint8_t *data, size_t size);
 
+/**
+ * Re-create the keyboard device after the server has been restarted
+ */
+bool
+sc_keyboard_uhid_resume(struct sc_keyboard_uhid *kb);
+
 #endif
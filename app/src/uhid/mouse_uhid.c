@@ -63,6 +63,28 @@ sc_mouse_processor_process_mouse_scroll(struct sc_mouse_processor *mp,
     sc_mouse_uhid_send_input(mouse, &hid_input, "mouse scroll");
 }
 
+static bool
+sc_mouse_uhid_send_create(struct sc_mouse_uhid *mouse) {
+    struct sc_hid_open hid_open;
+    sc_hid_mouse_generate_open(&hid_open);
+    assert(hid_open.hid_id == SC_HID_ID_MOUSE);
+
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_UHID_CREATE;
+    msg.uhid_create.id = SC_HID_ID_MOUSE;
+    msg.uhid_create.vendor_id = 0;
+    msg.uhid_create.product_id = 0;
+    msg.uhid_create.name = NULL;
+    msg.uhid_create.report_desc = hid_open.report_desc;
+    msg.uhid_create.report_desc_size = hid_open.report_desc_size;
+    if (!sc_controller_push_msg(mouse->controller, &msg)) {
+        LOGE("Could not push UHID_CREATE message (mouse)");
+        return false;
+    }
+
+    return true;
+}
+
 bool
 sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
                    struct sc_controller *controller) {
@@ -82,22 +104,12 @@ sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
 
     mouse->mouse_processor.relative_mode = true;
 
-    struct sc_hid_open hid_open;
-    sc_hid_mouse_generate_open(&hid_open);
-    assert(hid_open.hid_id == SC_HID_ID_MOUSE);
+    return sc_mouse_uhid_send_create(mouse);
+}
 
-    struct sc_control_msg msg;
-    msg.type = SC_CONTROL_MSG_TYPE_UHID_CREATE;
-    msg.uhid_create.id = SC_HID_ID_MOUSE;
-    msg.uhid_create.vendor_id = 0;
-    msg.uhid_create.product_id = 0;
-    msg.uhid_create.name = NULL;
-    msg.uhid_create.report_desc = hid_open.report_desc;
-    msg.uhid_create.report_desc_size = hid_open.report_desc_size;
-    if (!sc_controller_push_msg(controller, &msg)) {
-        LOGE("Could not push UHID_CREATE message (mouse)");
-        return false;
-    }
+bool
+sc_mouse_uhid_resume(struct sc_mouse_uhid *mouse) {
+    sc_hid_mouse_init(&mouse->hid);
 
-    return true;
+    return sc_mouse_uhid_send_create(mouse);
 }
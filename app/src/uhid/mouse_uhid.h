@@ -18,4 +18,10 @@ bool
 sc_mouse_uhid_init(struct sc_mouse_uhid *mouse,
                    struct sc_controller *controller);
 
+/**
+ * Re-create the mouse device after the server has been restarted
+ */
+bool
+sc_mouse_uhid_resume(struct sc_mouse_uhid *mouse);
+
 #endif
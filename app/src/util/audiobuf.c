@@ -11,9 +11,8 @@ sc_audiobuf_init(struct sc_audiobuf *buf, size_t sample_size,
     assert(sample_size);
     assert(capacity);
 
-    // The actual capacity is (alloc_size - 1) so that head == tail is
-    // non-ambiguous
-    buf->alloc_size = capacity + 1;
+    // The cursors are not wrapped, so head == tail is non-ambiguous
+    buf->alloc_size = capacity;
     buf->data = sc_allocarray(buf->alloc_size, sample_size);
     if (!buf->data) {
         LOG_OOM();
@@ -38,42 +37,74 @@ sc_audiobuf_read(struct sc_audiobuf *buf, void *to_, uint32_t samples_count) {
 
     uint8_t *to = to_;
 
-    // Only the reader thread can write tail without synchronization, so
-    // memory_order_relaxed is sufficient
-    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    // The writer may also move tail (to drop samples), so tail must be
+    // updated by compare-and-swap
+    uint64_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
 
-    // The head cursor is updated after the data is written to the array
-    uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    for (;;) {
+        // The head cursor is updated after the data is written to the array
+        uint64_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
 
-    uint32_t can_read = (buf->alloc_size + head - tail) % buf->alloc_size;
-    if (!can_read) {
-        return 0;
-    }
-    if (samples_count > can_read) {
-        samples_count = can_read;
-    }
-
-    if (to) {
-        uint32_t right_count = buf->alloc_size - tail;
-        if (right_count > samples_count) {
-            right_count = samples_count;
+        uint32_t can_read = head - tail;
+        if (!can_read) {
+            return 0;
         }
-        memcpy(to,
-               buf->data + (tail * buf->sample_size),
-               right_count * buf->sample_size);
-
-        if (samples_count > right_count) {
-            uint32_t left_count = samples_count - right_count;
-            memcpy(to + (right_count * buf->sample_size),
-                   buf->data,
-                   left_count * buf->sample_size);
+        uint32_t count = MIN(samples_count, can_read);
+
+        if (to) {
+            uint32_t index = tail % buf->alloc_size;
+            uint32_t right_count = buf->alloc_size - index;
+            if (right_count > count) {
+                right_count = count;
+            }
+            memcpy(to,
+                   buf->data + (index * buf->sample_size),
+                   right_count * buf->sample_size);
+
+            if (count > right_count) {
+                uint32_t left_count = count - right_count;
+                memcpy(to + (right_count * buf->sample_size),
+                       buf->data,
+                       left_count * buf->sample_size);
+            }
+        }
+
+        uint64_t new_tail = tail + count;
+        // On success, release the consumed samples to the writer. On failure,
+        // the writer has dropped samples concurrently (so the copied data may
+        // have been overwritten): retry from the new tail.
+        if (atomic_compare_exchange_weak_explicit(&buf->tail, &tail, new_tail,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+            return count;
         }
     }
+}
+
+uint32_t
+sc_audiobuf_drop(struct sc_audiobuf *buf, uint32_t samples_count) {
+    // Only the writer thread can write head, so memory_order_relaxed is
+    // sufficient
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
 
-    uint32_t new_tail = (tail + samples_count) % buf->alloc_size;
-    atomic_store_explicit(&buf->tail, new_tail, memory_order_release);
+    uint64_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
 
-    return samples_count;
+    for (;;) {
+        uint32_t can_read = head - tail;
+        uint32_t count = MIN(samples_count, can_read);
+        if (!count) {
+            return 0;
+        }
+
+        uint64_t new_tail = tail + count;
+        // On failure, the reader has consumed samples concurrently: retry from
+        // the new tail
+        if (atomic_compare_exchange_weak_explicit(&buf->tail, &tail, new_tail,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+            return count;
+        }
+    }
 }
 
 uint32_t
@@ -83,12 +114,12 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
 
     // Only the writer thread can write head, so memory_order_relaxed is
     // sufficient
-    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
 
     // The tail cursor is updated after the data is consumed by the reader
-    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
 
-    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    uint32_t can_write = buf->alloc_size - (uint32_t) (head - tail);
     if (!can_write) {
         return 0;
     }
@@ -96,11 +127,12 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
         samples_count = can_write;
     }
 
-    uint32_t right_count = buf->alloc_size - head;
+    uint32_t index = head % buf->alloc_size;
+    uint32_t right_count = buf->alloc_size - index;
     if (right_count > samples_count) {
         right_count = samples_count;
     }
-    memcpy(buf->data + (head * buf->sample_size),
+    memcpy(buf->data + (index * buf->sample_size),
            from,
            right_count * buf->sample_size);
 
@@ -111,7 +143,7 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
                left_count * buf->sample_size);
     }
 
-    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    uint64_t new_head = head + samples_count;
     atomic_store_explicit(&buf->head, new_head, memory_order_release);
 
     return samples_count;
@@ -121,12 +153,12 @@ uint32_t
 sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples_count) {
     // Only the writer thread can write head, so memory_order_relaxed is
     // sufficient
-    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
 
     // The tail cursor is updated after the data is consumed by the reader
-    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
 
-    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    uint32_t can_write = buf->alloc_size - (uint32_t) (head - tail);
     if (!can_write) {
         return 0;
     }
@@ -134,11 +166,12 @@ sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples_count) {
         samples_count = can_write;
     }
 
-    uint32_t right_count = buf->alloc_size - head;
+    uint32_t index = head % buf->alloc_size;
+    uint32_t right_count = buf->alloc_size - index;
     if (right_count > samples_count) {
         right_count = samples_count;
     }
-    memset(buf->data + (head * buf->sample_size), 0,
+    memset(buf->data + (index * buf->sample_size), 0,
            right_count * buf->sample_size);
 
     if (samples_count > right_count) {
@@ -146,7 +179,7 @@ sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples_count) {
         memset(buf->data, 0, left_count * buf->sample_size);
     }
 
-    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    uint64_t new_head = head + samples_count;
     atomic_store_explicit(&buf->head, new_head, memory_order_release);
 
     return samples_count;
@@ -13,16 +13,26 @@
  * Wrapper around bytebuf to read and write samples
  *
  * Each sample takes sample_size bytes.
+ *
+ * There must be a single reader thread and a single writer thread. The writer
+ * may drop the oldest samples (sc_audiobuf_drop()) without any lock: the
+ * reader detects it when publishing its new cursor, and retries.
+ *
+ * The cursors are monotonically increasing counters (the position in the
+ * array is the counter modulo alloc_size), so that a cursor never takes the
+ * same value twice: the compare-and-swap on tail can not succeed on a stale
+ * value (ABA) after the writer has dropped exactly a multiple of alloc_size
+ * samples.
  */
 struct sc_audiobuf {
     uint8_t *data;
     uint32_t alloc_size; // in samples
     size_t sample_size;
 
-    atomic_uint_least32_t head; // writer cursor, in samples
-    atomic_uint_least32_t tail; // reader cursor, in samples
+    atomic_uint_least64_t head; // writer cursor, in samples
+    atomic_uint_least64_t tail; // reader cursor, in samples
     // empty: tail == head
-    // full: ((tail + 1) % alloc_size) == head
+    // full: head - tail == alloc_size
 };
 
 static inline uint32_t
@@ -43,9 +53,24 @@ sc_audiobuf_init(struct sc_audiobuf *buf, size_t sample_size,
 void
 sc_audiobuf_destroy(struct sc_audiobuf *buf);
 
+/**
+ * Read (or skip, if `to` is NULL) up to `samples_count` samples
+ *
+ * Must be called from the reader thread.
+ */
 uint32_t
 sc_audiobuf_read(struct sc_audiobuf *buf, void *to, uint32_t samples_count);
 
+/**
+ * Drop up to `samples_count` of the oldest samples to make space
+ *
+ * Must be called from the writer thread. Return the number of samples
+ * dropped, which may be lower than `samples_count` if the reader has consumed
+ * samples concurrently.
+ */
+uint32_t
+sc_audiobuf_drop(struct sc_audiobuf *buf, uint32_t samples_count);
+
 uint32_t
 sc_audiobuf_write(struct sc_audiobuf *buf, const void *from,
                   uint32_t samples_count);
@@ -56,14 +81,15 @@ sc_audiobuf_write_silence(struct sc_audiobuf *buf, uint32_t samples);
 static inline uint32_t
 sc_audiobuf_capacity(struct sc_audiobuf *buf) {
     assert(buf->alloc_size);
-    return buf->alloc_size - 1;
+    return buf->alloc_size;
 }
 
 static inline uint32_t
 sc_audiobuf_can_read(struct sc_audiobuf *buf) {
-    uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
-    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
-    return (buf->alloc_size + head - tail) % buf->alloc_size;
+    // Load tail first, so that head >= tail
+    uint64_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    return head - tail;
 }
 
 #endif
@@ -0,0 +1,85 @@
+#include "audioconv.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define SC_AUDIOCONV_SSE2
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+# define SC_AUDIOCONV_NEON
+#endif
+
+// Same factor as libswresample: the conversion is exact (no rounding)
+#define SC_AUDIOCONV_S16_SCALE (1.0f / (1 << 15))
+
+void
+sc_audioconv_s16_to_f32(float *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+
+#if defined(SC_AUDIOCONV_SSE2)
+    const __m128 scale = _mm_set1_ps(SC_AUDIOCONV_S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        // Sign-extend to 32 bits: put each value in the high half of a
+        // 32-bit lane, then shift right arithmetically
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(&dst[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(SC_AUDIOCONV_NEON)
+    const float32x4_t scale = vdupq_n_f32(SC_AUDIOCONV_S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(&src[i]);
+        int32x4_t lo = vmovl_s16(vget_low_s16(v));
+        int32x4_t hi = vmovl_s16(vget_high_s16(v));
+        vst1q_f32(&dst[i], vmulq_f32(vcvtq_f32_s32(lo), scale));
+        vst1q_f32(&dst[i + 4], vmulq_f32(vcvtq_f32_s32(hi), scale));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        dst[i] = src[i] * SC_AUDIOCONV_S16_SCALE;
+    }
+}
+
+void
+sc_audioconv_interleave_f32(float *dst, const float *const *planes,
+                            unsigned channels, size_t samples) {
+    if (channels == 1) {
+        memcpy(dst, planes[0], samples * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+
+    if (channels == 2) {
+        const float *l = planes[0];
+        const float *r = planes[1];
+#if defined(SC_AUDIOCONV_SSE2)
+        for (; i + 4 <= samples; i += 4) {
+            __m128 vl = _mm_loadu_ps(&l[i]);
+            __m128 vr = _mm_loadu_ps(&r[i]);
+            _mm_storeu_ps(&dst[2 * i], _mm_unpacklo_ps(vl, vr));
+            _mm_storeu_ps(&dst[2 * i + 4], _mm_unpackhi_ps(vl, vr));
+        }
+#elif defined(SC_AUDIOCONV_NEON)
+        for (; i + 4 <= samples; i += 4) {
+            float32x4x2_t v = {{vld1q_f32(&l[i]), vld1q_f32(&r[i])}};
+            vst2q_f32(&dst[2 * i], v);
+        }
+#endif
+        for (; i < samples; ++i) {
+            dst[2 * i] = l[i];
+            dst[2 * i + 1] = r[i];
+        }
+        return;
+    }
+
+    for (; i < samples; ++i) {
+        for (unsigned c = 0; c < channels; ++c) {
+            dst[i * channels + c] = planes[c][i];
+        }
+    }
+}
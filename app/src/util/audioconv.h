@@ -0,0 +1,30 @@
+#ifndef SC_AUDIOCONV_H
+#define SC_AUDIOCONV_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sample format conversion kernels
+ *
+ * They produce exactly the same values as libswresample, but without the
+ * overhead of a generic conversion (they are vectorized using SSE2 or NEON
+ * when available).
+ */
+
+/**
+ * Convert `count` signed 16-bit values to float values in [-1, 1)
+ */
+void
+sc_audioconv_s16_to_f32(float *dst, const int16_t *src, size_t count);
+
+/**
+ * Interleave `samples` float samples from `channels` planes
+ */
+void
+sc_audioconv_interleave_f32(float *dst, const float *const *planes,
+                            unsigned channels, size_t samples);
+
+#endif
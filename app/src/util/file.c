@@ -4,6 +4,9 @@
 #include <string.h>
 
 #include "util/log.h"
+#ifdef _WIN32
+# include "util/str.h"
+#endif
 
 char *
 sc_file_build_path(const char *dir, const char *name) {
@@ -50,3 +53,53 @@ sc_file_get_local_path(const char *name) {
 
     return file_path;
 }
+
+FILE *
+sc_file_open_read(const char *path) {
+#ifdef _WIN32
+    wchar_t *wide_path = sc_str_to_wchars(path);
+    if (!wide_path) {
+        LOG_OOM();
+        return NULL;
+    }
+    FILE *file = _wfopen(wide_path, L"rb");
+    free(wide_path);
+    return file;
+#else
+    return fopen(path, "rb");
+#endif
+}
+
+bool
+sc_file_hash(const char *path, uint64_t *out_hash, uint64_t *out_size) {
+    FILE *file = sc_file_open_read(path);
+    if (!file) {
+        LOGE("Could not open file: %s", path);
+        return false;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325; // FNV offset basis
+    uint64_t size = 0;
+
+    uint8_t buf[4096];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), file))) {
+        for (size_t i = 0; i < r; ++i) {
+            hash ^= buf[i];
+            hash *= 0x100000001b3; // FNV prime
+        }
+        size += r;
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+
+    if (!ok) {
+        LOGE("Could not read file: %s", path);
+        return false;
+    }
+
+    *out_hash = hash;
+    *out_size = size;
+    return true;
+}
@@ -4,6 +4,8 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifdef _WIN32
 # define SC_PATH_SEPARATOR '\\'
@@ -55,4 +57,18 @@ sc_file_build_path(const char *dir, const char *filename);
 bool
 sc_file_is_regular(const char *path);
 
+/**
+ * Open a file for reading in binary mode
+ *
+ * The path is UTF-8 encoded, including on Windows.
+ */
+FILE *
+sc_file_open_read(const char *path);
+
+/**
+ * Compute a hash (64-bit FNV-1a) of the file content, and retrieve its size
+ */
+bool
+sc_file_hash(const char *path, uint64_t *out_hash, uint64_t *out_size);
+
 #endif
@@ -13,7 +13,9 @@
 # include <netinet/in.h>
 # include <netinet/tcp.h>
 # include <unistd.h>
+# include <sys/ioctl.h>
 # include <sys/socket.h>
+# include <sys/time.h>
 # include <sys/types.h>
 # define SOCKET_ERROR -1
   typedef struct sockaddr_in SOCKADDR_IN;
@@ -203,6 +205,79 @@ net_accept(sc_socket server_socket) {
     return wrap(raw_sock);
 }
 
+bool
+net_socketpair(sc_socket sockets[2]) {
+#ifndef _WIN32
+    int type = SOCK_STREAM;
+# ifdef HAVE_SOCK_CLOEXEC
+    type |= SOCK_CLOEXEC;
+# endif
+    sc_raw_socket raw_socks[2];
+    if (socketpair(AF_UNIX, type, 0, raw_socks) == SOCKET_ERROR) {
+        net_perror("socketpair");
+        return false;
+    }
+
+# ifndef HAVE_SOCK_CLOEXEC
+    if (!set_cloexec_flag(raw_socks[0]) || !set_cloexec_flag(raw_socks[1])) {
+        sc_raw_socket_close(raw_socks[0]);
+        sc_raw_socket_close(raw_socks[1]);
+        return false;
+    }
+# endif
+
+# ifdef SO_NOSIGPIPE
+    // There is no MSG_NOSIGNAL on macOS
+    int nosigpipe = 1;
+    setsockopt(raw_socks[0], SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe,
+               sizeof(nosigpipe));
+    setsockopt(raw_socks[1], SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe,
+               sizeof(nosigpipe));
+# endif
+
+    sockets[0] = wrap(raw_socks[0]);
+    sockets[1] = wrap(raw_socks[1]);
+#else
+    // There is no socketpair() on Windows, connect two sockets over the
+    // loopback interface instead
+    sc_socket server_socket = net_socket();
+    if (server_socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    sockets[0] = SC_SOCKET_NONE;
+    sockets[1] = SC_SOCKET_NONE;
+
+    SOCKADDR_IN sin;
+    socklen_t sinsize = sizeof(sin);
+    // Port 0: let the system choose an available port
+    bool ok = net_listen(server_socket, IPV4_LOCALHOST, 0, 1)
+           && !getsockname(unwrap(server_socket), (SOCKADDR *) &sin, &sinsize);
+    if (ok) {
+        sockets[0] = net_socket();
+        ok = sockets[0] != SC_SOCKET_NONE
+          && net_connect(sockets[0], IPV4_LOCALHOST, ntohs(sin.sin_port));
+        if (ok) {
+            sockets[1] = net_accept(server_socket);
+        }
+    }
+
+    net_close(server_socket);
+#endif
+
+    if (sockets[0] == SC_SOCKET_NONE || sockets[1] == SC_SOCKET_NONE) {
+        if (sockets[0] != SC_SOCKET_NONE) {
+            net_close(sockets[0]);
+        }
+        if (sockets[1] != SC_SOCKET_NONE) {
+            net_close(sockets[1]);
+        }
+        return false;
+    }
+
+    return true;
+}
+
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
@@ -218,7 +293,12 @@ net_recv_all(sc_socket socket, void *buf, size_t len) {
 ssize_t
 net_send(sc_socket socket, const void *buf, size_t len) {
     sc_raw_socket raw_sock = unwrap(socket);
+#ifdef MSG_NOSIGNAL
+    // Fail with EPIPE rather than raising SIGPIPE if the peer is closed
+    return send(raw_sock, buf, len, MSG_NOSIGNAL);
+#else
     return send(raw_sock, buf, len, 0);
+#endif
 }
 
 ssize_t
@@ -284,6 +364,120 @@ net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay) {
     return true;
 }
 
+static bool
+net_set_int_option(sc_socket socket, int level, int name, int value,
+                   const char *desc) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    int ret = setsockopt(raw_sock, level, name, (const void *) &value,
+                         sizeof(value));
+    if (ret == -1) {
+        net_perror(desc);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+net_get_int_option(sc_socket socket, int level, int name, int *value) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    socklen_t len = sizeof(*value);
+    return !getsockopt(raw_sock, level, name, (void *) value, &len);
+}
+
+bool
+net_set_recv_buffer_size(sc_socket socket, int size) {
+    return net_set_int_option(socket, SOL_SOCKET, SO_RCVBUF, size,
+                              "setsockopt(SO_RCVBUF)");
+}
+
+bool
+net_set_send_buffer_size(sc_socket socket, int size) {
+    return net_set_int_option(socket, SOL_SOCKET, SO_SNDBUF, size,
+                              "setsockopt(SO_SNDBUF)");
+}
+
+bool
+net_get_buffer_sizes(sc_socket socket, int *recv_size, int *send_size) {
+    return net_get_int_option(socket, SOL_SOCKET, SO_RCVBUF, recv_size)
+        && net_get_int_option(socket, SOL_SOCKET, SO_SNDBUF, send_size);
+}
+
+bool
+net_set_recv_timeout(sc_socket socket, unsigned timeout_ms) {
+    sc_raw_socket raw_sock = unwrap(socket);
+
+#ifdef _WIN32
+    DWORD value = timeout_ms;
+#else
+    struct timeval value = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+#endif
+    int ret = setsockopt(raw_sock, SOL_SOCKET, SO_RCVTIMEO,
+                         (const void *) &value, sizeof(value));
+    if (ret == -1) {
+        net_perror("setsockopt(SO_RCVTIMEO)");
+        return false;
+    }
+
+    return true;
+}
+
+bool
+net_set_low_latency(sc_socket socket) {
+#ifdef __linux__
+    // TCP_QUICKACK is not permanent (the kernel may switch back to delayed
+    // ACKs), but it avoids delaying the ACKs at the start of the stream, when
+    // the congestion window is small
+    bool ok = net_set_int_option(socket, IPPROTO_TCP, TCP_QUICKACK, 1,
+                                 "setsockopt(TCP_QUICKACK)");
+# ifdef SO_BUSY_POLL
+    // Busy-poll the device queue on blocking reads (in microseconds). It may
+    // require CAP_NET_ADMIN, so a failure is not an error.
+    int busy_poll = 50;
+    setsockopt(unwrap(socket), SOL_SOCKET, SO_BUSY_POLL,
+               (const void *) &busy_poll, sizeof(busy_poll));
+# endif
+    return ok;
+#else
+    (void) socket;
+    return false;
+#endif
+}
+
+bool
+net_get_tcp_stats(sc_socket socket, struct net_tcp_stats *stats) {
+#ifdef __linux__
+    sc_raw_socket raw_sock = unwrap(socket);
+
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(raw_sock, IPPROTO_TCP, TCP_INFO, (void *) &info, &len)) {
+        return false;
+    }
+
+    int queued;
+    if (ioctl(raw_sock, FIONREAD, &queued)) {
+        queued = 0;
+    }
+
+    stats->rtt_us = info.tcpi_rtt;
+    stats->rtt_var_us = info.tcpi_rttvar;
+    stats->unacked = info.tcpi_unacked;
+    stats->retransmits = info.tcpi_total_retrans;
+    stats->recv_queue = queued;
+    return true;
+#else
+    (void) socket;
+    (void) stats;
+    return false;
+#endif
+}
+
 bool
 net_parse_ipv4(const char *s, uint32_t *ipv4) {
     struct in_addr addr;
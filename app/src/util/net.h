@@ -60,6 +60,10 @@ net_listen(sc_socket server_socket, uint32_t addr, uint16_t port, int backlog);
 sc_socket
 net_accept(sc_socket server_socket);
 
+// Create a pair of connected sockets (local to this process)
+bool
+net_socketpair(sc_socket sockets[2]);
+
 // the _all versions wait/retry until len bytes have been written/read
 ssize_t
 net_recv(sc_socket socket, void *buf, size_t len);
@@ -87,6 +91,40 @@ net_close(sc_socket socket);
 bool
 net_set_tcp_nodelay(sc_socket socket, bool tcp_nodelay);
 
+// Set the socket receive buffer size (SO_RCVBUF)
+bool
+net_set_recv_buffer_size(sc_socket socket, int size);
+
+// Set the socket send buffer size (SO_SNDBUF)
+bool
+net_set_send_buffer_size(sc_socket socket, int size);
+
+// Retrieve the effective buffer sizes (as reported by the kernel)
+bool
+net_get_buffer_sizes(sc_socket socket, int *recv_size, int *send_size);
+
+// Make the blocking receive calls fail after timeout_ms milliseconds without
+// data (SO_RCVTIMEO), or never if timeout_ms is 0
+bool
+net_set_recv_timeout(sc_socket socket, unsigned timeout_ms);
+
+// Reduce the receive latency at the expense of CPU usage (TCP_QUICKACK and
+// SO_BUSY_POLL), if supported by the platform
+bool
+net_set_low_latency(sc_socket socket);
+
+struct net_tcp_stats {
+    uint32_t rtt_us;
+    uint32_t rtt_var_us;
+    uint32_t unacked; // segments sent but not acknowledged yet
+    uint32_t retransmits; // total
+    uint32_t recv_queue; // bytes received but not read yet
+};
+
+// Retrieve the kernel TCP statistics (TCP_INFO), if supported by the platform
+bool
+net_get_tcp_stats(sc_socket socket, struct net_tcp_stats *stats);
+
 /**
  * Parse `ip` "xxx.xxx.xxx.xxx" to an IPv4 host representation
  */
@@ -1,8 +1,18 @@
+#ifdef _WIN32
+// Expose rand_s()
+# define _CRT_RAND_S
+#endif
+
 #include "rand.h"
 
 #include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+# include <stdio.h>
+#endif
 
 #include "tick.h"
+#include "util/log.h"
 
 void sc_rand_init(struct sc_rand *rand) {
     sc_tick seed = sc_tick_now(); // microsecond precision
@@ -22,3 +32,35 @@ uint64_t sc_rand_u64(struct sc_rand *rand) {
     uint32_t lsb = sc_rand_u32(rand);
     return ((uint64_t) msb << 32) | lsb;
 }
+
+bool sc_rand_secure(void *buf, size_t len) {
+#ifdef _WIN32
+    uint8_t *p = buf;
+    while (len) {
+        unsigned int value;
+        if (rand_s(&value)) {
+            LOGE("Could not generate random data");
+            return false;
+        }
+        size_t n = MIN(len, sizeof(value));
+        memcpy(p, &value, n);
+        p += n;
+        len -= n;
+    }
+    return true;
+#else
+    FILE *file = fopen("/dev/urandom", "rb");
+    if (!file) {
+        LOGE("Could not open /dev/urandom");
+        return false;
+    }
+
+    size_t r = fread(buf, 1, len, file);
+    fclose(file);
+    if (r != len) {
+        LOGE("Could not read /dev/urandom");
+        return false;
+    }
+    return true;
+#endif
+}
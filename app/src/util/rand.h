@@ -4,6 +4,8 @@
 #include "common.h"
 
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 struct sc_rand {
     unsigned short xsubi[3];
@@ -13,4 +15,7 @@ void sc_rand_init(struct sc_rand *rand);
 uint32_t sc_rand_u32(struct sc_rand *rand);
 uint64_t sc_rand_u64(struct sc_rand *rand);
 
+// Generate cryptographically secure random bytes (for secrets)
+bool sc_rand_secure(void *buf, size_t len);
+
 #endif
@@ -0,0 +1,362 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adb/adb.h"
+#include "adb/adb_client.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+#define TEST_LOCAL_FILE "test_adb_client.tmp"
+
+typedef void (*fake_adb_handler)(sc_socket socket);
+
+// Fake adb server, handling a single connection
+struct fake_adb_server {
+    sc_socket server_socket;
+    fake_adb_handler handler;
+    sc_thread thread;
+};
+
+static sc_socket fake_server_socket = SC_SOCKET_NONE;
+
+static void read_exactly(sc_socket socket, void *buf, size_t len) {
+    ssize_t r = net_recv_all(socket, buf, len);
+    assert(r == (ssize_t) len);
+    (void) r;
+}
+
+static void send_str(sc_socket socket, const char *s) {
+    size_t len = strlen(s);
+    ssize_t w = net_send_all(socket, s, len);
+    assert(w == (ssize_t) len);
+    (void) w;
+}
+
+static void expect_request(sc_socket socket, const char *expected) {
+    char hex[5];
+    read_exactly(socket, hex, 4);
+    hex[4] = '\0';
+
+    size_t len = strtoul(hex, NULL, 16);
+    assert(len == strlen(expected));
+
+    char request[1024];
+    read_exactly(socket, request, len);
+    assert(!memcmp(request, expected, len));
+}
+
+static void send_okay(sc_socket socket) {
+    send_str(socket, "OKAY");
+}
+
+static void send_string(sc_socket socket, const char *s) {
+    char hex[5];
+    snprintf(hex, sizeof(hex), "%04x", (unsigned) strlen(s));
+    send_str(socket, hex);
+    send_str(socket, s);
+}
+
+static void send_fail(sc_socket socket, const char *msg) {
+    send_str(socket, "FAIL");
+    send_string(socket, msg);
+}
+
+static void expect_sync_header(sc_socket socket, const char *id,
+                               uint32_t *value) {
+    uint8_t header[8];
+    read_exactly(socket, header, 8);
+    assert(!memcmp(header, id, 4));
+    *value = sc_read32le(&header[4]);
+}
+
+static void send_sync_header(sc_socket socket, const char *id,
+                             uint32_t value) {
+    uint8_t header[8];
+    memcpy(header, id, 4);
+    sc_write32le(&header[4], value);
+    ssize_t w = net_send_all(socket, header, 8);
+    assert(w == 8);
+    (void) w;
+}
+
+static int run_fake_adb_server(void *data) {
+    struct fake_adb_server *server = data;
+
+    sc_socket socket = net_accept(server->server_socket);
+    assert(socket != SC_SOCKET_NONE);
+
+    server->handler(socket);
+
+    net_close(socket);
+    return 0;
+}
+
+// Run the client request while the fake adb server handles the connection
+static void start_fake_adb_server(struct fake_adb_server *server,
+                                  fake_adb_handler handler) {
+    server->server_socket = fake_server_socket;
+    server->handler = handler;
+    bool ok = sc_thread_create(&server->thread, run_fake_adb_server,
+                               "test-adb", server);
+    assert(ok);
+    (void) ok;
+}
+
+static void join_fake_adb_server(struct fake_adb_server *server) {
+    sc_thread_join(&server->thread, NULL);
+}
+
+static void handle_devices(sc_socket socket) {
+    expect_request(socket, "host:devices-l");
+    send_okay(socket);
+    send_string(socket, "0123456789abcdef       device usb:1-1 model:Pixel\n");
+}
+
+static void test_list_devices(void) {
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_devices);
+
+    char buf[256];
+    enum sc_adb_client_result res =
+        sc_adb_client_list_devices(NULL, buf, sizeof(buf), 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(!strcmp(buf, "0123456789abcdef       device usb:1-1 model:Pixel\n"));
+
+    join_fake_adb_server(&server);
+}
+
+static void handle_forward(sc_socket socket) {
+    expect_request(socket,
+                   "host-serial:0123456789abcdef:forward:tcp:1234;"
+                   "localabstract:scrcpy");
+    // The first status for the request, the second for the result
+    send_okay(socket);
+    send_okay(socket);
+}
+
+static void test_forward(void) {
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_forward);
+
+    enum sc_adb_client_result res =
+        sc_adb_client_forward(NULL, "0123456789abcdef", "tcp:1234",
+                              "localabstract:scrcpy", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+
+    join_fake_adb_server(&server);
+}
+
+static void handle_reverse_failure(sc_socket socket) {
+    expect_request(socket, "host:transport:0123456789abcdef");
+    send_okay(socket);
+    expect_request(socket, "reverse:forward:localabstract:scrcpy;tcp:1234");
+    send_okay(socket);
+    send_fail(socket, "cannot bind listener");
+}
+
+static void test_reverse_failure(void) {
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_reverse_failure);
+
+    enum sc_adb_client_result res =
+        sc_adb_client_reverse(NULL, "0123456789abcdef",
+                              "localabstract:scrcpy", "tcp:1234",
+                              SC_ADB_SILENT);
+    assert(res == SC_ADB_CLIENT_ERROR);
+
+    join_fake_adb_server(&server);
+}
+
+static void handle_shell(sc_socket socket) {
+    expect_request(socket, "host:transport:0123456789abcdef");
+    send_okay(socket);
+    expect_request(socket, "shell:getprop ro.build.version.sdk");
+    send_okay(socket);
+    // Raw output until the connection is closed
+    send_str(socket, "34\n");
+}
+
+static void test_shell(void) {
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_shell);
+
+    char buf[16];
+    size_t len;
+    enum sc_adb_client_result res =
+        sc_adb_client_shell(NULL, "0123456789abcdef",
+                            "getprop ro.build.version.sdk", buf, sizeof(buf),
+                            &len, 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(len == 3);
+    assert(!memcmp(buf, "34\n", 3));
+
+    join_fake_adb_server(&server);
+}
+
+static void handle_stat(sc_socket socket) {
+    expect_request(socket, "host:transport:0123456789abcdef");
+    send_okay(socket);
+    expect_request(socket, "sync:");
+    send_okay(socket);
+
+    uint32_t len;
+    expect_sync_header(socket, "STAT", &len);
+    char path[256];
+    assert(len < sizeof(path));
+    read_exactly(socket, path, len);
+    assert(!memcmp(path, "/data/local/tmp/file.jar", len));
+
+    uint8_t stat[16] = {0};
+    memcpy(stat, "STAT", 4);
+    sc_write32le(&stat[4], 0100644); // mode
+    sc_write32le(&stat[8], 12345); // size
+    ssize_t w = net_send_all(socket, stat, sizeof(stat));
+    assert(w == sizeof(stat));
+    (void) w;
+
+    expect_sync_header(socket, "QUIT", &len);
+}
+
+static void test_stat(void) {
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_stat);
+
+    uint32_t mode;
+    uint32_t size;
+    enum sc_adb_client_result res =
+        sc_adb_client_stat(NULL, "0123456789abcdef", "/data/local/tmp/file.jar",
+                           &mode, &size, 0);
+    assert(res == SC_ADB_CLIENT_OK);
+    assert(mode == 0100644);
+    assert(size == 12345);
+
+    join_fake_adb_server(&server);
+}
+
+#define PUSH_CONTENT_SIZE (150 * 1024)
+
+static void handle_push(sc_socket socket) {
+    expect_request(socket, "host:transport:0123456789abcdef");
+    send_okay(socket);
+    expect_request(socket, "sync:");
+    send_okay(socket);
+
+    // The target is a directory
+    uint32_t len;
+    expect_sync_header(socket, "STAT", &len);
+    char path[256];
+    assert(len < sizeof(path));
+    read_exactly(socket, path, len);
+    assert(!memcmp(path, "/data/local/tmp", len));
+    uint8_t stat[16] = {0};
+    memcpy(stat, "STAT", 4);
+    sc_write32le(&stat[4], 0040755); // mode
+    ssize_t w = net_send_all(socket, stat, sizeof(stat));
+    assert(w == sizeof(stat));
+    (void) w;
+
+    expect_sync_header(socket, "SEND", &len);
+    const char *spec = "/data/local/tmp/" TEST_LOCAL_FILE ",33188";
+    assert(len == strlen(spec));
+    read_exactly(socket, path, len);
+    assert(!memcmp(path, spec, len));
+
+    size_t total = 0;
+    uint8_t *chunk = malloc(64 * 1024);
+    assert(chunk);
+    for (;;) {
+        uint8_t header[8];
+        read_exactly(socket, header, 8);
+        uint32_t value = sc_read32le(&header[4]);
+        if (!memcmp(header, "DONE", 4)) {
+            break;
+        }
+
+        assert(!memcmp(header, "DATA", 4));
+        assert(value <= 64 * 1024);
+        read_exactly(socket, chunk, value);
+        for (uint32_t i = 0; i < value; ++i) {
+            assert(chunk[i] == (uint8_t) (total + i));
+        }
+        total += value;
+    }
+    free(chunk);
+    assert(total == PUSH_CONTENT_SIZE);
+
+    send_sync_header(socket, "OKAY", 0);
+    expect_sync_header(socket, "QUIT", &len);
+}
+
+static void test_push(void) {
+    FILE *file = fopen(TEST_LOCAL_FILE, "wb");
+    assert(file);
+    for (size_t i = 0; i < PUSH_CONTENT_SIZE; ++i) {
+        fputc((uint8_t) i, file);
+    }
+    fclose(file);
+
+    struct fake_adb_server server;
+    start_fake_adb_server(&server, handle_push);
+
+    enum sc_adb_client_result res =
+        sc_adb_client_push(NULL, "0123456789abcdef", TEST_LOCAL_FILE,
+                           "/data/local/tmp", 0);
+    assert(res == SC_ADB_CLIENT_OK);
+
+    join_fake_adb_server(&server);
+
+    remove(TEST_LOCAL_FILE);
+}
+
+static void test_server_unavailable(void) {
+    net_close(fake_server_socket);
+    fake_server_socket = SC_SOCKET_NONE;
+
+    // The caller must fall back to the adb executable
+    enum sc_adb_client_result res = sc_adb_client_ping(NULL);
+    assert(res == SC_ADB_CLIENT_UNSUPPORTED);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    fake_server_socket = net_socket();
+    assert(fake_server_socket != SC_SOCKET_NONE);
+
+    // Find an available port for the fake adb server
+    uint16_t port;
+    for (port = 15037; port < 15137; ++port) {
+        if (net_listen(fake_server_socket, IPV4_LOCALHOST, port, 1)) {
+            break;
+        }
+    }
+    assert(port < 15137);
+
+    char value[6];
+    snprintf(value, sizeof(value), "%" PRIu16, port);
+    setenv("ANDROID_ADB_SERVER_PORT", value, 1);
+
+    ok = sc_adb_client_init();
+    assert(ok);
+
+    test_list_devices();
+    test_forward();
+    test_reverse_failure();
+    test_shell();
+    test_stat();
+    test_push();
+    test_server_unavailable();
+
+    net_cleanup();
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "audio_adapter.h"
+
+#define SAMPLE_RATE 48000
+#define MIN_TARGET (SC_AUDIO_ADAPTER_MIN_TARGET_MS * SAMPLE_RATE / 1000)
+#define MAX_TARGET (SC_AUDIO_ADAPTER_MAX_TARGET_MS * SAMPLE_RATE / 1000)
+
+// Simulate periods without underflow, with the buffering level never going
+// below min_buffering, and return the target after the last one
+static uint32_t
+run_stable_periods(struct sc_audio_adapter *adapter, unsigned periods,
+                   uint32_t min_buffering) {
+    uint32_t target = adapter->target;
+    for (unsigned i = 0; i < periods; ++i) {
+        sc_audio_adapter_observe(adapter, min_buffering + 1000);
+        sc_audio_adapter_observe(adapter, min_buffering);
+        target = sc_audio_adapter_update(adapter, 0);
+    }
+    return target;
+}
+
+static void test_init_clamp(void) {
+    struct sc_audio_adapter adapter;
+
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 2400);
+    assert(adapter.target == 2400);
+    assert(adapter.min_target == 480);
+    assert(adapter.max_target == 24000);
+
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 100);
+    assert(adapter.target == MIN_TARGET);
+
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 100000);
+    assert(adapter.target == MAX_TARGET);
+}
+
+static void test_underflow_raises(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    // A small underflow raises by at least 10%
+    uint32_t target = sc_audio_adapter_update(&adapter, 100);
+    assert(target == 5280);
+
+    // A large underflow raises by at most 50%
+    target = sc_audio_adapter_update(&adapter, 10000);
+    assert(target == 7920);
+
+    // Otherwise, by the missing samples
+    target = sc_audio_adapter_update(&adapter, 1000);
+    assert(target == 8920);
+    assert(adapter.target == target);
+}
+
+static void test_underflow_clamp_max(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 20000);
+
+    uint32_t target = sc_audio_adapter_update(&adapter, 8000);
+    assert(target == MAX_TARGET);
+
+    // Repeated underflows never exceed the upper bound
+    for (int i = 0; i < 10; ++i) {
+        target = sc_audio_adapter_update(&adapter, 100000);
+        assert(target == MAX_TARGET);
+    }
+}
+
+static void test_stable_lowers(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    // Not lowered before enough stable periods
+    uint32_t target =
+        run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS - 1,
+                           4000);
+    assert(target == 4800);
+
+    // The jitter is 800 samples, so 1200 would be enough, but the target is
+    // lowered by at most 10% at a time
+    target = run_stable_periods(&adapter, 1, 4000);
+    assert(target == 4320);
+
+    // The stable period count restarts after an adjustment
+    target = run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS - 1,
+                                4000);
+    assert(target == 4320);
+}
+
+static void test_overflow_lowers(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    // The buffering level always stayed above the target
+    uint32_t target =
+        run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS, 6000);
+    assert(target == 4320);
+}
+
+static void test_large_jitter_keeps_target(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    // The buffer almost ran out: the whole target is needed
+    uint32_t target =
+        run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS, 100);
+    assert(target == 4800);
+}
+
+static void test_stable_clamp_min(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 500);
+
+    uint32_t target =
+        run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS, 1000);
+    assert(target == MIN_TARGET);
+
+    // Never lowered below the lower bound
+    target = run_stable_periods(&adapter,
+                                10 * SC_AUDIO_ADAPTER_STABLE_PERIODS, 1000);
+    assert(target == MIN_TARGET);
+}
+
+static void test_underflow_resets_stable_periods(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS - 1, 4000);
+    uint32_t target = sc_audio_adapter_update(&adapter, 100);
+    assert(target == 5280);
+
+    // The previous stable periods are not taken into account anymore
+    target = run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS - 1,
+                                4000);
+    assert(target == 5280);
+    target = run_stable_periods(&adapter, 1, 4000);
+    assert(target == 4752);
+}
+
+static void test_reset(void) {
+    struct sc_audio_adapter adapter;
+    sc_audio_adapter_init(&adapter, SAMPLE_RATE, 4800);
+
+    // A low buffering level observed before a reset is forgotten
+    sc_audio_adapter_observe(&adapter, 0);
+    sc_audio_adapter_reset(&adapter);
+
+    uint32_t target =
+        run_stable_periods(&adapter, SC_AUDIO_ADAPTER_STABLE_PERIODS, 6000);
+    assert(target == 4320);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_init_clamp();
+    test_underflow_raises();
+    test_underflow_clamp_max();
+    test_stable_lowers();
+    test_overflow_lowers();
+    test_large_jitter_keeps_target();
+    test_stable_clamp_min();
+    test_underflow_resets_stable_periods();
+    test_reset();
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "util/audiobuf.h"
+#include "util/thread.h"
 
 static void test_audiobuf_simple(void) {
     struct sc_audiobuf buf;
@@ -124,6 +125,106 @@ static void test_audiobuf_partial_read_write(void) {
     sc_audiobuf_destroy(&buf);
 }
 
+static void test_audiobuf_drop(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[10];
+
+    bool ok = sc_audiobuf_init(&buf, 4, 10);
+    assert(ok);
+
+    uint32_t samples[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint32_t w = sc_audiobuf_write(&buf, samples, 10);
+    assert(w == 10);
+
+    uint32_t d = sc_audiobuf_drop(&buf, 3);
+    assert(d == 3);
+
+    uint32_t more[] = {11, 12, 13};
+    w = sc_audiobuf_write(&buf, more, 3);
+    assert(w == 3);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 10);
+    assert(r == 10);
+    uint32_t expected[] = {4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+    assert(!memcmp(data, expected, 40));
+
+    // Cannot drop more than available
+    w = sc_audiobuf_write(&buf, samples, 2);
+    assert(w == 2);
+    d = sc_audiobuf_drop(&buf, 5);
+    assert(d == 2);
+    assert(!sc_audiobuf_can_read(&buf));
+
+    sc_audiobuf_destroy(&buf);
+}
+
+// Each sample contains a sequence number and its complement, to detect torn
+// samples
+struct test_sample {
+    uint32_t seq;
+    uint32_t check;
+};
+
+#define STRESS_SAMPLES 2000000
+#define STRESS_CAPACITY 256
+
+static int run_stress_writer(void *userdata) {
+    struct sc_audiobuf *buf = userdata;
+
+    struct test_sample chunk[97];
+    uint32_t seq = 0;
+    while (seq < STRESS_SAMPLES) {
+        // Variable chunk sizes, to write at any position in the ring buffer
+        uint32_t count = MIN(seq % 97 + 1, STRESS_SAMPLES - seq);
+        for (uint32_t i = 0; i < count; ++i) {
+            chunk[i].seq = seq + i;
+            chunk[i].check = ~(seq + i);
+        }
+
+        // Same strategy as the audio regulator: drop the oldest samples if
+        // the buffer is full
+        uint32_t w = sc_audiobuf_write(buf, chunk, count);
+        if (w < count) {
+            sc_audiobuf_drop(buf, count - w);
+            uint32_t w2 = sc_audiobuf_write(buf, &chunk[w], count - w);
+            assert(w2 == count - w);
+            (void) w2;
+        }
+
+        seq += count;
+    }
+
+    return 0;
+}
+
+static void test_audiobuf_concurrent_drop(void) {
+    struct sc_audiobuf buf;
+    bool ok = sc_audiobuf_init(&buf, sizeof(struct test_sample),
+                               STRESS_CAPACITY);
+    assert(ok);
+
+    sc_thread thread;
+    ok = sc_thread_create(&thread, run_stress_writer, "test-writer", &buf);
+    assert(ok);
+
+    struct test_sample chunk[61];
+    uint32_t count = 1;
+    int64_t last = -1;
+    while (last != STRESS_SAMPLES - 1) {
+        uint32_t r = sc_audiobuf_read(&buf, chunk, count);
+        for (uint32_t i = 0; i < r; ++i) {
+            // Never torn, never reordered (but some samples may be dropped)
+            assert(chunk[i].check == ~chunk[i].seq);
+            assert((int64_t) chunk[i].seq > last);
+            last = chunk[i].seq;
+        }
+        count = count % ARRAY_LEN(chunk) + 1;
+    }
+
+    sc_thread_join(&thread, NULL);
+    sc_audiobuf_destroy(&buf);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -131,6 +232,8 @@ int main(int argc, char *argv[]) {
     test_audiobuf_simple();
     test_audiobuf_boundaries();
     test_audiobuf_partial_read_write();
+    test_audiobuf_drop();
+    test_audiobuf_concurrent_drop();
 
     return 0;
 }
@@ -0,0 +1,116 @@
+#include "common.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/audioconv.h"
+#include "util/tick.h"
+
+// Large enough to test both the vectorized loops and the remaining samples
+#define TEST_SAMPLES 1027
+
+static void test_s16_to_f32(void) {
+    int16_t src[TEST_SAMPLES];
+    for (int i = 0; i < TEST_SAMPLES; ++i) {
+        src[i] = (int16_t) (i * 64 - 32768);
+    }
+    src[0] = INT16_MIN;
+    src[1] = INT16_MAX;
+    src[2] = 0;
+    src[3] = -1;
+
+    // Test all offsets, so that every sample goes through every lane, and all
+    // possible tail lengths are tested
+    for (int offset = 0; offset < 8; ++offset) {
+        float dst[TEST_SAMPLES + 1];
+        size_t count = TEST_SAMPLES - offset;
+        dst[count] = 42; // guard
+        sc_audioconv_s16_to_f32(dst, &src[offset], count);
+
+        for (size_t i = 0; i < count; ++i) {
+            // Bit-exact with libswresample
+            float expected = src[offset + i] * (1.0f / (1 << 15));
+            assert(!memcmp(&dst[i], &expected, sizeof(float)));
+        }
+        assert(dst[count] == 42);
+    }
+
+    float dst[2];
+    sc_audioconv_s16_to_f32(dst, src, 2);
+    assert(dst[0] == -1.0f);
+    assert(dst[1] == 32767.0f / 32768.0f);
+}
+
+static void test_interleave_f32(void) {
+    float l[TEST_SAMPLES];
+    float r[TEST_SAMPLES];
+    float c[TEST_SAMPLES];
+    for (int i = 0; i < TEST_SAMPLES; ++i) {
+        l[i] = i;
+        r[i] = -i;
+        c[i] = i + 0.5f;
+    }
+
+    for (unsigned channels = 1; channels <= 3; ++channels) {
+        for (int offset = 0; offset < 4; ++offset) {
+            const float *planes[] = {&l[offset], &r[offset], &c[offset]};
+            size_t samples = TEST_SAMPLES - offset;
+
+            float dst[3 * TEST_SAMPLES + 1];
+            dst[samples * channels] = 42; // guard
+            sc_audioconv_interleave_f32(dst, planes, channels, samples);
+
+            for (size_t i = 0; i < samples; ++i) {
+                for (unsigned ch = 0; ch < channels; ++ch) {
+                    assert(dst[i * channels + ch] == planes[ch][i]);
+                }
+            }
+            assert(dst[samples * channels] == 42);
+        }
+    }
+}
+
+// Run with --bench to measure the conversion throughput
+static void bench(void) {
+#define BENCH_SAMPLES 960 // 20ms at 48kHz
+#define BENCH_ITERATIONS 200000
+    static int16_t src[2 * BENCH_SAMPLES];
+    static float l[BENCH_SAMPLES];
+    static float r[BENCH_SAMPLES];
+    static float dst[2 * BENCH_SAMPLES];
+    for (int i = 0; i < 2 * BENCH_SAMPLES; ++i) {
+        src[i] = i;
+    }
+    const float *planes[] = {l, r};
+
+    sc_tick start = sc_tick_now();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        sc_audioconv_s16_to_f32(dst, src, 2 * BENCH_SAMPLES);
+    }
+    sc_tick s16_duration = sc_tick_now() - start;
+
+    start = sc_tick_now();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        sc_audioconv_interleave_f32(dst, planes, 2, BENCH_SAMPLES);
+    }
+    sc_tick fltp_duration = sc_tick_now() - start;
+
+    printf("s16 -> f32:  %" PRIi64 " ns per 20ms stereo packet\n",
+           s16_duration * 1000 / BENCH_ITERATIONS);
+    printf("fltp -> f32: %" PRIi64 " ns per 20ms stereo packet\n",
+           fltp_duration * 1000 / BENCH_ITERATIONS);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        bench();
+        return 0;
+    }
+
+    test_s16_to_f32();
+    test_interleave_f32();
+
+    return 0;
+}
@@ -96,6 +96,14 @@ static void test_read32be(void) {
     assert(val == 0xABCD1234);
 }
 
+static void test_read32le(void) {
+    uint8_t buf[4] = {0x34, 0x12, 0xCD, 0xAB};
+
+    uint32_t val = sc_read32le(buf);
+
+    assert(val == 0xABCD1234);
+}
+
 static void test_read64be(void) {
     uint8_t buf[8] = {0xAB, 0xCD, 0x12, 0x34,
                       0x56, 0x78, 0x90, 0xEF};
@@ -144,6 +152,7 @@ int main(int argc, char *argv[]) {
     test_write64be();
     test_read16be();
     test_read32be();
+    test_read32le();
     test_read64be();
 
     test_write16le();
@@ -121,6 +121,147 @@ static void test_options2(void) {
     assert(opts->record_format == SC_RECORD_FORMAT_MP4);
 }
 
+static void test_audio_buffer_auto(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--audio-buffer=auto"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+
+    const struct scrcpy_options *opts = &args.opts;
+    assert(opts->audio_buffer_auto);
+    // The initial value is the default one
+    assert(opts->audio_buffer == SC_TICK_FROM_MS(50));
+}
+
+static void test_multi_device(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--multi-device=abc,def",
+                    "--multi-device-jobs=8"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(!strcmp(args.opts.multi_device, "abc,def"));
+    assert(args.opts.multi_device_jobs == 8);
+
+    // Without serials, all the devices are mirrored
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--multi-device"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(ok);
+    assert(!strcmp(args.opts.multi_device, ""));
+
+    // The devices are selected by --multi-device
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--multi-device", "-s", "abc"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
+static void test_resume_timeout(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--resume-timeout=30"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.resume_timeout == SC_TICK_FROM_SEC(30));
+
+    // The dump would contain several streams
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--resume-timeout=30", "--stream-dump=dump"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_socket_buffers(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--socket-buffers=video=8M,control=64K"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.socket_buffers.video == 8000000);
+    assert(args.opts.socket_buffers.audio == 0);
+    assert(args.opts.socket_buffers.control == 64000);
+
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--socket-buffers=subtitles=1M"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+}
+
+static void test_video_scale_filter(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--video-scale-filter=lanczos",
+                    "--video-sharpen=0.3"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.video_scale_filter == SC_VIDEO_SCALE_FILTER_LANCZOS);
+    assert(!strcmp(args.opts.video_sharpen, "0.3"));
+
+    // The filter chain is only available for display mirroring
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--video-source=camera", "--no-audio",
+                     "--video-scale-filter=lanczos"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--video-scale-filter=bicubic"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
+static void test_video_simulcast(void) {
+    struct scrcpy_cli_args args = {
+        .opts = scrcpy_options_default,
+        .help = false,
+        .version = false,
+    };
+
+    char *argv[] = {"scrcpy", "--video-simulcast=640"};
+
+    bool ok = scrcpy_parse_args(&args, ARRAY_LEN(argv), argv);
+    assert(ok);
+    assert(args.opts.video_simulcast == 640);
+
+    // The stream is selected from the window focus, via the control channel
+    args.opts = scrcpy_options_default;
+    char *argv2[] = {"scrcpy", "--video-simulcast=640", "--no-control"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv2), argv2);
+    assert(!ok);
+
+    args.opts = scrcpy_options_default;
+    char *argv3[] = {"scrcpy", "--video-simulcast=640", "--video-dirty-rects"};
+    ok = scrcpy_parse_args(&args, ARRAY_LEN(argv3), argv3);
+    assert(!ok);
+}
+
 static void test_parse_shortcut_mods(void) {
     uint8_t mods;
     bool ok;
@@ -157,6 +298,12 @@ int main(int argc, char *argv[]) {
     test_flag_help();
     test_options();
     test_options2();
+    test_audio_buffer_auto();
+    test_multi_device();
+    test_resume_timeout();
+    test_socket_buffers();
+    test_video_scale_filter();
+    test_video_simulcast();
     test_parse_shortcut_mods();
     return 0;
 }
@@ -0,0 +1,114 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "dirty_rects.h"
+
+static void test_parse(void) {
+    const uint8_t data[] = {
+        0x00, 0x10, 0x00, 0x20, 0x01, 0x00, 0x00, 0x80, // 16,32 256x128
+        0x04, 0x38, 0x07, 0x80, 0x00, 0x02, 0x00, 0x04, // 1080,1920 2x4
+    };
+
+    struct sc_dirty_rects drs;
+    bool ok = sc_dirty_rects_parse(&drs, data, 2);
+    assert(ok);
+    assert(drs.count == 2);
+
+    assert(drs.rects[0].x == 16);
+    assert(drs.rects[0].y == 32);
+    assert(drs.rects[0].width == 256);
+    assert(drs.rects[0].height == 128);
+
+    assert(drs.rects[1].x == 1080);
+    assert(drs.rects[1].y == 1920);
+    assert(drs.rects[1].width == 2);
+    assert(drs.rects[1].height == 4);
+}
+
+static void test_parse_empty(void) {
+    struct sc_dirty_rects drs;
+    bool ok = sc_dirty_rects_parse(&drs, NULL, 0);
+    assert(ok);
+    assert(drs.count == 0);
+}
+
+static void test_parse_too_many(void) {
+    uint8_t data[(SC_DIRTY_RECTS_MAX + 1) * SC_DIRTY_RECT_SERIALIZED_SIZE] =
+        {0};
+
+    struct sc_dirty_rects drs;
+    bool ok = sc_dirty_rects_parse(&drs, data, SC_DIRTY_RECTS_MAX);
+    assert(ok);
+    assert(drs.count == SC_DIRTY_RECTS_MAX);
+
+    ok = sc_dirty_rects_parse(&drs, data, SC_DIRTY_RECTS_MAX + 1);
+    assert(!ok);
+}
+
+static void test_align(void) {
+    struct sc_size frame_size = {1080, 1920};
+    struct sc_dirty_rect rect = {.x = 15, .y = 33, .width = 100, .height = 50};
+    struct sc_dirty_rect out;
+
+    bool ok = sc_dirty_rect_align(&rect, frame_size, &out);
+    assert(ok);
+    assert(out.x == 14);
+    assert(out.y == 32);
+    assert(out.width == 102); // [14, 116)
+    assert(out.height == 52); // [32, 84)
+}
+
+static void test_align_clip(void) {
+    struct sc_size frame_size = {1080, 1920};
+    struct sc_dirty_rect rect = {.x = 1000, .y = 1900, .width = 200,
+                                 .height = 200};
+    struct sc_dirty_rect out;
+
+    bool ok = sc_dirty_rect_align(&rect, frame_size, &out);
+    assert(ok);
+    assert(out.x == 1000);
+    assert(out.y == 1900);
+    assert(out.width == 80);
+    assert(out.height == 20);
+
+    // Outside the frame
+    rect.x = 1080;
+    ok = sc_dirty_rect_align(&rect, frame_size, &out);
+    assert(!ok);
+
+    // Empty
+    rect.x = 10;
+    rect.width = 0;
+    ok = sc_dirty_rect_align(&rect, frame_size, &out);
+    assert(!ok);
+}
+
+static void test_align_odd_frame_size(void) {
+    struct sc_size frame_size = {1081, 1921};
+    struct sc_dirty_rect rect = {.x = 1079, .y = 1919, .width = 2,
+                                 .height = 2};
+    struct sc_dirty_rect out;
+
+    bool ok = sc_dirty_rect_align(&rect, frame_size, &out);
+    assert(ok);
+    assert(out.x == 1078);
+    assert(out.y == 1918);
+    assert(out.width == 3);
+    assert(out.height == 3);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_parse();
+    test_parse_empty();
+    test_parse_too_many();
+    test_align();
+    test_align_clip();
+    test_align_odd_frame_size();
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+
+static void test_metrics_values(void) {
+    sc_metrics_add(SC_METRIC_VIDEO_PACKETS, 1);
+    sc_metrics_add(SC_METRIC_VIDEO_PACKETS, 1);
+    sc_metrics_add(SC_METRIC_VIDEO_BYTES, 1000);
+    sc_metrics_set(SC_METRIC_AUDIO_COMPENSATION, -42);
+
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_snapshot(&snapshot);
+
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKETS] == 2);
+    assert(snapshot.values[SC_METRIC_VIDEO_BYTES] == 1000);
+    assert(snapshot.values[SC_METRIC_AUDIO_PACKETS] == 0);
+    assert(snapshot.values[SC_METRIC_AUDIO_COMPENSATION] == -42);
+}
+
+static void test_metrics_latency_percentiles(void) {
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.latency_count == 0);
+    assert(sc_metrics_snapshot_latency_percentile(&snapshot, 50) == -1);
+
+    // 90 values in (4ms, 5ms], 10 values in (40ms, 50ms]
+    for (int i = 0; i < 90; ++i) {
+        sc_metrics_record_decode_latency(SC_TICK_FROM_US(4500));
+    }
+    for (int i = 0; i < 10; ++i) {
+        sc_metrics_record_decode_latency(SC_TICK_FROM_MS(45));
+    }
+
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.latency_count == 100);
+    assert(snapshot.latency_sum == 90 * 4500 + 10 * 45000);
+
+    sc_tick p50 = sc_metrics_snapshot_latency_percentile(&snapshot, 50);
+    assert(p50 > SC_TICK_FROM_MS(4) && p50 <= SC_TICK_FROM_MS(5));
+
+    sc_tick p90 = sc_metrics_snapshot_latency_percentile(&snapshot, 90);
+    assert(p90 == SC_TICK_FROM_MS(5));
+
+    sc_tick p99 = sc_metrics_snapshot_latency_percentile(&snapshot, 99);
+    assert(p99 > SC_TICK_FROM_MS(40) && p99 <= SC_TICK_FROM_MS(50));
+
+    // A value beyond the last bound
+    sc_metrics_record_decode_latency(SC_TICK_FROM_SEC(3));
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.latency_buckets[SC_METRICS_LATENCY_BUCKETS - 2] == 100);
+    assert(snapshot.latency_buckets[SC_METRICS_LATENCY_BUCKETS - 1] == 101);
+}
+
+static void test_metrics_packet_size_stats(void) {
+    struct sc_packet_size_stats stats;
+    sc_packet_size_stats_init(&stats);
+
+    static const int64_t sizes[] = {2000, 4000, 4000, 4000, 5000, 5000, 7000};
+    for (unsigned i = 0; i < ARRAY_LEN(sizes); ++i) {
+        sc_metrics_record_video_packet_size(&stats, sizes[i],
+                                            SC_TICK_FROM_SEC(1 + i));
+    }
+
+    // The window is not complete, nothing is published
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKET_SIZE_STDDEV] == 0);
+
+    // The last packet of the window
+    sc_metrics_record_video_packet_size(&stats, 9000, SC_TICK_FROM_SEC(11));
+
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKET_SIZE_MEAN] == 5000);
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKET_SIZE_STDDEV] == 2000);
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKET_SIZE_MAX] == 9000);
+
+    // A new window is started
+    assert(stats.count == 0);
+    sc_metrics_record_video_packet_size(&stats, 100000, SC_TICK_FROM_SEC(12));
+    sc_metrics_snapshot(&snapshot);
+    assert(snapshot.values[SC_METRIC_VIDEO_PACKET_SIZE_MAX] == 9000);
+}
+
+static void test_metrics_format(void) {
+    struct sc_metrics_snapshot snapshot;
+    sc_metrics_snapshot(&snapshot);
+
+    struct sc_strbuf buf;
+    bool ok = sc_strbuf_init(&buf, 64);
+    assert(ok);
+
+    ok = sc_metrics_format_prometheus(&snapshot, &buf);
+    assert(ok);
+    assert(strstr(buf.s, "# TYPE scrcpy_demuxer_packets_total counter\n"));
+    assert(strstr(buf.s, "scrcpy_demuxer_packets_total{stream=\"video\"} 2\n"));
+    assert(strstr(buf.s, "scrcpy_demuxer_packets_total{stream=\"audio\"} 0\n"));
+    assert(strstr(buf.s, "scrcpy_audio_compensation_samples -42\n"));
+    assert(strstr(buf.s,
+                  "scrcpy_video_decode_latency_seconds_bucket{le=\"0.005\"} 90\n"));
+    assert(strstr(buf.s,
+                  "scrcpy_video_decode_latency_seconds_bucket{le=\"+Inf\"} 101\n"));
+    assert(strstr(buf.s, "scrcpy_video_decode_latency_seconds_count 101\n"));
+    // Each family is described only once
+    const char *help = "# HELP scrcpy_demuxer_packets_total ";
+    const char *first = strstr(buf.s, help);
+    assert(first);
+    assert(!strstr(first + 1, help));
+
+    buf.len = 0;
+    ok = sc_metrics_format_json(&snapshot, &buf);
+    assert(ok);
+    assert(buf.s[0] == '{');
+    assert(strstr(buf.s, "\"video_packets\":2,"));
+    assert(strstr(buf.s, "\"audio_compensation\":-42,"));
+    assert(strstr(buf.s, "\"video_decode_latency_us\":{\"count\":101,"));
+    assert(!strcmp(&buf.s[buf.len - 3], "}}\n"));
+
+    free(buf.s);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_metrics_values();
+    test_metrics_latency_percentiles();
+    test_metrics_format();
+    test_metrics_packet_size_stats();
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "packet_header.h"
+
+struct buffer_reader {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+};
+
+static ssize_t
+buffer_reader_recv_all(void *userdata, void *buf, size_t len) {
+    struct buffer_reader *reader = userdata;
+    size_t remaining = reader->len - reader->pos;
+    if (len > remaining) {
+        len = remaining;
+    }
+    memcpy(buf, &reader->data[reader->pos], len);
+    reader->pos += len;
+    return len;
+}
+
+static void test_parse_media_packet(void) {
+    const uint8_t data[] = {
+        0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, // PTS
+        0x00, 0x00, 0x01, 0x00, // len
+    };
+
+    struct sc_packet_header header;
+    sc_packet_header_parse(data, &header);
+    assert(header.pts == UINT64_C(0x0102030405));
+    assert(header.len == 256);
+    assert(!header.config);
+    assert(!header.key_frame);
+    assert(!header.dirty_rects);
+}
+
+static void test_parse_flags(void) {
+    const uint8_t data[] = {
+        0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // config, key, dirty
+        0x00, 0x00, 0x00, 0x08, // len
+    };
+
+    struct sc_packet_header header;
+    sc_packet_header_parse(data, &header);
+    assert(header.config);
+    assert(header.key_frame);
+    assert(header.dirty_rects);
+    assert(header.pts == 0);
+    assert(header.len == 8);
+}
+
+static void test_parse_dirty_rects_flag_only(void) {
+    // The dirty rects flag must not leak into the PTS
+    const uint8_t data[] = {
+        0x1F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0x00, 0x00, 0x00, 0x01,
+    };
+
+    struct sc_packet_header header;
+    sc_packet_header_parse(data, &header);
+    assert(header.dirty_rects);
+    assert(!header.config);
+    assert(!header.key_frame);
+    assert(header.pts == SC_PACKET_PTS_MASK);
+    assert(header.pts == (UINT64_C(1) << 60) - 1);
+}
+
+static void test_recv_dirty_rects(void) {
+    const uint8_t data[] = {
+        0x00, 0x02, // count
+        0x00, 0x10, 0x00, 0x20, 0x01, 0x00, 0x00, 0x80, // 16,32 256x128
+        0x04, 0x38, 0x07, 0x80, 0x00, 0x02, 0x00, 0x04, // 1080,1920 2x4
+        0xAB, // raw packet
+    };
+    struct buffer_reader reader = {data, sizeof(data), 0};
+
+    struct sc_dirty_rects drs;
+    bool eos;
+    bool ok = sc_packet_header_recv_dirty_rects(buffer_reader_recv_all,
+                                                &reader, &drs, &eos);
+    assert(ok);
+    assert(!eos);
+    assert(drs.count == 2);
+    assert(drs.rects[0].x == 16);
+    assert(drs.rects[0].height == 128);
+    assert(drs.rects[1].y == 1920);
+    assert(drs.rects[1].width == 2);
+
+    // The raw packet is not consumed
+    assert(reader.pos == sizeof(data) - 1);
+}
+
+static void test_recv_dirty_rects_empty(void) {
+    const uint8_t data[] = {0x00, 0x00};
+    struct buffer_reader reader = {data, sizeof(data), 0};
+
+    struct sc_dirty_rects drs;
+    bool eos;
+    bool ok = sc_packet_header_recv_dirty_rects(buffer_reader_recv_all,
+                                                &reader, &drs, &eos);
+    assert(ok);
+    assert(drs.count == 0);
+}
+
+static void test_recv_dirty_rects_too_many(void) {
+    uint8_t data[2 + (SC_DIRTY_RECTS_MAX + 1) * SC_DIRTY_RECT_SERIALIZED_SIZE]
+        = {0x00, SC_DIRTY_RECTS_MAX + 1};
+    struct buffer_reader reader = {data, sizeof(data), 0};
+
+    struct sc_dirty_rects drs;
+    bool eos;
+    bool ok = sc_packet_header_recv_dirty_rects(buffer_reader_recv_all,
+                                                &reader, &drs, &eos);
+    assert(!ok);
+    assert(!eos); // invalid stream, not the end of the stream
+}
+
+static void test_recv_dirty_rects_truncated(void) {
+    const uint8_t data[] = {
+        0x00, 0x02, // count
+        0x00, 0x10, 0x00, 0x20, 0x01, 0x00, 0x00, 0x80,
+        0x04, 0x38, 0x07, // truncated
+    };
+    struct buffer_reader reader = {data, sizeof(data), 0};
+
+    struct sc_dirty_rects drs;
+    bool eos;
+    bool ok = sc_packet_header_recv_dirty_rects(buffer_reader_recv_all,
+                                                &reader, &drs, &eos);
+    assert(!ok);
+    assert(eos);
+
+    // Truncated count
+    reader.len = 1;
+    reader.pos = 0;
+    ok = sc_packet_header_recv_dirty_rects(buffer_reader_recv_all, &reader,
+                                           &drs, &eos);
+    assert(!ok);
+    assert(eos);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_parse_media_packet();
+    test_parse_flags();
+    test_parse_dirty_rects_flag_only();
+    test_recv_dirty_rects();
+    test_recv_dirty_rects_empty();
+    test_recv_dirty_rects_too_many();
+    test_recv_dirty_rects_truncated();
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "startup.h"
+
+static void test_startup_mark_once(void) {
+    sc_startup_init(NULL);
+
+    assert(sc_startup_get(SC_STARTUP_PHASE_DEVICE_SELECTED) == -1);
+
+    sc_startup_mark(SC_STARTUP_PHASE_DEVICE_SELECTED);
+    sc_tick t = sc_startup_get(SC_STARTUP_PHASE_DEVICE_SELECTED);
+    assert(t > 0);
+
+    // Only the first mark is taken into account
+    sc_startup_mark(SC_STARTUP_PHASE_DEVICE_SELECTED);
+    assert(sc_startup_get(SC_STARTUP_PHASE_DEVICE_SELECTED) == t);
+
+    assert(sc_startup_get(SC_STARTUP_PHASE_ADB_SERVER_STARTED) == -1);
+    assert(!strcmp(sc_startup_phase_name(SC_STARTUP_PHASE_DEVICE_SELECTED),
+                   "device_selected"));
+}
+
+static void test_startup_format_json(void) {
+    sc_startup_init(NULL);
+
+    struct sc_strbuf buf;
+    bool ok = sc_strbuf_init(&buf, 64);
+    assert(ok);
+
+    ok = sc_startup_format_json(&buf);
+    assert(ok);
+    assert(!strcmp(buf.s, "{\"phases\":[]}\n"));
+
+    sc_startup_mark(SC_STARTUP_PHASE_ADB_SERVER_STARTED);
+    sc_startup_mark(SC_STARTUP_PHASE_SERVER_CONNECTED);
+
+    buf.len = 0;
+    ok = sc_startup_format_json(&buf);
+    assert(ok);
+    const char *prefix = "{\"phases\":[{\"name\":\"adb_server_started\","
+                         "\"time_us\":";
+    assert(!strncmp(buf.s, prefix, strlen(prefix)));
+    assert(strstr(buf.s, "},{\"name\":\"server_connected\",\"time_us\":"));
+    // The phases not reached are omitted
+    assert(!strstr(buf.s, "device_selected"));
+    assert(!strcmp(&buf.s[buf.len - 4], "}]}\n"));
+
+    free(buf.s);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_startup_mark_once();
+    test_startup_format_json();
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stream_dump.h"
+#include "stream_replay.h"
+
+#define TEST_FILENAME "test_stream_dump.scdump"
+
+static void test_stream_dump_replay(void) {
+    struct sc_stream_dump dump;
+    bool ok = sc_stream_dump_open(&dump, TEST_FILENAME);
+    assert(ok);
+
+    // Same calls as the demuxer: codec id, frame header and payload
+    const uint8_t codec_id[] = {'h', '2', '6', '4'};
+    const uint8_t header[] = {0, 0, 0, 0, 0, 0, 0, 42, 0, 0, 0, 5};
+    const uint8_t payload[] = {1, 2, 3, 4, 5};
+    sc_stream_dump_write(&dump, codec_id, sizeof(codec_id));
+    sc_stream_dump_write(&dump, header, sizeof(header));
+    sc_stream_dump_write(&dump, payload, sizeof(payload));
+    assert(!dump.failed);
+
+    sc_stream_dump_close(&dump);
+
+    struct sc_stream_replay replay;
+    ok = sc_stream_replay_init(&replay, TEST_FILENAME, 0);
+    assert(ok);
+
+    uint8_t data[16];
+    ssize_t r = sc_stream_replay_recv_all(&replay, data, 4);
+    assert(r == 4);
+    assert(!memcmp(data, codec_id, 4));
+
+    // Reads may span several records
+    r = sc_stream_replay_recv_all(&replay, data, 8);
+    assert(r == 8);
+    assert(!memcmp(data, header, 8));
+
+    r = sc_stream_replay_recv_all(&replay, data, 6);
+    assert(r == 6);
+    assert(!memcmp(data, &header[8], 4));
+    assert(!memcmp(&data[4], payload, 2));
+
+    // End-of-stream before the requested length
+    r = sc_stream_replay_recv_all(&replay, data, 16);
+    assert(r == 3);
+    assert(!memcmp(data, &payload[2], 3));
+
+    r = sc_stream_replay_recv_all(&replay, data, 16);
+    assert(r == 0);
+
+    sc_stream_replay_destroy(&replay);
+
+    remove(TEST_FILENAME);
+}
+
+static void test_stream_replay_interrupted(void) {
+    struct sc_stream_dump dump;
+    bool ok = sc_stream_dump_open(&dump, TEST_FILENAME);
+    assert(ok);
+
+    const uint8_t codec_id[] = {'o', 'p', 'u', 's'};
+    sc_stream_dump_write(&dump, codec_id, sizeof(codec_id));
+    sc_stream_dump_close(&dump);
+
+    struct sc_stream_replay replay;
+    ok = sc_stream_replay_init(&replay, TEST_FILENAME, 1);
+    assert(ok);
+
+    sc_stream_replay_interrupt(&replay);
+
+    uint8_t data[4];
+    ssize_t r = sc_stream_replay_recv_all(&replay, data, 4);
+    assert(r == -1);
+
+    sc_stream_replay_destroy(&replay);
+
+    remove(TEST_FILENAME);
+}
+
+static void test_stream_replay_invalid(void) {
+    FILE *file = fopen(TEST_FILENAME, "wb");
+    assert(file);
+    fputs("not a dump", file);
+    fclose(file);
+
+    struct sc_stream_replay replay;
+    bool ok = sc_stream_replay_init(&replay, TEST_FILENAME, 1);
+    assert(!ok);
+
+    remove(TEST_FILENAME);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_stream_dump_replay();
+    test_stream_replay_interrupted();
+    test_stream_replay_invalid();
+
+    return 0;
+}
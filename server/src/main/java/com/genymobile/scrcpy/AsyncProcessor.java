@@ -5,9 +5,11 @@ public interface AsyncProcessor {
         /**
          * Notify processor termination
          *
-         * @param fatalError {@code true} if this must cause the termination of the whole scrcpy-server.
+         * @param endSession {@code true} if this must end the client session (typically because the client disconnected)
+         * @param fatalError {@code true} if this must cause the termination of the whole scrcpy-server (even if it is kept running between
+         *                   sessions).
          */
-        void onTerminated(boolean fatalError);
+        void onTerminated(boolean endSession, boolean fatalError);
     }
 
     void start(TerminationListener listener);
@@ -14,6 +14,7 @@ import android.system.Os;
 import java.io.File;
 import java.io.IOException;
 import java.io.OutputStream;
+import java.util.regex.Pattern;
 
 /**
  * Handle the cleanup of scrcpy, even if the main process is killed.
@@ -22,6 +23,8 @@ import java.io.OutputStream;
  */
 public final class CleanUp {
 
+    private static final Pattern CACHED_SERVER_NAME_PATTERN = Pattern.compile("scrcpy-server-[0-9a-f]{16}\\.jar");
+
     // Dynamic options
     private static final int PENDING_CHANGE_DISPLAY_POWER = 1 << 0;
     private int pendingChanges;
@@ -174,12 +177,41 @@ public final class CleanUp {
 
     public static void unlinkSelf() {
         try {
-            new File(Server.SERVER_PATH).delete();
+            File serverFile = new File(Server.SERVER_PATH);
+            if (isCachedServerName(serverFile.getName())) {
+                // The client pushes the server to a path depending on its content, to avoid pushing it again on the next launch: keep it, but remove
+                // the other versions
+                removeStaleCachedServers(serverFile);
+            } else {
+                serverFile.delete();
+            }
         } catch (Exception e) {
             Ln.e("Could not unlink server", e);
         }
     }
 
+    static boolean isCachedServerName(String name) {
+        return CACHED_SERVER_NAME_PATTERN.matcher(name).matches();
+    }
+
+    private static void removeStaleCachedServers(File serverFile) {
+        File dir = serverFile.getParentFile();
+        if (dir == null) {
+            return;
+        }
+
+        File[] files = dir.listFiles();
+        if (files == null) {
+            return;
+        }
+
+        for (File file : files) {
+            if (isCachedServerName(file.getName()) && !file.equals(serverFile)) {
+                file.delete();
+            }
+        }
+    }
+
     @SuppressWarnings("deprecation")
     private static void prepareMainLooper() {
         Looper.prepareMainLooper();
@@ -11,6 +11,7 @@ import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.video.CameraAspectRatio;
 import com.genymobile.scrcpy.video.CameraFacing;
 import com.genymobile.scrcpy.video.VideoCodec;
+import com.genymobile.scrcpy.video.VideoScaleFilter;
 import com.genymobile.scrcpy.video.VideoSource;
 import com.genymobile.scrcpy.wrappers.WindowManager;
 
@@ -38,6 +39,20 @@ public class Options {
     private float maxFps;
     private float angle;
     private boolean tunnelForward;
+    private boolean multiplex;
+    private int directTcpPort; // connect without the adb tunnel if not 0
+    private byte[] directTcpToken;
+    private int videoSocketBuffer; // system default if 0
+    private int audioSocketBuffer;
+    private int controlSocketBuffer;
+    private boolean lowLatencySockets;
+    private boolean videoLowLatency;
+    private boolean skipUnchangedFrames;
+    private boolean videoDirtyRects;
+    private boolean videoDropFrames;
+    private VideoScaleFilter videoScaleFilter;
+    private float videoSharpen;
+    private int videoSimulcast; // max size of the simulcast stream, disabled if 0
     private Rect crop;
     private boolean control = true;
     private int displayId;
@@ -52,6 +67,7 @@ public class Options {
     private boolean showTouches;
     private boolean stayAwake;
     private int screenOffTimeout = -1;
+    private int idleTimeout; // keep the server alive for the next clients if not 0
     private int displayImePolicy = -1;
     private List<CodecOption> videoCodecOptions;
     private List<CodecOption> audioCodecOptions;
@@ -151,6 +167,62 @@ public class Options {
         return tunnelForward;
     }
 
+    public boolean isMultiplex() {
+        return multiplex;
+    }
+
+    public int getDirectTcpPort() {
+        return directTcpPort;
+    }
+
+    public byte[] getDirectTcpToken() {
+        return directTcpToken;
+    }
+
+    public int getVideoSocketBuffer() {
+        return videoSocketBuffer;
+    }
+
+    public int getAudioSocketBuffer() {
+        return audioSocketBuffer;
+    }
+
+    public int getControlSocketBuffer() {
+        return controlSocketBuffer;
+    }
+
+    public boolean getLowLatencySockets() {
+        return lowLatencySockets;
+    }
+
+    public boolean getVideoLowLatency() {
+        return videoLowLatency;
+    }
+
+    public boolean getSkipUnchangedFrames() {
+        return skipUnchangedFrames;
+    }
+
+    public boolean getVideoDirtyRects() {
+        return videoDirtyRects;
+    }
+
+    public boolean getVideoDropFrames() {
+        return videoDropFrames;
+    }
+
+    public VideoScaleFilter getVideoScaleFilter() {
+        return videoScaleFilter;
+    }
+
+    public float getVideoSharpen() {
+        return videoSharpen;
+    }
+
+    public int getVideoSimulcast() {
+        return videoSimulcast;
+    }
+
     public Rect getCrop() {
         return crop;
     }
@@ -207,6 +279,10 @@ public class Options {
         return screenOffTimeout;
     }
 
+    public int getIdleTimeout() {
+        return idleTimeout;
+    }
+
     public int getDisplayImePolicy() {
         return displayImePolicy;
     }
@@ -414,6 +490,55 @@ public class Options {
                 case "tunnel_forward":
                     options.tunnelForward = Boolean.parseBoolean(value);
                     break;
+                case "multiplex":
+                    options.multiplex = Boolean.parseBoolean(value);
+                    break;
+                case "direct_tcp_port":
+                    options.directTcpPort = Integer.parseInt(value);
+                    if (options.directTcpPort <= 0 || options.directTcpPort > 0xFFFF) {
+                        throw new IllegalArgumentException("Invalid direct TCP port: " + options.directTcpPort);
+                    }
+                    break;
+                case "direct_tcp_token":
+                    options.directTcpToken = parseHex(value);
+                    break;
+                case "video_socket_buffer":
+                    options.videoSocketBuffer = parseSocketBufferSize(value);
+                    break;
+                case "audio_socket_buffer":
+                    options.audioSocketBuffer = parseSocketBufferSize(value);
+                    break;
+                case "control_socket_buffer":
+                    options.controlSocketBuffer = parseSocketBufferSize(value);
+                    break;
+                case "low_latency_sockets":
+                    options.lowLatencySockets = Boolean.parseBoolean(value);
+                    break;
+                case "video_low_latency":
+                    options.videoLowLatency = Boolean.parseBoolean(value);
+                    break;
+                case "skip_unchanged_frames":
+                    options.skipUnchangedFrames = Boolean.parseBoolean(value);
+                    break;
+                case "video_dirty_rects":
+                    options.videoDirtyRects = Boolean.parseBoolean(value);
+                    break;
+                case "video_drop_frames":
+                    options.videoDropFrames = Boolean.parseBoolean(value);
+                    break;
+                case "video_scale_filter":
+                    VideoScaleFilter videoScaleFilter = VideoScaleFilter.findByName(value);
+                    if (videoScaleFilter == null) {
+                        throw new IllegalArgumentException("Video scale filter " + value + " not supported");
+                    }
+                    options.videoScaleFilter = videoScaleFilter;
+                    break;
+                case "video_sharpen":
+                    options.videoSharpen = parseFloat("video_sharpen", value);
+                    break;
+                case "video_simulcast":
+                    options.videoSimulcast = Integer.parseInt(value);
+                    break;
                 case "crop":
                     if (!value.isEmpty()) {
                         options.crop = parseCrop(value);
@@ -437,6 +562,12 @@ public class Options {
                         throw new IllegalArgumentException("Invalid screen off timeout: " + options.screenOffTimeout);
                     }
                     break;
+                case "idle_timeout":
+                    options.idleTimeout = Integer.parseInt(value);
+                    if (options.idleTimeout < 0) {
+                        throw new IllegalArgumentException("Invalid idle timeout: " + options.idleTimeout);
+                    }
+                    break;
                 case "video_codec_options":
                     options.videoCodecOptions = CodecOption.parse(value);
                     break;
@@ -574,6 +705,10 @@ public class Options {
             }
         }
 
+        if (options.directTcpPort != 0 && options.directTcpToken == null) {
+            throw new IllegalArgumentException("A direct TCP connection requires a token");
+        }
+
         if (options.newDisplay != null) {
             assert options.displayId == 0 : "Must not set both displayId and newDisplay";
             options.displayId = Device.DISPLAY_ID_NONE;
@@ -639,6 +774,30 @@ public class Options {
         }
     }
 
+    private static byte[] parseHex(String hex) {
+        if (hex.length() % 2 != 0) {
+            throw new IllegalArgumentException("Invalid hex value: \"" + hex + "\"");
+        }
+        byte[] bytes = new byte[hex.length() / 2];
+        for (int i = 0; i < bytes.length; ++i) {
+            int msb = Character.digit(hex.charAt(2 * i), 16);
+            int lsb = Character.digit(hex.charAt(2 * i + 1), 16);
+            if (msb == -1 || lsb == -1) {
+                throw new IllegalArgumentException("Invalid hex value: \"" + hex + "\"");
+            }
+            bytes[i] = (byte) ((msb << 4) | lsb);
+        }
+        return bytes;
+    }
+
+    private static int parseSocketBufferSize(String value) {
+        int size = Integer.parseInt(value);
+        if (size <= 0) {
+            throw new IllegalArgumentException("Invalid socket buffer size: " + size);
+        }
+        return size;
+    }
+
     private static NewDisplay parseNewDisplay(String newDisplay) {
         // Possible inputs:
         //  - "" (empty string)
@@ -17,7 +17,9 @@ import com.genymobile.scrcpy.model.NewDisplay;
 import com.genymobile.scrcpy.opengl.OpenGLRunner;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
+import com.genymobile.scrcpy.util.StartupTimer;
 import com.genymobile.scrcpy.video.CameraCapture;
+import com.genymobile.scrcpy.video.DirtyRegions;
 import com.genymobile.scrcpy.video.NewDisplayCapture;
 import com.genymobile.scrcpy.video.ScreenCapture;
 import com.genymobile.scrcpy.video.SurfaceCapture;
@@ -45,22 +47,41 @@ public final class Server {
         SERVER_PATH = classPaths[0];
     }
 
-    private static class Completion {
+    static final class Completion {
         private int running;
         private boolean fatalError;
+        private boolean completed;
+        private final Runnable onCompleted;
 
-        Completion(int running) {
+        Completion(int running, Runnable onCompleted) {
             this.running = running;
+            this.onCompleted = onCompleted;
         }
 
-        synchronized void addCompleted(boolean fatalError) {
+        synchronized void addCompleted(boolean endSession, boolean fatalError) {
             --running;
             if (fatalError) {
                 this.fatalError = true;
             }
-            if (running == 0 || this.fatalError) {
-                Looper.getMainLooper().quitSafely();
+            if (!completed && (running == 0 || endSession || this.fatalError)) {
+                completed = true;
+                notifyAll();
+                if (onCompleted != null) {
+                    onCompleted.run();
+                }
+            }
+        }
+
+        /**
+         * Wait for completion.
+         *
+         * @return {@code true} if a fatal error occurred
+         */
+        synchronized boolean await() throws InterruptedException {
+            while (!completed) {
+                wait();
             }
+            return fatalError;
         }
     }
 
@@ -93,77 +114,44 @@ public final class Server {
 
         int scid = options.getScid();
         boolean tunnelForward = options.isTunnelForward();
+        boolean multiplex = options.isMultiplex();
         boolean control = options.getControl();
         boolean video = options.getVideo();
         boolean audio = options.getAudio();
         boolean sendDummyByte = options.getSendDummyByte();
 
         Workarounds.apply();
+        StartupTimer.mark(StartupTimer.Phase.WORKAROUNDS_APPLIED);
 
-        List<AsyncProcessor> asyncProcessors = new ArrayList<>();
-
-        DesktopConnection connection = DesktopConnection.open(scid, tunnelForward, video, audio, control, sendDummyByte);
-        try {
-            if (options.getSendDeviceMeta()) {
-                connection.sendDeviceMeta(Device.getDeviceName());
+        if (options.getIdleTimeout() > 0) {
+            if (!tunnelForward || options.getDirectTcpPort() != 0) {
+                throw new ConfigurationException("A server kept alive requires a forward tunnel");
             }
-
-            Controller controller = null;
-
-            if (control) {
-                ControlChannel controlChannel = connection.getControlChannel();
-                controller = new Controller(controlChannel, cleanUp, options);
-                asyncProcessors.add(controller);
-            }
-
-            if (audio) {
-                AudioCodec audioCodec = options.getAudioCodec();
-                AudioSource audioSource = options.getAudioSource();
-                AudioCapture audioCapture;
-                if (audioSource.isDirect()) {
-                    audioCapture = new AudioDirectCapture(audioSource);
-                } else {
-                    audioCapture = new AudioPlaybackCapture(options.getAudioDup());
-                }
-
-                Streamer audioStreamer = new Streamer(connection.getAudioFd(), audioCodec, options.getSendStreamMeta(), options.getSendFrameMeta());
-                AsyncProcessor audioRecorder;
-                if (audioCodec == AudioCodec.RAW) {
-                    audioRecorder = new AudioRawRecorder(audioCapture, audioStreamer);
-                } else {
-                    audioRecorder = new AudioEncoder(audioCapture, audioStreamer, options);
-                }
-                asyncProcessors.add(audioRecorder);
+            try {
+                ServerDaemon.run(options, cleanUp);
+            } finally {
+                terminate(cleanUp);
             }
+            return;
+        }
 
-            if (video) {
-                Streamer videoStreamer = new Streamer(connection.getVideoFd(), options.getVideoCodec(), options.getSendStreamMeta(),
-                        options.getSendFrameMeta());
-                SurfaceCapture surfaceCapture;
-                if (options.getVideoSource() == VideoSource.DISPLAY) {
-                    NewDisplay newDisplay = options.getNewDisplay();
-                    if (newDisplay != null) {
-                        surfaceCapture = new NewDisplayCapture(controller, options);
-                    } else {
-                        assert options.getDisplayId() != Device.DISPLAY_ID_NONE;
-                        surfaceCapture = new ScreenCapture(controller, options);
-                    }
-                } else {
-                    surfaceCapture = new CameraCapture(options);
-                }
-                SurfaceEncoder surfaceEncoder = new SurfaceEncoder(surfaceCapture, videoStreamer, options);
-                asyncProcessors.add(surfaceEncoder);
+        List<AsyncProcessor> asyncProcessors = new ArrayList<>();
 
-                if (controller != null) {
-                    controller.setSurfaceCapture(surfaceCapture);
-                }
-            }
+        DesktopConnection connection;
+        int directTcpPort = options.getDirectTcpPort();
+        if (directTcpPort != 0) {
+            connection = DesktopConnection.openDirect(directTcpPort, options.getDirectTcpToken(), video, audio, control, multiplex,
+                    sendDummyByte);
+        } else {
+            connection = DesktopConnection.open(scid, tunnelForward, video, audio, control, multiplex, sendDummyByte);
+        }
+        StartupTimer.mark(StartupTimer.Phase.CLIENT_CONNECTED);
+        try {
+            createProcessors(connection, options, cleanUp, asyncProcessors);
 
-            Completion completion = new Completion(asyncProcessors.size());
+            Completion completion = new Completion(asyncProcessors.size(), () -> Looper.getMainLooper().quitSafely());
             for (AsyncProcessor asyncProcessor : asyncProcessors) {
-                asyncProcessor.start((fatalError) -> {
-                    completion.addCompleted(fatalError);
-                });
+                asyncProcessor.start(completion::addCompleted);
             }
 
             Looper.loop(); // interrupted by the Completion implementation
@@ -194,6 +182,132 @@ public final class Server {
         }
     }
 
+    /**
+     * Run a client session until its end (the client disconnected or a fatal error occurred), without terminating the server.
+     *
+     * @return {@code true} if a fatal error occurred
+     */
+    static boolean runSession(DesktopConnection connection, Options options, CleanUp cleanUp) throws IOException, ConfigurationException {
+        List<AsyncProcessor> asyncProcessors = new ArrayList<>();
+        try {
+            createProcessors(connection, options, cleanUp, asyncProcessors);
+
+            Completion completion = new Completion(asyncProcessors.size(), null);
+            for (AsyncProcessor asyncProcessor : asyncProcessors) {
+                asyncProcessor.start(completion::addCompleted);
+            }
+
+            return completion.await();
+        } catch (InterruptedException e) {
+            return true;
+        } finally {
+            for (AsyncProcessor asyncProcessor : asyncProcessors) {
+                asyncProcessor.stop();
+            }
+
+            connection.shutdown();
+
+            try {
+                for (AsyncProcessor asyncProcessor : asyncProcessors) {
+                    asyncProcessor.join();
+                }
+            } catch (InterruptedException e) {
+                // ignore
+            }
+
+            connection.close();
+        }
+    }
+
+    private static void terminate(CleanUp cleanUp) {
+        if (cleanUp != null) {
+            cleanUp.interrupt();
+        }
+
+        try {
+            if (cleanUp != null) {
+                cleanUp.join();
+            }
+
+            OpenGLRunner.shutdown();
+        } catch (InterruptedException e) {
+            // ignore
+        }
+    }
+
+    private static void createProcessors(DesktopConnection connection, Options options, CleanUp cleanUp, List<AsyncProcessor> asyncProcessors)
+            throws IOException, ConfigurationException {
+        connection.tuneSockets(options.getVideoSocketBuffer(), options.getAudioSocketBuffer(), options.getControlSocketBuffer(),
+                options.getLowLatencySockets());
+
+        if (options.getSendDeviceMeta()) {
+            connection.sendDeviceMeta(Device.getDeviceName());
+        }
+
+        boolean control = options.getControl();
+        boolean video = options.getVideo();
+        boolean audio = options.getAudio();
+
+        Controller controller = null;
+
+        if (control) {
+            ControlChannel controlChannel = connection.getControlChannel();
+            controller = new Controller(controlChannel, cleanUp, options);
+            asyncProcessors.add(controller);
+        }
+
+        if (audio) {
+            AudioCodec audioCodec = options.getAudioCodec();
+            AudioSource audioSource = options.getAudioSource();
+            AudioCapture audioCapture;
+            if (audioSource.isDirect()) {
+                audioCapture = new AudioDirectCapture(audioSource);
+            } else {
+                audioCapture = new AudioPlaybackCapture(options.getAudioDup());
+            }
+
+            Streamer audioStreamer = new Streamer(connection.getAudioFd(), audioCodec, options.getSendStreamMeta(), options.getSendFrameMeta());
+            AsyncProcessor audioRecorder;
+            if (audioCodec == AudioCodec.RAW) {
+                audioRecorder = new AudioRawRecorder(audioCapture, audioStreamer);
+            } else {
+                audioRecorder = new AudioEncoder(audioCapture, audioStreamer, options);
+            }
+            asyncProcessors.add(audioRecorder);
+        }
+
+        if (video) {
+            Streamer videoStreamer = new Streamer(connection.getVideoFd(), options.getVideoCodec(), options.getSendStreamMeta(),
+                    options.getSendFrameMeta());
+            SurfaceCapture surfaceCapture;
+            if (options.getVideoSource() == VideoSource.DISPLAY) {
+                NewDisplay newDisplay = options.getNewDisplay();
+                if (newDisplay != null) {
+                    surfaceCapture = new NewDisplayCapture(controller, options);
+                } else {
+                    assert options.getDisplayId() != Device.DISPLAY_ID_NONE;
+                    surfaceCapture = new ScreenCapture(controller, options);
+                }
+            } else {
+                surfaceCapture = new CameraCapture(options);
+            }
+            boolean simulcast = options.getVideoSimulcast() > 0;
+            if (options.getVideoDirtyRects() && options.getVideoSource() == VideoSource.DISPLAY && options.getSendFrameMeta() && !simulcast) {
+                // Computed by the OpenGL stage of the capture, sent along with each video packet (not supported with simulcast, since the
+                // regions would only match one of the streams)
+                DirtyRegions dirtyRegions = new DirtyRegions();
+                surfaceCapture.setDirtyRegions(dirtyRegions);
+                videoStreamer.setDirtyRegions(dirtyRegions);
+            }
+            SurfaceEncoder surfaceEncoder = new SurfaceEncoder(surfaceCapture, videoStreamer, options);
+            asyncProcessors.add(surfaceEncoder);
+
+            if (controller != null) {
+                controller.setSurfaceCapture(surfaceCapture);
+            }
+        }
+    }
+
     private static void prepareMainLooper() {
         // Like Looper.prepareMainLooper(), but with quitAllowed set to true
         Looper.prepare();
@@ -241,6 +355,7 @@ public final class Server {
 
         Ln.disableSystemStreams();
         Ln.initLogLevel(options.getLogLevel());
+        StartupTimer.start();
 
         Ln.i("Device: [" + Build.MANUFACTURER + "] " + Build.BRAND + " " + Build.MODEL + " (Android " + Build.VERSION.RELEASE + ")");
 
@@ -0,0 +1,140 @@
+package com.genymobile.scrcpy;
+
+import com.genymobile.scrcpy.device.DesktopConnection;
+import com.genymobile.scrcpy.model.ConfigurationException;
+import com.genymobile.scrcpy.util.Ln;
+import com.genymobile.scrcpy.util.StartupTimer;
+
+import android.net.LocalServerSocket;
+import android.os.Handler;
+import android.os.Looper;
+import android.system.ErrnoException;
+import android.system.Os;
+import android.system.OsConstants;
+
+import java.io.FileDescriptor;
+import java.io.IOException;
+
+/**
+ * Keep the server running between client sessions (--server-idle-timeout).
+ * <p>
+ * The process, the workarounds and the system services are initialized once, so the next clients connect to a warm server. Each session
+ * creates its own capture and encoders (they are not reused across sessions).
+ * <p>
+ * The server terminates if no client connects within the idle timeout after the last session, or on a fatal error (a configuration or
+ * encoder error). A client disconnection only ends its session.
+ */
+public final class ServerDaemon {
+
+    private final Options options;
+    private final CleanUp cleanUp;
+    private final LocalServerSocket serverSocket;
+    private final Handler handler = new Handler(Looper.getMainLooper());
+    private final Runnable idleTimeoutRunnable = this::onIdleTimeout;
+
+    private volatile boolean stopped;
+
+    private ServerDaemon(Options options, CleanUp cleanUp, LocalServerSocket serverSocket) {
+        this.options = options;
+        this.cleanUp = cleanUp;
+        this.serverSocket = serverSocket;
+    }
+
+    public static void run(Options options, CleanUp cleanUp) throws IOException {
+        try {
+            // Start a new session to survive the "adb shell" which started the server
+            Os.setsid();
+        } catch (ErrnoException e) {
+            Ln.w("setsid() failed", e);
+        }
+
+        try (LocalServerSocket serverSocket = DesktopConnection.listen(options.getScid())) {
+            ServerDaemon daemon = new ServerDaemon(options, cleanUp, serverSocket);
+            Thread thread = new Thread(daemon::loop, "daemon");
+            thread.start();
+
+            Looper.loop(); // interrupted by the daemon thread
+
+            daemon.stopped = true;
+            daemon.wakeUp();
+            try {
+                thread.join();
+            } catch (InterruptedException e) {
+                // ignore
+            }
+        }
+    }
+
+    private void loop() {
+        try {
+            boolean first = true;
+            while (!stopped) {
+                DesktopConnection connection;
+                try {
+                    connection = DesktopConnection.accept(serverSocket, options.getVideo(), options.getAudio(), options.getControl(),
+                            options.isMultiplex(), options.getSendDummyByte());
+                } catch (IOException e) {
+                    if (!stopped) {
+                        // For example, the client disconnected before the dummy byte was written
+                        Ln.e("Could not accept client", e);
+                    }
+                    continue;
+                }
+
+                handler.removeCallbacks(idleTimeoutRunnable);
+                if (first) {
+                    StartupTimer.mark(StartupTimer.Phase.CLIENT_CONNECTED);
+                    first = false;
+                } else {
+                    Ln.i("New client connected");
+                }
+
+                try {
+                    boolean fatalError = Server.runSession(connection, options, cleanUp);
+                    if (fatalError) {
+                        break;
+                    }
+                } catch (IOException e) {
+                    // The client may disconnect while the session is initialized
+                    Ln.e("Session error", e);
+                }
+
+                // The client may have killed the "adb shell" process, writing to its output would raise SIGPIPE
+                detachOutput();
+
+                Ln.i("Client disconnected, waiting for a new client (idle timeout: " + options.getIdleTimeout() + " ms)");
+                handler.postDelayed(idleTimeoutRunnable, options.getIdleTimeout());
+            }
+        } catch (ConfigurationException e) {
+            Ln.e("Session error", e);
+        } finally {
+            Looper.getMainLooper().quitSafely();
+        }
+    }
+
+    private void onIdleTimeout() {
+        Ln.i("No client connected before the idle timeout, terminating");
+        stopped = true;
+        wakeUp();
+    }
+
+    private void wakeUp() {
+        try {
+            // Unblock accept()
+            Os.shutdown(serverSocket.getFileDescriptor(), OsConstants.SHUT_RDWR);
+        } catch (ErrnoException e) {
+            // ignore
+        }
+    }
+
+    private static void detachOutput() {
+        try {
+            FileDescriptor devNull = Os.open("/dev/null", OsConstants.O_RDWR, 0);
+            Os.dup2(devNull, OsConstants.STDOUT_FILENO);
+            Os.dup2(devNull, OsConstants.STDERR_FILENO);
+            Os.close(devNull);
+        } catch (ErrnoException e) {
+            Ln.w("Could not detach the output", e);
+        }
+    }
+}
@@ -23,29 +23,9 @@ import android.os.Looper;
 import java.io.IOException;
 import java.nio.ByteBuffer;
 import java.util.List;
-import java.util.concurrent.ArrayBlockingQueue;
-import java.util.concurrent.BlockingQueue;
 
 public final class AudioEncoder implements AsyncProcessor {
 
-    private static class InputTask {
-        private final int index;
-
-        InputTask(int index) {
-            this.index = index;
-        }
-    }
-
-    private static class OutputTask {
-        private final int index;
-        private final MediaCodec.BufferInfo bufferInfo;
-
-        OutputTask(int index, MediaCodec.BufferInfo bufferInfo) {
-            this.index = index;
-            this.bufferInfo = bufferInfo;
-        }
-    }
-
     private static final int SAMPLE_RATE = AudioConfig.SAMPLE_RATE;
     private static final int CHANNELS = AudioConfig.CHANNELS;
 
@@ -59,9 +39,10 @@ public final class AudioEncoder implements AsyncProcessor {
     private long previousPts;
 
     // Capacity of 64 is in practice "infinite" (it is limited by the number of available MediaCodec buffers, typically 4).
-    // So many pending tasks would lead to an unacceptable delay anyway.
-    private final BlockingQueue<InputTask> inputTasks = new ArrayBlockingQueue<>(64);
-    private final BlockingQueue<OutputTask> outputTasks = new ArrayBlockingQueue<>(64);
+    // So many pending buffers would lead to an unacceptable delay anyway.
+    // The queues are preallocated, so that the codec callbacks (hundreds per second) do not allocate.
+    private final CodecBufferQueue inputBuffers = new CodecBufferQueue(64);
+    private final CodecBufferQueue outputBuffers = new CodecBufferQueue(64);
 
     private Thread thread;
     private HandlerThread mediaCodecThread;
@@ -103,30 +84,34 @@ public final class AudioEncoder implements AsyncProcessor {
         final MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
 
         while (!Thread.currentThread().isInterrupted()) {
-            InputTask task = inputTasks.take();
-            ByteBuffer buffer = mediaCodec.getInputBuffer(task.index);
+            int index = inputBuffers.take();
+            ByteBuffer buffer = mediaCodec.getInputBuffer(index);
             int r = capture.read(buffer, bufferInfo);
             if (r <= 0) {
                 throw new IOException("Could not read audio: " + r);
             }
 
-            mediaCodec.queueInputBuffer(task.index, bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags);
+            mediaCodec.queueInputBuffer(index, bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags);
         }
     }
 
     private void outputThread(MediaCodec mediaCodec) throws IOException, InterruptedException {
         streamer.writeAudioHeader();
 
+        // Reused for every packet
+        final MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
+
         while (!Thread.currentThread().isInterrupted()) {
-            OutputTask task = outputTasks.take();
-            ByteBuffer buffer = mediaCodec.getOutputBuffer(task.index);
+            int index = outputBuffers.take();
+            bufferInfo.set(outputBuffers.getOffset(), outputBuffers.getSize(), outputBuffers.getPresentationTimeUs(), outputBuffers.getFlags());
+            ByteBuffer buffer = mediaCodec.getOutputBuffer(index);
             try {
                 if (recreatePts) {
-                    fixTimestamp(task.bufferInfo);
+                    fixTimestamp(bufferInfo);
                 }
-                streamer.writePacket(buffer, task.bufferInfo);
+                streamer.writePacket(buffer, bufferInfo);
             } finally {
-                mediaCodec.releaseOutputBuffer(task.index, false);
+                mediaCodec.releaseOutputBuffer(index, false);
             }
         }
     }
@@ -166,7 +151,7 @@ public final class AudioEncoder implements AsyncProcessor {
                 fatalError = true;
             } finally {
                 Ln.d("Audio encoder stopped");
-                listener.onTerminated(fatalError);
+                listener.onTerminated(false, fatalError);
             }
         }, "audio-encoder");
         thread.start();
@@ -350,18 +335,17 @@ public final class AudioEncoder implements AsyncProcessor {
         @TargetApi(AndroidVersions.API_24_ANDROID_7_0)
         @Override
         public void onInputBufferAvailable(MediaCodec codec, int index) {
-            try {
-                inputTasks.put(new InputTask(index));
-            } catch (InterruptedException e) {
+            if (!inputBuffers.offer(index)) {
+                Ln.e("Audio input buffer queue full");
                 end();
             }
         }
 
         @Override
         public void onOutputBufferAvailable(MediaCodec codec, int index, MediaCodec.BufferInfo bufferInfo) {
-            try {
-                outputTasks.put(new OutputTask(index, bufferInfo));
-            } catch (InterruptedException e) {
+            // The fields are copied, so bufferInfo is not retained
+            if (!outputBuffers.offer(index, bufferInfo.offset, bufferInfo.size, bufferInfo.presentationTimeUs, bufferInfo.flags)) {
+                Ln.e("Audio output buffer queue full");
                 end();
             }
         }
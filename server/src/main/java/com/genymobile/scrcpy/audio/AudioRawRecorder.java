@@ -77,7 +77,7 @@ public final class AudioRawRecorder implements AsyncProcessor {
                 fatalError = true;
             } finally {
                 Ln.d("Audio recorder stopped");
-                listener.onTerminated(fatalError);
+                listener.onTerminated(false, fatalError);
             }
         }, "audio-raw");
         thread.start();
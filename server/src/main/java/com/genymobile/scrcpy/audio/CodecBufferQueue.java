@@ -0,0 +1,142 @@
+package com.genymobile.scrcpy.audio;
+
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * Single-producer single-consumer queue of codec buffers (an index and the fields of its {@code MediaCodec.BufferInfo}), without any
+ * allocation after construction.
+ * <p>
+ * The elements are stored in preallocated primitive arrays. The producer never blocks: the codec owns a limited number of buffers, so the
+ * queue can not be full unless it is too small. The consumer blocks until an element is available.
+ */
+public final class CodecBufferQueue {
+
+    private final int capacity;
+    private final int mask;
+
+    private final int[] indexes;
+    private final int[] offsets;
+    private final int[] sizes;
+    private final long[] presentationTimesUs;
+    private final int[] flags;
+
+    // Position of the next element to take (written by the consumer only)
+    private volatile long head;
+    // Position of the next element to offer (written by the producer only)
+    private volatile long tail;
+
+    // The consumer thread, to unpark when an element is offered
+    private volatile Thread waiter;
+
+    // Fields of the last taken element (accessed by the consumer only)
+    private int takenOffset;
+    private int takenSize;
+    private long takenPresentationTimeUs;
+    private int takenFlags;
+
+    /**
+     * @param capacity the maximum number of pending elements (must be a power of 2)
+     */
+    public CodecBufferQueue(int capacity) {
+        if (capacity <= 0 || (capacity & (capacity - 1)) != 0) {
+            throw new IllegalArgumentException("Capacity must be a power of 2: " + capacity);
+        }
+        this.capacity = capacity;
+        this.mask = capacity - 1;
+        indexes = new int[capacity];
+        offsets = new int[capacity];
+        sizes = new int[capacity];
+        presentationTimesUs = new long[capacity];
+        this.flags = new int[capacity];
+    }
+
+    /**
+     * Add a buffer index without buffer info (for input buffers).
+     *
+     * @return {@code false} if the queue is full
+     */
+    public boolean offer(int index) {
+        return offer(index, 0, 0, 0, 0);
+    }
+
+    /**
+     * Add a buffer index along with its buffer info fields (called by the producer thread only).
+     *
+     * @return {@code false} if the queue is full
+     */
+    public boolean offer(int index, int offset, int size, long presentationTimeUs, int flags) {
+        long t = tail;
+        if (t - head == capacity) {
+            return false;
+        }
+
+        int i = (int) t & mask;
+        indexes[i] = index;
+        offsets[i] = offset;
+        sizes[i] = size;
+        presentationTimesUs[i] = presentationTimeUs;
+        this.flags[i] = flags;
+
+        // The volatile write publishes the element to the consumer
+        tail = t + 1;
+
+        Thread thread = waiter;
+        if (thread != null) {
+            LockSupport.unpark(thread);
+        }
+        return true;
+    }
+
+    /**
+     * Wait for the next buffer and remove it (called by the consumer thread only).
+     * <p>
+     * Its buffer info fields are then available from the getters, until the next call.
+     *
+     * @return the buffer index
+     */
+    public int take() throws InterruptedException {
+        long h = head;
+        if (tail == h) {
+            // Publish the waiter before checking again, so that an element offered in the meantime always unparks this thread
+            waiter = Thread.currentThread();
+            try {
+                while (tail == h) {
+                    if (Thread.interrupted()) {
+                        throw new InterruptedException();
+                    }
+                    LockSupport.park(this);
+                }
+            } finally {
+                // The producer does not need to unpark this thread anymore
+                waiter = null;
+            }
+        }
+
+        int i = (int) h & mask;
+        int index = indexes[i];
+        takenOffset = offsets[i];
+        takenSize = sizes[i];
+        takenPresentationTimeUs = presentationTimesUs[i];
+        takenFlags = flags[i];
+
+        // The slot may be reused by the producer once head is written
+        head = h + 1;
+        return index;
+    }
+
+    public int getOffset() {
+        return takenOffset;
+    }
+
+    public int getSize() {
+        return takenSize;
+    }
+
+    public long getPresentationTimeUs() {
+        return takenPresentationTimeUs;
+    }
+
+    public int getFlags() {
+        return takenFlags;
+    }
+}
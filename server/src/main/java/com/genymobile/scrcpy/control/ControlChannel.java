@@ -2,7 +2,12 @@ package com.genymobile.scrcpy.control;
 
 import android.net.LocalSocket;
 
+import java.io.FileDescriptor;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
 import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
 
 public final class ControlChannel {
 
@@ -10,14 +15,27 @@ public final class ControlChannel {
     private final DeviceMessageWriter writer;
 
     public ControlChannel(LocalSocket controlSocket) throws IOException {
-        reader = new ControlMessageReader(controlSocket.getInputStream());
-        writer = new DeviceMessageWriter(controlSocket.getOutputStream());
+        this(controlSocket.getInputStream(), controlSocket.getOutputStream());
+    }
+
+    public ControlChannel(FileDescriptor fd) {
+        this(new FileInputStream(fd), new FileOutputStream(fd));
+    }
+
+    private ControlChannel(InputStream input, OutputStream output) {
+        // The Controller handles each message before reading the next one
+        reader = new ControlMessageReader(input, true);
+        writer = new DeviceMessageWriter(output);
     }
 
     public ControlMessage recv() throws IOException {
         return reader.read();
     }
 
+    public boolean isDataAvailable() throws IOException {
+        return reader.isDataAvailable();
+    }
+
     public void send(DeviceMessage msg) throws IOException {
         writer.write(msg);
     }
@@ -30,6 +30,7 @@ public final class ControlMessage {
     public static final int TYPE_CAMERA_ZOOM_OUT = 20;
     public static final int TYPE_RESIZE_DISPLAY = 21;
     public static final int TYPE_SCAN_FILE = 22;
+    public static final int TYPE_SELECT_VIDEO_STREAM = 23;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -60,17 +61,14 @@ public final class ControlMessage {
     private int productId;
     private int width;
     private int height;
+    private int stream;
 
     private ControlMessage() {
     }
 
     public static ControlMessage createInjectKeycode(int action, int keycode, int repeat, int metaState) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_KEYCODE;
-        msg.action = action;
-        msg.keycode = keycode;
-        msg.repeat = repeat;
-        msg.metaState = metaState;
+        msg.setInjectKeycode(action, keycode, repeat, metaState);
         return msg;
     }
 
@@ -84,23 +82,13 @@ public final class ControlMessage {
     public static ControlMessage createInjectTouchEvent(int action, long pointerId, Position position, float pressure, int actionButton,
             int buttons) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_TOUCH_EVENT;
-        msg.action = action;
-        msg.pointerId = pointerId;
-        msg.pressure = pressure;
-        msg.position = position;
-        msg.actionButton = actionButton;
-        msg.buttons = buttons;
+        msg.setInjectTouchEvent(action, pointerId, position, pressure, actionButton, buttons);
         return msg;
     }
 
     public static ControlMessage createInjectScrollEvent(Position position, float hScroll, float vScroll, int buttons) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_INJECT_SCROLL_EVENT;
-        msg.position = position;
-        msg.hScroll = hScroll;
-        msg.vScroll = vScroll;
-        msg.buttons = buttons;
+        msg.setInjectScrollEvent(position, hScroll, vScroll, buttons);
         return msg;
     }
 
@@ -153,9 +141,7 @@ public final class ControlMessage {
 
     public static ControlMessage createUhidInput(int id, byte[] data) {
         ControlMessage msg = new ControlMessage();
-        msg.type = TYPE_UHID_INPUT;
-        msg.id = id;
-        msg.data = data;
+        msg.setUhidInput(id, data);
         return msg;
     }
 
@@ -195,6 +181,47 @@ public final class ControlMessage {
         return msg;
     }
 
+    public static ControlMessage createSelectVideoStream(int stream) {
+        ControlMessage msg = new ControlMessage();
+        msg.type = TYPE_SELECT_VIDEO_STREAM;
+        msg.stream = stream;
+        return msg;
+    }
+
+    // The setters below allow to reuse a message instance for the frequent message types (see ControlMessageReader)
+
+    void setInjectKeycode(int action, int keycode, int repeat, int metaState) {
+        this.type = TYPE_INJECT_KEYCODE;
+        this.action = action;
+        this.keycode = keycode;
+        this.repeat = repeat;
+        this.metaState = metaState;
+    }
+
+    void setInjectTouchEvent(int action, long pointerId, Position position, float pressure, int actionButton, int buttons) {
+        this.type = TYPE_INJECT_TOUCH_EVENT;
+        this.action = action;
+        this.pointerId = pointerId;
+        this.pressure = pressure;
+        this.position = position;
+        this.actionButton = actionButton;
+        this.buttons = buttons;
+    }
+
+    void setInjectScrollEvent(Position position, float hScroll, float vScroll, int buttons) {
+        this.type = TYPE_INJECT_SCROLL_EVENT;
+        this.position = position;
+        this.hScroll = hScroll;
+        this.vScroll = vScroll;
+        this.buttons = buttons;
+    }
+
+    void setUhidInput(int id, byte[] data) {
+        this.type = TYPE_UHID_INPUT;
+        this.id = id;
+        this.data = data;
+    }
+
     public int getType() {
         return type;
     }
@@ -286,4 +313,8 @@ public final class ControlMessage {
     public int getHeight() {
         return height;
     }
+
+    public int getStream() {
+        return stream;
+    }
 }
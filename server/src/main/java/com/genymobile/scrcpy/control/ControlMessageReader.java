@@ -1,6 +1,8 @@
 package com.genymobile.scrcpy.control;
 
+import com.genymobile.scrcpy.model.Point;
 import com.genymobile.scrcpy.model.Position;
+import com.genymobile.scrcpy.model.Size;
 import com.genymobile.scrcpy.util.Binary;
 
 import java.io.BufferedInputStream;
@@ -18,8 +20,48 @@ public class ControlMessageReader {
 
     private final DataInputStream dis;
 
+    // If set, the messages of the frequent types (keycode, touch, scroll and UHID input) are reused: a message returned by read() is only
+    // valid until the next call
+    private final boolean reuseMessages;
+    private final ControlMessage keycodeMessage;
+    private final ControlMessage touchMessage;
+    private final ControlMessage scrollMessage;
+    private final ControlMessage uhidInputMessage;
+
+    // The last parsed position. Without message reuse, it is returned again if the next one is identical (for example on touch down and
+    // up at the same location). With message reuse, its point is updated in place (like the messages, it is only valid until the next
+    // call to read()).
+    private Position lastPosition;
+
     public ControlMessageReader(InputStream rawInputStream) {
+        this(rawInputStream, false);
+    }
+
+    public ControlMessageReader(InputStream rawInputStream, boolean reuseMessages) {
         dis = new DataInputStream(new BufferedInputStream(rawInputStream));
+        this.reuseMessages = reuseMessages;
+        if (reuseMessages) {
+            keycodeMessage = ControlMessage.createEmpty(ControlMessage.TYPE_INJECT_KEYCODE);
+            touchMessage = ControlMessage.createEmpty(ControlMessage.TYPE_INJECT_TOUCH_EVENT);
+            scrollMessage = ControlMessage.createEmpty(ControlMessage.TYPE_INJECT_SCROLL_EVENT);
+            uhidInputMessage = ControlMessage.createEmpty(ControlMessage.TYPE_UHID_INPUT);
+        } else {
+            keycodeMessage = null;
+            touchMessage = null;
+            scrollMessage = null;
+            uhidInputMessage = null;
+        }
+    }
+
+    private ControlMessage obtain(ControlMessage reusable, int type) {
+        return reuseMessages ? reusable : ControlMessage.createEmpty(type);
+    }
+
+    /**
+     * Indicate whether some data is available to read without blocking (possibly a partial message).
+     */
+    public boolean isDataAvailable() throws IOException {
+        return dis.available() > 0;
     }
 
     public ControlMessage read() throws IOException {
@@ -64,6 +106,8 @@ public class ControlMessageReader {
                 return parseResizeDisplay();
             case ControlMessage.TYPE_SCAN_FILE:
                 return parseScanFile();
+            case ControlMessage.TYPE_SELECT_VIDEO_STREAM:
+                return parseSelectVideoStream();
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
@@ -74,7 +118,9 @@ public class ControlMessageReader {
         int keycode = dis.readInt();
         int repeat = dis.readInt();
         int metaState = dis.readInt();
-        return ControlMessage.createInjectKeycode(action, keycode, repeat, metaState);
+        ControlMessage msg = obtain(keycodeMessage, ControlMessage.TYPE_INJECT_KEYCODE);
+        msg.setInjectKeycode(action, keycode, repeat, metaState);
+        return msg;
     }
 
     private int parseBufferLength(int sizeBytes) throws IOException {
@@ -115,7 +161,9 @@ public class ControlMessageReader {
         float pressure = Binary.u16FixedPointToFloat(dis.readShort());
         int actionButton = dis.readInt();
         int buttons = dis.readInt();
-        return ControlMessage.createInjectTouchEvent(action, pointerId, position, pressure, actionButton, buttons);
+        ControlMessage msg = obtain(touchMessage, ControlMessage.TYPE_INJECT_TOUCH_EVENT);
+        msg.setInjectTouchEvent(action, pointerId, position, pressure, actionButton, buttons);
+        return msg;
     }
 
     private ControlMessage parseInjectScrollEvent() throws IOException {
@@ -124,7 +172,9 @@ public class ControlMessageReader {
         float hScroll = Binary.i16FixedPointToFloat(dis.readShort()) * 16;
         float vScroll = Binary.i16FixedPointToFloat(dis.readShort()) * 16;
         int buttons = dis.readInt();
-        return ControlMessage.createInjectScrollEvent(position, hScroll, vScroll, buttons);
+        ControlMessage msg = obtain(scrollMessage, ControlMessage.TYPE_INJECT_SCROLL_EVENT);
+        msg.setInjectScrollEvent(position, hScroll, vScroll, buttons);
+        return msg;
     }
 
     private ControlMessage parseBackOrScreenOnEvent() throws IOException {
@@ -160,8 +210,21 @@ public class ControlMessageReader {
 
     private ControlMessage parseUhidInput() throws IOException {
         int id = dis.readUnsignedShort();
-        byte[] data = parseByteArray(2);
-        return ControlMessage.createUhidInput(id, data);
+        byte[] data;
+        if (reuseMessages) {
+            int len = parseBufferLength(2);
+            // The reports of a given device usually have a constant size, so the previous array can be reused
+            data = uhidInputMessage.getData();
+            if (data == null || data.length != len) {
+                data = new byte[len];
+            }
+            dis.readFully(data);
+        } else {
+            data = parseByteArray(2);
+        }
+        ControlMessage msg = obtain(uhidInputMessage, ControlMessage.TYPE_UHID_INPUT);
+        msg.setUhidInput(id, data);
+        return msg;
     }
 
     private ControlMessage parseUhidDestroy() throws IOException {
@@ -190,11 +253,32 @@ public class ControlMessageReader {
         return ControlMessage.createScanFile(path);
     }
 
+    private ControlMessage parseSelectVideoStream() throws IOException {
+        int stream = dis.readUnsignedByte();
+        return ControlMessage.createSelectVideoStream(stream);
+    }
+
     private Position parsePosition() throws IOException {
         int x = dis.readInt();
         int y = dis.readInt();
         int screenWidth = dis.readUnsignedShort();
         int screenHeight = dis.readUnsignedShort();
-        return new Position(x, y, screenWidth, screenHeight);
+
+        if (lastPosition != null) {
+            Point lastPoint = lastPosition.getPoint();
+            Size lastScreenSize = lastPosition.getScreenSize();
+            if (lastScreenSize.getWidth() == screenWidth && lastScreenSize.getHeight() == screenHeight) {
+                if (reuseMessages) {
+                    lastPoint.set(x, y);
+                } else if (lastPoint.getX() != x || lastPoint.getY() != y) {
+                    // The screen size rarely changes
+                    lastPosition = new Position(new Point(x, y), lastScreenSize);
+                }
+                return lastPosition;
+            }
+        }
+
+        lastPosition = new Position(x, y, screenWidth, screenHeight);
+        return lastPosition;
     }
 }
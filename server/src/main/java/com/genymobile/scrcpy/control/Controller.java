@@ -69,6 +69,28 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
         }
     }
 
+    // Create and inject the batched move events (see MoveBatcher)
+    private final class MoveInjector implements MoveBatcher.Injector {
+        @Override
+        public void begin(long eventTime, int action, int source, int buttons, int pointerCount, int displayId) {
+            pendingMoveEvent = MotionEvent.obtain(lastTouchDown, eventTime, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f,
+                    1f, DEFAULT_DEVICE_ID, 0, source, 0);
+            pendingMoveDisplayId = displayId;
+        }
+
+        @Override
+        public void append(long eventTime) {
+            pendingMoveEvent.addBatch(eventTime, pointerCoords, 0);
+        }
+
+        @Override
+        public boolean inject() {
+            MotionEvent event = pendingMoveEvent;
+            pendingMoveEvent = null;
+            return Device.injectEvent(event, pendingMoveDisplayId, Device.INJECT_MODE_ASYNC);
+        }
+    }
+
     private static final int DEFAULT_DEVICE_ID = 0;
 
     // control_msg.h values of the pointerId field in inject_touch_event message
@@ -107,6 +129,10 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
     private final MotionEvent.PointerProperties[] pointerProperties = new MotionEvent.PointerProperties[PointersState.MAX_POINTERS];
     private final MotionEvent.PointerCoords[] pointerCoords = new MotionEvent.PointerCoords[PointersState.MAX_POINTERS];
 
+    private final MoveBatcher moveBatcher = new MoveBatcher(new MoveInjector());
+    private MotionEvent pendingMoveEvent;
+    private int pendingMoveDisplayId;
+
     private boolean keepDisplayPowerOff;
 
     // Used for resetting video encoding on RESET_VIDEO message or for sending camera controls
@@ -286,7 +312,8 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
                 if (uhidManager != null) {
                     uhidManager.closeAll();
                 }
-                listener.onTerminated(true);
+                // The end of the control stream ends the session, but is not an error of the server
+                listener.onTerminated(true, false);
             }
         }, "control-recv");
         thread.start();
@@ -318,7 +345,29 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
         }
     }
 
+    private boolean isControlDataAvailable() {
+        try {
+            return controlChannel.isDataAvailable();
+        } catch (IOException e) {
+            // The error will be reported by the next read
+            return false;
+        }
+    }
+
+    private static boolean isMoveEvent(ControlMessage msg) {
+        if (msg.getType() != ControlMessage.TYPE_INJECT_TOUCH_EVENT) {
+            return false;
+        }
+        int action = msg.getAction();
+        return action == MotionEvent.ACTION_MOVE || action == MotionEvent.ACTION_HOVER_MOVE;
+    }
+
     private boolean handleEvent() throws IOException {
+        if (moveBatcher.hasPending() && !isControlDataAvailable()) {
+            // No other move is queued, do not delay the pending one until the next message
+            moveBatcher.flush();
+        }
+
         ControlMessage msg;
         try {
             msg = controlChannel.recv();
@@ -330,6 +379,11 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             return false;
         }
 
+        if (!isMoveEvent(msg)) {
+            // Preserve the events order
+            moveBatcher.flush();
+        }
+
         int type = msg.getType();
 
         // Events for all sources (display or camera)
@@ -416,6 +470,9 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
                 case ControlMessage.TYPE_SCAN_FILE:
                     scanFile(msg.getText());
                     return true;
+                case ControlMessage.TYPE_SELECT_VIDEO_STREAM:
+                    selectVideoStream(msg.getStream());
+                    return true;
                 default:
                     // fall through
             }
@@ -615,6 +672,11 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             }
         }
 
+        if (action == MotionEvent.ACTION_MOVE || action == MotionEvent.ACTION_HOVER_MOVE) {
+            // Merged with the next moves already received, if any
+            return moveBatcher.move(now, action, source, buttons, pointerCount, targetDisplayId);
+        }
+
         MotionEvent event = MotionEvent.obtain(lastTouchDown, now, action, pointerCount, pointerProperties, pointerCoords, 0, buttons, 1f, 1f,
                 DEFAULT_DEVICE_ID, 0, source, 0);
         return Device.injectEvent(event, targetDisplayId, Device.INJECT_MODE_ASYNC);
@@ -881,6 +943,12 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
         newDisplayCapture.requestResize(width, height);
     }
 
+    private void selectVideoStream(int stream) {
+        if (surfaceCapture != null) {
+            surfaceCapture.getCaptureControl().selectStream(stream);
+        }
+    }
+
     private void scanFile(String path) {
         try {
             @SuppressWarnings("deprecation")
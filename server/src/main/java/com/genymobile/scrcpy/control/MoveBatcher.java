@@ -0,0 +1,113 @@
+package com.genymobile.scrcpy.control;
+
+/**
+ * Coalesce consecutive MOVE (or HOVER_MOVE) events into a single injected event, containing the intermediate positions as historical
+ * samples.
+ * <p>
+ * Each injection is a binder call to the input manager. When the client sends moves faster than they are injected (typically with a high
+ * polling rate mouse), the events queued in the control socket are merged instead of being injected one by one.
+ * <p>
+ * The caller must flush the pending event before handling any other event, and before waiting for the next message.
+ */
+public final class MoveBatcher {
+
+    public interface Injector {
+        /**
+         * Create a new pending event from the current pointers state.
+         */
+        void begin(long eventTime, int action, int source, int buttons, int pointerCount, int displayId);
+
+        /**
+         * Add the current pointers state to the pending event, as a new sample.
+         */
+        void append(long eventTime);
+
+        /**
+         * Inject the pending event.
+         *
+         * @return {@code true} on success
+         */
+        boolean inject();
+    }
+
+    // Bound the latency added by the batching if the moves are received continuously
+    public static final int DEFAULT_MAX_SAMPLES = 32;
+    public static final long DEFAULT_MAX_DELAY_MS = 8;
+
+    private final Injector injector;
+    private final int maxSamples;
+    private final long maxDelayMs;
+
+    private boolean pending;
+    private int sampleCount;
+    private long firstEventTime;
+
+    // Parameters of the pending event: a move may be merged only if they are identical
+    private int action;
+    private int source;
+    private int buttons;
+    private int pointerCount;
+    private int displayId;
+
+    public MoveBatcher(Injector injector) {
+        this(injector, DEFAULT_MAX_SAMPLES, DEFAULT_MAX_DELAY_MS);
+    }
+
+    public MoveBatcher(Injector injector, int maxSamples, long maxDelayMs) {
+        this.injector = injector;
+        this.maxSamples = maxSamples;
+        this.maxDelayMs = maxDelayMs;
+    }
+
+    /**
+     * Add a move, with the current pointers state.
+     * <p>
+     * The move is either merged into the pending event, or starts a new pending event (the previous one, if any, is injected).
+     *
+     * @return {@code false} if an injection failed
+     */
+    public boolean move(long eventTime, int action, int source, int buttons, int pointerCount, int displayId) {
+        boolean ok = true;
+        if (pending && this.action == action && this.source == source && this.buttons == buttons && this.pointerCount == pointerCount
+                && this.displayId == displayId) {
+            injector.append(eventTime);
+            ++sampleCount;
+        } else {
+            ok = flush();
+
+            injector.begin(eventTime, action, source, buttons, pointerCount, displayId);
+            pending = true;
+            sampleCount = 1;
+            firstEventTime = eventTime;
+            this.action = action;
+            this.source = source;
+            this.buttons = buttons;
+            this.pointerCount = pointerCount;
+            this.displayId = displayId;
+        }
+
+        if (sampleCount >= maxSamples || eventTime - firstEventTime >= maxDelayMs) {
+            ok &= flush();
+        }
+
+        return ok;
+    }
+
+    /**
+     * Inject the pending event, if any.
+     *
+     * @return {@code false} if the injection failed
+     */
+    public boolean flush() {
+        if (!pending) {
+            return true;
+        }
+
+        pending = false;
+        return injector.inject();
+    }
+
+    public boolean hasPending() {
+        return pending;
+    }
+}
@@ -14,7 +14,8 @@ public class Pointer {
      */
     private final int localId;
 
-    private Point point;
+    // Copied, since the point of a reused control message is updated in place by the next message
+    private final Point point = new Point(0, 0);
     private float pressure;
     private boolean up;
 
@@ -36,7 +37,7 @@ public class Pointer {
     }
 
     public void setPoint(Point point) {
-        this.point = point;
+        this.point.set(point.getX(), point.getY());
     }
 
     public float getPressure() {
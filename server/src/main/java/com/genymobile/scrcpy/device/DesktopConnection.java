@@ -2,11 +2,15 @@ package com.genymobile.scrcpy.device;
 
 import com.genymobile.scrcpy.control.ControlChannel;
 import com.genymobile.scrcpy.util.IO;
+import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.StringUtils;
 
 import android.net.LocalServerSocket;
 import android.net.LocalSocket;
 import android.net.LocalSocketAddress;
+import android.system.ErrnoException;
+import android.system.Os;
+import android.system.OsConstants;
 
 import java.io.Closeable;
 import java.io.FileDescriptor;
@@ -19,6 +23,11 @@ public final class DesktopConnection implements Closeable {
 
     private static final String SOCKET_NAME_PREFIX = "scrcpy";
 
+    // Not exposed by OsConstants (value from linux/tcp.h)
+    private static final int TCP_NOTSENT_LOWAT = 25;
+    // Keep at most this amount of unsent data in the kernel in low latency mode, so that the pending data is sent in priority
+    private static final int LOW_LATENCY_NOTSENT_LOWAT = 16 * 1024;
+
     private final LocalSocket videoSocket;
     private final FileDescriptor videoFd;
 
@@ -26,18 +35,52 @@ public final class DesktopConnection implements Closeable {
     private final FileDescriptor audioFd;
 
     private final LocalSocket controlSocket;
+    private final FileDescriptor controlFd;
     private final ControlChannel controlChannel;
 
+    // Only set if all the streams are multiplexed over a single socket
+    private final LocalSocket multiplexedSocket;
+    private final Multiplexer multiplexer;
+
+    // Only set for a direct TCP connection (the items may be null)
+    private final FileDescriptor[] tcpSockets;
+
     private DesktopConnection(LocalSocket videoSocket, LocalSocket audioSocket, LocalSocket controlSocket) throws IOException {
         this.videoSocket = videoSocket;
         this.audioSocket = audioSocket;
         this.controlSocket = controlSocket;
+        this.multiplexedSocket = null;
+        this.multiplexer = null;
+        this.tcpSockets = null;
 
         videoFd = videoSocket != null ? videoSocket.getFileDescriptor() : null;
         audioFd = audioSocket != null ? audioSocket.getFileDescriptor() : null;
+        controlFd = controlSocket != null ? controlSocket.getFileDescriptor() : null;
         controlChannel = controlSocket != null ? new ControlChannel(controlSocket) : null;
     }
 
+    private DesktopConnection(FileDescriptor videoFd, FileDescriptor audioFd, FileDescriptor controlFd, LocalSocket multiplexedSocket,
+            Multiplexer multiplexer, FileDescriptor[] tcpSockets) {
+        this.videoSocket = null;
+        this.audioSocket = null;
+        this.controlSocket = null;
+        this.multiplexedSocket = multiplexedSocket;
+        this.multiplexer = multiplexer;
+        this.tcpSockets = tcpSockets;
+
+        this.videoFd = videoFd;
+        this.audioFd = audioFd;
+        this.controlFd = controlFd;
+        controlChannel = controlFd != null ? new ControlChannel(controlFd) : null;
+    }
+
+    private static DesktopConnection multiplexed(Multiplexer multiplexer, LocalSocket multiplexedSocket, FileDescriptor[] tcpSockets) {
+        FileDescriptor videoFd = multiplexer.getFd(Multiplexer.CHANNEL_VIDEO);
+        FileDescriptor audioFd = multiplexer.getFd(Multiplexer.CHANNEL_AUDIO);
+        FileDescriptor controlFd = multiplexer.getFd(Multiplexer.CHANNEL_CONTROL);
+        return new DesktopConnection(videoFd, audioFd, controlFd, multiplexedSocket, multiplexer, tcpSockets);
+    }
+
     private static LocalSocket connect(String abstractName) throws IOException {
         LocalSocket localSocket = new LocalSocket();
         localSocket.connect(new LocalSocketAddress(abstractName));
@@ -53,79 +96,246 @@ public final class DesktopConnection implements Closeable {
         return SOCKET_NAME_PREFIX + String.format("_%08x", scid);
     }
 
-    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean sendDummyByte)
-            throws IOException {
+    /**
+     * Create the server socket on which the client connects in forward tunnel mode.
+     *
+     * @param scid the scrcpy id
+     * @return the server socket
+     */
+    public static LocalServerSocket listen(int scid) throws IOException {
+        return new LocalServerSocket(getSocketName(scid));
+    }
+
+    /**
+     * Accept a client connection (all its sockets) on a server socket created by {@link #listen(int)}.
+     * <p>
+     * The server socket is not closed, so that it may accept the next clients.
+     */
+    public static DesktopConnection accept(LocalServerSocket localServerSocket, boolean video, boolean audio, boolean control,
+            boolean multiplex, boolean sendDummyByte) throws IOException {
+        if (multiplex) {
+            return multiplex(localServerSocket.accept(), video, audio, control, sendDummyByte);
+        }
+
+        LocalSocket videoSocket = null;
+        LocalSocket audioSocket = null;
+        LocalSocket controlSocket = null;
+        try {
+            if (video) {
+                videoSocket = localServerSocket.accept();
+                if (sendDummyByte) {
+                    // send one byte so the client may read() to detect a connection error
+                    videoSocket.getOutputStream().write(0);
+                    sendDummyByte = false;
+                }
+            }
+            if (audio) {
+                audioSocket = localServerSocket.accept();
+                if (sendDummyByte) {
+                    // send one byte so the client may read() to detect a connection error
+                    audioSocket.getOutputStream().write(0);
+                    sendDummyByte = false;
+                }
+            }
+            if (control) {
+                controlSocket = localServerSocket.accept();
+                if (sendDummyByte) {
+                    // send one byte so the client may read() to detect a connection error
+                    controlSocket.getOutputStream().write(0);
+                    sendDummyByte = false;
+                }
+            }
+        } catch (IOException | RuntimeException e) {
+            closeAll(videoSocket, audioSocket, controlSocket);
+            throw e;
+        }
+
+        return new DesktopConnection(videoSocket, audioSocket, controlSocket);
+    }
+
+    public static DesktopConnection open(int scid, boolean tunnelForward, boolean video, boolean audio, boolean control, boolean multiplex,
+            boolean sendDummyByte) throws IOException {
+        if (tunnelForward) {
+            try (LocalServerSocket localServerSocket = listen(scid)) {
+                return accept(localServerSocket, video, audio, control, multiplex, sendDummyByte);
+            }
+        }
+
         String socketName = getSocketName(scid);
 
+        if (multiplex) {
+            return multiplex(connect(socketName), video, audio, control, false);
+        }
+
         LocalSocket videoSocket = null;
         LocalSocket audioSocket = null;
         LocalSocket controlSocket = null;
         try {
-            if (tunnelForward) {
-                try (LocalServerSocket localServerSocket = new LocalServerSocket(socketName)) {
-                    if (video) {
-                        videoSocket = localServerSocket.accept();
-                        if (sendDummyByte) {
-                            // send one byte so the client may read() to detect a connection error
-                            videoSocket.getOutputStream().write(0);
-                            sendDummyByte = false;
-                        }
-                    }
-                    if (audio) {
-                        audioSocket = localServerSocket.accept();
-                        if (sendDummyByte) {
-                            // send one byte so the client may read() to detect a connection error
-                            audioSocket.getOutputStream().write(0);
-                            sendDummyByte = false;
-                        }
+            if (video) {
+                videoSocket = connect(socketName);
+            }
+            if (audio) {
+                audioSocket = connect(socketName);
+            }
+            if (control) {
+                controlSocket = connect(socketName);
+            }
+        } catch (IOException | RuntimeException e) {
+            closeAll(videoSocket, audioSocket, controlSocket);
+            throw e;
+        }
+
+        return new DesktopConnection(videoSocket, audioSocket, controlSocket);
+    }
+
+    private static DesktopConnection multiplex(LocalSocket socket, boolean video, boolean audio, boolean control, boolean sendDummyByte)
+            throws IOException {
+        try {
+            if (sendDummyByte) {
+                // send one byte so the client may read() to detect a connection error
+                socket.getOutputStream().write(0);
+            }
+            Multiplexer multiplexer = Multiplexer.start(socket.getFileDescriptor(), video, audio, control);
+            return multiplexed(multiplexer, socket, null);
+        } catch (IOException | RuntimeException e) {
+            socket.close();
+            throw e;
+        }
+    }
+
+    /**
+     * Accept a client connecting directly over TCP (without the adb tunnel).
+     *
+     * @param port  the TCP port to listen on
+     * @param token the token which must be sent by the client on each connection
+     */
+    public static DesktopConnection openDirect(int port, byte[] token, boolean video, boolean audio, boolean control, boolean multiplex,
+            boolean sendDummyByte) throws IOException {
+        try (DirectTcpServer server = DirectTcpServer.listen(port, token)) {
+            if (multiplex) {
+                FileDescriptor socket = server.accept();
+                try {
+                    if (sendDummyByte) {
+                        // send one byte so the client may read() to detect a connection error
+                        IO.writeFully(socket, new byte[1], 0, 1);
                     }
-                    if (control) {
-                        controlSocket = localServerSocket.accept();
+                    Multiplexer multiplexer = Multiplexer.start(socket, video, audio, control);
+                    return multiplexed(multiplexer, null, new FileDescriptor[] {socket});
+                } catch (IOException | RuntimeException e) {
+                    DirectTcpServer.closeQuietly(socket);
+                    throw e;
+                }
+            }
+
+            FileDescriptor[] sockets = new FileDescriptor[3];
+            boolean[] enabled = {video, audio, control};
+            try {
+                for (int i = 0; i < sockets.length; ++i) {
+                    if (enabled[i]) {
+                        sockets[i] = server.accept();
                         if (sendDummyByte) {
                             // send one byte so the client may read() to detect a connection error
-                            controlSocket.getOutputStream().write(0);
+                            IO.writeFully(sockets[i], new byte[1], 0, 1);
                             sendDummyByte = false;
                         }
                     }
                 }
-            } else {
-                if (video) {
-                    videoSocket = connect(socketName);
-                }
-                if (audio) {
-                    audioSocket = connect(socketName);
-                }
-                if (control) {
-                    controlSocket = connect(socketName);
+            } catch (IOException | RuntimeException e) {
+                for (FileDescriptor socket : sockets) {
+                    if (socket != null) {
+                        DirectTcpServer.closeQuietly(socket);
+                    }
                 }
+                throw e;
             }
-        } catch (IOException | RuntimeException e) {
-            if (videoSocket != null) {
-                videoSocket.close();
+
+            return new DesktopConnection(sockets[0], sockets[1], sockets[2], null, null, sockets);
+        }
+    }
+
+    /**
+     * Configure the socket buffers (a size of 0 keeps the system default) and the low latency options.
+     * <p>
+     * If the streams are multiplexed, the single socket is configured with the video buffer size.
+     */
+    public void tuneSockets(int videoBufferSize, int audioBufferSize, int controlBufferSize, boolean lowLatency) {
+        if (multiplexer != null) {
+            FileDescriptor fd = multiplexedSocket != null ? multiplexedSocket.getFileDescriptor() : tcpSockets[0];
+            tuneSocket(fd, "multiplexed", videoBufferSize, lowLatency);
+            return;
+        }
+
+        if (videoFd != null) {
+            tuneSocket(videoFd, "video", videoBufferSize, lowLatency);
+        }
+        if (audioFd != null) {
+            tuneSocket(audioFd, "audio", audioBufferSize, lowLatency);
+        }
+        if (controlFd != null) {
+            tuneSocket(controlFd, "control", controlBufferSize, lowLatency);
+        }
+    }
+
+    private void tuneSocket(FileDescriptor fd, String name, int bufferSize, boolean lowLatency) {
+        try {
+            if (bufferSize > 0) {
+                Os.setsockoptInt(fd, OsConstants.SOL_SOCKET, OsConstants.SO_SNDBUF, bufferSize);
+                Os.setsockoptInt(fd, OsConstants.SOL_SOCKET, OsConstants.SO_RCVBUF, bufferSize);
             }
-            if (audioSocket != null) {
-                audioSocket.close();
+
+            // Local sockets (through the adb tunnel) have no TCP options
+            if (lowLatency && tcpSockets != null) {
+                Os.setsockoptInt(fd, OsConstants.IPPROTO_TCP, OsConstants.TCP_NODELAY, 1);
+                Os.setsockoptInt(fd, OsConstants.IPPROTO_TCP, TCP_NOTSENT_LOWAT, LOW_LATENCY_NOTSENT_LOWAT);
             }
-            if (controlSocket != null) {
-                controlSocket.close();
+
+            if (Ln.isEnabled(Ln.Level.DEBUG)) {
+                int sndbuf = Os.getsockoptInt(fd, OsConstants.SOL_SOCKET, OsConstants.SO_SNDBUF);
+                int rcvbuf = Os.getsockoptInt(fd, OsConstants.SOL_SOCKET, OsConstants.SO_RCVBUF);
+                Ln.d("Socket " + name + ": send buffer " + sndbuf + " bytes, receive buffer " + rcvbuf + " bytes");
             }
-            throw e;
+        } catch (ErrnoException e) {
+            Ln.w("Could not configure the " + name + " socket: " + e.getMessage());
         }
-
-        return new DesktopConnection(videoSocket, audioSocket, controlSocket);
     }
 
-    private LocalSocket getFirstSocket() {
+    private static void closeAll(LocalSocket videoSocket, LocalSocket audioSocket, LocalSocket controlSocket) throws IOException {
         if (videoSocket != null) {
-            return videoSocket;
+            videoSocket.close();
         }
         if (audioSocket != null) {
-            return audioSocket;
+            audioSocket.close();
+        }
+        if (controlSocket != null) {
+            controlSocket.close();
+        }
+    }
+
+    private FileDescriptor getFirstFd() {
+        if (videoFd != null) {
+            return videoFd;
         }
-        return controlSocket;
+        if (audioFd != null) {
+            return audioFd;
+        }
+        return controlFd;
     }
 
     public void shutdown() throws IOException {
+        if (multiplexer != null) {
+            multiplexer.shutdown();
+        }
+        if (tcpSockets != null) {
+            for (FileDescriptor socket : tcpSockets) {
+                if (socket != null) {
+                    try {
+                        Os.shutdown(socket, OsConstants.SHUT_RDWR);
+                    } catch (ErrnoException e) {
+                        // ignore
+                    }
+                }
+            }
+        }
         if (videoSocket != null) {
             videoSocket.shutdownInput();
             videoSocket.shutdownOutput();
@@ -141,6 +351,19 @@ public final class DesktopConnection implements Closeable {
     }
 
     public void close() throws IOException {
+        if (multiplexer != null) {
+            multiplexer.close();
+            if (multiplexedSocket != null) {
+                multiplexedSocket.close();
+            }
+        }
+        if (tcpSockets != null) {
+            for (FileDescriptor socket : tcpSockets) {
+                if (socket != null) {
+                    DirectTcpServer.closeQuietly(socket);
+                }
+            }
+        }
         if (videoSocket != null) {
             videoSocket.close();
         }
@@ -160,8 +383,7 @@ public final class DesktopConnection implements Closeable {
         System.arraycopy(deviceNameBytes, 0, buffer, 0, len);
         // byte[] are always 0-initialized in java, no need to set '\0' explicitly
 
-        FileDescriptor fd = getFirstSocket().getFileDescriptor();
-        IO.writeFully(fd, buffer, 0, buffer.length);
+        IO.writeFully(getFirstFd(), buffer, 0, buffer.length);
     }
 
     public FileDescriptor getVideoFd() {
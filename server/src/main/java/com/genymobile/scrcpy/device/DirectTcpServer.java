@@ -0,0 +1,206 @@
+package com.genymobile.scrcpy.device;
+
+import com.genymobile.scrcpy.util.Ln;
+
+import android.os.SystemClock;
+import android.system.ErrnoException;
+import android.system.Os;
+import android.system.OsConstants;
+import android.system.StructPollfd;
+
+import java.io.Closeable;
+import java.io.FileDescriptor;
+import java.io.IOException;
+import java.net.InetAddress;
+import java.net.SocketException;
+import java.security.MessageDigest;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * TCP server socket on which the client connects directly, without the adb tunnel (--direct-tcp).
+ * <p>
+ * Since the port is reachable from the network, each connection must start with the token generated by the client for this server instance
+ * (transmitted via adb in the server arguments). The other connections are rejected.
+ */
+public final class DirectTcpServer implements Closeable {
+
+    private static final int TOKEN_TIMEOUT_MS = 2000;
+    private static final int MAX_PENDING_PEERS = 8;
+
+    // A connection which has not sent the whole token yet
+    private static final class Peer {
+        private FileDescriptor fd;
+        private byte[] received;
+        private int offset;
+        private long deadline;
+    }
+
+    private final FileDescriptor fd;
+    private final byte[] token;
+    private final List<Peer> pending = new ArrayList<>();
+
+    private DirectTcpServer(FileDescriptor fd, byte[] token) {
+        this.fd = fd;
+        this.token = token;
+    }
+
+    public static DirectTcpServer listen(int port, byte[] token) throws IOException {
+        FileDescriptor fd;
+        try {
+            fd = Os.socket(OsConstants.AF_INET, OsConstants.SOCK_STREAM, 0);
+        } catch (ErrnoException e) {
+            throw new IOException(e);
+        }
+
+        try {
+            Os.setsockoptInt(fd, OsConstants.SOL_SOCKET, OsConstants.SO_REUSEADDR, 1);
+            Os.bind(fd, InetAddress.getByAddress(new byte[4]), port); // INADDR_ANY
+            Os.listen(fd, 3);
+        } catch (ErrnoException | SocketException e) {
+            closeQuietly(fd);
+            throw new IOException(e);
+        }
+
+        return new DirectTcpServer(fd, token);
+    }
+
+    /**
+     * Accept the next authenticated connection.
+     * <p>
+     * The tokens of the pending connections are read concurrently, so that a peer which does not send anything does not delay the
+     * authentication of the others.
+     *
+     * @return the connected socket
+     */
+    public FileDescriptor accept() throws IOException {
+        while (true) {
+            long now = SystemClock.uptimeMillis();
+            int timeout = -1;
+            for (int i = pending.size() - 1; i >= 0; --i) {
+                Peer peer = pending.get(i);
+                int remaining = (int) (peer.deadline - now);
+                if (remaining <= 0) {
+                    reject(i, "timeout");
+                } else if (timeout == -1 || remaining < timeout) {
+                    timeout = remaining;
+                }
+            }
+
+            StructPollfd[] pollFds = new StructPollfd[pending.size() + 1];
+            for (int i = 0; i < pollFds.length; ++i) {
+                StructPollfd pollFd = new StructPollfd();
+                pollFd.fd = i == 0 ? fd : pending.get(i - 1).fd;
+                pollFd.events = (short) OsConstants.POLLIN;
+                pollFds[i] = pollFd;
+            }
+
+            try {
+                Os.poll(pollFds, timeout);
+            } catch (ErrnoException e) {
+                if (e.errno == OsConstants.EINTR) {
+                    continue;
+                }
+                throw new IOException(e);
+            }
+
+            // In the order of the connections, the client connects its sockets in a specific order
+            int removed = 0;
+            for (int i = 1; i < pollFds.length; ++i) {
+                if (pollFds[i].revents == 0) {
+                    continue;
+                }
+                int index = i - 1 - removed;
+                Peer peer = pending.get(index);
+                int result = readToken(peer);
+                if (result > 0) {
+                    pending.remove(index);
+                    return peer.fd;
+                }
+                if (result < 0) {
+                    reject(index, "invalid token");
+                    ++removed;
+                }
+            }
+
+            short revents = pollFds[0].revents;
+            if ((revents & (OsConstants.POLLERR | OsConstants.POLLNVAL)) != 0) {
+                throw new IOException("Direct TCP server socket error");
+            }
+            if ((revents & OsConstants.POLLIN) != 0) {
+                acceptPeer();
+            }
+        }
+    }
+
+    private void acceptPeer() throws IOException {
+        FileDescriptor socket;
+        try {
+            socket = Os.accept(fd, null);
+        } catch (ErrnoException | SocketException e) {
+            if (e instanceof ErrnoException && ((ErrnoException) e).errno == OsConstants.EINTR) {
+                return;
+            }
+            throw new IOException(e);
+        }
+
+        if (pending.size() == MAX_PENDING_PEERS) {
+            // Do not let unauthenticated peers exhaust the file descriptors
+            reject(0, "too many pending connections");
+        }
+
+        Peer peer = new Peer();
+        peer.fd = socket;
+        peer.received = new byte[token.length];
+        peer.deadline = SystemClock.uptimeMillis() + TOKEN_TIMEOUT_MS;
+        pending.add(peer);
+    }
+
+    private void reject(int index, String reason) {
+        Peer peer = pending.remove(index);
+        closeQuietly(peer.fd);
+        Ln.w("Rejected a direct TCP connection (" + reason + ")");
+    }
+
+    /**
+     * Read the available bytes of the token (the socket is readable).
+     *
+     * @return 1 if the whole token is received and valid, -1 if the connection must be rejected, 0 if more bytes are expected
+     */
+    private int readToken(Peer peer) {
+        byte[] received = peer.received;
+        try {
+            int r = Os.read(peer.fd, received, peer.offset, received.length - peer.offset);
+            if (r == 0) {
+                return -1;
+            }
+            peer.offset += r;
+        } catch (ErrnoException | IOException e) {
+            return -1;
+        }
+
+        if (peer.offset < received.length) {
+            return 0;
+        }
+
+        // Constant-time comparison
+        return MessageDigest.isEqual(received, token) ? 1 : -1;
+    }
+
+    static void closeQuietly(FileDescriptor fd) {
+        try {
+            Os.close(fd);
+        } catch (ErrnoException e) {
+            // ignore
+        }
+    }
+
+    @Override
+    public void close() {
+        for (Peer peer : pending) {
+            closeQuietly(peer.fd);
+        }
+        pending.clear();
+        closeQuietly(fd);
+    }
+}
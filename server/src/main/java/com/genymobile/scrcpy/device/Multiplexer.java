@@ -0,0 +1,275 @@
+package com.genymobile.scrcpy.device;
+
+import com.genymobile.scrcpy.util.IO;
+import com.genymobile.scrcpy.util.Ln;
+
+import android.system.ErrnoException;
+import android.system.Os;
+import android.system.OsConstants;
+import android.system.StructPollfd;
+
+import java.io.BufferedInputStream;
+import java.io.Closeable;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.FileDescriptor;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Carry the video, audio and control streams over a single socket (--multiplex).
+ * <p>
+ * Each stream is exposed to its component (a {@link Streamer} or the {@link com.genymobile.scrcpy.control.ControlChannel}) as one end of a
+ * local socket pair, so the components are not aware of the multiplexing. The data is transmitted in frames:
+ *
+ * <pre>
+ *     [channel (1 byte)] [payload length (4 bytes)] [payload]
+ * </pre>
+ * <p>
+ * When several channels have pending data, control is sent first, then audio, then video. The data is sent in chunks of limited size, so
+ * that a large video key frame does not delay the audio packets and the device messages for long.
+ */
+public final class Multiplexer implements Closeable {
+
+    public static final int CHANNEL_VIDEO = 0;
+    public static final int CHANNEL_AUDIO = 1;
+    public static final int CHANNEL_CONTROL = 2;
+    private static final int CHANNEL_COUNT = 3;
+
+    // Channels in decreasing priority order
+    private static final int[] PRIORITIES = {CHANNEL_CONTROL, CHANNEL_AUDIO, CHANNEL_VIDEO};
+
+    private static final int HEADER_LENGTH = 5;
+    private static final int MAX_CHUNK_LENGTH = 16 * 1024;
+
+    private final FileDescriptor socketFd;
+
+    // The ends used by the components, indexed by channel (null if the channel is disabled)
+    private final FileDescriptor[] externalFds = new FileDescriptor[CHANNEL_COUNT];
+    // The ends read and written by the multiplexer, indexed by channel
+    private final FileDescriptor[] internalFds = new FileDescriptor[CHANNEL_COUNT];
+
+    private Thread sendThread;
+    private Thread receiveThread;
+    private volatile boolean stopped;
+
+    private Multiplexer(FileDescriptor socketFd) {
+        this.socketFd = socketFd;
+    }
+
+    /**
+     * Start multiplexing the enabled channels over the socket.
+     * <p>
+     * On error, the socket is not closed (it is still owned by the caller).
+     */
+    public static Multiplexer start(FileDescriptor socketFd, boolean video, boolean audio, boolean control) throws IOException {
+        Multiplexer multiplexer = new Multiplexer(socketFd);
+        try {
+            if (video) {
+                multiplexer.openChannel(CHANNEL_VIDEO);
+            }
+            if (audio) {
+                multiplexer.openChannel(CHANNEL_AUDIO);
+            }
+            if (control) {
+                multiplexer.openChannel(CHANNEL_CONTROL);
+            }
+        } catch (IOException e) {
+            multiplexer.closeChannels();
+            throw e;
+        }
+
+        multiplexer.sendThread = new Thread(multiplexer::sendLoop, "mux-send");
+        multiplexer.sendThread.start();
+        if (control) {
+            // Only the control channel carries data from the client
+            multiplexer.receiveThread = new Thread(multiplexer::receiveLoop, "mux-receive");
+            multiplexer.receiveThread.start();
+        }
+
+        return multiplexer;
+    }
+
+    private void openChannel(int channel) throws IOException {
+        FileDescriptor external = new FileDescriptor();
+        FileDescriptor internal = new FileDescriptor();
+        try {
+            Os.socketpair(OsConstants.AF_UNIX, OsConstants.SOCK_STREAM, 0, external, internal);
+        } catch (ErrnoException e) {
+            throw new IOException(e);
+        }
+        externalFds[channel] = external;
+        internalFds[channel] = internal;
+    }
+
+    /**
+     * Return the file descriptor to be used by the component of a channel.
+     */
+    public FileDescriptor getFd(int channel) {
+        return externalFds[channel];
+    }
+
+    private void sendLoop() {
+        List<StructPollfd> pollFds = new ArrayList<>();
+        for (int channel : PRIORITIES) {
+            if (internalFds[channel] != null) {
+                StructPollfd pollFd = new StructPollfd();
+                pollFd.fd = internalFds[channel];
+                pollFd.events = (short) OsConstants.POLLIN;
+                pollFd.userData = channel;
+                pollFds.add(pollFd);
+            }
+        }
+
+        byte[] buffer = new byte[HEADER_LENGTH + MAX_CHUNK_LENGTH];
+        try {
+            while (!pollFds.isEmpty()) {
+                poll(pollFds);
+
+                // Only serve the channel with the highest priority, then poll again
+                for (int i = 0; i < pollFds.size(); ++i) {
+                    StructPollfd pollFd = pollFds.get(i);
+                    if (pollFd.revents == 0) {
+                        continue;
+                    }
+
+                    int r = read(pollFd.fd, buffer, HEADER_LENGTH, MAX_CHUNK_LENGTH);
+                    if (r == 0) {
+                        // The component closed its end
+                        pollFds.remove(i);
+                        break;
+                    }
+
+                    int channel = (Integer) pollFd.userData;
+                    buffer[0] = (byte) channel;
+                    buffer[1] = (byte) (r >>> 24);
+                    buffer[2] = (byte) (r >>> 16);
+                    buffer[3] = (byte) (r >>> 8);
+                    buffer[4] = (byte) r;
+                    IO.writeFully(socketFd, buffer, 0, HEADER_LENGTH + r);
+                    break;
+                }
+            }
+        } catch (IOException e) {
+            if (!stopped && !IO.isBrokenPipe(e)) {
+                Ln.e("Multiplexer send error", e);
+            }
+        } finally {
+            disconnect();
+        }
+    }
+
+    private void receiveLoop() {
+        byte[] payload = new byte[MAX_CHUNK_LENGTH];
+        try {
+            DataInputStream input = new DataInputStream(new BufferedInputStream(new FileInputStream(socketFd)));
+            while (true) {
+                int channel = input.readUnsignedByte();
+                int length = input.readInt();
+                if (channel != CHANNEL_CONTROL || length < 0 || length > MAX_CHUNK_LENGTH) {
+                    throw new IOException("Invalid multiplexed frame (channel " + channel + ", length " + length + ")");
+                }
+                input.readFully(payload, 0, length);
+                IO.writeFully(internalFds[CHANNEL_CONTROL], payload, 0, length);
+            }
+        } catch (EOFException e) {
+            // The client disconnected
+        } catch (IOException e) {
+            if (!stopped && !IO.isBrokenPipe(e)) {
+                Ln.e("Multiplexer receive error", e);
+            }
+        } finally {
+            disconnect();
+        }
+    }
+
+    private static void poll(List<StructPollfd> pollFds) throws IOException {
+        StructPollfd[] array = pollFds.toArray(new StructPollfd[0]);
+        while (true) {
+            try {
+                Os.poll(array, -1);
+                return;
+            } catch (ErrnoException e) {
+                if (e.errno != OsConstants.EINTR) {
+                    throw new IOException(e);
+                }
+            }
+        }
+    }
+
+    private static int read(FileDescriptor fd, byte[] buffer, int offset, int len) throws IOException {
+        while (true) {
+            try {
+                return Os.read(fd, buffer, offset, len);
+            } catch (ErrnoException e) {
+                if (e.errno != OsConstants.EINTR) {
+                    throw new IOException(e);
+                }
+            }
+        }
+    }
+
+    private static void shutdown(FileDescriptor fd) {
+        if (fd != null) {
+            try {
+                Os.shutdown(fd, OsConstants.SHUT_RDWR);
+            } catch (ErrnoException e) {
+                // ignore
+            }
+        }
+    }
+
+    // Make the components and the other thread fail as if their own socket was disconnected
+    private void disconnect() {
+        shutdown(socketFd);
+        for (FileDescriptor fd : internalFds) {
+            shutdown(fd);
+        }
+    }
+
+    public void shutdown() {
+        stopped = true;
+        disconnect();
+        for (FileDescriptor fd : externalFds) {
+            shutdown(fd);
+        }
+    }
+
+    private void closeChannels() {
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            closeQuietly(externalFds[i]);
+            closeQuietly(internalFds[i]);
+        }
+    }
+
+    private static void closeQuietly(FileDescriptor fd) {
+        if (fd != null && fd.valid()) {
+            try {
+                Os.close(fd);
+            } catch (ErrnoException e) {
+                // ignore
+            }
+        }
+    }
+
+    /**
+     * Stop the multiplexer and close the channels.
+     * <p>
+     * The socket itself is not closed (it is owned by the caller).
+     */
+    @Override
+    public void close() {
+        shutdown();
+        try {
+            sendThread.join();
+            if (receiveThread != null) {
+                receiveThread.join();
+            }
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        closeChannels();
+    }
+}
@@ -0,0 +1,279 @@
+package com.genymobile.scrcpy.device;
+
+import com.genymobile.scrcpy.model.Codec;
+import com.genymobile.scrcpy.util.Ln;
+
+import android.media.MediaCodec;
+
+import java.io.IOException;
+import java.io.InterruptedIOException;
+import java.nio.ByteBuffer;
+
+/**
+ * Decouple the encoder output from the socket writes.
+ * <p>
+ * The encoded packets are copied to a small pool of buffers, so that the encoder buffers are released immediately, and written to the
+ * socket by a separate thread. A slow socket does not hold the encoder buffers (which would stall the encoder).
+ * <p>
+ * If the queue is full, the caller waits for a free buffer. Optionally (if a sync frame requester is provided), the new packet is dropped
+ * instead, along with all the following packets until the next key frame (the decoder could not decode them anyway), and a key frame is
+ * requested (at most once per second). Config packets and key frames are never dropped.
+ * <p>
+ * The session headers must also be queued, to be written in order with the packets (the streamer must not be used concurrently).
+ */
+public final class PacketPipeline {
+
+    public static final int DEFAULT_CAPACITY = 4;
+
+    private static final long STATS_INTERVAL_NS = 5_000_000_000L;
+    private static final long SYNC_FRAME_REQUEST_INTERVAL_NS = 1_000_000_000L;
+
+    private static final class Packet {
+        private ByteBuffer buffer;
+        private long pts;
+        private boolean config;
+        private boolean keyFrame;
+        private long dequeueTimeNs;
+        // If set, the packet is a session header (the buffer is unused)
+        private boolean session;
+        private int width;
+        private int height;
+        private boolean clientResize;
+    }
+
+    private final Streamer streamer;
+    private final Runnable syncFrameRequester;
+
+    private final Object lock = new Object();
+    // Ring buffer of packets: the queued packets are in [head, head + count), the packet at head is being written
+    private final Packet[] packets;
+    private int head;
+    private int count;
+    private boolean stopped;
+    private IOException error;
+
+    // Drop all the packets until the next key frame
+    private boolean dropping;
+    // Requesting a key frame for every dropped packet would saturate the encoder (a key frame is large, and makes the congestion worse)
+    private boolean syncFrameRequested;
+    private long lastSyncFrameRequestNs;
+
+    // Statistics, logged periodically (in debug)
+    private int statsPackets;
+    private long statsTotalLatencyNs;
+    private long statsMaxLatencyNs;
+    private int statsDropped;
+    private long statsStartNs;
+
+    private Thread thread;
+
+    /**
+     * @param streamer           the streamer to write the packets to
+     * @param capacity           the number of packets which may be queued
+     * @param syncFrameRequester called to request a key frame after packets have been dropped, or {@code null} to never drop packets
+     */
+    public PacketPipeline(Streamer streamer, int capacity, Runnable syncFrameRequester) {
+        this.streamer = streamer;
+        this.syncFrameRequester = syncFrameRequester;
+        packets = new Packet[capacity];
+        for (int i = 0; i < capacity; ++i) {
+            packets[i] = new Packet();
+        }
+    }
+
+    public void start() {
+        statsStartNs = System.nanoTime();
+        String name = streamer.getCodec().getType() == Codec.Type.VIDEO ? "video-writer" : "audio-writer";
+        thread = new Thread(this::run, name);
+        thread.start();
+    }
+
+    private void run() {
+        try {
+            while (true) {
+                Packet packet;
+                synchronized (lock) {
+                    while (count == 0 && !stopped) {
+                        lock.wait();
+                    }
+                    if (stopped) {
+                        return;
+                    }
+                    // The packet remains in the queue (so its buffer is not reused) until it is written
+                    packet = packets[head];
+                }
+
+                if (packet.session) {
+                    streamer.writeSessionMeta(packet.width, packet.height, packet.clientResize);
+                } else {
+                    streamer.writePacket(packet.buffer, packet.pts, packet.config, packet.keyFrame);
+                }
+                long now = System.nanoTime();
+
+                synchronized (lock) {
+                    head = (head + 1) % packets.length;
+                    --count;
+                    lock.notifyAll();
+
+                    updateStats(now, now - packet.dequeueTimeNs);
+                }
+            }
+        } catch (IOException e) {
+            synchronized (lock) {
+                error = e;
+                lock.notifyAll();
+            }
+        } catch (InterruptedException e) {
+            // stopped
+        }
+    }
+
+    private void updateStats(long now, long latencyNs) {
+        ++statsPackets;
+        statsTotalLatencyNs += latencyNs;
+        if (latencyNs > statsMaxLatencyNs) {
+            statsMaxLatencyNs = latencyNs;
+        }
+
+        if (now - statsStartNs >= STATS_INTERVAL_NS) {
+            if (Ln.isEnabled(Ln.Level.DEBUG)) {
+                float avgMs = statsTotalLatencyNs / 1e6f / statsPackets;
+                float maxMs = statsMaxLatencyNs / 1e6f;
+                Ln.d(String.format("Packet pipeline: %d packets, dequeue-to-send latency avg %.1f ms, max %.1f ms, %d dropped", statsPackets,
+                        avgMs, maxMs, statsDropped));
+            }
+            statsPackets = 0;
+            statsTotalLatencyNs = 0;
+            statsMaxLatencyNs = 0;
+            statsDropped = 0;
+            statsStartNs = now;
+        }
+    }
+
+    private void checkError() throws IOException {
+        if (error != null) {
+            throw error;
+        }
+    }
+
+    /**
+     * Queue a copy of the packet to be written.
+     * <p>
+     * The codec buffer may be released as soon as this method returns.
+     */
+    public void push(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException {
+        long dequeueTimeNs = System.nanoTime();
+        boolean config = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
+        boolean keyFrame = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0;
+        boolean droppable = syncFrameRequester != null && !config && !keyFrame;
+
+        boolean requestSyncFrame = false;
+        synchronized (lock) {
+            checkError();
+
+            if (droppable && (dropping || count == packets.length)) {
+                dropping = true;
+                // Request again if the previous request did not produce a key frame in time
+                if (!syncFrameRequested || dequeueTimeNs - lastSyncFrameRequestNs >= SYNC_FRAME_REQUEST_INTERVAL_NS) {
+                    syncFrameRequested = true;
+                    lastSyncFrameRequestNs = dequeueTimeNs;
+                    requestSyncFrame = true;
+                }
+                ++statsDropped;
+            } else {
+                try {
+                    while (count == packets.length && error == null) {
+                        lock.wait();
+                    }
+                } catch (InterruptedException e) {
+                    Thread.currentThread().interrupt();
+                    throw new InterruptedIOException();
+                }
+                checkError();
+
+                if (keyFrame) {
+                    dropping = false;
+                }
+
+                Packet packet = packets[(head + count) % packets.length];
+                copy(codecBuffer, bufferInfo, packet);
+                packet.pts = bufferInfo.presentationTimeUs;
+                packet.config = config;
+                packet.keyFrame = keyFrame;
+                packet.dequeueTimeNs = dequeueTimeNs;
+                packet.session = false;
+
+                ++count;
+                lock.notifyAll();
+            }
+        }
+
+        if (requestSyncFrame) {
+            syncFrameRequester.run();
+        }
+    }
+
+    /**
+     * Queue a session header, to be written after the packets already queued.
+     * <p>
+     * It is never dropped: the caller waits for a free slot.
+     */
+    public void pushSession(int width, int height, boolean clientResize) throws IOException {
+        synchronized (lock) {
+            try {
+                while (count == packets.length && error == null) {
+                    lock.wait();
+                }
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                throw new InterruptedIOException();
+            }
+            checkError();
+
+            Packet packet = packets[(head + count) % packets.length];
+            packet.session = true;
+            packet.width = width;
+            packet.height = height;
+            packet.clientResize = clientResize;
+            packet.dequeueTimeNs = System.nanoTime();
+
+            ++count;
+            lock.notifyAll();
+        }
+    }
+
+    private static void copy(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo, Packet packet) {
+        int size = bufferInfo.size;
+        ByteBuffer buffer = packet.buffer;
+        if (buffer == null || buffer.capacity() < size) {
+            // Grow geometrically to avoid reallocating on each larger key frame
+            int capacity = buffer == null ? size : Math.max(size, 2 * buffer.capacity());
+            buffer = ByteBuffer.allocateDirect(capacity);
+            packet.buffer = buffer;
+        }
+
+        ByteBuffer src = codecBuffer.duplicate();
+        src.limit(bufferInfo.offset + size);
+        src.position(bufferInfo.offset);
+
+        buffer.clear();
+        buffer.put(src);
+        buffer.flip();
+    }
+
+    /**
+     * Stop the writer thread, without writing the pending packets.
+     */
+    public void stop() {
+        synchronized (lock) {
+            stopped = true;
+            lock.notifyAll();
+        }
+    }
+
+    public void join() throws InterruptedException {
+        if (thread != null) {
+            thread.join();
+        }
+    }
+}
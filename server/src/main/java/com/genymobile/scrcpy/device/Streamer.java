@@ -2,7 +2,10 @@ package com.genymobile.scrcpy.device;
 
 import com.genymobile.scrcpy.audio.AudioCodec;
 import com.genymobile.scrcpy.model.Codec;
+import com.genymobile.scrcpy.util.GatheringWriter;
 import com.genymobile.scrcpy.util.IO;
+import com.genymobile.scrcpy.util.StartupTimer;
+import com.genymobile.scrcpy.video.DirtyRegions;
 
 import android.media.MediaCodec;
 
@@ -17,25 +20,44 @@ public final class Streamer {
     private static final long PACKET_FLAG_SESSION = 1L << 63;
     private static final long PACKET_FLAG_CONFIG = 1L << 62;
     private static final long PACKET_FLAG_KEY_FRAME = 1L << 61;
+    private static final long PACKET_FLAG_DIRTY_RECTS = 1L << 60;
+
+    // u16 count, then (u16 x, u16 y, u16 width, u16 height) for each rectangle
+    private static final int DIRTY_RECTS_MAX_SIZE = 2 + 8 * DirtyRegions.MAX_RECTS;
 
     private final FileDescriptor fd;
     private final Codec codec;
     private final boolean sendStreamMeta;
     private final boolean sendFrameMeta;
 
-    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
+    private final ByteBuffer headerBuffer = ByteBuffer.allocate(12 + DIRTY_RECTS_MAX_SIZE);
+    // Write the frame header and the packet in a single syscall
+    private final GatheringWriter gatheringWriter;
+
+    private boolean firstPacketWritten;
+
+    private DirtyRegions dirtyRegions;
+    private final int[] dirtyRects = new int[4 * DirtyRegions.MAX_RECTS];
 
     public Streamer(FileDescriptor fd, Codec codec, boolean sendCodecMeta, boolean sendFrameMeta) {
         this.fd = fd;
         this.codec = codec;
         this.sendStreamMeta = sendCodecMeta;
         this.sendFrameMeta = sendFrameMeta;
+        gatheringWriter = new GatheringWriter(fd);
     }
 
     public Codec getCodec() {
         return codec;
     }
 
+    /**
+     * Send the dirty rectangles of each video frame (if frame meta is enabled).
+     */
+    public void setDirtyRegions(DirtyRegions dirtyRegions) {
+        this.dirtyRegions = dirtyRegions;
+    }
+
     public void writeAudioHeader() throws IOException {
         if (sendStreamMeta) {
             ByteBuffer buffer = ByteBuffer.allocate(4);
@@ -75,10 +97,16 @@ public final class Streamer {
         }
 
         if (sendFrameMeta) {
-            writeFrameMeta(fd, buffer.remaining(), pts, config, keyFrame);
+            prepareFrameMeta(buffer.remaining(), pts, config, keyFrame);
+            gatheringWriter.writeFully(headerBuffer.array(), headerBuffer.remaining(), buffer);
+        } else {
+            IO.writeFully(fd, buffer);
         }
 
-        IO.writeFully(fd, buffer);
+        if (!firstPacketWritten && !config) {
+            firstPacketWritten = true;
+            StartupTimer.mark(codec.getType() == Codec.Type.VIDEO ? StartupTimer.Phase.FIRST_VIDEO_PACKET : StartupTimer.Phase.FIRST_AUDIO_PACKET);
+        }
     }
 
     public void writePacket(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException {
@@ -104,23 +132,38 @@ public final class Streamer {
         }
     }
 
-    private void writeFrameMeta(FileDescriptor fd, int packetSize, long pts, boolean config, boolean keyFrame) throws IOException {
+    private void prepareFrameMeta(int packetSize, long pts, boolean config, boolean keyFrame) {
         headerBuffer.clear();
 
         long ptsAndFlags;
+        int rectCount = -1;
         if (config) {
             ptsAndFlags = PACKET_FLAG_CONFIG; // non-media data packet
         } else {
             ptsAndFlags = pts;
+            if (dirtyRegions != null) {
+                // Always poll, to consume the rendered frames up to this PTS
+                rectCount = dirtyRegions.poll(pts, dirtyRects);
+            }
             if (keyFrame) {
                 ptsAndFlags |= PACKET_FLAG_KEY_FRAME;
+                // A key frame replaces the whole picture
+                rectCount = -1;
+            }
+            if (rectCount != -1) {
+                ptsAndFlags |= PACKET_FLAG_DIRTY_RECTS;
             }
         }
 
         headerBuffer.putLong(ptsAndFlags);
         headerBuffer.putInt(packetSize);
+        if (rectCount != -1) {
+            headerBuffer.putShort((short) rectCount);
+            for (int i = 0; i < 4 * rectCount; ++i) {
+                headerBuffer.putShort((short) dirtyRects[i]);
+            }
+        }
         headerBuffer.flip();
-        IO.writeFully(fd, headerBuffer);
     }
 
     private static void fixOpusConfigPacket(ByteBuffer buffer) throws IOException {
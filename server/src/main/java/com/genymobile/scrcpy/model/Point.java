@@ -3,14 +3,24 @@ package com.genymobile.scrcpy.model;
 import java.util.Objects;
 
 public class Point {
-    private final int x;
-    private final int y;
+    private int x;
+    private int y;
 
     public Point(int x, int y) {
         this.x = x;
         this.y = y;
     }
 
+    /**
+     * Update the coordinates in place.
+     * <p>
+     * Only for instances not shared with other users (for example the position of a reused control message, valid until the next message).
+     */
+    public void set(int x, int y) {
+        this.x = x;
+        this.y = y;
+    }
+
     public int getX() {
         return x;
     }
@@ -0,0 +1,127 @@
+package com.genymobile.scrcpy.opengl;
+
+import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.AffineMatrix;
+import com.genymobile.scrcpy.video.VideoScaleFilter;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Compose the render passes to transform, downscale and sharpen the captured frames.
+ * <p>
+ * The Lanczos downscale is separable: a first pass applies the transform and filters horizontally (to the output width), a second pass filters
+ * vertically (to the output height). The second pass is omitted if the height is not reduced.
+ */
+public final class FilterChain {
+
+    // Number of lobes of the Lanczos kernel on each side
+    public static final int LANCZOS_A = 3;
+
+    // Maximum number of taps on each side of the center (the bound of the shader loop)
+    public static final int MAX_RADIUS = 8;
+
+    private FilterChain() {
+        // not instantiable
+    }
+
+    /**
+     * Indicate whether the filter chain is necessary (otherwise, a single bilinear pass is sufficient).
+     */
+    public static boolean isRequired(VideoScaleFilter scaleFilter, float sharpen) {
+        return scaleFilter == VideoScaleFilter.LANCZOS || sharpen > 0;
+    }
+
+    /**
+     * Create the render passes.
+     *
+     * @param transform   the transform from the output coordinates to the input coordinates (may be {@code null})
+     * @param sourceSize  the size of the content at full resolution, in the output orientation
+     * @param outputSize  the output size
+     * @param scaleFilter the scale filter ({@code null} for bilinear)
+     * @param sharpen     the sharpening amount ({@code 0} to disable)
+     * @return the render passes, to execute in order
+     */
+    public static List<FilterPass> createPasses(AffineMatrix transform, Size sourceSize, Size outputSize, VideoScaleFilter scaleFilter,
+            float sharpen) {
+        if (transform == null) {
+            transform = AffineMatrix.IDENTITY;
+        }
+
+        List<FilterPass> passes = new ArrayList<>();
+        if (scaleFilter == VideoScaleFilter.LANCZOS) {
+            int sourceHeight = sourceSize.getHeight();
+            double scaleX = (double) sourceSize.getWidth() / outputSize.getWidth();
+            double scaleY = (double) sourceHeight / outputSize.getHeight();
+
+            // If the height is not reduced, the first pass renders directly at the output size (with bilinear sampling vertically)
+            boolean verticalPass = scaleY > 1;
+            Size horizontalPassSize = verticalPass ? new Size(outputSize.getWidth(), sourceHeight) : outputSize;
+
+            passes.add(createLanczosPass(horizontalPassSize, transform, sourceSize.getWidth(), scaleX, true));
+            if (verticalPass) {
+                passes.add(createLanczosPass(outputSize, AffineMatrix.IDENTITY, sourceHeight, scaleY, false));
+            }
+        } else {
+            passes.add(FilterPass.createResample(outputSize, transform, 0, 0, new float[] {1}));
+        }
+
+        if (sharpen > 0) {
+            passes.add(FilterPass.createSharpen(outputSize, sharpen));
+        }
+
+        return passes;
+    }
+
+    private static FilterPass createLanczosPass(Size outputSize, AffineMatrix transform, int sourceLength, double scale, boolean horizontal) {
+        if (scale <= 1) {
+            // Not downscaled along this axis, a bilinear sample is sufficient
+            return FilterPass.createResample(outputSize, transform, 0, 0, new float[] {1});
+        }
+
+        // The kernel covers LANCZOS_A * scale source pixels on each side. If this exceeds the maximum number of taps, space them further
+        // (the bilinear sampling of each tap averages the pixels in between).
+        double support = LANCZOS_A * scale;
+        double spacing = Math.max(1, support / (MAX_RADIUS + 1));
+        int radius = Math.min(MAX_RADIUS, (int) Math.ceil(support / spacing) - 1);
+        float[] weights = computeLanczosWeights(radius, spacing / scale);
+
+        // Spacing between taps, in the output coordinates (normalized), converted to the input coordinates
+        double step = spacing / sourceLength;
+        float[] inputStep = horizontal ? transform.applyToVector(step, 0) : transform.applyToVector(0, step);
+        return FilterPass.createResample(outputSize, transform, inputStep[0], inputStep[1], weights);
+    }
+
+    /**
+     * Compute the normalized weights of the taps.
+     *
+     * @param radius      the number of taps on each side of the center
+     * @param tapDistance the distance between two taps, in kernel units
+     * @return the weights of the center and of each side tap (the sum of all the {@code 2 * radius + 1} weights is 1)
+     */
+    static float[] computeLanczosWeights(int radius, double tapDistance) {
+        double[] values = new double[radius + 1];
+        double sum = 0;
+        for (int i = 0; i <= radius; ++i) {
+            values[i] = lanczos(i * tapDistance);
+            sum += i == 0 ? values[i] : 2 * values[i];
+        }
+
+        float[] weights = new float[radius + 1];
+        for (int i = 0; i <= radius; ++i) {
+            weights[i] = (float) (values[i] / sum);
+        }
+        return weights;
+    }
+
+    static double lanczos(double x) {
+        if (x == 0) {
+            return 1;
+        }
+        if (Math.abs(x) >= LANCZOS_A) {
+            return 0;
+        }
+        double px = Math.PI * x;
+        return LANCZOS_A * Math.sin(px) * Math.sin(px / LANCZOS_A) / (px * px);
+    }
+}
@@ -0,0 +1,345 @@
+package com.genymobile.scrcpy.opengl;
+
+import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.AffineMatrix;
+
+import android.opengl.GLES11Ext;
+import android.opengl.GLES20;
+
+import java.nio.FloatBuffer;
+import java.util.List;
+
+/**
+ * Execute the render passes of a {@link FilterChain}.
+ * <p>
+ * Each pass except the last one renders to an intermediate texture, read by the next pass.
+ */
+public class FilterChainOpenGLFilter implements OpenGLFilter {
+
+    private static final float[] IDENTITY_MATRIX = AffineMatrix.IDENTITY.to4x4();
+
+    private static final class Program {
+        private int id;
+
+        private int vertexPosLoc;
+        private int texCoordsInLoc;
+
+        private int texLoc;
+        private int texMatrixLoc;
+        private int userMatrixLoc;
+        private int stepLoc;
+
+        // RESAMPLE only
+        private int radiusLoc;
+        private int weightsLoc;
+
+        // SHARPEN only
+        private int amountLoc;
+    }
+
+    private final List<FilterPass> passes;
+    private final float[][] userMatrices;
+
+    private Program resampleExternalProgram;
+    private Program resampleProgram;
+    private Program sharpenProgram;
+
+    private FloatBuffer vertexBuffer;
+    private FloatBuffer texCoordsBuffer;
+
+    // The intermediate framebuffers and textures (the output of each pass except the last one)
+    private int[] framebuffers;
+    private int[] textures;
+
+    public FilterChainOpenGLFilter(List<FilterPass> passes) {
+        assert !passes.isEmpty();
+        assert passes.get(0).getType() == FilterPass.Type.RESAMPLE : "The first pass must read the external texture";
+        this.passes = passes;
+        userMatrices = new float[passes.size()][];
+        for (int i = 0; i < passes.size(); ++i) {
+            userMatrices[i] = passes.get(i).getTransform().to4x4();
+        }
+    }
+
+    @Override
+    public void init() throws OpenGLException {
+        resampleExternalProgram = createResampleProgram(true);
+        for (int i = 1; i < passes.size(); ++i) {
+            FilterPass.Type type = passes.get(i).getType();
+            if (type == FilterPass.Type.RESAMPLE && resampleProgram == null) {
+                resampleProgram = createResampleProgram(false);
+            } else if (type == FilterPass.Type.SHARPEN && sharpenProgram == null) {
+                sharpenProgram = createSharpenProgram();
+            }
+        }
+
+        float[] vertices = {
+                -1, -1, // Bottom-left
+                1, -1, // Bottom-right
+                -1, 1, // Top-left
+                1, 1, // Top-right
+        };
+
+        float[] texCoords = {
+                0, 0, // Bottom-left
+                1, 0, // Bottom-right
+                0, 1, // Top-left
+                1, 1, // Top-right
+        };
+
+        vertexBuffer = GLUtils.createFloatBuffer(vertices);
+        texCoordsBuffer = GLUtils.createFloatBuffer(texCoords);
+
+        int intermediateCount = passes.size() - 1;
+        framebuffers = new int[intermediateCount];
+        textures = new int[intermediateCount];
+        if (intermediateCount > 0) {
+            GLES20.glGenFramebuffers(intermediateCount, framebuffers, 0);
+            GLUtils.checkGlError();
+            GLES20.glGenTextures(intermediateCount, textures, 0);
+            GLUtils.checkGlError();
+        }
+
+        for (int i = 0; i < intermediateCount; ++i) {
+            Size size = passes.get(i).getOutputSize();
+            GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textures[i]);
+            GLUtils.checkGlError();
+            GLES20.glTexImage2D(GLES20.GL_TEXTURE_2D, 0, GLES20.GL_RGBA, size.getWidth(), size.getHeight(), 0, GLES20.GL_RGBA,
+                    GLES20.GL_UNSIGNED_BYTE, null);
+            GLUtils.checkGlError();
+            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MIN_FILTER, GLES20.GL_LINEAR);
+            GLUtils.checkGlError();
+            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MAG_FILTER, GLES20.GL_LINEAR);
+            GLUtils.checkGlError();
+            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_WRAP_S, GLES20.GL_CLAMP_TO_EDGE);
+            GLUtils.checkGlError();
+            GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_WRAP_T, GLES20.GL_CLAMP_TO_EDGE);
+            GLUtils.checkGlError();
+
+            GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, framebuffers[i]);
+            GLUtils.checkGlError();
+            GLES20.glFramebufferTexture2D(GLES20.GL_FRAMEBUFFER, GLES20.GL_COLOR_ATTACHMENT0, GLES20.GL_TEXTURE_2D, textures[i], 0);
+            GLUtils.checkGlError();
+            int status = GLES20.glCheckFramebufferStatus(GLES20.GL_FRAMEBUFFER);
+            GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, 0);
+            if (status != GLES20.GL_FRAMEBUFFER_COMPLETE) {
+                throw new OpenGLException("Framebuffer incomplete: 0x" + Integer.toHexString(status));
+            }
+        }
+        GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, 0);
+        GLUtils.checkGlError();
+    }
+
+    private static String createVertexShaderCode() {
+        // @formatter:off
+        return "#version 100\n"
+                + "attribute vec4 vertex_pos;\n"
+                + "attribute vec4 tex_coords_in;\n"
+                + "varying vec2 tex_coords;\n"
+                + "varying vec2 tex_step;\n"
+                + "uniform mat4 tex_matrix;\n"
+                + "uniform mat4 user_matrix;\n"
+                + "uniform vec2 tap_step;\n"
+                + "void main() {\n"
+                + "    gl_Position = vertex_pos;\n"
+                + "    tex_coords = (tex_matrix * user_matrix * tex_coords_in).xy;\n"
+                // The step is a vector in the input coordinates (not a position), so it is not translated
+                + "    tex_step = (tex_matrix * vec4(tap_step, 0.0, 0.0)).xy;\n"
+                + "}";
+    }
+
+    private static Program createResampleProgram(boolean external) throws OpenGLException {
+        // @formatter:off
+        String fragmentShaderCode = "#version 100\n"
+                + (external ? "#extension GL_OES_EGL_image_external : require\n" : "")
+                + "precision highp float;\n"
+                + "#define MAX_RADIUS " + FilterChain.MAX_RADIUS + "\n"
+                + (external ? "uniform samplerExternalOES tex;\n" : "uniform sampler2D tex;\n")
+                + "uniform int radius;\n"
+                + "uniform float weights[MAX_RADIUS + 1];\n"
+                + "varying vec2 tex_coords;\n"
+                + "varying vec2 tex_step;\n"
+                + "vec4 fetch(vec2 coords) {\n"
+                + "    return texture2D(tex, clamp(coords, 0.0, 1.0));\n"
+                + "}\n"
+                + "void main() {\n"
+                + "    if (tex_coords.x < 0.0 || tex_coords.x > 1.0 || tex_coords.y < 0.0 || tex_coords.y > 1.0) {\n"
+                // Outside the input (for example, if the content is rotated by a custom angle)
+                + "        gl_FragColor = vec4(0.0);\n"
+                + "        return;\n"
+                + "    }\n"
+                + "    vec4 sum = weights[0] * fetch(tex_coords);\n"
+                + "    for (int i = 1; i <= MAX_RADIUS; ++i) {\n"
+                + "        if (i > radius) {\n"
+                + "            break;\n"
+                + "        }\n"
+                + "        vec2 offset = float(i) * tex_step;\n"
+                + "        sum += weights[i] * (fetch(tex_coords - offset) + fetch(tex_coords + offset));\n"
+                + "    }\n"
+                + "    gl_FragColor = sum;\n"
+                + "}";
+
+        Program program = createProgram(fragmentShaderCode);
+
+        program.radiusLoc = GLES20.glGetUniformLocation(program.id, "radius");
+        assert program.radiusLoc != -1;
+
+        program.weightsLoc = GLES20.glGetUniformLocation(program.id, "weights");
+        assert program.weightsLoc != -1;
+
+        return program;
+    }
+
+    private static Program createSharpenProgram() throws OpenGLException {
+        // @formatter:off
+        String fragmentShaderCode = "#version 100\n"
+                + "precision highp float;\n"
+                + "uniform sampler2D tex;\n"
+                + "uniform float amount;\n"
+                + "varying vec2 tex_coords;\n"
+                + "varying vec2 tex_step;\n"
+                + "void main() {\n"
+                + "    vec4 center = texture2D(tex, tex_coords);\n"
+                + "    vec4 neighbours = texture2D(tex, tex_coords - vec2(tex_step.x, 0.0))\n"
+                + "                    + texture2D(tex, tex_coords + vec2(tex_step.x, 0.0))\n"
+                + "                    + texture2D(tex, tex_coords - vec2(0.0, tex_step.y))\n"
+                + "                    + texture2D(tex, tex_coords + vec2(0.0, tex_step.y));\n"
+                // Unsharp mask: amplify the difference with the local average
+                + "    gl_FragColor = center + amount * (4.0 * center - neighbours);\n"
+                + "}";
+
+        Program program = createProgram(fragmentShaderCode);
+
+        program.amountLoc = GLES20.glGetUniformLocation(program.id, "amount");
+        assert program.amountLoc != -1;
+
+        return program;
+    }
+
+    private static Program createProgram(String fragmentShaderCode) throws OpenGLException {
+        Program program = new Program();
+        program.id = GLUtils.createProgram(createVertexShaderCode(), fragmentShaderCode);
+        if (program.id == 0) {
+            throw new OpenGLException("Cannot create OpenGL program");
+        }
+
+        program.vertexPosLoc = GLES20.glGetAttribLocation(program.id, "vertex_pos");
+        assert program.vertexPosLoc != -1;
+
+        program.texCoordsInLoc = GLES20.glGetAttribLocation(program.id, "tex_coords_in");
+        assert program.texCoordsInLoc != -1;
+
+        program.texLoc = GLES20.glGetUniformLocation(program.id, "tex");
+        assert program.texLoc != -1;
+
+        program.texMatrixLoc = GLES20.glGetUniformLocation(program.id, "tex_matrix");
+        assert program.texMatrixLoc != -1;
+
+        program.userMatrixLoc = GLES20.glGetUniformLocation(program.id, "user_matrix");
+        assert program.userMatrixLoc != -1;
+
+        program.stepLoc = GLES20.glGetUniformLocation(program.id, "tap_step");
+        assert program.stepLoc != -1;
+
+        return program;
+    }
+
+    @Override
+    public void draw(int textureId, float[] texMatrix) {
+        int inputTexture = textureId;
+        float[] inputTexMatrix = texMatrix;
+
+        int count = passes.size();
+        for (int i = 0; i < count; ++i) {
+            FilterPass pass = passes.get(i);
+            boolean last = i == count - 1;
+
+            // The last pass renders to the output surface
+            GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, last ? 0 : framebuffers[i]);
+            GLUtils.checkGlError();
+            Size size = pass.getOutputSize();
+            GLES20.glViewport(0, 0, size.getWidth(), size.getHeight());
+            GLUtils.checkGlError();
+
+            Program program;
+            if (pass.getType() == FilterPass.Type.SHARPEN) {
+                program = sharpenProgram;
+            } else {
+                program = i == 0 ? resampleExternalProgram : resampleProgram;
+            }
+            int textureTarget = i == 0 ? GLES11Ext.GL_TEXTURE_EXTERNAL_OES : GLES20.GL_TEXTURE_2D;
+            drawPass(program, pass, userMatrices[i], textureTarget, inputTexture, inputTexMatrix);
+
+            if (!last) {
+                inputTexture = textures[i];
+                inputTexMatrix = IDENTITY_MATRIX;
+            }
+        }
+    }
+
+    private void drawPass(Program program, FilterPass pass, float[] userMatrix, int textureTarget, int textureId, float[] texMatrix) {
+        GLES20.glUseProgram(program.id);
+        GLUtils.checkGlError();
+
+        GLES20.glEnableVertexAttribArray(program.vertexPosLoc);
+        GLUtils.checkGlError();
+        GLES20.glEnableVertexAttribArray(program.texCoordsInLoc);
+        GLUtils.checkGlError();
+
+        GLES20.glVertexAttribPointer(program.vertexPosLoc, 2, GLES20.GL_FLOAT, false, 0, vertexBuffer);
+        GLUtils.checkGlError();
+        GLES20.glVertexAttribPointer(program.texCoordsInLoc, 2, GLES20.GL_FLOAT, false, 0, texCoordsBuffer);
+        GLUtils.checkGlError();
+
+        GLES20.glActiveTexture(GLES20.GL_TEXTURE0);
+        GLUtils.checkGlError();
+        GLES20.glBindTexture(textureTarget, textureId);
+        GLUtils.checkGlError();
+        GLES20.glUniform1i(program.texLoc, 0);
+        GLUtils.checkGlError();
+
+        GLES20.glUniformMatrix4fv(program.texMatrixLoc, 1, false, texMatrix, 0);
+        GLUtils.checkGlError();
+        GLES20.glUniformMatrix4fv(program.userMatrixLoc, 1, false, userMatrix, 0);
+        GLUtils.checkGlError();
+        GLES20.glUniform2f(program.stepLoc, pass.getStepX(), pass.getStepY());
+        GLUtils.checkGlError();
+
+        if (pass.getType() == FilterPass.Type.SHARPEN) {
+            GLES20.glUniform1f(program.amountLoc, pass.getAmount());
+            GLUtils.checkGlError();
+        } else {
+            float[] weights = pass.getWeights();
+            GLES20.glUniform1i(program.radiusLoc, pass.getRadius());
+            GLUtils.checkGlError();
+            GLES20.glUniform1fv(program.weightsLoc, weights.length, weights, 0);
+            GLUtils.checkGlError();
+        }
+
+        GLES20.glClear(GLES20.GL_COLOR_BUFFER_BIT);
+        GLUtils.checkGlError();
+        GLES20.glDrawArrays(GLES20.GL_TRIANGLE_STRIP, 0, 4);
+        GLUtils.checkGlError();
+    }
+
+    @Override
+    public void release() {
+        if (framebuffers.length > 0) {
+            GLES20.glDeleteFramebuffers(framebuffers.length, framebuffers, 0);
+            GLUtils.checkGlError();
+            GLES20.glDeleteTextures(textures.length, textures, 0);
+            GLUtils.checkGlError();
+        }
+
+        GLES20.glDeleteProgram(resampleExternalProgram.id);
+        GLUtils.checkGlError();
+        if (resampleProgram != null) {
+            GLES20.glDeleteProgram(resampleProgram.id);
+            GLUtils.checkGlError();
+        }
+        if (sharpenProgram != null) {
+            GLES20.glDeleteProgram(sharpenProgram.id);
+            GLUtils.checkGlError();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+package com.genymobile.scrcpy.opengl;
+
+import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.AffineMatrix;
+
+/**
+ * A render pass of a {@link FilterChain}.
+ * <p>
+ * All the coordinates are normalized (in [0, 1]).
+ */
+public final class FilterPass {
+
+    public enum Type {
+        /**
+         * Sample the input at {@code 2 * radius + 1} taps, spaced by (stepX, stepY) in the input coordinates, weighted by the (symmetric)
+         * weights.
+         */
+        RESAMPLE,
+        /**
+         * Unsharp mask: subtract the 4 neighbours, at (±stepX, 0) and (0, ±stepY), weighted by the amount.
+         */
+        SHARPEN,
+    }
+
+    private final Type type;
+    private final Size outputSize;
+    private final AffineMatrix transform;
+    private final float stepX;
+    private final float stepY;
+    private final float[] weights;
+    private final float amount;
+
+    private FilterPass(Type type, Size outputSize, AffineMatrix transform, float stepX, float stepY, float[] weights, float amount) {
+        this.type = type;
+        this.outputSize = outputSize;
+        this.transform = transform;
+        this.stepX = stepX;
+        this.stepY = stepY;
+        this.weights = weights;
+        this.amount = amount;
+    }
+
+    /**
+     * @param transform the transform from the output coordinates to the input coordinates
+     * @param weights   the weights of the center tap and of the taps on each side ({@code weights[i]} for the taps at {@code ±i * step})
+     */
+    public static FilterPass createResample(Size outputSize, AffineMatrix transform, float stepX, float stepY, float[] weights) {
+        return new FilterPass(Type.RESAMPLE, outputSize, transform, stepX, stepY, weights, 0);
+    }
+
+    public static FilterPass createSharpen(Size outputSize, float amount) {
+        return new FilterPass(Type.SHARPEN, outputSize, AffineMatrix.IDENTITY, 1f / outputSize.getWidth(), 1f / outputSize.getHeight(),
+                null, amount);
+    }
+
+    public Type getType() {
+        return type;
+    }
+
+    public Size getOutputSize() {
+        return outputSize;
+    }
+
+    public AffineMatrix getTransform() {
+        return transform;
+    }
+
+    public float getStepX() {
+        return stepX;
+    }
+
+    public float getStepY() {
+        return stepY;
+    }
+
+    public int getRadius() {
+        return weights == null ? 0 : weights.length - 1;
+    }
+
+    public float[] getWeights() {
+        return weights;
+    }
+
+    public float getAmount() {
+        return amount;
+    }
+}
@@ -0,0 +1,270 @@
+package com.genymobile.scrcpy.opengl;
+
+import com.genymobile.scrcpy.util.AffineMatrix;
+
+import android.opengl.GLES11Ext;
+import android.opengl.GLES20;
+
+import java.nio.ByteBuffer;
+import java.nio.FloatBuffer;
+
+/**
+ * Detect whether the frame has changed since the previous frame, from a small signature computed on the GPU.
+ * <p>
+ * The output (after the filter transform) is divided into a grid of cells. Each pixel of the signature sums several samples of a cell
+ * (each sample interpolates 2x2 texels), and keeps only the fractional part of the amplified sum, so that a small change in a cell changes
+ * the signature.
+ * <p>
+ * This is a heuristic: a change which is not sampled (typically a few pixels) may be missed. It is only visible after the next detected
+ * change (or refresh).
+ */
+public class FrameChangeDetector {
+
+    public interface Listener {
+        /**
+         * Called for each frame rendered to the encoder.
+         *
+         * @param timestampNs the presentation timestamp
+         * @param dirtyCells  one long per grid row (from the top), the bit {@code 1L << col} being set if the cell changed, or {@code null} if
+         *                    the whole frame must be considered as changed
+         */
+        void onFrameRendered(long timestampNs, long[] dirtyCells);
+    }
+
+    // One long per row for the dirty cells
+    public static final int GRID_SIZE = 64;
+    private static final int SAMPLES = 8; // per cell, in each dimension
+
+    // A changed cell remains dirty for some frames, during which the encoder typically improves its quality
+    private static final int DIRTY_FRAMES = 8;
+
+    private final float[] userMatrix;
+    private final boolean skipUnchangedFrames;
+    private final Listener listener;
+
+    private int program;
+    private int framebuffer;
+    private int texture;
+    private FloatBuffer vertexBuffer;
+
+    private int vertexPosLoc;
+    private int texLoc;
+    private int texMatrixLoc;
+    private int userMatrixLoc;
+
+    // The signatures of the current and previous frames, swapped after each frame
+    private ByteBuffer signature;
+    private ByteBuffer previousSignature;
+    private boolean hasPreviousSignature;
+
+    // Number of frames during which each cell remains dirty
+    private final byte[] cellDirtyFrames;
+    private final long[] dirtyCells;
+    private boolean wholeFrameDirty;
+
+    /**
+     * @param transform           the filter transform (may be {@code null}), so that the signature covers the output
+     * @param skipUnchangedFrames whether the unchanged frames must not be rendered
+     * @param listener            notified of the dirty cells of each rendered frame (may be {@code null})
+     */
+    public FrameChangeDetector(AffineMatrix transform, boolean skipUnchangedFrames, Listener listener) {
+        userMatrix = (transform != null ? transform : AffineMatrix.IDENTITY).to4x4();
+        this.skipUnchangedFrames = skipUnchangedFrames;
+        this.listener = listener;
+        cellDirtyFrames = listener != null ? new byte[GRID_SIZE * GRID_SIZE] : null;
+        dirtyCells = listener != null ? new long[GRID_SIZE] : null;
+    }
+
+    public boolean getSkipUnchangedFrames() {
+        return skipUnchangedFrames;
+    }
+
+    public void init() throws OpenGLException {
+        // @formatter:off
+        String vertexShaderCode = "#version 100\n"
+                + "attribute vec4 vertex_pos;\n"
+                + "void main() {\n"
+                + "    gl_Position = vertex_pos;\n"
+                + "}";
+
+        // @formatter:off
+        String fragmentShaderCode = "#version 100\n"
+                + "#extension GL_OES_EGL_image_external : require\n"
+                + "precision highp float;\n"
+                + "#define GRID_SIZE " + GRID_SIZE + ".0\n"
+                + "#define SAMPLES " + SAMPLES + "\n"
+                + "uniform samplerExternalOES tex;\n"
+                + "uniform mat4 tex_matrix;\n"
+                + "uniform mat4 user_matrix;\n"
+                + "void main() {\n"
+                + "    vec2 cell = floor(gl_FragCoord.xy) / GRID_SIZE;\n"
+                + "    vec4 sum = vec4(0.0);\n"
+                + "    for (int i = 0; i < SAMPLES; ++i) {\n"
+                + "        for (int j = 0; j < SAMPLES; ++j) {\n"
+                + "            vec2 pos = cell + (vec2(float(i), float(j)) + 0.5) / (GRID_SIZE * float(SAMPLES));\n"
+                + "            sum += texture2D(tex, (tex_matrix * user_matrix * vec4(pos, 0.0, 1.0)).xy);\n"
+                + "        }\n"
+                + "    }\n"
+                // A change of 1 level in a single texel changes the result by several levels
+                + "    gl_FragColor = fract(sum * 16.0);\n"
+                + "}";
+
+        program = GLUtils.createProgram(vertexShaderCode, fragmentShaderCode);
+        if (program == 0) {
+            throw new OpenGLException("Cannot create OpenGL program");
+        }
+
+        float[] vertices = {
+                -1, -1, // Bottom-left
+                1, -1, // Bottom-right
+                -1, 1, // Top-left
+                1, 1, // Top-right
+        };
+        vertexBuffer = GLUtils.createFloatBuffer(vertices);
+
+        vertexPosLoc = GLES20.glGetAttribLocation(program, "vertex_pos");
+        assert vertexPosLoc != -1;
+
+        texLoc = GLES20.glGetUniformLocation(program, "tex");
+        assert texLoc != -1;
+
+        texMatrixLoc = GLES20.glGetUniformLocation(program, "tex_matrix");
+        assert texMatrixLoc != -1;
+
+        userMatrixLoc = GLES20.glGetUniformLocation(program, "user_matrix");
+        assert userMatrixLoc != -1;
+
+        int[] textures = new int[1];
+        GLES20.glGenTextures(1, textures, 0);
+        GLUtils.checkGlError();
+        texture = textures[0];
+
+        GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, texture);
+        GLUtils.checkGlError();
+        GLES20.glTexImage2D(GLES20.GL_TEXTURE_2D, 0, GLES20.GL_RGBA, GRID_SIZE, GRID_SIZE, 0, GLES20.GL_RGBA, GLES20.GL_UNSIGNED_BYTE, null);
+        GLUtils.checkGlError();
+        GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MIN_FILTER, GLES20.GL_NEAREST);
+        GLUtils.checkGlError();
+        GLES20.glTexParameteri(GLES20.GL_TEXTURE_2D, GLES20.GL_TEXTURE_MAG_FILTER, GLES20.GL_NEAREST);
+        GLUtils.checkGlError();
+
+        int[] framebuffers = new int[1];
+        GLES20.glGenFramebuffers(1, framebuffers, 0);
+        GLUtils.checkGlError();
+        framebuffer = framebuffers[0];
+
+        GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, framebuffer);
+        GLUtils.checkGlError();
+        GLES20.glFramebufferTexture2D(GLES20.GL_FRAMEBUFFER, GLES20.GL_COLOR_ATTACHMENT0, GLES20.GL_TEXTURE_2D, texture, 0);
+        GLUtils.checkGlError();
+        int status = GLES20.glCheckFramebufferStatus(GLES20.GL_FRAMEBUFFER);
+        GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, 0);
+        if (status != GLES20.GL_FRAMEBUFFER_COMPLETE) {
+            throw new OpenGLException("Framebuffer incomplete: 0x" + Integer.toHexString(status));
+        }
+
+        signature = ByteBuffer.allocateDirect(GRID_SIZE * GRID_SIZE * 4);
+        previousSignature = ByteBuffer.allocateDirect(GRID_SIZE * GRID_SIZE * 4);
+    }
+
+    /**
+     * Compute the signature of the current frame, and compare it to the signature of the previous one.
+     * <p>
+     * This changes the framebuffer binding and the viewport.
+     *
+     * @return {@code true} if the frame has (probably) changed
+     */
+    public boolean hasChanged(int textureId, float[] texMatrix) {
+        GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, framebuffer);
+        GLUtils.checkGlError();
+        GLES20.glViewport(0, 0, GRID_SIZE, GRID_SIZE);
+        GLUtils.checkGlError();
+
+        GLES20.glUseProgram(program);
+        GLUtils.checkGlError();
+
+        GLES20.glEnableVertexAttribArray(vertexPosLoc);
+        GLUtils.checkGlError();
+        GLES20.glVertexAttribPointer(vertexPosLoc, 2, GLES20.GL_FLOAT, false, 0, vertexBuffer);
+        GLUtils.checkGlError();
+
+        GLES20.glActiveTexture(GLES20.GL_TEXTURE0);
+        GLUtils.checkGlError();
+        GLES20.glBindTexture(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, textureId);
+        GLUtils.checkGlError();
+        GLES20.glUniform1i(texLoc, 0);
+        GLUtils.checkGlError();
+        GLES20.glUniformMatrix4fv(texMatrixLoc, 1, false, texMatrix, 0);
+        GLUtils.checkGlError();
+        GLES20.glUniformMatrix4fv(userMatrixLoc, 1, false, userMatrix, 0);
+        GLUtils.checkGlError();
+
+        GLES20.glDrawArrays(GLES20.GL_TRIANGLE_STRIP, 0, 4);
+        GLUtils.checkGlError();
+
+        // The signature is tiny (16 KB), the read back only waits for this small draw
+        GLES20.glReadPixels(0, 0, GRID_SIZE, GRID_SIZE, GLES20.GL_RGBA, GLES20.GL_UNSIGNED_BYTE, signature);
+        GLUtils.checkGlError();
+
+        GLES20.glBindFramebuffer(GLES20.GL_FRAMEBUFFER, 0);
+        GLUtils.checkGlError();
+
+        boolean changed = !hasPreviousSignature || !signature.equals(previousSignature);
+        if (listener != null) {
+            wholeFrameDirty = !hasPreviousSignature;
+            if (hasPreviousSignature) {
+                updateDirtyCells();
+            }
+        }
+
+        ByteBuffer tmp = previousSignature;
+        previousSignature = signature;
+        signature = tmp;
+        hasPreviousSignature = true;
+
+        return changed;
+    }
+
+    private void updateDirtyCells() {
+        for (int row = 0; row < GRID_SIZE; ++row) {
+            // The signature is read from the bottom (OpenGL coordinates), the dirty cells are stored from the top (video coordinates)
+            int sigRow = GRID_SIZE - 1 - row;
+            long bits = 0;
+            for (int col = 0; col < GRID_SIZE; ++col) {
+                int cell = sigRow * GRID_SIZE + col;
+                if (signature.getInt(4 * cell) != previousSignature.getInt(4 * cell)) {
+                    cellDirtyFrames[cell] = DIRTY_FRAMES;
+                }
+                if (cellDirtyFrames[cell] > 0) {
+                    --cellDirtyFrames[cell];
+                    bits |= 1L << col;
+                }
+            }
+            dirtyCells[row] = bits;
+        }
+    }
+
+    /**
+     * Notify the listener that the last detected frame has been rendered.
+     *
+     * @param wholeFrame {@code true} if the whole frame must be considered as changed (for example if the frame is rendered again)
+     */
+    public void notifyRendered(long timestampNs, boolean wholeFrame) {
+        if (listener != null) {
+            listener.onFrameRendered(timestampNs, wholeFrame || wholeFrameDirty ? null : dirtyCells);
+        }
+    }
+
+    public void release() {
+        int[] framebuffers = {framebuffer};
+        GLES20.glDeleteFramebuffers(1, framebuffers, 0);
+        GLUtils.checkGlError();
+
+        int[] textures = {texture};
+        GLES20.glDeleteTextures(1, textures, 0);
+        GLUtils.checkGlError();
+
+        GLES20.glDeleteProgram(program);
+        GLUtils.checkGlError();
+    }
+}
@@ -1,6 +1,7 @@
 package com.genymobile.scrcpy.opengl;
 
 import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.Threads;
 
 import android.graphics.SurfaceTexture;
@@ -21,6 +22,10 @@ import java.util.concurrent.Semaphore;
 
 public final class OpenGLRunner {
 
+    // When unchanged frames are skipped, render the last frame again once the content is stable, so that the encoder may improve its
+    // quality (this replaces the encoder repeat mechanism, which keeps repeating the frame while the content is idle)
+    private static final long REFRESH_DELAY_MS = 100;
+
     private static HandlerThread handlerThread;
     private static Handler handler;
 
@@ -28,22 +33,75 @@ public final class OpenGLRunner {
     private EGLContext eglContext;
     private EGLSurface eglSurface;
 
+    // Optional second output, rendered from the same texture at another size
+    private OpenGLFilter simulcastFilter;
+    private Size simulcastSize;
+    private Surface simulcastSurface;
+    private EGLSurface simulcastEglSurface;
+
     private final OpenGLFilter filter;
     private final float[] overrideTransformMatrix;
+    private final FrameChangeDetector changeDetector;
 
     private SurfaceTexture surfaceTexture;
     private Surface inputSurface;
     private int textureId;
+    private Size outputSize;
+    private final float[] transformMatrix = new float[16];
+
+    private final Runnable refreshRunnable = this::refresh;
+    private int renderedFrames;
+    private int skippedFrames;
+
+    // Frames arriving faster than the max fps are dropped before rendering (the latest one is rendered once the interval has elapsed)
+    private long minFrameIntervalNs;
+    private final Runnable decimatedRenderRunnable = this::renderDecimated;
+    private boolean decimatedRenderPending;
+    private boolean hasRendered;
+    private long lastRenderTimestampNs;
+    private int decimatedFrames;
 
     private boolean stopped;
 
-    public OpenGLRunner(OpenGLFilter filter, float[] overrideTransformMatrix) {
+    /**
+     * @param changeDetector if not {@code null}, detect the changes between consecutive frames (to skip the unchanged frames and/or to
+     *                       report the dirty regions)
+     */
+    public OpenGLRunner(OpenGLFilter filter, float[] overrideTransformMatrix, FrameChangeDetector changeDetector) {
         this.filter = filter;
         this.overrideTransformMatrix = overrideTransformMatrix;
+        this.changeDetector = changeDetector;
+    }
+
+    public OpenGLRunner(OpenGLFilter filter, float[] overrideTransformMatrix) {
+        this(filter, overrideTransformMatrix, null);
     }
 
     public OpenGLRunner(OpenGLFilter filter) {
-        this(filter, null);
+        this(filter, null, null);
+    }
+
+    /**
+     * Drop the frames arriving faster than {@code maxFps} before rendering them, so that the filter passes and the encoder do not process
+     * them.
+     * <p>
+     * Must be called before {@link #start(Size, Size, Surface)}.
+     *
+     * @param maxFps the maximum frame rate ({@code 0} to disable)
+     */
+    public void setMaxFps(float maxFps) {
+        minFrameIntervalNs = maxFps > 0 ? (long) (1_000_000_000 / maxFps) : 0;
+    }
+
+    /**
+     * Also render each frame to a second output surface, with its own filter.
+     * <p>
+     * Must be called before {@link #start(Size, Size, Surface)}.
+     */
+    public void setSimulcastOutput(OpenGLFilter filter, Size size, Surface surface) {
+        simulcastFilter = filter;
+        simulcastSize = size;
+        simulcastSurface = surface;
     }
 
     public static synchronized void initOnce() {
@@ -90,6 +148,8 @@ public final class OpenGLRunner {
     }
 
     private void run(Size inputSize, Size outputSize, Surface outputSurface) throws OpenGLException {
+        this.outputSize = outputSize;
+
         eglDisplay = EGL14.eglGetDisplay(EGL14.EGL_DEFAULT_DISPLAY);
         if (eglDisplay == EGL14.EGL_NO_DISPLAY) {
             throw new OpenGLException("Unable to get EGL14 display");
@@ -142,11 +202,25 @@ public final class OpenGLRunner {
 
         if (!EGL14.eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext)) {
             EGL14.eglDestroySurface(eglDisplay, eglSurface);
+            if (simulcastEglSurface != null) {
+                EGL14.eglDestroySurface(eglDisplay, simulcastEglSurface);
+                simulcastEglSurface = null;
+            }
             EGL14.eglDestroyContext(eglDisplay, eglContext);
             EGL14.eglTerminate(eglDisplay);
             throw new OpenGLException("Failed to make EGL context current");
         }
 
+        if (simulcastSurface != null) {
+            simulcastEglSurface = EGL14.eglCreateWindowSurface(eglDisplay, eglConfig, simulcastSurface, surfaceAttribList, 0);
+            if (simulcastEglSurface == null) {
+                EGL14.eglDestroySurface(eglDisplay, eglSurface);
+                EGL14.eglDestroyContext(eglDisplay, eglContext);
+                EGL14.eglTerminate(eglDisplay);
+                throw new OpenGLException("Failed to create EGL simulcast window surface");
+            }
+        }
+
         int[] textures = new int[1];
         GLES20.glGenTextures(1, textures, 0);
         GLUtils.checkGlError();
@@ -166,6 +240,12 @@ public final class OpenGLRunner {
         inputSurface = new Surface(surfaceTexture);
 
         filter.init();
+        if (simulcastFilter != null) {
+            simulcastFilter.init();
+        }
+        if (changeDetector != null) {
+            changeDetector.init();
+        }
 
         surfaceTexture.setOnFrameAvailableListener(surfaceTexture -> {
             if (stopped) {
@@ -173,28 +253,116 @@ public final class OpenGLRunner {
                 return;
             }
 
-            render(outputSize);
+            surfaceTexture.updateTexImage();
+            long timestampNs = surfaceTexture.getTimestamp();
+            if (decimate(timestampNs)) {
+                return;
+            }
+
+            render(timestampNs);
         }, handler);
     }
 
-    private void render(Size outputSize) {
-        GLES20.glViewport(0, 0, outputSize.getWidth(), outputSize.getHeight());
-        GLUtils.checkGlError();
+    private boolean decimate(long timestampNs) {
+        if (minFrameIntervalNs == 0) {
+            return false;
+        }
+
+        long delayNs = lastRenderTimestampNs + minFrameIntervalNs - timestampNs;
+        if (hasRendered && delayNs > 0) {
+            // The texture now contains this frame, render it later if no other frame arrives in the meantime
+            ++decimatedFrames;
+            if (!decimatedRenderPending) {
+                decimatedRenderPending = true;
+                handler.postDelayed(decimatedRenderRunnable, (delayNs + 999_999) / 1_000_000);
+            }
+            return true;
+        }
+
+        if (decimatedRenderPending) {
+            handler.removeCallbacks(decimatedRenderRunnable);
+            decimatedRenderPending = false;
+        }
+        return false;
+    }
 
-        surfaceTexture.updateTexImage();
+    private void renderDecimated() {
+        decimatedRenderPending = false;
+        if (stopped) {
+            return;
+        }
+
+        // The last decimated frame is rendered late, so its original timestamp would be older than the actual presentation
+        render(System.nanoTime());
+    }
+
+    private void render(long timestampNs) {
+        float[] matrix = getTransformMatrix();
+
+        if (changeDetector != null) {
+            boolean changed = changeDetector.hasChanged(textureId, matrix);
+            if (changeDetector.getSkipUnchangedFrames()) {
+                if (!changed) {
+                    // The previous frame, already encoded, remains displayed on the client
+                    ++skippedFrames;
+                    return;
+                }
+
+                handler.removeCallbacks(refreshRunnable);
+                handler.postDelayed(refreshRunnable, REFRESH_DELAY_MS);
+            }
+        }
+
+        draw(matrix, timestampNs);
+        ++renderedFrames;
+        hasRendered = true;
+        lastRenderTimestampNs = timestampNs;
+
+        if (changeDetector != null) {
+            changeDetector.notifyRendered(timestampNs, false);
+        }
+    }
+
+    private void refresh() {
+        if (stopped) {
+            return;
+        }
 
-        float[] matrix;
+        // The texture still contains the last rendered frame (or a frame identical to it)
+        long timestampNs = System.nanoTime();
+        draw(getTransformMatrix(), timestampNs);
+        changeDetector.notifyRendered(timestampNs, true);
+    }
+
+    private float[] getTransformMatrix() {
         if (overrideTransformMatrix != null) {
-            matrix = overrideTransformMatrix;
-        } else {
-            matrix = new float[16];
-            surfaceTexture.getTransformMatrix(matrix);
+            return overrideTransformMatrix;
         }
+        surfaceTexture.getTransformMatrix(transformMatrix);
+        return transformMatrix;
+    }
+
+    private void draw(float[] matrix, long timestampNs) {
+        GLES20.glViewport(0, 0, outputSize.getWidth(), outputSize.getHeight());
+        GLUtils.checkGlError();
 
         filter.draw(textureId, matrix);
 
-        EGLExt.eglPresentationTimeANDROID(eglDisplay, eglSurface, surfaceTexture.getTimestamp());
+        EGLExt.eglPresentationTimeANDROID(eglDisplay, eglSurface, timestampNs);
         EGL14.eglSwapBuffers(eglDisplay, eglSurface);
+
+        if (simulcastEglSurface != null) {
+            // The same context renders to the second surface, so the texture is shared
+            EGL14.eglMakeCurrent(eglDisplay, simulcastEglSurface, simulcastEglSurface, eglContext);
+            GLES20.glViewport(0, 0, simulcastSize.getWidth(), simulcastSize.getHeight());
+            GLUtils.checkGlError();
+
+            simulcastFilter.draw(textureId, matrix);
+
+            EGLExt.eglPresentationTimeANDROID(eglDisplay, simulcastEglSurface, timestampNs);
+            EGL14.eglSwapBuffers(eglDisplay, simulcastEglSurface);
+            EGL14.eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+        }
     }
 
     public void stopAndRelease() {
@@ -204,7 +372,22 @@ public final class OpenGLRunner {
             stopped = true;
             surfaceTexture.setOnFrameAvailableListener(null, handler);
 
+            handler.removeCallbacks(decimatedRenderRunnable);
+            if (minFrameIntervalNs != 0) {
+                Ln.d("Frames decimated: " + decimatedFrames);
+            }
+
             filter.release();
+            if (simulcastFilter != null) {
+                simulcastFilter.release();
+            }
+            if (changeDetector != null) {
+                handler.removeCallbacks(refreshRunnable);
+                changeDetector.release();
+                if (changeDetector.getSkipUnchangedFrames()) {
+                    Ln.d("Unchanged frames skipped: " + skippedFrames + "/" + (renderedFrames + skippedFrames));
+                }
+            }
 
             int[] textures = {textureId};
             GLES20.glDeleteTextures(1, textures, 0);
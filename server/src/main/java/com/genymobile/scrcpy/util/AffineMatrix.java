@@ -91,6 +91,17 @@ public class AffineMatrix {
         return new Point(xx, yy);
     }
 
+    /**
+     * Apply the linear part of the transform (ignoring the translation) to a vector, typically a displacement in normalized coordinates.
+     *
+     * @param x the x component of the vector
+     * @param y the y component of the vector
+     * @return the transformed vector, as {@code {x, y}}
+     */
+    public float[] applyToVector(double x, double y) {
+        return new float[] {(float) (a * x + c * y), (float) (b * x + d * y)};
+    }
+
     /**
      * Compute <code>this * rhs</code>.
      *
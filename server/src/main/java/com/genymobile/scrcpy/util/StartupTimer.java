@@ -0,0 +1,66 @@
+package com.genymobile.scrcpy.util;
+
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Log the time elapsed since the server started for each startup phase, to measure where the time to the first frame is spent.
+ * <p>
+ * The phases are logged at debug level, so they are visible with {@code scrcpy -Vdebug}.
+ */
+public final class StartupTimer {
+
+    private static long origin = System.nanoTime();
+    private static final AtomicInteger MARKED = new AtomicInteger();
+
+    public enum Phase {
+        STARTED("started"),
+        WORKAROUNDS_APPLIED("workarounds_applied"),
+        CLIENT_CONNECTED("client_connected"),
+        VIDEO_ENCODER_STARTED("video_encoder_started"),
+        FIRST_VIDEO_PACKET("first_video_packet"),
+        FIRST_AUDIO_PACKET("first_audio_packet");
+
+        private final String name;
+
+        Phase(String name) {
+            this.name = name;
+        }
+    }
+
+    private StartupTimer() {
+        // not instantiable
+    }
+
+    /**
+     * Reset the origin of the measures.
+     * <p>
+     * Must be called before starting any new thread.
+     */
+    public static void start() {
+        origin = System.nanoTime();
+        MARKED.set(0);
+        mark(Phase.STARTED);
+    }
+
+    /**
+     * Mark the end of a phase (only the first call for a given phase is taken into account).
+     *
+     * @param phase the phase
+     */
+    public static void mark(Phase phase) {
+        int bit = 1 << phase.ordinal();
+        int marked;
+        do {
+            marked = MARKED.get();
+            if ((marked & bit) != 0) {
+                // Already marked
+                return;
+            }
+        } while (!MARKED.compareAndSet(marked, marked | bit));
+
+        if (Ln.isEnabled(Ln.Level.DEBUG)) {
+            long elapsedMs = (System.nanoTime() - origin) / 1_000_000;
+            Ln.d("Startup: " + phase.name + " at " + elapsedMs + " ms");
+        }
+    }
+}
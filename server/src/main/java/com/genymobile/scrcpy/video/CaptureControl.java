@@ -1,5 +1,7 @@
 package com.genymobile.scrcpy.video;
 
+import com.genymobile.scrcpy.util.Ln;
+
 import android.media.MediaCodec;
 
 public class CaptureControl {
@@ -14,6 +16,9 @@ public class CaptureControl {
     // Current instance of MediaCodec to "interrupt" on reset
     private MediaCodec runningMediaCodec;
 
+    // Set if simulcast is enabled
+    private Simulcast simulcast;
+
     public synchronized boolean isResetRequested() {
         return reset != 0;
     }
@@ -39,4 +44,19 @@ public class CaptureControl {
     public synchronized void setRunningMediaCodec(MediaCodec runningMediaCodec) {
         this.runningMediaCodec = runningMediaCodec;
     }
+
+    public synchronized void setSimulcast(Simulcast simulcast) {
+        this.simulcast = simulcast;
+    }
+
+    /**
+     * Select the video stream to send (one of {@code Simulcast.STREAM_*}), without resetting the capture.
+     */
+    public synchronized void selectStream(int stream) {
+        if (simulcast == null) {
+            Ln.w("Video stream selection ignored, simulcast is disabled");
+            return;
+        }
+        simulcast.select(stream);
+    }
 }
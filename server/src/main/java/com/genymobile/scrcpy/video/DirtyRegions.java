@@ -0,0 +1,207 @@
+package com.genymobile.scrcpy.video;
+
+import com.genymobile.scrcpy.model.Size;
+
+/**
+ * Track the regions of the video which changed since the previous encoded frame.
+ * <p>
+ * The OpenGL stage adds, for each rendered frame, the cells of a {@link #GRID_SIZE}x{@link #GRID_SIZE} grid which changed. The streamer
+ * polls the dirty rectangles for each encoded packet, by its PTS.
+ * <p>
+ * The encoder may drop some frames, so the cells of all the frames up to the polled PTS are merged. If the PTS does not match any rendered
+ * frame (for example a frame repeated by the encoder), the whole frame must be updated.
+ */
+public final class DirtyRegions {
+
+    // One long (64 bits) per row
+    public static final int GRID_SIZE = 64;
+    public static final int MAX_RECTS = 16;
+
+    // Expand the rectangles to cover the decoder filters across block edges (deblocking)
+    private static final int MARGIN = 16;
+
+    private static final int CAPACITY = 32;
+
+    // Ring buffer of the rendered frames not polled yet
+    private final long[] ptsUs = new long[CAPACITY];
+    private final long[][] cells = new long[CAPACITY][GRID_SIZE];
+    private final boolean[] full = new boolean[CAPACITY];
+    private int head;
+    private int count;
+
+    private Size videoSize;
+
+    // Temporary storage for poll()
+    private final long[] mergedCells = new long[GRID_SIZE];
+    // The indices of the rectangles ending on the previous row and on the current row
+    private int[] openRects = new int[MAX_RECTS];
+    private int[] newOpenRects = new int[MAX_RECTS];
+
+    /**
+     * Start a new capture session.
+     */
+    public synchronized void reset(Size videoSize) {
+        this.videoSize = videoSize;
+        head = 0;
+        count = 0;
+    }
+
+    /**
+     * Add a rendered frame.
+     *
+     * @param timestampUs the presentation timestamp of the frame
+     * @param dirtyCells  one long per grid row (the bit {@code 1L << col} is set if the cell changed), or {@code null} if the whole frame
+     *                    changed
+     */
+    public synchronized void add(long timestampUs, long[] dirtyCells) {
+        int index;
+        if (count == CAPACITY) {
+            // The encoder is late, merge into the last frame (the previous PTS will not be found, so the whole frame will be updated)
+            index = (head + count - 1) % CAPACITY;
+        } else {
+            index = (head + count) % CAPACITY;
+            ++count;
+            full[index] = false;
+            clear(cells[index]);
+        }
+
+        ptsUs[index] = timestampUs;
+        if (dirtyCells == null) {
+            full[index] = true;
+        } else {
+            or(cells[index], dirtyCells);
+        }
+    }
+
+    /**
+     * Consume the rendered frames up to the given PTS, and compute the dirty rectangles in video coordinates.
+     *
+     * @param pts   the PTS of the encoded packet
+     * @param rects the output array, receiving (x, y, width, height) for each rectangle (its length must be at least
+     *              {@code 4 * MAX_RECTS})
+     * @return the number of rectangles, or -1 if the whole frame must be updated
+     */
+    public synchronized int poll(long pts, int[] rects) {
+        boolean found = false;
+        boolean wholeFrame = false;
+        clear(mergedCells);
+
+        while (count > 0 && ptsUs[head] <= pts) {
+            if (ptsUs[head] == pts) {
+                found = true;
+            }
+            wholeFrame |= full[head];
+            or(mergedCells, cells[head]);
+            head = (head + 1) % CAPACITY;
+            --count;
+        }
+
+        if (!found || wholeFrame || videoSize == null) {
+            return -1;
+        }
+
+        return toRects(mergedCells, videoSize, rects);
+    }
+
+    private int toRects(long[] dirtyCells, Size size, int[] rects) {
+        // Merge the horizontal runs of dirty cells of consecutive rows, when they cover the same columns
+        int n = 0;
+        int openCount = 0;
+        for (int row = 0; row < GRID_SIZE; ++row) {
+            long bits = dirtyCells[row];
+            int newOpenCount = 0;
+            int col = 0;
+            while (bits >>> col != 0) {
+                col += Long.numberOfTrailingZeros(bits >>> col);
+                int end = col + Long.numberOfTrailingZeros(~(bits >>> col));
+
+                int rect = -1;
+                for (int i = 0; i < openCount; ++i) {
+                    int r = openRects[i];
+                    if (rects[4 * r] == col && rects[4 * r + 2] == end) {
+                        rect = r;
+                        break;
+                    }
+                }
+
+                if (rect == -1) {
+                    if (n == MAX_RECTS) {
+                        return toBoundingRect(dirtyCells, size, rects);
+                    }
+                    rect = n++;
+                    // Temporarily stored in grid units as (colStart, rowStart, colEnd, rowEnd)
+                    rects[4 * rect] = col;
+                    rects[4 * rect + 1] = row;
+                    rects[4 * rect + 2] = end;
+                }
+                rects[4 * rect + 3] = row + 1;
+                newOpenRects[newOpenCount++] = rect;
+
+                if (end == GRID_SIZE) {
+                    break;
+                }
+                col = end;
+            }
+            int[] tmp = openRects;
+            openRects = newOpenRects;
+            newOpenRects = tmp;
+            openCount = newOpenCount;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            toVideoRect(rects, i, size);
+        }
+        return n;
+    }
+
+    private static int toBoundingRect(long[] dirtyCells, Size size, int[] rects) {
+        long allColumns = 0;
+        int rowStart = -1;
+        int rowEnd = -1;
+        for (int row = 0; row < GRID_SIZE; ++row) {
+            if (dirtyCells[row] != 0) {
+                allColumns |= dirtyCells[row];
+                if (rowStart == -1) {
+                    rowStart = row;
+                }
+                rowEnd = row + 1;
+            }
+        }
+
+        rects[0] = Long.numberOfTrailingZeros(allColumns);
+        rects[1] = rowStart;
+        rects[2] = GRID_SIZE - Long.numberOfLeadingZeros(allColumns);
+        rects[3] = rowEnd;
+        toVideoRect(rects, 0, size);
+        return 1;
+    }
+
+    private static void toVideoRect(int[] rects, int i, Size size) {
+        int w = size.getWidth();
+        int h = size.getHeight();
+        int x0 = Math.max(0, rects[4 * i] * w / GRID_SIZE - MARGIN);
+        int y0 = Math.max(0, rects[4 * i + 1] * h / GRID_SIZE - MARGIN);
+        int x1 = Math.min(w, ceilDiv(rects[4 * i + 2] * w, GRID_SIZE) + MARGIN);
+        int y1 = Math.min(h, ceilDiv(rects[4 * i + 3] * h, GRID_SIZE) + MARGIN);
+        rects[4 * i] = x0;
+        rects[4 * i + 1] = y0;
+        rects[4 * i + 2] = x1 - x0;
+        rects[4 * i + 3] = y1 - y0;
+    }
+
+    private static int ceilDiv(int a, int b) {
+        return (a + b - 1) / b;
+    }
+
+    private static void clear(long[] array) {
+        for (int i = 0; i < array.length; ++i) {
+            array[i] = 0;
+        }
+    }
+
+    private static void or(long[] dst, long[] src) {
+        for (int i = 0; i < dst.length; ++i) {
+            dst[i] |= src[i];
+        }
+    }
+}
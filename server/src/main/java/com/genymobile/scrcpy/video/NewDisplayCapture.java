@@ -11,7 +11,8 @@ import com.genymobile.scrcpy.display.DisplayResizeDebouncer;
 import com.genymobile.scrcpy.model.NewDisplay;
 import com.genymobile.scrcpy.model.Orientation;
 import com.genymobile.scrcpy.model.Size;
-import com.genymobile.scrcpy.opengl.AffineOpenGLFilter;
+import com.genymobile.scrcpy.opengl.FilterChain;
+import com.genymobile.scrcpy.opengl.FrameChangeDetector;
 import com.genymobile.scrcpy.opengl.OpenGLFilter;
 import com.genymobile.scrcpy.opengl.OpenGLRunner;
 import com.genymobile.scrcpy.util.AffineMatrix;
@@ -58,6 +59,11 @@ public class NewDisplayCapture extends SurfaceCapture {
     private final boolean captureOrientationLocked;
     private final Orientation captureOrientation;
     private final float angle;
+    private final boolean skipUnchangedFrames;
+    private final VideoScaleFilter scaleFilter;
+    private final float sharpen;
+    private final float maxFps;
+    private final boolean simulcast;
     private final boolean vdDestroyContent;
     private final boolean vdSystemDecorations;
     private final boolean flexDisplay;
@@ -65,6 +71,7 @@ public class NewDisplayCapture extends SurfaceCapture {
     private VideoConstraints videoConstraints;
 
     private VirtualDisplay virtualDisplay;
+    private Size contentSize; // the size of the video before downscaling
     private Size videoSize;
     private Size displaySize; // the logical size of the display (including rotation)
     private Size physicalSize; // the physical size of the display (without rotation)
@@ -85,6 +92,11 @@ public class NewDisplayCapture extends SurfaceCapture {
         this.captureOrientation = options.getCaptureOrientation();
         assert captureOrientation != null;
         this.angle = options.getAngle();
+        this.skipUnchangedFrames = options.getSkipUnchangedFrames();
+        this.scaleFilter = options.getVideoScaleFilter();
+        this.sharpen = options.getVideoSharpen();
+        this.maxFps = options.getMaxFps();
+        this.simulcast = options.getVideoSimulcast() > 0;
         this.vdDestroyContent = options.getVDDestroyContent();
         this.vdSystemDecorations = options.getVDSystemDecorations();
         this.flexDisplay = options.getFlexDisplay();
@@ -176,6 +188,7 @@ public class NewDisplayCapture extends SurfaceCapture {
         filter.addOrientation(displayRotation, captureOrientationLocked, captureOrientation);
         filter.addAngle(angle);
 
+        contentSize = filter.getOutputSize();
         if (!flexDisplay) {
             Size outputSize = filter.getOutputSize();
             Size filteredSize = outputSize.constrain(videoConstraints);
@@ -206,6 +219,12 @@ public class NewDisplayCapture extends SurfaceCapture {
         //                    = DISPLAY_FILTER_MATRIX⁻¹ * FILTER_MATRIX⁻¹
         //                    = displayRotationMatrix * eventTransform
         displayTransform = AffineMatrix.multiplyAll(displayRotationMatrix, eventTransform);
+        boolean glRunnerRequired = skipUnchangedFrames || getDirtyRegions() != null || simulcast || FilterChain.isRequired(scaleFilter, sharpen);
+        if (displayTransform == null && glRunnerRequired) {
+            // The frame changes are detected (and the filter chain and the simulcast output are executed) by the OpenGL runner, so it must
+            // run even without filter
+            displayTransform = AffineMatrix.IDENTITY;
+        }
     }
 
     public void startNew(Surface surface) {
@@ -267,8 +286,13 @@ public class NewDisplayCapture extends SurfaceCapture {
     public void start(Surface surface) throws IOException {
         if (displayTransform != null) {
             assert glRunner == null;
-            OpenGLFilter glFilter = new AffineOpenGLFilter(displayTransform);
-            glRunner = new OpenGLRunner(glFilter);
+            OpenGLFilter glFilter = createOpenGLFilter(displayTransform, contentSize, videoSize, scaleFilter, sharpen);
+            FrameChangeDetector changeDetector = createFrameChangeDetector(displayTransform, skipUnchangedFrames, videoSize);
+            glRunner = new OpenGLRunner(glFilter, null, changeDetector);
+            if (FilterChain.isRequired(scaleFilter, sharpen)) {
+                glRunner.setMaxFps(maxFps);
+            }
+            addSimulcastOutput(glRunner, displayTransform, contentSize, scaleFilter, sharpen);
             surface = glRunner.start(physicalSize, videoSize, surface);
         }
 
@@ -10,7 +10,8 @@ import com.genymobile.scrcpy.display.DisplayProperties;
 import com.genymobile.scrcpy.model.ConfigurationException;
 import com.genymobile.scrcpy.model.Orientation;
 import com.genymobile.scrcpy.model.Size;
-import com.genymobile.scrcpy.opengl.AffineOpenGLFilter;
+import com.genymobile.scrcpy.opengl.FilterChain;
+import com.genymobile.scrcpy.opengl.FrameChangeDetector;
 import com.genymobile.scrcpy.opengl.OpenGLFilter;
 import com.genymobile.scrcpy.opengl.OpenGLRunner;
 import com.genymobile.scrcpy.util.AffineMatrix;
@@ -36,10 +37,16 @@ public class ScreenCapture extends SurfaceCapture {
     private Orientation.Lock captureOrientationLock;
     private Orientation captureOrientation;
     private final float angle;
+    private final boolean skipUnchangedFrames;
+    private final VideoScaleFilter scaleFilter;
+    private final float sharpen;
+    private final float maxFps;
+    private final boolean simulcast;
 
     private VideoConstraints videoConstraints;
 
     private DisplayInfo displayInfo;
+    private Size contentSize; // the size of the video before downscaling
     private Size videoSize;
 
     private final DisplayMonitor displayMonitor = new DisplayMonitor();
@@ -60,6 +67,11 @@ public class ScreenCapture extends SurfaceCapture {
         assert captureOrientationLock != null;
         assert captureOrientation != null;
         this.angle = options.getAngle();
+        this.skipUnchangedFrames = options.getSkipUnchangedFrames();
+        this.scaleFilter = options.getVideoScaleFilter();
+        this.sharpen = options.getVideoSharpen();
+        this.maxFps = options.getMaxFps();
+        this.simulcast = options.getVideoSimulcast() > 0;
     }
 
     @Override
@@ -102,7 +114,14 @@ public class ScreenCapture extends SurfaceCapture {
         filter.addAngle(angle);
 
         transform = filter.getInverseTransform();
-        videoSize = filter.getOutputSize().constrain(videoConstraints);
+        boolean glRunnerRequired = skipUnchangedFrames || getDirtyRegions() != null || simulcast || FilterChain.isRequired(scaleFilter, sharpen);
+        if (transform == null && glRunnerRequired) {
+            // The frame changes are detected (and the filter chain and the simulcast output are executed) by the OpenGL runner, so it must
+            // run even without filter
+            transform = AffineMatrix.IDENTITY;
+        }
+        contentSize = filter.getOutputSize();
+        videoSize = contentSize.constrain(videoConstraints);
     }
 
     @Override
@@ -121,8 +140,13 @@ public class ScreenCapture extends SurfaceCapture {
             // If there is a filter, it must receive the full display content
             inputSize = displayInfo.getSize();
             assert glRunner == null;
-            OpenGLFilter glFilter = new AffineOpenGLFilter(transform);
-            glRunner = new OpenGLRunner(glFilter);
+            OpenGLFilter glFilter = createOpenGLFilter(transform, contentSize, videoSize, scaleFilter, sharpen);
+            FrameChangeDetector changeDetector = createFrameChangeDetector(transform, skipUnchangedFrames, videoSize);
+            glRunner = new OpenGLRunner(glFilter, null, changeDetector);
+            if (FilterChain.isRequired(scaleFilter, sharpen)) {
+                glRunner.setMaxFps(maxFps);
+            }
+            addSimulcastOutput(glRunner, transform, contentSize, scaleFilter, sharpen);
             surface = glRunner.start(inputSize, videoSize, surface);
         } else {
             // If there is no filter, the display must be rendered at target video size directly
@@ -0,0 +1,193 @@
+package com.genymobile.scrcpy.video;
+
+import com.genymobile.scrcpy.device.PacketPipeline;
+import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.Ln;
+
+import android.media.MediaCodec;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Forward the packets of one of two encoders, fed with the same frames at different resolutions, to the client.
+ * <p>
+ * Since both encoders keep running, switching to the other stream does not reconfigure any encoder: a key frame is requested to the
+ * newly selected encoder, and its packets are forwarded from this key frame, preceded by a new session header and by its codec config. The
+ * packets of the previously selected stream are forwarded until then, so that the client never waits for a frame.
+ */
+public final class Simulcast {
+
+    public static final int STREAM_MAIN = 0;
+    public static final int STREAM_SIMULCAST = 1; // the lower resolution stream
+
+    private static final int NONE = -1;
+
+    // Serialize the writes to the pipeline (which may block on the socket). The stream selection itself never waits for it, so that a slow
+    // network delays neither the control messages nor the encoder of the stream which is not sent.
+    private final Object pushLock = new Object();
+
+    // Protected by pushLock
+    private PacketPipeline pipeline;
+
+    // Protected by "this"
+    private final MediaCodec[] codecs = new MediaCodec[2];
+
+    // Written on session start, before the encoding threads push any packet
+    private final Size[] sizes = new Size[2];
+
+    // The last config packet of each encoder, to be sent again on switch (each element is accessed only by the thread of its stream)
+    private final ByteBuffer[] configs = new ByteBuffer[2];
+    private final boolean[] hasConfig = new boolean[2];
+    private final MediaCodec.BufferInfo[] configInfos = {new MediaCodec.BufferInfo(), new MediaCodec.BufferInfo()};
+
+    // Only changed by the thread of the newly selected stream, holding pushLock
+    private volatile int selected = STREAM_MAIN;
+    private final AtomicInteger pending = new AtomicInteger(NONE);
+
+    /**
+     * Select the stream to forward (may be called at any time, from any thread, without waiting for the video to be written).
+     */
+    public void select(int stream) {
+        if (stream != STREAM_MAIN && stream != STREAM_SIMULCAST) {
+            Ln.w("Unknown video stream: " + stream);
+            return;
+        }
+
+        if (stream == selected) {
+            // Cancel any pending switch
+            pending.set(NONE);
+            return;
+        }
+
+        pending.set(stream);
+        synchronized (this) {
+            if (codecs[stream] != null) {
+                SurfaceEncoder.requestSyncFrame(codecs[stream]);
+            }
+        }
+    }
+
+    /**
+     * Start a new encoding session (a pending switch is applied immediately, since both encoders start with a key frame).
+     *
+     * @return the size of the selected stream, to be written in the session header
+     */
+    public Size startSession(PacketPipeline pipeline, MediaCodec mainCodec, Size mainSize, MediaCodec simulcastCodec, Size simulcastSize) {
+        sizes[STREAM_MAIN] = mainSize;
+        sizes[STREAM_SIMULCAST] = simulcastSize;
+        hasConfig[STREAM_MAIN] = false;
+        hasConfig[STREAM_SIMULCAST] = false;
+
+        synchronized (this) {
+            codecs[STREAM_MAIN] = mainCodec;
+            codecs[STREAM_SIMULCAST] = simulcastCodec;
+        }
+
+        synchronized (pushLock) {
+            this.pipeline = pipeline;
+            int pendingStream = pending.getAndSet(NONE);
+            if (pendingStream != NONE) {
+                selected = pendingStream;
+            }
+            return sizes[selected];
+        }
+    }
+
+    /**
+     * Stop forwarding packets until the next session (may be called several times).
+     * <p>
+     * Once this method returns, no packet is pushed to the pipeline anymore.
+     */
+    public void stopSession() {
+        synchronized (this) {
+            codecs[STREAM_MAIN] = null;
+            codecs[STREAM_SIMULCAST] = null;
+        }
+        synchronized (pushLock) {
+            pipeline = null;
+        }
+    }
+
+    /**
+     * Request a key frame to the selected encoder (typically after packets have been dropped).
+     */
+    public synchronized void requestSyncFrame() {
+        MediaCodec codec = codecs[selected];
+        if (codec != null) {
+            SurfaceEncoder.requestSyncFrame(codec);
+        }
+    }
+
+    /**
+     * Push a packet produced by the encoder of the given stream (called by the encoding thread of each stream).
+     */
+    public void push(int stream, ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException {
+        boolean config = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
+        if (config) {
+            storeConfig(stream, codecBuffer, bufferInfo);
+        } else if (stream == pending.get()) {
+            boolean keyFrame = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0;
+            if (keyFrame && hasConfig[stream]) {
+                synchronized (pushLock) {
+                    // The switch may have been cancelled in the meantime
+                    if (pipeline != null && pending.compareAndSet(stream, NONE)) {
+                        switchTo(stream, codecBuffer, bufferInfo);
+                    }
+                }
+            }
+            // Otherwise, wait for the requested key frame
+            return;
+        }
+
+        // Only the thread of a stream may select it, so if it is not selected, it will not be until this thread switches to it. This avoids
+        // to wait for pushLock for the packets which are not sent.
+        if (stream == selected) {
+            synchronized (pushLock) {
+                // The other stream may have been selected in the meantime
+                if (pipeline != null && stream == selected) {
+                    pipeline.push(codecBuffer, bufferInfo);
+                }
+            }
+        }
+    }
+
+    private void switchTo(int stream, ByteBuffer keyFrameBuffer, MediaCodec.BufferInfo keyFrameInfo) throws IOException {
+        assert Thread.holdsLock(pushLock);
+        selected = stream;
+
+        // The stream size changes, but the client window must not be resized
+        Size size = sizes[stream];
+        pipeline.pushSession(size.getWidth(), size.getHeight(), true);
+        pipeline.push(configs[stream], configInfo(stream));
+        pipeline.push(keyFrameBuffer, keyFrameInfo);
+
+        Ln.d("Video stream switched to " + (stream == STREAM_MAIN ? "main" : "simulcast") + " (" + size.getWidth() + "x" + size.getHeight()
+                + ")");
+    }
+
+    private void storeConfig(int stream, ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) {
+        int size = bufferInfo.size;
+        ByteBuffer buffer = configs[stream];
+        if (buffer == null || buffer.capacity() < size) {
+            buffer = ByteBuffer.allocate(size);
+            configs[stream] = buffer;
+        }
+
+        ByteBuffer src = codecBuffer.duplicate();
+        src.limit(bufferInfo.offset + size);
+        src.position(bufferInfo.offset);
+
+        buffer.clear();
+        buffer.put(src);
+        buffer.flip();
+        hasConfig[stream] = true;
+    }
+
+    private MediaCodec.BufferInfo configInfo(int stream) {
+        MediaCodec.BufferInfo configInfo = configInfos[stream];
+        configInfo.set(0, configs[stream].remaining(), 0, MediaCodec.BUFFER_FLAG_CODEC_CONFIG);
+        return configInfo;
+    }
+}
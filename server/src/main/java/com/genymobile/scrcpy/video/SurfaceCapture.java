@@ -2,6 +2,13 @@ package com.genymobile.scrcpy.video;
 
 import com.genymobile.scrcpy.model.ConfigurationException;
 import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.opengl.AffineOpenGLFilter;
+import com.genymobile.scrcpy.opengl.FilterChain;
+import com.genymobile.scrcpy.opengl.FilterChainOpenGLFilter;
+import com.genymobile.scrcpy.opengl.FrameChangeDetector;
+import com.genymobile.scrcpy.opengl.OpenGLFilter;
+import com.genymobile.scrcpy.opengl.OpenGLRunner;
+import com.genymobile.scrcpy.util.AffineMatrix;
 
 import android.view.Surface;
 
@@ -13,6 +20,10 @@ import java.io.IOException;
 public abstract class SurfaceCapture {
 
     private CaptureControl captureControl;
+    private DirtyRegions dirtyRegions;
+
+    private Surface simulcastSurface;
+    private Size simulcastSize;
 
     /**
      * Called once before the first capture starts.
@@ -26,6 +37,83 @@ public abstract class SurfaceCapture {
         return captureControl;
     }
 
+    /**
+     * Track the dirty regions of the rendered frames (must be called before {@link #init(CaptureControl, VideoConstraints)}).
+     */
+    public void setDirtyRegions(DirtyRegions dirtyRegions) {
+        this.dirtyRegions = dirtyRegions;
+    }
+
+    public DirtyRegions getDirtyRegions() {
+        return dirtyRegions;
+    }
+
+    /**
+     * Render the captured frames to an additional encoder surface, at a lower resolution (must be called before
+     * {@link #start(Surface)}).
+     */
+    public void setSimulcastOutput(Surface surface, Size size) {
+        this.simulcastSurface = surface;
+        this.simulcastSize = size;
+    }
+
+    /**
+     * Register the simulcast output (if any) to an OpenGL runner, before it is started.
+     *
+     * @param glRunner    the OpenGL runner
+     * @param transform   the filter transform
+     * @param contentSize the size of the content before downscaling, in the video orientation
+     * @param scaleFilter the scale filter ({@code null} for bilinear)
+     * @param sharpen     the sharpening amount ({@code 0} to disable)
+     */
+    protected void addSimulcastOutput(OpenGLRunner glRunner, AffineMatrix transform, Size contentSize, VideoScaleFilter scaleFilter,
+            float sharpen) {
+        if (simulcastSurface != null) {
+            OpenGLFilter filter = createOpenGLFilter(transform, contentSize, simulcastSize, scaleFilter, sharpen);
+            glRunner.setSimulcastOutput(filter, simulcastSize, simulcastSurface);
+        }
+    }
+
+    /**
+     * Create the frame change detector for an OpenGL runner, if the unchanged frames are skipped or the dirty regions are tracked.
+     *
+     * @param transform           the filter transform
+     * @param skipUnchangedFrames whether the unchanged frames must be skipped
+     * @param videoSize           the output size of the runner
+     * @return the frame change detector, or {@code null} if none is needed
+     */
+    protected FrameChangeDetector createFrameChangeDetector(AffineMatrix transform, boolean skipUnchangedFrames, Size videoSize) {
+        if (!skipUnchangedFrames && dirtyRegions == null) {
+            return null;
+        }
+
+        FrameChangeDetector.Listener listener = null;
+        if (dirtyRegions != null) {
+            dirtyRegions.reset(videoSize);
+            // The encoder PTS (in microseconds) is the timestamp of the rendered frame
+            listener = (timestampNs, dirtyCells) -> dirtyRegions.add(timestampNs / 1000, dirtyCells);
+        }
+        return new FrameChangeDetector(transform, skipUnchangedFrames, listener);
+    }
+
+    /**
+     * Create the OpenGL filter rendering the captured frames to the encoder.
+     *
+     * @param transform   the filter transform
+     * @param contentSize the size of the content before downscaling, in the video orientation
+     * @param videoSize   the output size of the runner
+     * @param scaleFilter the scale filter ({@code null} for bilinear)
+     * @param sharpen     the sharpening amount ({@code 0} to disable)
+     * @return the OpenGL filter
+     */
+    protected static OpenGLFilter createOpenGLFilter(AffineMatrix transform, Size contentSize, Size videoSize, VideoScaleFilter scaleFilter,
+            float sharpen) {
+        if (!FilterChain.isRequired(scaleFilter, sharpen)) {
+            return new AffineOpenGLFilter(transform);
+        }
+        return new FilterChainOpenGLFilter(FilterChain.createPasses(transform, contentSize, videoSize, scaleFilter, sharpen));
+    }
+
     /**
      * Called once before the first capture starts.
      *
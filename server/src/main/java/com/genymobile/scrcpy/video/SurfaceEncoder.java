@@ -3,6 +3,7 @@ package com.genymobile.scrcpy.video;
 import com.genymobile.scrcpy.AndroidVersions;
 import com.genymobile.scrcpy.AsyncProcessor;
 import com.genymobile.scrcpy.Options;
+import com.genymobile.scrcpy.device.PacketPipeline;
 import com.genymobile.scrcpy.device.Streamer;
 import com.genymobile.scrcpy.model.Codec;
 import com.genymobile.scrcpy.model.CodecOption;
@@ -12,11 +13,13 @@ import com.genymobile.scrcpy.util.CodecUtils;
 import com.genymobile.scrcpy.util.IO;
 import com.genymobile.scrcpy.util.Ln;
 import com.genymobile.scrcpy.util.LogUtils;
+import com.genymobile.scrcpy.util.StartupTimer;
 
 import android.media.MediaCodec;
 import android.media.MediaCodecInfo;
 import android.media.MediaFormat;
 import android.os.Build;
+import android.os.Bundle;
 import android.os.Looper;
 import android.os.SystemClock;
 import android.view.Surface;
@@ -29,6 +32,11 @@ import java.util.concurrent.atomic.AtomicBoolean;
 public class SurfaceEncoder implements AsyncProcessor {
 
     private static final int DEFAULT_I_FRAME_INTERVAL = 10; // seconds
+    // With intra refresh, the key frames are only generated on request (on start, on reset or after packets are dropped)
+    private static final int INTRA_REFRESH_I_FRAME_INTERVAL = 3600; // seconds
+    private static final int INTRA_REFRESH_PERIOD = 60; // frames
+    // Fallback if intra refresh is not supported: smaller key frames, more often
+    private static final int LOW_LATENCY_I_FRAME_INTERVAL = 2; // seconds
     private static final int REPEAT_FRAME_DELAY_US = 100_000; // repeat after 100ms
     private static final String KEY_MAX_FPS_TO_ENCODER = "max-fps-to-encoder";
 
@@ -36,6 +44,13 @@ public class SurfaceEncoder implements AsyncProcessor {
     private static final int[] MAX_SIZE_FALLBACK = {2560, 1920, 1600, 1280, 1024, 800};
     private static final int MAX_CONSECUTIVE_ERRORS = 3;
 
+    private static final int MIN_SIMULCAST_BIT_RATE = 500_000;
+
+    @FunctionalInterface
+    private interface PacketConsumer {
+        void accept(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo) throws IOException;
+    }
+
     private final SurfaceCapture capture;
     private final Streamer streamer;
     private final String encoderName;
@@ -46,6 +61,11 @@ public class SurfaceEncoder implements AsyncProcessor {
     private final boolean downsizeOnError;
     private final int minSizeAlignment;
     private final boolean ignoreVideoEncoderConstraints;
+    private final boolean lowLatency;
+    private final boolean skipUnchangedFrames;
+    private final boolean dropFrames;
+    private final int simulcastMaxSize;
+    private final Simulcast simulcast;
 
     private boolean firstFrameSent;
     private int consecutiveErrors;
@@ -68,12 +88,24 @@ public class SurfaceEncoder implements AsyncProcessor {
         this.downsizeOnError = options.getDownsizeOnError();
         this.minSizeAlignment = options.getMinSizeAlignment();
         this.ignoreVideoEncoderConstraints = options.getIgnoreVideoEncoderConstraints();
+        this.lowLatency = options.getVideoLowLatency();
+        this.skipUnchangedFrames = options.getSkipUnchangedFrames() && options.getVideoSource() == VideoSource.DISPLAY;
+        this.dropFrames = options.getVideoDropFrames();
+        this.simulcastMaxSize = options.getVideoSource() == VideoSource.DISPLAY ? options.getVideoSimulcast() : 0;
+        this.simulcast = simulcastMaxSize > 0 ? new Simulcast() : null;
+        captureControl.setSimulcast(simulcast);
     }
 
     private void streamCapture() throws IOException, ConfigurationException {
         Codec codec = streamer.getCodec();
         MediaCodec mediaCodec = createMediaCodec(codec, encoderName);
-        MediaFormat format = createFormat(codec.getMimeType(), videoBitRate, maxFps, codecOptions);
+        MediaCodecInfo.CodecCapabilities codecCaps = lowLatency ? mediaCodec.getCodecInfo().getCapabilitiesForType(codec.getMimeType()) : null;
+        MediaFormat format = createFormat(codec.getMimeType(), videoBitRate, maxFps, !skipUnchangedFrames, codecCaps, codecOptions);
+
+        // The simulcast encoder receives the same frames at a lower resolution
+        MediaCodec simulcastCodec = simulcast != null ? createMediaCodec(codec, encoderName) : null;
+        MediaFormat simulcastFormat = simulcast != null
+                ? createFormat(codec.getMimeType(), videoBitRate, maxFps, !skipUnchangedFrames, codecCaps, codecOptions) : null;
 
         MediaCodecInfo.VideoCapabilities caps;
         int alignment;
@@ -96,10 +128,25 @@ public class SurfaceEncoder implements AsyncProcessor {
 
         capture.init(captureControl, videoConstraints);
 
+        // Without a sync frame requester, the pipeline never drops packets
+        Runnable syncFrameRequester = null;
+        if (dropFrames) {
+            syncFrameRequester = () -> {
+                if (simulcast != null) {
+                    simulcast.requestSyncFrame();
+                } else {
+                    requestSyncFrame(mediaCodec);
+                }
+            };
+        }
+        PacketPipeline pipeline = new PacketPipeline(streamer, PacketPipeline.DEFAULT_CAPACITY, syncFrameRequester);
+        PacketConsumer mainConsumer = (codecBuffer, bufferInfo) -> pushMainPacket(codecBuffer, bufferInfo, pipeline);
+
         try {
             boolean alive;
 
             streamer.writeVideoHeader();
+            pipeline.start();
 
             int retainedResetReasons = 0;
 
@@ -120,18 +167,40 @@ public class SurfaceEncoder implements AsyncProcessor {
                 format.setInteger(MediaFormat.KEY_WIDTH, size.getWidth());
                 format.setInteger(MediaFormat.KEY_HEIGHT, size.getHeight());
 
+                Size simulcastSize = null;
+                if (simulcast != null) {
+                    simulcastSize = size.constrain(videoConstraints.withMaxSize(simulcastMaxSize));
+                    simulcastFormat.setInteger(MediaFormat.KEY_WIDTH, simulcastSize.getWidth());
+                    simulcastFormat.setInteger(MediaFormat.KEY_HEIGHT, simulcastSize.getHeight());
+                    simulcastFormat.setInteger(MediaFormat.KEY_BIT_RATE, getSimulcastBitRate(size, simulcastSize));
+                }
+
                 Surface surface = null;
+                Surface simulcastSurface = null;
                 boolean mediaCodecStarted = false;
+                boolean simulcastCodecStarted = false;
+                Thread simulcastThread = null;
                 boolean captureStarted = false;
                 try {
                     mediaCodec.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE);
                     surface = mediaCodec.createInputSurface();
 
+                    if (simulcast != null) {
+                        simulcastCodec.configure(simulcastFormat, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE);
+                        simulcastSurface = simulcastCodec.createInputSurface();
+                        capture.setSimulcastOutput(simulcastSurface, simulcastSize);
+                    }
+
                     capture.start(surface);
                     captureStarted = true;
 
                     mediaCodec.start();
                     mediaCodecStarted = true;
+                    if (simulcast != null) {
+                        simulcastCodec.start();
+                        simulcastCodecStarted = true;
+                    }
+                    StartupTimer.mark(StartupTimer.Phase.VIDEO_ENCODER_STARTED);
 
                     // Set the MediaCodec instance to "interrupt" (by signaling an EOS) on reset
                     captureControl.setRunningMediaCodec(mediaCodec);
@@ -143,10 +212,25 @@ public class SurfaceEncoder implements AsyncProcessor {
                             // The reset is due to a resize initiated by the client
                             boolean isClientResize = (resetReasons & CaptureControl.RESET_REASON_CLIENT_RESIZED) != 0
                                     && (resetReasons & CaptureControl.RESET_REASON_DISPLAY_PROPERTIES_CHANGED) == 0;
-                            streamer.writeSessionMeta(size.getWidth(), size.getHeight(), isClientResize);
+                            Size sessionSize = size;
+                            if (simulcast != null) {
+                                sessionSize = simulcast.startSession(pipeline, mediaCodec, size, simulcastCodec, simulcastSize);
+                            }
+                            // The header is queued in order with the packets: the writer thread may still be writing the packets of the
+                            // previous session (or of a failed attempt)
+                            pipeline.pushSession(sessionSize.getWidth(), sessionSize.getHeight(), isClientResize);
+                            if (simulcast != null) {
+                                // The simulcast packets may be pushed as soon as its thread is started, so after the session header
+                                simulcastThread = startSimulcastEncoding(simulcastCodec, simulcast);
+                            }
 
                             // If a reset is requested during encode(), it will interrupt the encoding by an EOS
-                            encode(mediaCodec, streamer);
+                            encode(mediaCodec, mainConsumer);
+
+                            if (simulcast != null) {
+                                // The simulcast encoder may still produce packets, they must not be written after the next session header
+                                simulcast.stopSession();
+                            }
                         }
 
                         // The capture might have been closed internally (for example if the camera is disconnected)
@@ -166,6 +250,12 @@ public class SurfaceEncoder implements AsyncProcessor {
                     alive = true;
                 } finally {
                     captureControl.setRunningMediaCodec(null);
+                    if (simulcastThread != null) {
+                        stopSimulcastEncoding(simulcastCodec, simulcastThread);
+                    }
+                    if (simulcast != null) {
+                        simulcast.stopSession();
+                    }
                     if (captureStarted) {
                         capture.stop();
                     }
@@ -180,14 +270,46 @@ public class SurfaceEncoder implements AsyncProcessor {
                     if (surface != null) {
                         surface.release();
                     }
+                    if (simulcast != null) {
+                        if (simulcastCodecStarted) {
+                            try {
+                                simulcastCodec.stop();
+                            } catch (IllegalStateException e) {
+                                // ignore (just in case)
+                            }
+                        }
+                        simulcastCodec.reset();
+                        if (simulcastSurface != null) {
+                            simulcastSurface.release();
+                        }
+                    }
                 }
             } while (alive);
         } finally {
+            pipeline.stop();
+            try {
+                pipeline.join();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
             mediaCodec.release();
+            if (simulcastCodec != null) {
+                simulcastCodec.release();
+            }
             capture.release();
         }
     }
 
+    static void requestSyncFrame(MediaCodec mediaCodec) {
+        Bundle bundle = new Bundle();
+        bundle.putInt(MediaCodec.PARAMETER_KEY_REQUEST_SYNC_FRAME, 0);
+        try {
+            mediaCodec.setParameters(bundle);
+        } catch (IllegalStateException e) {
+            // The encoder is being reset, the next frame will be a key frame anyway
+        }
+    }
+
     private boolean prepareRetry(MediaCodecInfo.VideoCapabilities caps, Size currentSize) {
         if (firstFrameSent) {
             ++consecutiveErrors;
@@ -249,7 +371,23 @@ public class SurfaceEncoder implements AsyncProcessor {
         return 0;
     }
 
-    private void encode(MediaCodec codec, Streamer streamer) throws IOException {
+    private void pushMainPacket(ByteBuffer codecBuffer, MediaCodec.BufferInfo bufferInfo, PacketPipeline pipeline) throws IOException {
+        boolean isConfig = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
+        if (!isConfig) {
+            // If this is not a config packet, then it contains a frame
+            firstFrameSent = true;
+            consecutiveErrors = 0;
+        }
+
+        // Copy the packet, so that the buffer is released without waiting for the socket
+        if (simulcast != null) {
+            simulcast.push(Simulcast.STREAM_MAIN, codecBuffer, bufferInfo);
+        } else {
+            pipeline.push(codecBuffer, bufferInfo);
+        }
+    }
+
+    private static void encode(MediaCodec codec, PacketConsumer consumer) throws IOException {
         MediaCodec.BufferInfo bufferInfo = new MediaCodec.BufferInfo();
 
         boolean eos;
@@ -259,15 +397,8 @@ public class SurfaceEncoder implements AsyncProcessor {
                 eos = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0;
                 // On EOS, there might be data or not, depending on bufferInfo.size
                 if (outputBufferId >= 0 && bufferInfo.size > 0) {
-                    boolean isConfig = (bufferInfo.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) != 0;
-                    if (!isConfig) {
-                        // If this is not a config packet, then it contains a frame
-                        firstFrameSent = true;
-                        consecutiveErrors = 0;
-                    }
-
                     ByteBuffer codecBuffer = codec.getOutputBuffer(outputBufferId);
-                    streamer.writePacket(codecBuffer, bufferInfo);
+                    consumer.accept(codecBuffer, bufferInfo);
                 }
             } finally {
                 if (outputBufferId >= 0) {
@@ -277,6 +408,63 @@ public class SurfaceEncoder implements AsyncProcessor {
         } while (!eos);
     }
 
+    private static Thread startSimulcastEncoding(MediaCodec codec, Simulcast simulcast) {
+        Thread thread = new Thread(() -> {
+            try {
+                encode(codec, (codecBuffer, bufferInfo) -> simulcast.push(Simulcast.STREAM_SIMULCAST, codecBuffer, bufferInfo));
+            } catch (IOException | IllegalStateException e) {
+                // The main encoding fails as well, and handles the error
+                Ln.d("Simulcast encoding stopped: " + e.getMessage());
+            }
+        }, "video-simulcast");
+        thread.start();
+        return thread;
+    }
+
+    private static void stopSimulcastEncoding(MediaCodec codec, Thread thread) {
+        try {
+            codec.signalEndOfInputStream();
+        } catch (IllegalStateException e) {
+            // ignore
+        }
+        try {
+            thread.join();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+    }
+
+    private int getSimulcastBitRate(Size size, Size simulcastSize) {
+        // Proportional to the number of pixels
+        long pixels = (long) size.getWidth() * size.getHeight();
+        long simulcastPixels = (long) simulcastSize.getWidth() * simulcastSize.getHeight();
+        long bitRate = videoBitRate * simulcastPixels / pixels;
+        return (int) Math.min(videoBitRate, Math.max(MIN_SIMULCAST_BIT_RATE, bitRate));
+    }
+
+    private static void applyLowLatencyProfile(MediaFormat format, MediaCodecInfo.CodecCapabilities caps) {
+        // Periodic key frames are much larger than the other frames, and cause latency spikes on links with a limited bandwidth
+        if (Build.VERSION.SDK_INT >= AndroidVersions.API_24_ANDROID_7_0 && caps.isFeatureSupported(
+                MediaCodecInfo.CodecCapabilities.FEATURE_IntraRefresh)) {
+            // Refresh the picture progressively, a part of each frame being intra-coded, instead of using periodic key frames
+            format.setInteger(MediaFormat.KEY_INTRA_REFRESH_PERIOD, INTRA_REFRESH_PERIOD);
+            format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, INTRA_REFRESH_I_FRAME_INTERVAL);
+            Ln.i("Low latency video: intra refresh enabled (period: " + INTRA_REFRESH_PERIOD + " frames)");
+            return;
+        }
+
+        // Smaller key frames: a constant bit rate limits their size, at the cost of their quality, which is quickly restored by a shorter
+        // key frame interval
+        format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, LOW_LATENCY_I_FRAME_INTERVAL);
+        MediaCodecInfo.EncoderCapabilities encoderCaps = caps.getEncoderCapabilities();
+        boolean cbr = encoderCaps != null && encoderCaps.isBitrateModeSupported(MediaCodecInfo.EncoderCapabilities.BITRATE_MODE_CBR);
+        if (cbr) {
+            format.setInteger(MediaFormat.KEY_BITRATE_MODE, MediaCodecInfo.EncoderCapabilities.BITRATE_MODE_CBR);
+        }
+        Ln.i("Low latency video: intra refresh not supported by the encoder, using a " + LOW_LATENCY_I_FRAME_INTERVAL + "-second key frame "
+                + "interval" + (cbr ? " with a constant bit rate" : ""));
+    }
+
     private static MediaCodec createMediaCodec(Codec codec, String encoderName) throws IOException, ConfigurationException {
         if (encoderName != null) {
             Ln.d("Creating encoder by name: '" + encoderName + "'");
@@ -307,7 +495,14 @@ public class SurfaceEncoder implements AsyncProcessor {
         }
     }
 
-    private static MediaFormat createFormat(String videoMimeType, int bitRate, float maxFps, List<CodecOption> codecOptions) {
+    /**
+     * Create the encoder format.
+     *
+     * @param repeatFrames   whether the encoder must repeat the previous frame if no new frame is received
+     * @param lowLatencyCaps the encoder capabilities to enable the low latency profile, or {@code null}
+     */
+    private static MediaFormat createFormat(String videoMimeType, int bitRate, float maxFps, boolean repeatFrames,
+            MediaCodecInfo.CodecCapabilities lowLatencyCaps, List<CodecOption> codecOptions) {
         MediaFormat format = new MediaFormat();
         format.setString(MediaFormat.KEY_MIME, videoMimeType);
         format.setInteger(MediaFormat.KEY_BIT_RATE, bitRate);
@@ -318,8 +513,10 @@ public class SurfaceEncoder implements AsyncProcessor {
             format.setInteger(MediaFormat.KEY_COLOR_RANGE, MediaFormat.COLOR_RANGE_LIMITED);
         }
         format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, DEFAULT_I_FRAME_INTERVAL);
-        // display the very first frame, and recover from bad quality when no new frames
-        format.setLong(MediaFormat.KEY_REPEAT_PREVIOUS_FRAME_AFTER, REPEAT_FRAME_DELAY_US); // µs
+        if (repeatFrames) {
+            // display the very first frame, and recover from bad quality when no new frames
+            format.setLong(MediaFormat.KEY_REPEAT_PREVIOUS_FRAME_AFTER, REPEAT_FRAME_DELAY_US); // µs
+        }
         if (Build.VERSION.SDK_INT >= AndroidVersions.API_23_ANDROID_6_0) {
             // real-time priority
             format.setInteger(MediaFormat.KEY_PRIORITY, 0);
@@ -335,6 +532,11 @@ public class SurfaceEncoder implements AsyncProcessor {
             format.setFloat(KEY_MAX_FPS_TO_ENCODER, maxFps);
         }
 
+        if (lowLatencyCaps != null) {
+            applyLowLatencyProfile(format, lowLatencyCaps);
+        }
+
+        // The codec options may override any value set above
         if (codecOptions != null) {
             for (CodecOption option : codecOptions) {
                 String key = option.getKey();
@@ -354,18 +556,21 @@ public class SurfaceEncoder implements AsyncProcessor {
             // <https://github.com/Genymobile/scrcpy/issues/4143>
             Looper.prepare();
 
+            boolean fatalError = false;
             try {
                 streamCapture();
             } catch (ConfigurationException e) {
                 // Do not print stack trace, a user-friendly error-message has already been logged
+                fatalError = true;
             } catch (IOException e) {
                 // Broken pipe is expected on close, because the socket is closed by the client
                 if (!IO.isBrokenPipe(e)) {
                     Ln.e("Video encoding error", e);
+                    fatalError = true;
                 }
             } finally {
                 Ln.d("Screen streaming stopped");
-                listener.onTerminated(true);
+                listener.onTerminated(true, fatalError);
             }
         }, "video");
         thread.start();
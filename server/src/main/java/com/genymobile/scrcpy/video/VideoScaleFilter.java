@@ -0,0 +1,22 @@
+package com.genymobile.scrcpy.video;
+
+public enum VideoScaleFilter {
+    BILINEAR("bilinear"),
+    LANCZOS("lanczos");
+
+    private final String name;
+
+    VideoScaleFilter(String name) {
+        this.name = name;
+    }
+
+    public static VideoScaleFilter findByName(String name) {
+        for (VideoScaleFilter filter : VideoScaleFilter.values()) {
+            if (name.equals(filter.name)) {
+                return filter;
+            }
+        }
+
+        return null;
+    }
+}
@@ -0,0 +1,124 @@
+package com.genymobile.scrcpy.audio;
+
+import com.genymobile.scrcpy.util.AllocationCounter;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class CodecBufferQueueTest {
+
+    @Test
+    public void testOfferTake() throws InterruptedException {
+        CodecBufferQueue queue = new CodecBufferQueue(4);
+
+        Assert.assertTrue(queue.offer(3, 10, 200, 123456, 2));
+        Assert.assertTrue(queue.offer(1));
+
+        Assert.assertEquals(3, queue.take());
+        Assert.assertEquals(10, queue.getOffset());
+        Assert.assertEquals(200, queue.getSize());
+        Assert.assertEquals(123456, queue.getPresentationTimeUs());
+        Assert.assertEquals(2, queue.getFlags());
+
+        Assert.assertEquals(1, queue.take());
+        Assert.assertEquals(0, queue.getOffset());
+        Assert.assertEquals(0, queue.getSize());
+        Assert.assertEquals(0, queue.getPresentationTimeUs());
+        Assert.assertEquals(0, queue.getFlags());
+    }
+
+    @Test
+    public void testFull() throws InterruptedException {
+        CodecBufferQueue queue = new CodecBufferQueue(2);
+
+        Assert.assertTrue(queue.offer(0));
+        Assert.assertTrue(queue.offer(1));
+        Assert.assertFalse(queue.offer(2));
+
+        // Taking an element frees a slot
+        Assert.assertEquals(0, queue.take());
+        Assert.assertTrue(queue.offer(2));
+        Assert.assertEquals(1, queue.take());
+        Assert.assertEquals(2, queue.take());
+    }
+
+    @Test(expected = IllegalArgumentException.class)
+    public void testCapacityNotPowerOf2() {
+        new CodecBufferQueue(3);
+    }
+
+    @Test
+    public void testInterrupt() throws InterruptedException {
+        CodecBufferQueue queue = new CodecBufferQueue(4);
+        boolean[] interrupted = new boolean[1];
+
+        Thread consumer = new Thread(() -> {
+            try {
+                queue.take();
+            } catch (InterruptedException e) {
+                interrupted[0] = true;
+            }
+        });
+        consumer.start();
+        consumer.interrupt();
+        consumer.join();
+
+        Assert.assertTrue(interrupted[0]);
+    }
+
+    @Test
+    public void testConcurrent() throws InterruptedException {
+        final int count = 100_000;
+        CodecBufferQueue queue = new CodecBufferQueue(8);
+        int[] errors = new int[1];
+
+        Thread consumer = new Thread(() -> {
+            try {
+                for (int i = 0; i < count; ++i) {
+                    int index = queue.take();
+                    // All the fields of an element must be consistent
+                    if (index != i || queue.getOffset() != i + 1 || queue.getSize() != i + 2 || queue.getPresentationTimeUs() != i * 1000L
+                            || queue.getFlags() != (i & 0xF)) {
+                        ++errors[0];
+                    }
+                }
+            } catch (InterruptedException e) {
+                ++errors[0];
+            }
+        });
+        consumer.start();
+
+        for (int i = 0; i < count; ++i) {
+            while (!queue.offer(i, i + 1, i + 2, i * 1000L, i & 0xF)) {
+                // The consumer is late, the codec would not produce more buffers than it owns
+                Thread.yield();
+            }
+        }
+
+        consumer.join();
+        Assert.assertEquals(0, errors[0]);
+    }
+
+    @Test
+    public void testNoAllocation() throws InterruptedException {
+        AllocationCounter allocationCounter = AllocationCounter.create();
+
+        CodecBufferQueue queue = new CodecBufferQueue(64);
+
+        // Warm up (class loading, JIT)
+        for (int i = 0; i < 10_000; ++i) {
+            queue.offer(i, 0, i, i, 0);
+            queue.take();
+        }
+
+        long before = allocationCounter.getAllocatedBytes();
+        for (int i = 0; i < 100_000; ++i) {
+            queue.offer(i, 0, i, i, 0);
+            queue.take();
+        }
+        long after = allocationCounter.getAllocatedBytes();
+
+        // Tolerate the allocations of the measurement itself (a single allocation per element would be more than 1 MB)
+        Assert.assertTrue("Allocated bytes: " + (after - before), after - before < 4096);
+    }
+}
@@ -1,5 +1,7 @@
 package com.genymobile.scrcpy.control;
 
+import com.genymobile.scrcpy.util.AllocationCounter;
+
 import android.view.KeyEvent;
 import android.view.MotionEvent;
 import org.junit.Assert;
@@ -513,6 +515,24 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParseSelectVideoStream() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_SELECT_VIDEO_STREAM);
+        dos.writeByte(1);
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SELECT_VIDEO_STREAM, event.getType());
+        Assert.assertEquals(1, event.getStream());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
@@ -584,4 +604,131 @@ public class ControlMessageReaderTest {
             // expected
         }
     }
+
+    private static void writeTouchEvent(DataOutputStream dos, int action, int x, int y) throws IOException {
+        dos.writeByte(ControlMessage.TYPE_INJECT_TOUCH_EVENT);
+        dos.writeByte(action);
+        dos.writeLong(-1); // pointerId
+        dos.writeInt(x);
+        dos.writeInt(y);
+        dos.writeShort(1080);
+        dos.writeShort(1920);
+        dos.writeShort(0xffff); // pressure
+        dos.writeInt(0); // action button
+        dos.writeInt(0); // buttons
+    }
+
+    private static void writeKeycodeEvent(DataOutputStream dos, int action, int keycode) throws IOException {
+        dos.writeByte(ControlMessage.TYPE_INJECT_KEYCODE);
+        dos.writeByte(action);
+        dos.writeInt(keycode);
+        dos.writeInt(0); // repeat
+        dos.writeInt(0); // meta state
+    }
+
+    private static void writeUhidInput(DataOutputStream dos, byte[] data) throws IOException {
+        dos.writeByte(ControlMessage.TYPE_UHID_INPUT);
+        dos.writeShort(1); // id
+        dos.writeShort(data.length);
+        dos.write(data);
+    }
+
+    @Test
+    public void testReuseMessages() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        writeTouchEvent(dos, MotionEvent.ACTION_DOWN, 100, 200);
+        writeTouchEvent(dos, MotionEvent.ACTION_UP, 100, 200);
+        writeTouchEvent(dos, MotionEvent.ACTION_DOWN, 300, 400);
+        writeUhidInput(dos, new byte[] {1, 2, 3});
+        writeUhidInput(dos, new byte[] {4, 5, 6});
+        writeUhidInput(dos, new byte[] {7, 8});
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis, true);
+
+        ControlMessage event1 = reader.read();
+        Assert.assertEquals(MotionEvent.ACTION_DOWN, event1.getAction());
+        Assert.assertEquals(100, event1.getPosition().getPoint().getX());
+        Assert.assertEquals(200, event1.getPosition().getPoint().getY());
+
+        ControlMessage event2 = reader.read();
+        Assert.assertSame(event1, event2);
+        Assert.assertEquals(MotionEvent.ACTION_UP, event2.getAction());
+        Assert.assertEquals(100, event2.getPosition().getPoint().getX());
+        Assert.assertEquals(200, event2.getPosition().getPoint().getY());
+
+        ControlMessage event3 = reader.read();
+        Assert.assertSame(event1, event3);
+        Assert.assertEquals(MotionEvent.ACTION_DOWN, event3.getAction());
+        Assert.assertEquals(300, event3.getPosition().getPoint().getX());
+        Assert.assertEquals(400, event3.getPosition().getPoint().getY());
+        Assert.assertEquals(1080, event3.getPosition().getScreenSize().getWidth());
+        Assert.assertEquals(1920, event3.getPosition().getScreenSize().getHeight());
+
+        ControlMessage uhid1 = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_UHID_INPUT, uhid1.getType());
+        Assert.assertArrayEquals(new byte[] {1, 2, 3}, uhid1.getData());
+        byte[] data = uhid1.getData();
+
+        ControlMessage uhid2 = reader.read();
+        Assert.assertSame(uhid1, uhid2);
+        Assert.assertSame(data, uhid2.getData()); // same size, the array is reused
+        Assert.assertArrayEquals(new byte[] {4, 5, 6}, uhid2.getData());
+
+        ControlMessage uhid3 = reader.read();
+        Assert.assertArrayEquals(new byte[] {7, 8}, uhid3.getData());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
+    @Test
+    public void testNoReuseByDefault() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        writeKeycodeEvent(dos, KeyEvent.ACTION_DOWN, KeyEvent.KEYCODE_A);
+        writeKeycodeEvent(dos, KeyEvent.ACTION_UP, KeyEvent.KEYCODE_A);
+        byte[] packet = bos.toByteArray();
+
+        ControlMessageReader reader = new ControlMessageReader(new ByteArrayInputStream(packet));
+        ControlMessage event1 = reader.read();
+        ControlMessage event2 = reader.read();
+        Assert.assertNotSame(event1, event2);
+        Assert.assertEquals(KeyEvent.ACTION_DOWN, event1.getAction());
+        Assert.assertEquals(KeyEvent.ACTION_UP, event2.getAction());
+    }
+
+    @Test
+    public void testReusedMessagesDoNotAllocate() throws IOException {
+        AllocationCounter allocationCounter = AllocationCounter.create();
+
+        final int count = 10000;
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        byte[] report = {1, 2, 3, 4, 5, 6, 7, 8};
+        // Twice, the first half to warm up
+        for (int i = 0; i < 2 * count; ++i) {
+            writeKeycodeEvent(dos, i % 2 == 0 ? KeyEvent.ACTION_DOWN : KeyEvent.ACTION_UP, KeyEvent.KEYCODE_A);
+            // A drag, each move at a new location
+            writeTouchEvent(dos, MotionEvent.ACTION_MOVE, 500 + i % 300, 600 + i % 500);
+            writeUhidInput(dos, report);
+        }
+        byte[] packet = bos.toByteArray();
+
+        ControlMessageReader reader = new ControlMessageReader(new ByteArrayInputStream(packet), true);
+        for (int i = 0; i < 3 * count; ++i) {
+            reader.read();
+        }
+
+        long before = allocationCounter.getAllocatedBytes();
+        for (int i = 0; i < 3 * count; ++i) {
+            reader.read();
+        }
+        long allocated = allocationCounter.getAllocatedBytes() - before;
+
+        // Allocating a single object per message would take at least 16 bytes per message
+        Assert.assertTrue("Allocated " + allocated + " bytes for " + 3 * count + " messages", allocated < count);
+    }
 }
@@ -0,0 +1,154 @@
+package com.genymobile.scrcpy.control;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+public class MoveBatcherTest {
+
+    private static final int ACTION_MOVE = 2;
+    private static final int ACTION_HOVER_MOVE = 7;
+    private static final int SOURCE_TOUCHSCREEN = 0x1002;
+
+    /**
+     * Record the injected events, as the list of their sample times.
+     */
+    private static class FakeInjector implements MoveBatcher.Injector {
+        private final List<List<Long>> injected = new ArrayList<>();
+        private List<Long> current;
+        private int lastAction;
+
+        @Override
+        public void begin(long eventTime, int action, int source, int buttons, int pointerCount, int displayId) {
+            Assert.assertNull("The previous event was not injected", current);
+            current = new ArrayList<>();
+            current.add(eventTime);
+            lastAction = action;
+        }
+
+        @Override
+        public void append(long eventTime) {
+            Assert.assertNotNull(current);
+            current.add(eventTime);
+        }
+
+        @Override
+        public boolean inject() {
+            Assert.assertNotNull(current);
+            injected.add(current);
+            current = null;
+            return true;
+        }
+    }
+
+    @Test
+    public void testMergeConsecutiveMoves() {
+        FakeInjector injector = new FakeInjector();
+        MoveBatcher batcher = new MoveBatcher(injector, 32, 100);
+
+        Assert.assertTrue(batcher.move(1, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0));
+        Assert.assertTrue(batcher.move(2, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0));
+        Assert.assertTrue(batcher.move(3, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0));
+
+        // Nothing is injected until flush
+        Assert.assertTrue(injector.injected.isEmpty());
+        Assert.assertTrue(batcher.hasPending());
+
+        Assert.assertTrue(batcher.flush());
+        Assert.assertFalse(batcher.hasPending());
+
+        // A single injection, with all the samples
+        Assert.assertEquals(1, injector.injected.size());
+        Assert.assertEquals(Arrays.asList(1L, 2L, 3L), injector.injected.get(0));
+    }
+
+    @Test
+    public void testFlushWithoutPending() {
+        FakeInjector injector = new FakeInjector();
+        MoveBatcher batcher = new MoveBatcher(injector);
+
+        Assert.assertTrue(batcher.flush());
+        Assert.assertTrue(injector.injected.isEmpty());
+    }
+
+    @Test
+    public void testIncompatibleMoves() {
+        FakeInjector injector = new FakeInjector();
+        MoveBatcher batcher = new MoveBatcher(injector, 32, 100);
+
+        batcher.move(1, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        batcher.move(2, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        // Another pointer count (a second finger is down)
+        batcher.move(3, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 2, 0);
+        // Other buttons
+        batcher.move(4, ACTION_MOVE, SOURCE_TOUCHSCREEN, 1, 2, 0);
+        // Another action
+        batcher.move(5, ACTION_HOVER_MOVE, SOURCE_TOUCHSCREEN, 1, 2, 0);
+        // Another display
+        batcher.move(6, ACTION_HOVER_MOVE, SOURCE_TOUCHSCREEN, 1, 2, 3);
+        batcher.move(7, ACTION_HOVER_MOVE, SOURCE_TOUCHSCREEN, 1, 2, 3);
+        batcher.flush();
+
+        Assert.assertEquals(5, injector.injected.size());
+        Assert.assertEquals(Arrays.asList(1L, 2L), injector.injected.get(0));
+        Assert.assertEquals(Arrays.asList(3L), injector.injected.get(1));
+        Assert.assertEquals(Arrays.asList(4L), injector.injected.get(2));
+        Assert.assertEquals(Arrays.asList(5L), injector.injected.get(3));
+        Assert.assertEquals(Arrays.asList(6L, 7L), injector.injected.get(4));
+        Assert.assertEquals(ACTION_HOVER_MOVE, injector.lastAction);
+    }
+
+    @Test
+    public void testMaxSamples() {
+        FakeInjector injector = new FakeInjector();
+        MoveBatcher batcher = new MoveBatcher(injector, 3, 100);
+
+        for (int i = 0; i < 7; ++i) {
+            batcher.move(i, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        }
+
+        // The full batches are injected immediately
+        Assert.assertEquals(2, injector.injected.size());
+        Assert.assertEquals(Arrays.asList(0L, 1L, 2L), injector.injected.get(0));
+        Assert.assertEquals(Arrays.asList(3L, 4L, 5L), injector.injected.get(1));
+
+        batcher.flush();
+        Assert.assertEquals(3, injector.injected.size());
+        Assert.assertEquals(Arrays.asList(6L), injector.injected.get(2));
+    }
+
+    @Test
+    public void testMaxDelay() {
+        FakeInjector injector = new FakeInjector();
+        MoveBatcher batcher = new MoveBatcher(injector, 32, 8);
+
+        batcher.move(100, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        batcher.move(104, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        Assert.assertTrue(injector.injected.isEmpty());
+
+        // 8 ms after the first sample, the batch is injected even if more moves are queued
+        batcher.move(108, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0);
+        Assert.assertEquals(1, injector.injected.size());
+        Assert.assertEquals(Arrays.asList(100L, 104L, 108L), injector.injected.get(0));
+        Assert.assertFalse(batcher.hasPending());
+    }
+
+    @Test
+    public void testInjectionFailure() {
+        MoveBatcher batcher = new MoveBatcher(new FakeInjector() {
+            @Override
+            public boolean inject() {
+                super.inject();
+                return false;
+            }
+        }, 32, 100);
+
+        Assert.assertTrue(batcher.move(1, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 1, 0));
+        // The pending event is injected (and fails) when an incompatible move is received
+        Assert.assertFalse(batcher.move(2, ACTION_MOVE, SOURCE_TOUCHSCREEN, 0, 2, 0));
+        Assert.assertFalse(batcher.flush());
+    }
+}
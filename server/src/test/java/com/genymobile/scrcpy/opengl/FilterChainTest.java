@@ -0,0 +1,157 @@
+package com.genymobile.scrcpy.opengl;
+
+import com.genymobile.scrcpy.model.Size;
+import com.genymobile.scrcpy.util.AffineMatrix;
+import com.genymobile.scrcpy.video.VideoScaleFilter;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.util.List;
+
+public class FilterChainTest {
+
+    private static final float EPSILON = 1e-6f;
+
+    private static final Size FULL_HD = new Size(1920, 1080);
+    private static final Size HALF_HD = new Size(960, 540);
+
+    private static float sum(float[] weights) {
+        // The side weights are applied on both sides of the center
+        float sum = weights[0];
+        for (int i = 1; i < weights.length; ++i) {
+            sum += 2 * weights[i];
+        }
+        return sum;
+    }
+
+    @Test
+    public void testIsRequired() {
+        Assert.assertFalse(FilterChain.isRequired(null, 0));
+        Assert.assertFalse(FilterChain.isRequired(VideoScaleFilter.BILINEAR, 0));
+        Assert.assertTrue(FilterChain.isRequired(VideoScaleFilter.LANCZOS, 0));
+        Assert.assertTrue(FilterChain.isRequired(VideoScaleFilter.BILINEAR, 0.3f));
+    }
+
+    @Test
+    public void testBilinear() {
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, HALF_HD, VideoScaleFilter.BILINEAR, 0);
+        Assert.assertEquals(1, passes.size());
+
+        FilterPass pass = passes.get(0);
+        Assert.assertEquals(FilterPass.Type.RESAMPLE, pass.getType());
+        Assert.assertEquals(HALF_HD, pass.getOutputSize());
+        Assert.assertEquals(0, pass.getRadius());
+        Assert.assertArrayEquals(new float[] {1}, pass.getWeights(), EPSILON);
+    }
+
+    @Test
+    public void testLanczosHalf() {
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, HALF_HD, VideoScaleFilter.LANCZOS, 0);
+        Assert.assertEquals(2, passes.size());
+
+        // The horizontal pass reduces the width only
+        FilterPass horizontal = passes.get(0);
+        Assert.assertEquals(new Size(960, 1080), horizontal.getOutputSize());
+        // The kernel covers 3 * 2 source pixels on each side, the farthest tap (at 6) has a zero weight so it is not included
+        Assert.assertEquals(5, horizontal.getRadius());
+        Assert.assertEquals(1f / 1920, horizontal.getStepX(), EPSILON);
+        Assert.assertEquals(0, horizontal.getStepY(), EPSILON);
+
+        float[] weights = horizontal.getWeights();
+        // The taps on the zeros of the kernel (at 1 and 2 in kernel units)
+        Assert.assertEquals(0, weights[2], EPSILON);
+        Assert.assertEquals(0, weights[4], EPSILON);
+        // Negative lobe
+        Assert.assertTrue(weights[3] < 0);
+        Assert.assertEquals(1, sum(weights), EPSILON);
+
+        FilterPass vertical = passes.get(1);
+        Assert.assertEquals(HALF_HD, vertical.getOutputSize());
+        Assert.assertEquals(5, vertical.getRadius());
+        Assert.assertEquals(0, vertical.getStepX(), EPSILON);
+        Assert.assertEquals(1f / 1080, vertical.getStepY(), EPSILON);
+    }
+
+    @Test
+    public void testLanczosWidthOnly() {
+        Size outputSize = new Size(960, 1080);
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, outputSize, VideoScaleFilter.LANCZOS, 0);
+
+        // The height is not reduced, so the horizontal pass renders directly to the output
+        Assert.assertEquals(1, passes.size());
+        Assert.assertEquals(outputSize, passes.get(0).getOutputSize());
+        Assert.assertEquals(5, passes.get(0).getRadius());
+    }
+
+    @Test
+    public void testLanczosUpscale() {
+        Size outputSize = new Size(3840, 2160);
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, outputSize, VideoScaleFilter.LANCZOS, 0);
+
+        Assert.assertEquals(1, passes.size());
+        Assert.assertEquals(0, passes.get(0).getRadius());
+        Assert.assertArrayEquals(new float[] {1}, passes.get(0).getWeights(), EPSILON);
+    }
+
+    @Test
+    public void testLanczosMaxRadius() {
+        Size outputSize = new Size(480, 270);
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, outputSize, VideoScaleFilter.LANCZOS, 0);
+        Assert.assertEquals(2, passes.size());
+
+        // The kernel covers 3 * 4 = 12 source pixels on each side, so the taps are spaced by 12 / 9 pixels
+        FilterPass horizontal = passes.get(0);
+        Assert.assertEquals(FilterChain.MAX_RADIUS, horizontal.getRadius());
+        Assert.assertEquals(12f / 9 / 1920, horizontal.getStepX(), EPSILON);
+        Assert.assertEquals(1, sum(horizontal.getWeights()), EPSILON);
+    }
+
+    @Test
+    public void testSharpen() {
+        List<FilterPass> passes = FilterChain.createPasses(null, FULL_HD, HALF_HD, VideoScaleFilter.LANCZOS, 0.3f);
+        Assert.assertEquals(3, passes.size());
+
+        FilterPass sharpen = passes.get(2);
+        Assert.assertEquals(FilterPass.Type.SHARPEN, sharpen.getType());
+        Assert.assertEquals(HALF_HD, sharpen.getOutputSize());
+        Assert.assertEquals(0.3f, sharpen.getAmount(), EPSILON);
+        // The neighbours are the adjacent pixels of the output
+        Assert.assertEquals(1f / 960, sharpen.getStepX(), EPSILON);
+        Assert.assertEquals(1f / 540, sharpen.getStepY(), EPSILON);
+    }
+
+    @Test
+    public void testRotatedStep() {
+        AffineMatrix transform = AffineMatrix.rotateOrtho(1);
+        List<FilterPass> passes = FilterChain.createPasses(transform, FULL_HD, HALF_HD, VideoScaleFilter.LANCZOS, 0);
+
+        // The horizontal axis of the output is the vertical axis of the (rotated) input
+        FilterPass horizontal = passes.get(0);
+        Assert.assertEquals(0, horizontal.getStepX(), EPSILON);
+        Assert.assertEquals(1f / 1920, horizontal.getStepY(), EPSILON);
+    }
+
+    @Test
+    public void testTransformAppliedOnce() {
+        AffineMatrix transform = AffineMatrix.rotate(23).fromCenter();
+        List<FilterPass> passes = FilterChain.createPasses(transform, FULL_HD, HALF_HD, VideoScaleFilter.LANCZOS, 0.3f);
+
+        // The first pass applies the transform, the next ones read the intermediate textures as is
+        AffineMatrix product = AffineMatrix.IDENTITY;
+        for (FilterPass pass : passes) {
+            product = product.multiply(pass.getTransform());
+        }
+        Assert.assertArrayEquals(transform.to4x4(), product.to4x4(), EPSILON);
+        Assert.assertArrayEquals(transform.to4x4(), passes.get(0).getTransform().to4x4(), EPSILON);
+    }
+
+    @Test
+    public void testLanczosKernel() {
+        Assert.assertEquals(1, FilterChain.lanczos(0), EPSILON);
+        Assert.assertEquals(0, FilterChain.lanczos(1), EPSILON);
+        Assert.assertEquals(0, FilterChain.lanczos(2), EPSILON);
+        Assert.assertEquals(0, FilterChain.lanczos(3), EPSILON);
+        Assert.assertEquals(FilterChain.lanczos(0.5), FilterChain.lanczos(-0.5), EPSILON);
+    }
+}
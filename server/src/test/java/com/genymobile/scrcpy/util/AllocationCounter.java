@@ -0,0 +1,56 @@
+package com.genymobile.scrcpy.util;
+
+import org.junit.Assume;
+
+import java.lang.reflect.Method;
+
+/**
+ * Count the bytes allocated by the current thread, to check that a code path does not allocate.
+ * <p>
+ * The per-thread allocation counter is specific to the HotSpot JVM, and the management API is not in the Android SDK, so it is accessed via
+ * reflection. If it is not available, the calling test is skipped.
+ */
+public final class AllocationCounter {
+
+    private final Object threadMXBean;
+    private final Method getThreadAllocatedBytes;
+    private final long threadId = Thread.currentThread().getId();
+
+    private AllocationCounter(Object threadMXBean, Method getThreadAllocatedBytes) {
+        this.threadMXBean = threadMXBean;
+        this.getThreadAllocatedBytes = getThreadAllocatedBytes;
+    }
+
+    /**
+     * Create a counter for the current thread, or skip the test if the allocation counter is not supported.
+     */
+    public static AllocationCounter create() {
+        try {
+            Class<?> managementFactory = Class.forName("java.lang.management.ManagementFactory");
+            Object threadMXBean = managementFactory.getMethod("getThreadMXBean").invoke(null);
+            Class<?> hotSpotThreadMXBean = Class.forName("com.sun.management.ThreadMXBean");
+            Assume.assumeTrue(hotSpotThreadMXBean.isInstance(threadMXBean));
+            Assume.assumeTrue((boolean) hotSpotThreadMXBean.getMethod("isThreadAllocatedMemorySupported").invoke(threadMXBean));
+            hotSpotThreadMXBean.getMethod("setThreadAllocatedMemoryEnabled", boolean.class).invoke(threadMXBean, true);
+            Method getThreadAllocatedBytes = hotSpotThreadMXBean.getMethod("getThreadAllocatedBytes", long.class);
+            return new AllocationCounter(threadMXBean, getThreadAllocatedBytes);
+        } catch (ReflectiveOperationException e) {
+            Assume.assumeNoException(e);
+            throw new AssertionError(e); // unreachable
+        }
+    }
+
+    /**
+     * Return the total number of bytes allocated by the thread which created this counter.
+     */
+    public long getAllocatedBytes() {
+        long bytes;
+        try {
+            bytes = (long) getThreadAllocatedBytes.invoke(threadMXBean, threadId);
+        } catch (ReflectiveOperationException e) {
+            throw new AssertionError(e);
+        }
+        Assume.assumeTrue(bytes >= 0); // -1 if the measurement is disabled
+        return bytes;
+    }
+}
@@ -0,0 +1,142 @@
+package com.genymobile.scrcpy.util;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+public class GatheringWriterTest {
+
+    /**
+     * Stand-in for a pipe or socket file descriptor, accepting at most {@code capacity} bytes per call (like a non-empty socket buffer).
+     */
+    private static final class PipeSink implements GatheringWriter.Sink {
+        private final int capacity;
+        private final ByteArrayOutputStream written = new ByteArrayOutputStream();
+        private int calls;
+
+        PipeSink(int capacity) {
+            this.capacity = capacity;
+        }
+
+        @Override
+        public int writev(Object[] buffers, int[] offsets, int[] byteCounts) {
+            ++calls;
+            int total = 0;
+            for (int i = 0; i < buffers.length && total < capacity; ++i) {
+                int len = Math.min(byteCounts[i], capacity - total);
+                if (buffers[i] instanceof byte[]) {
+                    written.write((byte[]) buffers[i], offsets[i], len);
+                } else {
+                    ByteBuffer buffer = ((ByteBuffer) buffers[i]).duplicate();
+                    Assert.assertTrue(buffer.isDirect());
+                    buffer.limit(buffer.capacity());
+                    buffer.position(offsets[i]);
+                    for (int j = 0; j < len; ++j) {
+                        written.write(buffer.get());
+                    }
+                }
+                total += len;
+            }
+            return total;
+        }
+    }
+
+    private static ByteBuffer createDirectPayload(byte[] data) {
+        ByteBuffer buffer = ByteBuffer.allocateDirect(data.length + 4);
+        buffer.position(4); // the payload does not start at 0
+        buffer.put(data);
+        buffer.flip();
+        buffer.position(4);
+        return buffer;
+    }
+
+    private static byte[] concat(byte[] a, byte[] b) {
+        byte[] result = new byte[a.length + b.length];
+        System.arraycopy(a, 0, result, 0, a.length);
+        System.arraycopy(b, 0, result, a.length, b.length);
+        return result;
+    }
+
+    @Test
+    public void testSingleSyscall() throws IOException {
+        byte[] header = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+        byte[] data = {20, 21, 22, 23, 24, 25, 26};
+        ByteBuffer payload = createDirectPayload(data);
+
+        PipeSink sink = new PipeSink(Integer.MAX_VALUE);
+        GatheringWriter writer = new GatheringWriter(sink);
+        writer.writeFully(header, header.length, payload);
+
+        Assert.assertEquals(1, sink.calls);
+        Assert.assertArrayEquals(concat(header, data), sink.written.toByteArray());
+        Assert.assertFalse(payload.hasRemaining());
+    }
+
+    @Test
+    public void testPartialWrites() throws IOException {
+        byte[] header = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+        byte[] data = new byte[100];
+        for (int i = 0; i < data.length; ++i) {
+            data[i] = (byte) i;
+        }
+        ByteBuffer payload = createDirectPayload(data);
+
+        // Some writes end in the middle of the header, others in the middle of the payload
+        PipeSink sink = new PipeSink(5);
+        GatheringWriter writer = new GatheringWriter(sink);
+        writer.writeFully(header, header.length, payload);
+
+        Assert.assertEquals((header.length + data.length + 4) / 5, sink.calls);
+        Assert.assertArrayEquals(concat(header, data), sink.written.toByteArray());
+        Assert.assertFalse(payload.hasRemaining());
+    }
+
+    @Test
+    public void testConsecutivePackets() throws IOException {
+        byte[] header1 = {1, 2, 3};
+        byte[] data1 = {10, 11};
+        byte[] header2 = {4, 5, 6};
+        byte[] data2 = {12, 13, 14};
+
+        PipeSink sink = new PipeSink(Integer.MAX_VALUE);
+        GatheringWriter writer = new GatheringWriter(sink);
+        writer.writeFully(header1, header1.length, createDirectPayload(data1));
+        writer.writeFully(header2, header2.length, createDirectPayload(data2));
+
+        Assert.assertEquals(2, sink.calls);
+        byte[] expected = concat(concat(header1, data1), concat(header2, data2));
+        Assert.assertArrayEquals(expected, sink.written.toByteArray());
+    }
+
+    @Test
+    public void testHeapPayload() throws IOException {
+        byte[] header = {1, 2, 3, 4};
+        byte[] array = {0, 0, 30, 31, 32, 33, 0};
+        // A slice, so that the array offset is not 0
+        ByteBuffer payload = ByteBuffer.wrap(array, 1, 5).slice();
+        payload.position(1);
+
+        PipeSink sink = new PipeSink(3);
+        GatheringWriter writer = new GatheringWriter(sink);
+        writer.writeFully(header, header.length, payload);
+
+        Assert.assertArrayEquals(new byte[] {1, 2, 3, 4, 30, 31, 32, 33}, sink.written.toByteArray());
+        Assert.assertFalse(payload.hasRemaining());
+    }
+
+    @Test
+    public void testHeaderLength() throws IOException {
+        // Only the first bytes of the header array are written
+        byte[] header = {1, 2, 3, 4, 5, 6};
+        byte[] data = {7, 8};
+
+        PipeSink sink = new PipeSink(Integer.MAX_VALUE);
+        GatheringWriter writer = new GatheringWriter(sink);
+        writer.writeFully(header, 2, createDirectPayload(data));
+
+        Assert.assertArrayEquals(new byte[] {1, 2, 7, 8}, sink.written.toByteArray());
+    }
+}
@@ -0,0 +1,133 @@
+package com.genymobile.scrcpy.video;
+
+import com.genymobile.scrcpy.model.Size;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class DirtyRegionsTest {
+
+    // 1280x640: each cell is 20x10 pixels
+    private static final Size VIDEO_SIZE = new Size(1280, 640);
+
+    private static long[] cells(int... colRows) {
+        long[] cells = new long[DirtyRegions.GRID_SIZE];
+        for (int i = 0; i < colRows.length; i += 2) {
+            cells[colRows[i + 1]] |= 1L << colRows[i];
+        }
+        return cells;
+    }
+
+    private static int[] newRects() {
+        return new int[4 * DirtyRegions.MAX_RECTS];
+    }
+
+    private static void assertRect(int[] rects, int i, int x, int y, int w, int h) {
+        Assert.assertEquals(x, rects[4 * i]);
+        Assert.assertEquals(y, rects[4 * i + 1]);
+        Assert.assertEquals(w, rects[4 * i + 2]);
+        Assert.assertEquals(h, rects[4 * i + 3]);
+    }
+
+    @Test
+    public void testSingleCell() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, cells(10, 5));
+
+        int[] rects = newRects();
+        Assert.assertEquals(1, dirtyRegions.poll(1000, rects));
+        // Cell (200, 50, 20, 10), expanded by 16 pixels on each side
+        assertRect(rects, 0, 184, 34, 52, 42);
+    }
+
+    @Test
+    public void testMarginClamped() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, cells(0, 0, 63, 63));
+
+        int[] rects = newRects();
+        Assert.assertEquals(2, dirtyRegions.poll(1000, rects));
+        assertRect(rects, 0, 0, 0, 36, 26);
+        assertRect(rects, 1, 1244, 614, 36, 26);
+    }
+
+    @Test
+    public void testMergeRows() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, cells(0, 2, 1, 2, 0, 3, 1, 3, 0, 4, 1, 4));
+
+        int[] rects = newRects();
+        Assert.assertEquals(1, dirtyRegions.poll(1000, rects));
+        assertRect(rects, 0, 0, 4, 56, 62);
+    }
+
+    @Test
+    public void testMergeDroppedFrames() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, cells(10, 5));
+        dirtyRegions.add(2000, cells(30, 40));
+        dirtyRegions.add(3000, cells(50, 60));
+
+        // The frame 1000 has not been encoded, its changes must be included in the frame 2000
+        int[] rects = newRects();
+        Assert.assertEquals(2, dirtyRegions.poll(2000, rects));
+        assertRect(rects, 0, 184, 34, 52, 42);
+        assertRect(rects, 1, 584, 384, 52, 42);
+
+        Assert.assertEquals(1, dirtyRegions.poll(3000, rects));
+        assertRect(rects, 0, 984, 584, 52, 42);
+    }
+
+    @Test
+    public void testUnknownPts() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, cells(10, 5));
+
+        // For example, a frame repeated by the encoder
+        int[] rects = newRects();
+        Assert.assertEquals(-1, dirtyRegions.poll(1500, rects));
+        Assert.assertEquals(-1, dirtyRegions.poll(1000, rects));
+    }
+
+    @Test
+    public void testWholeFrame() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        dirtyRegions.add(1000, null);
+        dirtyRegions.add(2000, cells(10, 5));
+
+        int[] rects = newRects();
+        Assert.assertEquals(-1, dirtyRegions.poll(2000, rects));
+    }
+
+    @Test
+    public void testTooManyRects() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.reset(VIDEO_SIZE);
+        // 17 cells, in non-consecutive rows
+        int[] colRows = new int[2 * (DirtyRegions.MAX_RECTS + 1)];
+        for (int i = 0; i <= DirtyRegions.MAX_RECTS; ++i) {
+            colRows[2 * i + 1] = 2 * i;
+        }
+        dirtyRegions.add(1000, cells(colRows));
+
+        // Fallback to the bounding rectangle
+        int[] rects = newRects();
+        Assert.assertEquals(1, dirtyRegions.poll(1000, rects));
+        assertRect(rects, 0, 0, 0, 36, 346);
+    }
+
+    @Test
+    public void testNoVideoSize() {
+        DirtyRegions dirtyRegions = new DirtyRegions();
+        dirtyRegions.add(1000, cells(10, 5));
+
+        int[] rects = newRects();
+        Assert.assertEquals(-1, dirtyRegions.poll(1000, rects));
+    }
+}